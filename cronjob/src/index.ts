@@ -16,6 +16,8 @@ const SENSOR_PATHS = [
   "vibration",
   "humidity",
   "temperature",
+  "raw",
+  "alarm",
 ];
 
 // Records older than this many days will be deleted
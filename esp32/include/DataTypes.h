@@ -3,31 +3,94 @@
 
 #include <Arduino.h>
 
-// Sensor data structure to pass between tasks
+// Number of frequency bands in the sound features
+#define SOUND_BAND_COUNT 4
+
+// Analog channels (bit positions in SensorData::analogSampled)
+enum AnalogChannel {
+  ANALOG_LIGHT,
+  ANALOG_GAS,
+  ANALOG_FLAME,
+  ANALOG_SOIL_MOISTURE,
+  ANALOG_SOUND,
+  ANALOG_CHANNEL_COUNT
+};
+
+// Sensor data structure to pass between tasks (packed to 32 bytes on the
+// ESP32: it is copied through the sensor queue for every reading). The
+// wall-clock time is not stored: it is derived from timestamp once per
+// batch.
 struct SensorData {
   // Analog sensor values (12-bit ADC: 0-4095)
-  int lightValue;
-  int gasValue;
-  int flameValue;
-  int soilMoistureValue;
-  int soundValue;
+  uint16_t lightValue;
+  uint16_t gasValue;
+  uint16_t flameValue;
+  uint16_t soilMoistureValue;
+  uint16_t soundValue;
+
+  // Sound features over the reading interval (see SoundAnalyzer)
+  uint16_t soundRms;                     // RMS amplitude (ADC counts)
+  uint16_t soundPeak;                    // peak amplitude (ADC counts)
+  uint16_t soundZcr;                     // zero crossings per 1000 samples
+  uint16_t soundBands[SOUND_BAND_COUNT]; // per-mille of energy per band
+
+  // DHT11 sensor values in fixed point (tenths of °C / %RH)
+  int32_t temperatureTenths : 12;
+  uint32_t humidityTenths : 10;
 
-  // DHT11 sensor values
-  float temperature;
-  float humidity;
+  // Validity flags (set when the reading carries a fresh measurement)
+  uint32_t temperatureValid : 1;
+  uint32_t humidityValid : 1;
+
+  // Analog channels sampled for this reading (one bit per AnalogChannel);
+  // the others repeat their previous value
+  uint32_t analogSampled : ANALOG_CHANNEL_COUNT;
 
   // Timestamp when data was captured
   unsigned long timestamp;
 
-  // Validity flags
-  bool temperatureValid;
-  bool humidityValid;
-
   // Constructor with default values
   SensorData()
       : lightValue(0), gasValue(0), flameValue(0), soilMoistureValue(0),
-        soundValue(0), temperature(0.0f), humidity(0.0f), timestamp(0),
-        temperatureValid(false), humidityValid(false) {}
+        soundValue(0), soundRms(0), soundPeak(0), soundZcr(0),
+        soundBands(), temperatureTenths(0), humidityTenths(0),
+        temperatureValid(0), humidityValid(0), analogSampled(0),
+        timestamp(0) {}
+
+  // Fixed-point conversion
+  float getTemperature() const { return temperatureTenths / 10.0f; }
+  float getHumidity() const { return humidityTenths / 10.0f; }
+  void setTemperature(float celsius) {
+    temperatureTenths = (int32_t)lroundf(celsius * 10.0f);
+  }
+  void setHumidity(float percent) {
+    humidityTenths = (uint32_t)lroundf(percent * 10.0f);
+  }
+
+  bool isSampled(AnalogChannel channel) const {
+    return analogSampled & (1 << channel);
+  }
+};
+
+// Channels with a range in a SensorRecord: the analog channels, then
+// temperature and humidity (tenths)
+#define RECORD_TEMPERATURE ANALOG_CHANNEL_COUNT
+#define RECORD_HUMIDITY (ANALOG_CHANNEL_COUNT + 1)
+#define RECORD_CHANNEL_COUNT (ANALOG_CHANNEL_COUNT + 2)
+
+// What the sensor queue carries: one reading, or under backpressure
+// several adjacent readings merged into one (see ReadingBuffer). Merged,
+// data holds the per-channel means (rounded) and the capture time of the
+// first reading; the sums, counts and ranges below cover all merged
+// readings exactly.
+struct SensorRecord {
+  SensorData data;
+  unsigned long lastTimestamp; // capture time of the last reading
+  uint16_t readingCount;       // readings merged (1 for a plain reading)
+  uint16_t count[RECORD_CHANNEL_COUNT]; // samples per channel
+  int16_t min[RECORD_CHANNEL_COUNT];
+  int16_t max[RECORD_CHANNEL_COUNT];
+  int32_t sum[RECORD_CHANNEL_COUNT];
 };
 
 // Event types for digital sensors
@@ -38,8 +101,35 @@ struct EventData {
   EventType type;
   unsigned long timestamp;
 
-  EventData() : type(MOTION), timestamp(0) {}
-  EventData(EventType t, unsigned long ts) : type(t), timestamp(ts) {}
+  // Wall-clock time of detection (Unix ms), 0 if time was not synced yet
+  uint64_t epochMs;
+
+  // Edges seen since the previous event of this type (including this one)
+  uint16_t edgeCount;
+
+  EventData() : type(MOTION), timestamp(0), epochMs(0), edgeCount(1) {}
+  EventData(EventType t, unsigned long ts, uint16_t edges = 1)
+      : type(t), timestamp(ts), epochMs(0), edgeCount(edges) {}
+};
+
+// Alarm channel of the DHT11 temperature (after the analog channels)
+#define ALARM_TEMPERATURE ANALOG_CHANNEL_COUNT
+
+// Alarm record, sent by SensorTask on the priority path to CloudTask
+struct AlarmData {
+  uint8_t channel; // AnalogChannel or ALARM_TEMPERATURE
+  uint8_t cause;   // AlarmCause (see AlarmEvaluator)
+  bool active;     // true when raised, false when cleared
+  float value;     // sample that changed the state
+  float rate;      // change per second toward the alarm
+  unsigned long timestamp;
+
+  // Wall-clock time of the sample (Unix ms), 0 if time was not synced yet
+  uint64_t epochMs;
+
+  AlarmData()
+      : channel(0), cause(0), active(false), value(0.0f), rate(0.0f),
+        timestamp(0) {}
 };
 
 #endif // DATA_TYPES_H
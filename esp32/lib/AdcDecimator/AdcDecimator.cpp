@@ -0,0 +1,51 @@
+#include "AdcDecimator.h"
+
+AdcDecimator::AdcDecimator() {
+  for (uint8_t ch = 0; ch < ADC_DECIMATOR_CHANNELS; ch++) {
+    resetChannel(ch);
+  }
+}
+
+void AdcDecimator::process(const uint8_t *data, size_t length) {
+  for (size_t i = 0; i + 1 < length; i += 2) {
+    uint16_t word = data[i] | (data[i + 1] << 8);
+    addSample(word >> 12, word & 0x0FFF);
+  }
+}
+
+void AdcDecimator::addSample(uint8_t channel, uint16_t value) {
+  if (channel >= ADC_DECIMATOR_CHANNELS) {
+    return;
+  }
+
+  _sum[channel] += value;
+  _count[channel]++;
+  if (value < _min[channel]) {
+    _min[channel] = value;
+  }
+  if (value > _max[channel]) {
+    _max[channel] = value;
+  }
+}
+
+bool AdcDecimator::takeWindow(uint8_t channel, AdcWindow &window) {
+  if (channel >= ADC_DECIMATOR_CHANNELS || _count[channel] == 0) {
+    return false;
+  }
+
+  // Rounded mean of all oversampled readings
+  window.mean = (_sum[channel] + _count[channel] / 2) / _count[channel];
+  window.min = _min[channel];
+  window.max = _max[channel];
+  window.count = _count[channel];
+
+  resetChannel(channel);
+  return true;
+}
+
+void AdcDecimator::resetChannel(uint8_t channel) {
+  _sum[channel] = 0;
+  _count[channel] = 0;
+  _min[channel] = 0xFFFF;
+  _max[channel] = 0;
+}
@@ -0,0 +1,46 @@
+#ifndef ADC_DECIMATOR_H
+#define ADC_DECIMATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ADC1 has 8 channels, the DMA output carries the channel number per sample
+#define ADC_DECIMATOR_CHANNELS 8
+
+// Reduction of all samples one channel received during a window
+struct AdcWindow {
+  uint16_t mean;
+  uint16_t min;
+  uint16_t max;
+  uint32_t count;
+};
+
+// Demultiplexes the interleaved DMA sample stream into per-channel
+// accumulators and reduces each channel to mean/min/max per window.
+// Pure logic (no driver calls), so it can be fed recorded streams.
+class AdcDecimator {
+public:
+  // Constructor
+  AdcDecimator();
+
+  // Process raw DMA output: little-endian 16-bit words in "type 1"
+  // format (bits 0-11 sample, bits 12-15 channel)
+  void process(const uint8_t *data, size_t length);
+
+  // Add one already demultiplexed sample
+  void addSample(uint8_t channel, uint16_t value);
+
+  // Return the window of a channel and start a new one (false if empty)
+  bool takeWindow(uint8_t channel, AdcWindow &window);
+
+private:
+  uint64_t _sum[ADC_DECIMATOR_CHANNELS]; // no wrap on long windows
+  uint32_t _count[ADC_DECIMATOR_CHANNELS];
+  uint16_t _min[ADC_DECIMATOR_CHANNELS];
+  uint16_t _max[ADC_DECIMATOR_CHANNELS];
+
+  // Clear the accumulator of one channel
+  void resetChannel(uint8_t channel);
+};
+
+#endif // ADC_DECIMATOR_H
@@ -0,0 +1,89 @@
+#include "AlarmEvaluator.h"
+
+AlarmEvaluator::AlarmEvaluator() : _raiseCount(0) {
+  for (uint8_t i = 0; i < ALARM_MAX_CHANNELS; i++) {
+    _channels[i].configured = false;
+  }
+}
+
+void AlarmEvaluator::configure(uint8_t channel, const AlarmRule &rule) {
+  if (channel >= ALARM_MAX_CHANNELS) {
+    return;
+  }
+  Channel &c = _channels[channel];
+  c.rule = rule;
+  c.configured = true;
+  c.active = false;
+  c.cause = ALARM_CAUSE_LEVEL;
+  c.rate = 0.0f;
+  c.hasRef = false;
+  c.refValue = 0.0f;
+  c.refTime = 0;
+  c.raisedAt = 0;
+}
+
+AlarmTransition AlarmEvaluator::evaluate(uint8_t channel, float value,
+                                         uint32_t nowMs) {
+  if (channel >= ALARM_MAX_CHANNELS || !_channels[channel].configured) {
+    return ALARM_NONE;
+  }
+  Channel &c = _channels[channel];
+  const AlarmRule &rule = c.rule;
+
+  // Rate toward the alarm direction, updated once per rate window
+  if (!c.hasRef) {
+    c.hasRef = true;
+    c.refValue = value;
+    c.refTime = nowMs;
+  } else if (nowMs - c.refTime >= rule.rateWindowMs && nowMs != c.refTime) {
+    float change = rule.below ? c.refValue - value : value - c.refValue;
+    c.rate = change * 1000.0f / (nowMs - c.refTime);
+    c.refValue = value;
+    c.refTime = nowMs;
+  }
+
+  bool levelAlarm = rule.raiseLevel != ALARM_NO_LEVEL &&
+                    pastLevel(rule, value, rule.raiseLevel);
+  bool rateAlarm = rule.riseRate > 0.0f && c.rate >= rule.riseRate;
+
+  if (!c.active) {
+    if (levelAlarm || rateAlarm) {
+      c.active = true;
+      c.cause = levelAlarm ? ALARM_CAUSE_LEVEL : ALARM_CAUSE_RATE;
+      c.raisedAt = nowMs;
+      _raiseCount++;
+      return ALARM_RAISED;
+    }
+    return ALARM_NONE;
+  }
+
+  // Clear only once back past the clear level and no longer rising fast
+  bool levelClear = rule.raiseLevel == ALARM_NO_LEVEL ||
+                    !pastLevel(rule, value, rule.clearLevel);
+  bool rateClear = rule.riseRate <= 0.0f || c.rate < rule.riseRate / 2;
+  if (levelClear && rateClear && nowMs - c.raisedAt >= rule.holdMs) {
+    c.active = false;
+    return ALARM_CLEARED;
+  }
+  return ALARM_NONE;
+}
+
+bool AlarmEvaluator::isActive(uint8_t channel) const {
+  return channel < ALARM_MAX_CHANNELS && _channels[channel].active;
+}
+
+AlarmCause AlarmEvaluator::getCause(uint8_t channel) const {
+  return channel < ALARM_MAX_CHANNELS ? _channels[channel].cause
+                                      : ALARM_CAUSE_LEVEL;
+}
+
+float AlarmEvaluator::getRate(uint8_t channel) const {
+  return channel < ALARM_MAX_CHANNELS ? _channels[channel].rate : 0.0f;
+}
+
+uint32_t AlarmEvaluator::getRaiseCount() const { return _raiseCount; }
+
+bool AlarmEvaluator::pastLevel(const AlarmRule &rule, float value,
+                               float level) {
+  return rule.below ? value <= level : value >= level;
+}
@@ -0,0 +1,73 @@
+#ifndef ALARM_EVALUATOR_H
+#define ALARM_EVALUATOR_H
+
+#include <stdint.h>
+
+// Maximum number of channels with alarm rules
+#define ALARM_MAX_CHANNELS 8
+
+// Level that disables the level rule of a channel
+#define ALARM_NO_LEVEL -1.0f
+
+// What raised an alarm
+enum AlarmCause { ALARM_CAUSE_LEVEL, ALARM_CAUSE_RATE };
+
+// State change reported by AlarmEvaluator::evaluate()
+enum AlarmTransition { ALARM_NONE, ALARM_RAISED, ALARM_CLEARED };
+
+// Alarm rule of one channel. An alarm is raised when the value reaches
+// raiseLevel or moves toward it faster than riseRate (measured over
+// rateWindowMs). It clears once the value is back past clearLevel
+// (hysteresis), the rate has calmed down and holdMs have passed.
+struct AlarmRule {
+  float raiseLevel;      // alarm level, or ALARM_NO_LEVEL
+  float clearLevel;      // level the value must return past to clear
+  bool below;            // true if falling values are the alarm direction
+  float riseRate;        // change per second toward the alarm, 0 disables
+  uint32_t rateWindowMs; // time span the rate is measured over
+  uint32_t holdMs;       // minimum time an alarm stays raised
+};
+
+// Per-channel alarm rules (thresholds with hysteresis and rate of rise).
+// Pure logic, all times are passed in, so rules can be checked against
+// synthetic traces on the host.
+class AlarmEvaluator {
+public:
+  // Constructor
+  AlarmEvaluator();
+
+  // Set a channel's rule
+  void configure(uint8_t channel, const AlarmRule &rule);
+
+  // Feed a sample of a configured channel, returns the state change
+  AlarmTransition evaluate(uint8_t channel, float value, uint32_t nowMs);
+
+  // Current state of a channel and the cause/rate of its latest raise
+  bool isActive(uint8_t channel) const;
+  AlarmCause getCause(uint8_t channel) const;
+  float getRate(uint8_t channel) const;
+
+  // Number of alarms raised so far
+  uint32_t getRaiseCount() const;
+
+private:
+  struct Channel {
+    AlarmRule rule;
+    bool configured;
+    bool active;
+    AlarmCause cause;
+    float rate;       // latest rate toward the alarm (per second)
+    bool hasRef;
+    float refValue;   // start of the current rate window
+    uint32_t refTime;
+    uint32_t raisedAt;
+  };
+
+  Channel _channels[ALARM_MAX_CHANNELS];
+  uint32_t _raiseCount;
+
+  // True if value is at or past level in the alarm direction
+  static bool pastLevel(const AlarmRule &rule, float value, float level);
+};
+
+#endif // ALARM_EVALUATOR_H
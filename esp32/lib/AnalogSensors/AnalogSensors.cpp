@@ -1,48 +1,215 @@
 #include "AnalogSensors.h"
+#include <esp_timer.h>
 
-AnalogSensors::AnalogSensors() {
-  // Constructor
+static_assert(SOUND_ANALYZER_BANDS == SOUND_BAND_COUNT,
+              "Sound analyzer bands must match SensorData");
+
+// Channels scanned by the DMA pattern table
+static const adc1_channel_t SCAN_CHANNELS[] = {
+    LIGHT_SENSOR_CHANNEL, GAS_SENSOR_CHANNEL, FLAME_SENSOR_CHANNEL,
+    SOIL_MOISTURE_SENSOR_CHANNEL, SOUND_SENSOR_CHANNEL};
+static const int SCAN_CHANNEL_COUNT =
+    sizeof(SCAN_CHANNELS) / sizeof(SCAN_CHANNELS[0]);
+
+AnalogSensors::AnalogSensors()
+    : _lock(portMUX_INITIALIZER_UNLOCKED), _started(false), _overrunCount(0),
+      _soundAnalyzer(SOUND_SAMPLE_RATE_HZ), _soundEnergySum(0.0f),
+      _soundPeakMax(0.0f), _soundZcrSum(0.0f), _soundWindows(0),
+      _soundAnalysisMaxUs(0), _soundBudgetOverruns(0) {
+  for (int i = 0; i < ADC_DECIMATOR_CHANNELS; i++) {
+    _lastValue[i] = 0;
+  }
+  for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+    _soundBandSum[b] = 0.0f;
+  }
 }
 
 void AnalogSensors::begin() {
-  // ADC pins are input by default, no setup needed
-  Serial.println("Analog sensors initialized (ADC1 pins)");
-}
+  uint32_t channelMask = 0;
+  for (int i = 0; i < SCAN_CHANNEL_COUNT; i++) {
+    channelMask |= (1 << SCAN_CHANNELS[i]);
+  }
 
-int AnalogSensors::readLight() { return analogRead(LIGHT_SENSOR_PIN); }
+  // DMA driver: frames of ADC_FRAME_BYTES handed over per interrupt
+  adc_digi_init_config_t initConfig;
+  memset(&initConfig, 0, sizeof(initConfig));
+  initConfig.max_store_buf_size = ADC_DMA_BUFFER_BYTES;
+  initConfig.conv_num_each_intr = ADC_FRAME_BYTES;
+  initConfig.adc1_chan_mask = channelMask;
+  initConfig.adc2_chan_mask = 0;
 
-int AnalogSensors::readGas() { return analogRead(GAS_SENSOR_PIN); }
+  esp_err_t err = adc_digi_initialize(&initConfig);
+  if (err != ESP_OK) {
+    Serial.printf("ADC DMA init failed: %s\n", esp_err_to_name(err));
+    return;
+  }
 
-int AnalogSensors::readFlame() { return analogRead(FLAME_SENSOR_PIN); }
+  // Pattern table: scan the 5 channels round-robin at full 12-bit width
+  adc_digi_pattern_config_t pattern[SOC_ADC_PATT_LEN_MAX];
+  memset(pattern, 0, sizeof(pattern));
+  for (int i = 0; i < SCAN_CHANNEL_COUNT; i++) {
+    pattern[i].atten = ADC_ATTEN_DB_11; // full 0-3.3V range
+    pattern[i].channel = SCAN_CHANNELS[i];
+    pattern[i].unit = 0; // ADC1
+    pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
 
-int AnalogSensors::readSoilMoisture() {
-  return analogRead(SOIL_MOISTURE_SENSOR_PIN);
+  adc_digi_configuration_t config;
+  memset(&config, 0, sizeof(config));
+  config.conv_limit_en = true; // required on ESP32
+  config.conv_limit_num = 250;
+  config.pattern_num = SCAN_CHANNEL_COUNT;
+  config.adc_pattern = pattern;
+  config.sample_freq_hz = ADC_SAMPLE_RATE_HZ;
+  config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+  err = adc_digi_controller_configure(&config);
+  if (err == ESP_OK) {
+    err = adc_digi_start();
+  }
+  if (err != ESP_OK) {
+    Serial.printf("ADC DMA start failed: %s\n", esp_err_to_name(err));
+    return;
+  }
+
+  _started = true;
+  Serial.printf("Analog sensors initialized (ADC1 DMA, %d Hz per channel)\n",
+                ADC_SAMPLE_RATE_HZ / SCAN_CHANNEL_COUNT);
 }
 
-int AnalogSensors::readSoundValue() {
-  unsigned long startTime = millis();
-  int minValue = 4095;
-  int maxValue = 0;
-
-  // Sample for 100ms with periodic yields to prevent watchdog
-  while (millis() - startTime < SOUND_SAMPLING_DURATION_MS) {
-    int currentValue = analogRead(SOUND_SENSOR_PIN);
-    if (currentValue < minValue) {
-      minValue = currentValue;
+void AnalogSensors::processSamples() {
+  if (!_started) {
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    return;
+  }
+
+  uint8_t frame[ADC_FRAME_BYTES];
+  uint32_t length = 0;
+
+  // Blocks until the DMA hands over a frame
+  esp_err_t err = adc_digi_read_bytes(frame, sizeof(frame), &length, 100);
+  if (err == ESP_ERR_INVALID_STATE) {
+    // Driver buffer overflowed, data is still returned
+    _overrunCount++;
+  } else if (err != ESP_OK) {
+    return;
+  }
+
+  portENTER_CRITICAL(&_lock);
+  _decimator.process(frame, length);
+  portEXIT_CRITICAL(&_lock);
+
+  // Feed the sound channel to the feature extractor (outside the lock,
+  // window analysis takes up to SOUND_ANALYSIS_BUDGET_US)
+  for (uint32_t i = 0; i + 1 < length; i += 2) {
+    uint16_t word = frame[i] | (frame[i + 1] << 8);
+    if ((word >> 12) != SOUND_SENSOR_CHANNEL) {
+      continue;
     }
-    if (currentValue > maxValue) {
-      maxValue = currentValue;
+
+    int64_t start = esp_timer_get_time();
+    if (!_soundAnalyzer.addSample(word & 0x0FFF)) {
+      continue;
+    }
+    uint32_t elapsed = esp_timer_get_time() - start;
+    if (elapsed > _soundAnalysisMaxUs) {
+      _soundAnalysisMaxUs = elapsed;
+    }
+    if (elapsed > SOUND_ANALYSIS_BUDGET_US) {
+      _soundBudgetOverruns++;
     }
 
-    // Yield to other tasks periodically (every ~10 samples)
-    // This prevents watchdog timer from triggering
-    taskYIELD();
+    const SoundFeatures &features = _soundAnalyzer.getFeatures();
+    portENTER_CRITICAL(&_lock);
+    _soundEnergySum += features.rms * features.rms;
+    if (features.peak > _soundPeakMax) {
+      _soundPeakMax = features.peak;
+    }
+    _soundZcrSum += features.zcr;
+    for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+      _soundBandSum[b] += features.bandEnergy[b];
+    }
+    _soundWindows++;
+    portEXIT_CRITICAL(&_lock);
   }
+}
 
-  // Calculate peak-to-peak value
-  int value = maxValue - minValue;
+int AnalogSensors::readLight() { return readMean(LIGHT_SENSOR_CHANNEL); }
 
-  Serial.printf("Sound: min=%d, max=%d, value=%d\n", minValue, maxValue, value);
+int AnalogSensors::readGas() { return readMean(GAS_SENSOR_CHANNEL); }
+
+int AnalogSensors::readFlame() { return readMean(FLAME_SENSOR_CHANNEL); }
+
+int AnalogSensors::readSoilMoisture() {
+  return readMean(SOIL_MOISTURE_SENSOR_CHANNEL);
+}
+
+int AnalogSensors::readSoundValue() {
+  AdcWindow window;
+  if (!takeWindow(SOUND_SENSOR_CHANNEL, window)) {
+    return _lastValue[SOUND_SENSOR_CHANNEL];
+  }
+
+  // Calculate peak-to-peak value over the whole window
+  int value = window.max - window.min;
+  _lastValue[SOUND_SENSOR_CHANNEL] = value;
+
+  Serial.printf("Sound: min=%d, max=%d, value=%d (%u samples)\n", window.min,
+                window.max, value, window.count);
 
   return value;
 }
+
+void AnalogSensors::readSoundFeatures(SensorData &data) {
+  portENTER_CRITICAL(&_lock);
+  float energySum = _soundEnergySum;
+  float peakMax = _soundPeakMax;
+  float zcrSum = _soundZcrSum;
+  float bandSum[SOUND_BAND_COUNT];
+  for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+    bandSum[b] = _soundBandSum[b];
+    _soundBandSum[b] = 0.0f;
+  }
+  uint32_t windows = _soundWindows;
+  _soundEnergySum = 0.0f;
+  _soundPeakMax = 0.0f;
+  _soundZcrSum = 0.0f;
+  _soundWindows = 0;
+  portEXIT_CRITICAL(&_lock);
+
+  if (windows == 0) {
+    return;
+  }
+
+  // RMS over the interval is the root of the mean window energy
+  data.soundRms = (uint16_t)(sqrtf(energySum / windows) + 0.5f);
+  data.soundPeak = (uint16_t)(peakMax + 0.5f);
+  data.soundZcr = (uint16_t)(zcrSum / windows * 1000.0f + 0.5f);
+  for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+    data.soundBands[b] = (uint16_t)(bandSum[b] / windows * 1000.0f + 0.5f);
+  }
+}
+
+uint32_t AnalogSensors::getOverrunCount() { return _overrunCount; }
+
+uint32_t AnalogSensors::getSoundAnalysisMaxUs() { return _soundAnalysisMaxUs; }
+
+uint32_t AnalogSensors::getSoundBudgetOverruns() {
+  return _soundBudgetOverruns;
+}
+
+bool AnalogSensors::takeWindow(adc1_channel_t channel, AdcWindow &window) {
+  portENTER_CRITICAL(&_lock);
+  bool available = _decimator.takeWindow(channel, window);
+  portEXIT_CRITICAL(&_lock);
+  return available;
+}
+
+int AnalogSensors::readMean(adc1_channel_t channel) {
+  AdcWindow window;
+  if (takeWindow(channel, window)) {
+    _lastValue[channel] = window.mean;
+  }
+  return _lastValue[channel];
+}
@@ -1,7 +1,11 @@
 #ifndef ANALOG_SENSORS_H
 #define ANALOG_SENSORS_H
 
+#include "../../include/DataTypes.h"
+#include "AdcDecimator.h"
+#include "SoundAnalyzer.h"
 #include <Arduino.h>
+#include <driver/adc.h>
 
 // Pin definitions for analog sensors (ADC1 only - WiFi safe)
 #define LIGHT_SENSOR_PIN 36         // ADC1_CH0
@@ -10,28 +14,89 @@
 #define SOIL_MOISTURE_SENSOR_PIN 35 // ADC1_CH7
 #define SOUND_SENSOR_PIN 32         // ADC1_CH4
 
-// Sound sensor sampling window duration (100ms)
-#define SOUND_SAMPLING_DURATION_MS 100
+// ADC1 channels scanned by the DMA controller (same order as pins above)
+#define LIGHT_SENSOR_CHANNEL ADC1_CHANNEL_0
+#define GAS_SENSOR_CHANNEL ADC1_CHANNEL_3
+#define FLAME_SENSOR_CHANNEL ADC1_CHANNEL_6
+#define SOIL_MOISTURE_SENSOR_CHANNEL ADC1_CHANNEL_7
+#define SOUND_SENSOR_CHANNEL ADC1_CHANNEL_4
+
+// Continuous sampling configuration. The rate is the total conversion
+// rate across all channels (20 kHz minimum on ESP32), so each of the 5
+// channels is sampled at ADC_SAMPLE_RATE_HZ / 5
+#define ADC_SAMPLE_RATE_HZ 20000
+#define ADC_FRAME_BYTES 256       // bytes per DMA transfer (128 samples)
+#define ADC_DMA_BUFFER_BYTES 4096 // driver-side buffer between frames
+
+// Per-channel rate of the sound stream fed to the sound analyzer
+#define SOUND_SAMPLE_RATE_HZ (ADC_SAMPLE_RATE_HZ / 5)
+
+// CPU budget for analyzing one sound window (64 ms of audio at 4 kHz):
+// 2 ms per window keeps sound analysis around 3% of Core 1
+#define SOUND_ANALYSIS_BUDGET_US 2000
 
 class AnalogSensors {
 public:
   // Constructor
   AnalogSensors();
 
-  // Initialize sensors (if needed)
+  // Configure and start continuous DMA sampling of all channels
   void begin();
 
-  // Read individual sensor values
+  // Wait for the next DMA frame and fold it into the channel windows
+  // (call in a loop from the ADC task)
+  void processSamples();
+
+  // Read individual sensor values (mean of all samples since last read)
   int readLight();
   int readGas();
   int readFlame();
   int readSoilMoisture();
 
-  // Read sound value over sampling window (non-blocking with yields)
+  // Read sound value (peak-to-peak of all samples since last read)
   int readSoundValue();
 
+  // Fill the sound feature fields of data (averaged over all windows
+  // analyzed since last read)
+  void readSoundFeatures(SensorData &data);
+
+  // Number of DMA overruns (samples lost because processing fell behind)
+  uint32_t getOverrunCount();
+
+  // Slowest sound window analysis and windows over SOUND_ANALYSIS_BUDGET_US
+  uint32_t getSoundAnalysisMaxUs();
+  uint32_t getSoundBudgetOverruns();
+
 private:
-  // No state needed for basic analog reads
+  // Per-channel decimation, shared between ADC task and readers
+  AdcDecimator _decimator;
+  portMUX_TYPE _lock;
+
+  bool _started;
+  uint32_t _overrunCount;
+
+  // Last reported values (returned again if a window is empty)
+  int _lastValue[ADC_DECIMATOR_CHANNELS];
+
+  // Sound feature extraction (runs in the ADC task)
+  SoundAnalyzer _soundAnalyzer;
+
+  // Sound features accumulated since last read (guarded by _lock)
+  float _soundEnergySum;
+  float _soundPeakMax;
+  float _soundZcrSum;
+  float _soundBandSum[SOUND_BAND_COUNT];
+  uint32_t _soundWindows;
+
+  // Sound analysis CPU usage
+  uint32_t _soundAnalysisMaxUs;
+  uint32_t _soundBudgetOverruns;
+
+  // Take a channel's window under the lock
+  bool takeWindow(adc1_channel_t channel, AdcWindow &window);
+
+  // Mean of a channel's window (falls back to the last value)
+  int readMean(adc1_channel_t channel);
 };
 
 #endif // ANALOG_SENSORS_H
@@ -0,0 +1,70 @@
+#include "BatchController.h"
+
+// Smoothing of round trip and failure rate (weight of a new sample, as a
+// shift: 1/8 like TCP's SRTT)
+#define BATCH_SMOOTHING_SHIFT 3
+
+// Failure rate scale (1.0)
+#define BATCH_RATE_ONE 65536
+
+static uint32_t clampMs(uint64_t value, uint32_t low, uint32_t high) {
+  if (value < low) {
+    return low;
+  }
+  if (value > high) {
+    return high;
+  }
+  return (uint32_t)value;
+}
+
+BatchController::BatchController(const BatchBounds &bounds)
+    : _bounds(bounds), _hasRtt(false), _srtt(0), _failureRate(0),
+      _backlog(0), _flushMs(bounds.minFlushMs), _drainMs(bounds.minDrainMs) {}
+
+void BatchController::addRoundTrip(uint32_t rttMs) {
+  if (!_hasRtt) {
+    _srtt = rttMs;
+    _hasRtt = true;
+  } else {
+    int32_t error = (int32_t)(rttMs - _srtt);
+    _srtt += error / (1 << BATCH_SMOOTHING_SHIFT);
+  }
+  addResult(false);
+}
+
+void BatchController::addFailure() { addResult(true); }
+
+void BatchController::update(uint8_t backlogPercent) {
+  _backlog = backlogPercent > 100 ? 100 : backlogPercent;
+
+  // About one request per round trip, stretched up to 4x as failures
+  // approach 100%
+  uint64_t pace =
+      _srtt + ((uint64_t)_srtt * 3 * _failureRate) / BATCH_RATE_ONE;
+
+  // A backed up queue: batch events up to 3x longer, and slow the
+  // offline catch-up down to a fifth so live data goes first
+  _flushMs = clampMs(pace * (100 + 2 * _backlog) / 100, _bounds.minFlushMs,
+                     _bounds.maxFlushMs);
+  _drainMs = clampMs(2 * pace * (100 + 4 * _backlog) / 100,
+                     _bounds.minDrainMs, _bounds.maxDrainMs);
+}
+
+uint32_t BatchController::getFlushMs() const { return _flushMs; }
+
+uint32_t BatchController::getDrainMs() const { return _drainMs; }
+
+uint32_t BatchController::getSmoothedRtt() const { return _srtt; }
+
+uint8_t BatchController::getFailurePercent() const {
+  return (uint8_t)((_failureRate * 100 + BATCH_RATE_ONE / 2) /
+                   BATCH_RATE_ONE);
+}
+
+uint8_t BatchController::getBacklogPercent() const { return _backlog; }
+
+void BatchController::addResult(bool failed) {
+  int32_t target = failed ? BATCH_RATE_ONE : 0;
+  int32_t error = target - (int32_t)_failureRate;
+  _failureRate += error / (1 << BATCH_SMOOTHING_SHIFT);
+}
@@ -0,0 +1,58 @@
+#ifndef BATCH_CONTROLLER_H
+#define BATCH_CONTROLLER_H
+
+#include <stdint.h>
+
+// Bounds of the batching decisions
+struct BatchBounds {
+  uint32_t minFlushMs; // shortest wait before events go on their own
+  uint32_t maxFlushMs;
+  uint32_t minDrainMs; // shortest interval between offline log uploads
+  uint32_t maxDrainMs;
+};
+
+// Adapts two timings to the link at runtime: how long events wait to be
+// flushed together, and the interval between offline log uploads. Both
+// follow the smoothed round trip, so a slow link sends events in fewer,
+// larger batches and a fast one with low latency. Failures stretch them
+// further, and a backed up queue makes events wait longer and the offline
+// catch-up yield to live data. The upload window size and the summary
+// window stay fixed. Pure logic, so it can be driven by a simulated link
+// on the host.
+class BatchController {
+public:
+  // Constructor
+  BatchController(const BatchBounds &bounds);
+
+  // Report an acknowledged request and its round trip
+  void addRoundTrip(uint32_t rttMs);
+
+  // Report a failed request
+  void addFailure();
+
+  // Recompute the decisions with the fullest queue at backlogPercent
+  void update(uint8_t backlogPercent);
+
+  // Current decisions
+  uint32_t getFlushMs() const;
+  uint32_t getDrainMs() const;
+
+  // Inputs as smoothed: round trip (ms), failure rate and backlog (%)
+  uint32_t getSmoothedRtt() const;
+  uint8_t getFailurePercent() const;
+  uint8_t getBacklogPercent() const;
+
+private:
+  BatchBounds _bounds;
+  bool _hasRtt;
+  uint32_t _srtt;        // smoothed round trip (ms)
+  uint32_t _failureRate; // smoothed failure rate, 1/65536 units
+  uint8_t _backlog;
+  uint32_t _flushMs;
+  uint32_t _drainMs;
+
+  // Fold one result (failed or not) into the failure rate
+  void addResult(bool failed);
+};
+
+#endif // BATCH_CONTROLLER_H
@@ -0,0 +1,66 @@
+#include "DhtDecoder.h"
+
+DhtStatus decodeDhtPulses(const DhtPulse *pulses, size_t count,
+                          DhtSample &sample) {
+  // Find the last DHT_FRAME_BITS high pulses, each preceded by a low one
+  size_t highCount = 0;
+  size_t first = count;
+  while (first > 0 && highCount < DHT_FRAME_BITS) {
+    first--;
+    if (pulses[first].level && first > 0 && !pulses[first - 1].level) {
+      highCount++;
+    }
+  }
+  if (highCount < DHT_FRAME_BITS) {
+    return DHT_ERROR_TIMEOUT;
+  }
+
+  uint8_t bytes[DHT_FRAME_BITS / 8] = {0};
+  int bit = 0;
+  for (size_t i = first; i < count && bit < DHT_FRAME_BITS; i++) {
+    if (!pulses[i].level || pulses[i - 1].level) {
+      continue;
+    }
+
+    uint16_t low = pulses[i - 1].durationUs;
+    uint16_t high = pulses[i].durationUs;
+    if (low < DHT_MIN_PULSE_US || low > DHT_MAX_PULSE_US ||
+        high < DHT_MIN_PULSE_US || high > DHT_MAX_PULSE_US) {
+      return DHT_ERROR_TIMING;
+    }
+
+    bytes[bit / 8] <<= 1;
+    if (high > DHT_BIT_THRESHOLD_US) {
+      bytes[bit / 8] |= 1;
+    }
+    bit++;
+  }
+
+  uint8_t checksum = bytes[0] + bytes[1] + bytes[2] + bytes[3];
+  if (checksum != bytes[4]) {
+    return DHT_ERROR_CHECKSUM;
+  }
+
+  // DHT11: integral and decimal bytes, sign in bit 7 of the temperature
+  // decimal byte
+  sample.humidity = bytes[0] + bytes[1] * 0.1f;
+  sample.temperature = bytes[2] + (bytes[3] & 0x7F) * 0.1f;
+  if (bytes[3] & 0x80) {
+    sample.temperature = -sample.temperature;
+  }
+  return DHT_OK;
+}
+
+const char *dhtStatusName(DhtStatus status) {
+  switch (status) {
+  case DHT_OK:
+    return "ok";
+  case DHT_ERROR_TIMEOUT:
+    return "timeout";
+  case DHT_ERROR_TIMING:
+    return "bad timing";
+  case DHT_ERROR_CHECKSUM:
+    return "checksum mismatch";
+  }
+  return "unknown";
+}
@@ -0,0 +1,45 @@
+#ifndef DHT_DECODER_H
+#define DHT_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One DHT frame carries 5 bytes: humidity, temperature, checksum
+#define DHT_FRAME_BITS 40
+
+// Bit timing (µs): every bit starts with ~50 µs low, followed by
+// ~26 µs high for a 0 or ~70 µs high for a 1
+#define DHT_BIT_THRESHOLD_US 48
+#define DHT_MIN_PULSE_US 10
+#define DHT_MAX_PULSE_US 110
+
+// One level of the captured line and how long it was held
+struct DhtPulse {
+  uint8_t level;
+  uint16_t durationUs;
+};
+
+// Result of decoding one capture
+enum DhtStatus {
+  DHT_OK,
+  DHT_ERROR_TIMEOUT,  // no or incomplete response
+  DHT_ERROR_TIMING,   // pulse outside the protocol timing
+  DHT_ERROR_CHECKSUM, // bits received but checksum mismatch
+};
+
+// Decoded DHT11 measurement
+struct DhtSample {
+  float temperature; // °C
+  float humidity;    // %RH
+};
+
+// Decode a captured DHT11 pulse train. The capture may start anywhere
+// before the sensor's response; the data bits are the last 40 high
+// pulses. Pure logic, so it can be fed recorded timing traces.
+DhtStatus decodeDhtPulses(const DhtPulse *pulses, size_t count,
+                          DhtSample &sample);
+
+// Human readable status for logs
+const char *dhtStatusName(DhtStatus status);
+
+#endif // DHT_DECODER_H
@@ -0,0 +1,141 @@
+#include "DhtReader.h"
+
+// Two pulses per RMT item, a full frame is 43 items
+#define DHT_MAX_PULSES 96
+
+DhtReader::DhtReader()
+    : _ringbuf(NULL), _started(false), _lock(portMUX_INITIALIZER_UNLOCKED),
+      _sampleTime(0), _hasSample(false), _readCount(0), _errorCount(0),
+      _lastStatus(DHT_ERROR_TIMEOUT) {
+  _sample.temperature = 0.0f;
+  _sample.humidity = 0.0f;
+}
+
+bool DhtReader::begin() {
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)DHT_SENSOR_PIN,
+                                              DHT_RMT_CHANNEL);
+  config.clk_div = 80; // 1 µs per tick
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = 100; // ignore glitches < 1.25 µs
+  config.rx_config.idle_threshold = DHT_IDLE_THRESHOLD_US;
+
+  esp_err_t err = rmt_config(&config);
+  if (err == ESP_OK) {
+    err = rmt_driver_install(DHT_RMT_CHANNEL, 1024, 0);
+  }
+  if (err == ESP_OK) {
+    err = rmt_get_ringbuf_handle(DHT_RMT_CHANNEL, &_ringbuf);
+  }
+  if (err != ESP_OK) {
+    Serial.printf("DHT11 RMT init failed: %s\n", esp_err_to_name(err));
+    return false;
+  }
+
+  // Idle line is high (open drain with pull-up)
+  gpio_set_pull_mode((gpio_num_t)DHT_SENSOR_PIN, GPIO_PULLUP_ONLY);
+  gpio_set_level((gpio_num_t)DHT_SENSOR_PIN, 1);
+
+  _started = true;
+  Serial.println("DHT11 sensor initialized (RMT capture).");
+  return true;
+}
+
+DhtStatus DhtReader::acquire() {
+  if (!_started) {
+    return DHT_ERROR_TIMEOUT;
+  }
+
+  // Drop a frame that completed after an earlier timeout
+  size_t length = 0;
+  void *stale;
+  while ((stale = xRingbufferReceive(_ringbuf, &length, 0)) != NULL) {
+    vRingbufferReturnItem(_ringbuf, stale);
+  }
+
+  // Start signal: pull the line low, then release it to the pull-up
+  gpio_num_t pin = (gpio_num_t)DHT_SENSOR_PIN;
+  gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_level(pin, 0);
+  vTaskDelay(pdMS_TO_TICKS(DHT_START_SIGNAL_MS));
+  gpio_set_level(pin, 1);
+  gpio_set_direction(pin, GPIO_MODE_INPUT);
+
+  // Capture the response in hardware; the sensor answers within 40 µs
+  rmt_rx_start(DHT_RMT_CHANNEL, true);
+
+  rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(
+      _ringbuf, &length, pdMS_TO_TICKS(DHT_RESPONSE_TIMEOUT_MS));
+  rmt_rx_stop(DHT_RMT_CHANNEL);
+
+  DhtStatus status = DHT_ERROR_TIMEOUT;
+  if (items != NULL) {
+    status = decodeItems(items, length / sizeof(rmt_item32_t));
+    vRingbufferReturnItem(_ringbuf, items);
+  }
+
+  _readCount++;
+  _lastStatus = status;
+  if (status != DHT_OK) {
+    _errorCount++;
+    Serial.printf("DHT11 read failed: %s\n", dhtStatusName(status));
+  }
+  return status;
+}
+
+DhtStatus DhtReader::decodeItems(const rmt_item32_t *items,
+                                 size_t itemCount) {
+  // Flatten items into pulses, a zero duration marks the end of capture
+  DhtPulse pulses[DHT_MAX_PULSES];
+  size_t count = 0;
+  for (size_t i = 0; i < itemCount && count + 2 <= DHT_MAX_PULSES; i++) {
+    if (items[i].duration0 == 0) {
+      break;
+    }
+    pulses[count].level = items[i].level0;
+    pulses[count++].durationUs = items[i].duration0;
+    if (items[i].duration1 == 0) {
+      break;
+    }
+    pulses[count].level = items[i].level1;
+    pulses[count++].durationUs = items[i].duration1;
+  }
+
+  DhtSample sample;
+  DhtStatus status = decodeDhtPulses(pulses, count, sample);
+  if (status == DHT_OK) {
+    portENTER_CRITICAL(&_lock);
+    _sample = sample;
+    _sampleTime = millis();
+    _hasSample = true;
+    portEXIT_CRITICAL(&_lock);
+  }
+  return status;
+}
+
+bool DhtReader::getCached(bool temperature, float &value, uint32_t &ageMs) {
+  portENTER_CRITICAL(&_lock);
+  bool hasSample = _hasSample;
+  value = temperature ? _sample.temperature : _sample.humidity;
+  unsigned long sampleTime = _sampleTime;
+  portEXIT_CRITICAL(&_lock);
+
+  if (!hasSample) {
+    return false;
+  }
+  ageMs = millis() - sampleTime;
+  return ageMs <= DHT_MAX_AGE_MS;
+}
+
+bool DhtReader::getTemperature(float &value, uint32_t &ageMs) {
+  return getCached(true, value, ageMs);
+}
+
+bool DhtReader::getHumidity(float &value, uint32_t &ageMs) {
+  return getCached(false, value, ageMs);
+}
+
+uint32_t DhtReader::getReadCount() { return _readCount; }
+
+uint32_t DhtReader::getErrorCount() { return _errorCount; }
+
+DhtStatus DhtReader::getLastStatus() { return _lastStatus; }
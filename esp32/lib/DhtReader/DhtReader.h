@@ -0,0 +1,75 @@
+#ifndef DHT_READER_H
+#define DHT_READER_H
+
+#include "DhtDecoder.h"
+#include <Arduino.h>
+#include <driver/rmt.h>
+
+// DHT11 data pin and the RMT channel capturing it
+#define DHT_SENSOR_PIN 18
+#define DHT_RMT_CHANNEL RMT_CHANNEL_4
+
+// DHT11 can't be polled faster than 1 Hz; 2 s leaves margin
+#define DHT_READ_INTERVAL_MS 2000
+
+// Host start signal (DHT11 needs at least 18 ms low)
+#define DHT_START_SIGNAL_MS 20
+
+// A frame takes ~5 ms; give up after this long without one
+#define DHT_RESPONSE_TIMEOUT_MS 20
+
+// Line idle this long (µs) ends the capture
+#define DHT_IDLE_THRESHOLD_US 1000
+
+// Cached values older than this are reported as invalid
+#define DHT_MAX_AGE_MS 10000
+
+// Asynchronous DHT11 reader. The RMT peripheral captures the pulse train
+// in hardware (no bit-banging with interrupts disabled), the background
+// DHT task decodes it and caches the latest valid measurement. Readers
+// only ever touch the cache.
+class DhtReader {
+public:
+  // Constructor
+  DhtReader();
+
+  // Configure the RMT receiver, returns false on driver errors
+  bool begin();
+
+  // Run one measurement: start signal, capture, decode, update the cache.
+  // Blocks the calling task for ~25 ms (yielding), called by the DHT task.
+  DhtStatus acquire();
+
+  // Latest valid temperature (°C) and its age, false if none or stale
+  bool getTemperature(float &value, uint32_t &ageMs);
+
+  // Latest valid humidity (%RH) and its age, false if none or stale
+  bool getHumidity(float &value, uint32_t &ageMs);
+
+  // Measurement statistics
+  uint32_t getReadCount();
+  uint32_t getErrorCount();
+  DhtStatus getLastStatus();
+
+private:
+  RingbufHandle_t _ringbuf;
+  bool _started;
+
+  // Cache of the latest valid sample (guarded by _lock)
+  portMUX_TYPE _lock;
+  DhtSample _sample;
+  unsigned long _sampleTime;
+  bool _hasSample;
+
+  uint32_t _readCount;
+  uint32_t _errorCount;
+  DhtStatus _lastStatus;
+
+  // Decode RMT items into the cache
+  DhtStatus decodeItems(const rmt_item32_t *items, size_t itemCount);
+
+  // Copy a cached value out under the lock
+  bool getCached(bool temperature, float &value, uint32_t &ageMs);
+};
+
+#endif // DHT_READER_H
@@ -1,17 +1,18 @@
 #include "DigitalSensors.h"
+#include <esp_timer.h>
 
-// Initialize static member
-TaskHandle_t DigitalSensors::_sensorTaskHandle = NULL;
+// Initialize static members
+TaskHandle_t DigitalSensors::_eventTaskHandle = NULL;
+EdgeRecord DigitalSensors::_edges[EDGE_BUFFER_SIZE];
+std::atomic<uint32_t> DigitalSensors::_edgeHead(0);
+std::atomic<uint32_t> DigitalSensors::_edgeTail(0);
+volatile uint32_t DigitalSensors::_edgeOverflows = 0;
 
-DigitalSensors::DigitalSensors() : _dht(DHT_SENSOR_PIN, DHTTYPE) {
+DigitalSensors::DigitalSensors() {
   // Constructor
 }
 
 void DigitalSensors::begin() {
-  // Initialize DHT11 sensor
-  _dht.begin();
-  Serial.println("DHT11 sensor initialized.");
-
   // Initialize PIR sensor pin
   pinMode(PIR_SENSOR_PIN, INPUT);
   Serial.println("PIR sensor initialized.");
@@ -21,8 +22,8 @@ void DigitalSensors::begin() {
   Serial.println("Vibration sensor initialized.");
 }
 
-void DigitalSensors::setupInterrupts(TaskHandle_t sensorTaskHandle) {
-  _sensorTaskHandle = sensorTaskHandle;
+void DigitalSensors::setupInterrupts(TaskHandle_t eventTaskHandle) {
+  _eventTaskHandle = eventTaskHandle;
 
   // Attach interrupts for digital sensors (rising edge)
   attachInterrupt(digitalPinToInterrupt(PIR_SENSOR_PIN), pirISR, RISING);
@@ -32,38 +33,43 @@ void DigitalSensors::setupInterrupts(TaskHandle_t sensorTaskHandle) {
   Serial.println("Digital sensor interrupts attached.");
 }
 
-float DigitalSensors::readTemperature() { return _dht.readTemperature(); }
-
-float DigitalSensors::readHumidity() { return _dht.readHumidity(); }
+bool DigitalSensors::popEdge(EdgeRecord &edge) {
+  uint32_t tail = _edgeTail.load(std::memory_order_relaxed);
+  if (tail == _edgeHead.load(std::memory_order_acquire)) {
+    return false;
+  }
 
-bool DigitalSensors::isValidReading(float value) { return !isnan(value); }
+  edge = _edges[tail % EDGE_BUFFER_SIZE];
+  _edgeTail.store(tail + 1, std::memory_order_release);
+  return true;
+}
 
-DHT &DigitalSensors::getDHT() { return _dht; }
+uint32_t DigitalSensors::getEdgeOverflows() { return _edgeOverflows; }
 
 // ISR for PIR motion sensor
-void IRAM_ATTR DigitalSensors::pirISR() {
-  if (_sensorTaskHandle != NULL) {
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-
-    // Notify sensor task about motion event
-    xTaskNotifyFromISR(_sensorTaskHandle, MOTION_EVENT_BIT, eSetBits,
-                       &xHigherPriorityTaskWoken);
+void IRAM_ATTR DigitalSensors::pirISR() { recordEdge(MOTION); }
 
-    // Yield if a higher priority task was woken
-    if (xHigherPriorityTaskWoken) {
-      portYIELD_FROM_ISR();
-    }
+// ISR for vibration sensor
+void IRAM_ATTR DigitalSensors::vibrationISR() { recordEdge(VIBRATION); }
+
+void IRAM_ATTR DigitalSensors::recordEdge(EventType type) {
+  // Timestamp first, so queueing overhead does not skew it
+  int64_t now = esp_timer_get_time();
+
+  uint32_t head = _edgeHead.load(std::memory_order_relaxed);
+  if (head - _edgeTail.load(std::memory_order_acquire) >= EDGE_BUFFER_SIZE) {
+    _edgeOverflows++;
+  } else {
+    _edges[head % EDGE_BUFFER_SIZE].type = type;
+    _edges[head % EDGE_BUFFER_SIZE].timestampUs = now;
+    _edgeHead.store(head + 1, std::memory_order_release);
   }
-}
 
-// ISR for vibration sensor
-void IRAM_ATTR DigitalSensors::vibrationISR() {
-  if (_sensorTaskHandle != NULL) {
+  if (_eventTaskHandle != NULL) {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
-    // Notify sensor task about vibration event
-    xTaskNotifyFromISR(_sensorTaskHandle, VIBRATION_EVENT_BIT, eSetBits,
-                       &xHigherPriorityTaskWoken);
+    // Wake the event task to drain the ring buffer
+    vTaskNotifyGiveFromISR(_eventTaskHandle, &xHigherPriorityTaskWoken);
 
     // Yield if a higher priority task was woken
     if (xHigherPriorityTaskWoken) {
@@ -3,17 +3,20 @@
 
 #include "../../include/DataTypes.h"
 #include <Arduino.h>
-#include <DHT.h>
+#include <atomic>
 
 // Pin definitions
 #define PIR_SENSOR_PIN 23
 #define VIBRATION_SENSOR_PIN 19
-#define DHT_SENSOR_PIN 18
-#define DHTTYPE DHT11
 
-// Task notification bits for events
-#define MOTION_EVENT_BIT (1 << 0)
-#define VIBRATION_EVENT_BIT (1 << 1)
+// Edge ring buffer capacity (must be a power of two)
+#define EDGE_BUFFER_SIZE 64
+
+// One rising edge captured in an ISR
+struct EdgeRecord {
+  EventType type;
+  int64_t timestampUs; // esp_timer_get_time() at the edge
+};
 
 class DigitalSensors {
 public:
@@ -23,30 +26,33 @@ public:
   // Initialize sensors and setup interrupts
   void begin();
 
-  // Setup interrupts with task handle for notifications
-  void setupInterrupts(TaskHandle_t sensorTaskHandle);
-
-  // Read DHT11 temperature
-  float readTemperature();
+  // Setup interrupts with the handle of the task consuming edges
+  void setupInterrupts(TaskHandle_t eventTaskHandle);
 
-  // Read DHT11 humidity
-  float readHumidity();
+  // Pop the oldest captured edge (single consumer), false if none
+  bool popEdge(EdgeRecord &edge);
 
-  // Check if temperature/humidity readings are valid
-  bool isValidReading(float value);
-
-  // Get DHT sensor object (for direct access if needed)
-  DHT &getDHT();
+  // Number of edges lost because the ring buffer was full
+  uint32_t getEdgeOverflows();
 
 private:
-  DHT _dht;
-
   // ISR handlers (must be static)
   static void IRAM_ATTR pirISR();
   static void IRAM_ATTR vibrationISR();
 
+  // Timestamp an edge into the ring buffer and wake the consumer
+  static void IRAM_ATTR recordEdge(EventType type);
+
   // Static task handle for ISR notifications
-  static TaskHandle_t _sensorTaskHandle;
+  static TaskHandle_t _eventTaskHandle;
+
+  // Lock-free single-producer/single-consumer ring buffer. Both ISRs run
+  // on the same core at the same interrupt level and cannot nest, so they
+  // act as a single producer. Head/tail are free-running counters.
+  static EdgeRecord _edges[EDGE_BUFFER_SIZE];
+  static std::atomic<uint32_t> _edgeHead;
+  static std::atomic<uint32_t> _edgeTail;
+  static volatile uint32_t _edgeOverflows;
 };
 
 #endif // DIGITAL_SENSORS_H
@@ -1,7 +1,8 @@
 #include "DisplayManager.h"
 
 DisplayManager::DisplayManager()
-    : _lcd(LCD_ADDRESS, LCD_COLS, LCD_ROWS), _i2cMutex(NULL) {
+    : _lcd(LCD_ADDRESS, LCD_COLS, LCD_ROWS), _i2cMutex(NULL),
+      _lastUpdateBytes(0), _totalBytes(0) {
 
   // Initialize custom character bitmaps
   byte wifiChar[8] = {0b00000, 0b01110, 0b10001, 0b00100,
@@ -26,9 +27,10 @@ void DisplayManager::begin(SemaphoreHandle_t i2cMutex) {
   Wire.begin(21, 22);             // SDA=21, SCL=22
   vTaskDelay(pdMS_TO_TICKS(250)); // Wait for display to power up
 
-  // Initialize LCD
+  // Initialize LCD (cleared by init, matching the blank shadow frame)
   _lcd.init();
   _lcd.backlight();
+  _shown.clear();
 
   // Register custom characters
   createCustomChars();
@@ -48,76 +50,86 @@ void DisplayManager::createCustomChars() {
 
 void DisplayManager::showInitMessage() {
   if (takeMutex()) {
-    _lcd.clear();
-    _lcd.setCursor(0, 0);
-    _lcd.print("Initializing...");
+    _frame.clear();
+    _frame.print(0, 0, "Initializing...");
+    render();
     releaseMutex();
   }
 }
 
-void DisplayManager::updateStatus(const String &ssid, const String &ip,
+void DisplayManager::updateStatus(const char *ssid, const char *ip,
                                   bool firebaseReady,
                                   unsigned long lastSyncTime,
                                   uint32_t droppedPackets) {
-  if (!takeMutex()) {
-    return; // Skip update if mutex not available
-  }
+  // Compose the frame (no I2C traffic, no heap); text longer than a row
+  // is cut by the frame, so the buffer fits any number formatted into it
+  char text[32];
+  _frame.clear();
 
-  _lcd.clear();
-
-  // Row 0: WiFi Status (icon + SSID)
-  _lcd.setCursor(0, 0);
-  _lcd.write(CHAR_WIFI);
-  _lcd.print(" ");
-  if (ssid.length() > 0) {
-    String truncatedSsid = ssid.substring(0, 18); // Truncate to fit
-    _lcd.print(truncatedSsid);
-  } else {
-    _lcd.print("Disconnected");
-  }
+  // Row 0: WiFi Status (icon + SSID, truncated by the frame)
+  _frame.setChar(0, 0, CHAR_WIFI);
+  _frame.print(0, 2, ssid[0] != '\0' ? ssid : "Disconnected");
 
   // Row 1: IP Address (icon + IP)
-  _lcd.setCursor(0, 1);
-  _lcd.write(CHAR_IP);
-  _lcd.print(" ");
-  if (ip.length() > 0) {
-    _lcd.print(ip);
-  } else {
-    _lcd.print("N/A");
-  }
+  _frame.setChar(1, 0, CHAR_IP);
+  _frame.print(1, 2, ip[0] != '\0' ? ip : "N/A");
 
   // Row 2: Firebase Status (icon + status) + Dropped packets
-  _lcd.setCursor(0, 2);
-  _lcd.write(CHAR_FIREBASE);
+  _frame.setChar(2, 0, CHAR_FIREBASE);
   if (droppedPackets > 0) {
-    _lcd.print(" FB:");
-    _lcd.print(firebaseReady ? "OK" : "NO");
-    _lcd.print(" Drop:");
-    _lcd.print(droppedPackets);
+    snprintf(text, sizeof(text), " FB:%s Drop:%u", firebaseReady ? "OK" : "NO",
+             droppedPackets);
   } else {
-    _lcd.print(" Firebase:");
-    _lcd.print(firebaseReady ? "OK" : "NO");
+    snprintf(text, sizeof(text), " Firebase:%s", firebaseReady ? "OK" : "NO");
   }
+  _frame.print(2, 1, text);
 
   // Row 3: Last Sync Time (icon + time)
-  _lcd.setCursor(0, 3);
-  _lcd.write(CHAR_SYNC);
-  _lcd.print(" Sync:");
+  _frame.setChar(3, 0, CHAR_SYNC);
   if (lastSyncTime == 0) {
-    _lcd.print("Never");
+    snprintf(text, sizeof(text), " Sync:Never");
   } else {
     unsigned long elapsed = (millis() - lastSyncTime) / 1000;
     if (elapsed == 0) {
-      _lcd.print("Just now");
+      snprintf(text, sizeof(text), " Sync:Just now");
     } else {
-      _lcd.print(elapsed);
-      _lcd.print("s ago");
+      snprintf(text, sizeof(text), " Sync:%lus ago", elapsed);
     }
   }
+  _frame.print(3, 1, text);
 
+  if (!takeMutex()) {
+    return; // Skip update if mutex not available
+  }
+  render();
   releaseMutex();
 }
 
+uint32_t DisplayManager::getLastUpdateBytes() { return _lastUpdateBytes; }
+
+uint32_t DisplayManager::getTotalBytes() { return _totalBytes; }
+
+void DisplayManager::render() {
+  LcdRun runs[LCD_MAX_RUNS];
+  uint8_t count = _frame.diff(_shown, runs, LCD_MAX_RUNS);
+
+  // One cursor move per run, then the run's cells; the shadow frame
+  // follows exactly what was sent
+  for (uint8_t i = 0; i < count; i++) {
+    const LcdRun &run = runs[i];
+    _lcd.setCursor(run.col, run.row);
+    for (uint8_t col = run.col; col < run.col + run.length; col++) {
+      char c = _frame.get(run.row, col);
+      _lcd.write((uint8_t)c);
+      _shown.setChar(run.row, col, c);
+    }
+  }
+
+  _lastUpdateBytes =
+      LcdFrame::writeCount(runs, count) * LCD_I2C_BYTES_PER_WRITE;
+  _totalBytes += _lastUpdateBytes;
+}
+
 bool DisplayManager::takeMutex(uint32_t timeoutMs) {
   if (_i2cMutex == NULL) {
     return true; // No mutex configured, proceed anyway
@@ -1,15 +1,18 @@
 #ifndef DISPLAY_MANAGER_H
 #define DISPLAY_MANAGER_H
 
+#include "LcdFrame.h"
 #include <Arduino.h>
 #include <LiquidCrystal_I2C.h>
 #include <Wire.h>
 
-// LCD Display configuration
-#define LCD_COLS 20
-#define LCD_ROWS 4
+// LCD Display configuration (size in LcdFrame.h)
 #define LCD_ADDRESS 0x27
 
+// I2C bytes per LCD write through the PCF8574 backpack: two nibbles, each
+// three expander writes (data, enable high, enable low) of address + data
+#define LCD_I2C_BYTES_PER_WRITE 12
+
 // Custom character indices
 #define CHAR_WIFI 0
 #define CHAR_IP 1
@@ -24,17 +27,30 @@ public:
   // Initialize LCD display with custom characters
   void begin(SemaphoreHandle_t i2cMutex);
 
-  // Update display with current status (mutex-protected)
-  void updateStatus(const String &ssid, const String &ip, bool firebaseReady,
+  // Update display with current status (mutex-protected). ssid/ip may be
+  // empty; only cells that changed since the last update are sent
+  void updateStatus(const char *ssid, const char *ip, bool firebaseReady,
                     unsigned long lastSyncTime, uint32_t droppedPackets);
 
   // Show initialization message
   void showInitMessage();
 
+  // I2C bytes sent by the last update and in total
+  uint32_t getLastUpdateBytes();
+  uint32_t getTotalBytes();
+
 private:
   LiquidCrystal_I2C _lcd;
   SemaphoreHandle_t _i2cMutex;
 
+  // Frame being composed and frame currently on the display
+  LcdFrame _frame;
+  LcdFrame _shown;
+
+  // I2C traffic counters
+  uint32_t _lastUpdateBytes;
+  uint32_t _totalBytes;
+
   // Custom character bitmaps
   byte _wifiChar[8];
   byte _ipChar[8];
@@ -44,6 +60,9 @@ private:
   // Register custom characters
   void createCustomChars();
 
+  // Send the cells of _frame that differ from _shown (mutex held)
+  void render();
+
   // Take I2C mutex with timeout
   bool takeMutex(uint32_t timeoutMs = 100);
 
@@ -0,0 +1,35 @@
+#include "EpochClock.h"
+
+EpochClock::EpochClock()
+    : _synced(false), _anchorEpochMs(0), _anchorLocalMs(0), _syncCount(0),
+      _lastCorrection(0) {}
+
+void EpochClock::sync(uint64_t epochMs, unsigned long localMs) {
+  if (_synced) {
+    _lastCorrection = (int32_t)(epochMs - toEpochMs(localMs));
+  }
+  _anchorEpochMs = epochMs;
+  _anchorLocalMs = localMs;
+  _synced = true;
+  _syncCount++;
+}
+
+bool EpochClock::isSynced() const { return _synced; }
+
+uint64_t EpochClock::toEpochMs(unsigned long localMs) const {
+  if (!_synced) {
+    return 0;
+  }
+
+  // Signed distance to the anchor (readings may predate the sync)
+  int32_t delta = (int32_t)(uint32_t)(localMs - _anchorLocalMs);
+  return _anchorEpochMs + delta;
+}
+
+unsigned long EpochClock::getSyncAge(unsigned long localMs) const {
+  return _synced ? localMs - _anchorLocalMs : 0;
+}
+
+uint32_t EpochClock::getSyncCount() const { return _syncCount; }
+
+int32_t EpochClock::getLastCorrection() const { return _lastCorrection; }
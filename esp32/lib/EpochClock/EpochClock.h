@@ -0,0 +1,42 @@
+#ifndef EPOCH_CLOCK_H
+#define EPOCH_CLOCK_H
+
+#include <stdint.h>
+
+// Maps the local millis() clock to Unix epoch milliseconds.
+// Each sync anchors a (local, epoch) pair; local timestamps are converted
+// relative to the latest anchor, so readings taken before the first sync
+// of this boot convert correctly too, and millis() wraparound is harmless
+// while readings are within ~24 days of the anchor. Pure logic, all
+// times are passed in.
+class EpochClock {
+public:
+  // Constructor
+  EpochClock();
+
+  // Record that the wall clock read epochMs at local time localMs
+  void sync(uint64_t epochMs, unsigned long localMs);
+
+  // True once a sync has been recorded
+  bool isSynced() const;
+
+  // Epoch time of a local timestamp, 0 while unsynced
+  uint64_t toEpochMs(unsigned long localMs) const;
+
+  // Local time elapsed since the last sync
+  unsigned long getSyncAge(unsigned long localMs) const;
+
+  // Number of syncs and the clock step applied by the latest one (ms,
+  // positive if the local clock was behind)
+  uint32_t getSyncCount() const;
+  int32_t getLastCorrection() const;
+
+private:
+  bool _synced;
+  uint64_t _anchorEpochMs;
+  unsigned long _anchorLocalMs;
+  uint32_t _syncCount;
+  int32_t _lastCorrection;
+};
+
+#endif // EPOCH_CLOCK_H
@@ -1,17 +1,54 @@
 #include "FirebaseManager.h"
+#include <new>
+
+// Initialize static member
+FirebaseManager *FirebaseManager::_instance = NULL;
+
+// Retry policies and circuit breaker (see FirebaseManager.h)
+static const RetryPolicy uploadRetryPolicy = {
+    UPLOAD_RETRY_BASE_MS, UPLOAD_RETRY_MAX_MS, UPLOAD_MAX_ATTEMPTS};
+static const RetryPolicy alarmRetryPolicy = {
+    ALARM_RETRY_BASE_MS, ALARM_RETRY_MAX_MS, ALARM_MAX_ATTEMPTS};
+static const BreakerPolicy breakerPolicy = {
+    BREAKER_FAILURE_THRESHOLD, BREAKER_OPEN_MS, BREAKER_MAX_OPEN_MS};
 
 FirebaseManager::FirebaseManager(const char *firebaseHost,
-                                 const char *firebaseAuth)
+                                 const char *firebaseAuth,
+                                 const char *rootCa)
     : _firebaseHost(firebaseHost), _firebaseAuth(firebaseAuth),
-      _aClient(_sslClient), _legacyToken(firebaseAuth) {
-  // Constructor
+      _rootCa(rootCa), _aClient(_sslClient), _legacyToken(firebaseAuth),
+      _requestCount(0), _eventCount(0), _maxEventLatency(0), _alarmCount(0),
+      _lastAlarmLatency(0), _maxAlarmLatency(0), _retryCount(0),
+      _failureCount(0), _abandonedCount(0), _retry(breakerPolicy),
+      _batching(NULL), _sensorLog(NULL), _eventLog(NULL), _timeSync(NULL),
+      _connected(false), _connectedAt(0), _connectionRequests(0),
+      _handshakeCount(0), _reusedCount(0), _disconnectCount(0) {
+  for (int i = 0; i < UPLOAD_WINDOW_SIZE; i++) {
+    _slots[i].inUse = false;
+    _slots[i].inFlight = false;
+    _slots[i].kind = UPLOAD_BATCH;
+    _slots[i].fromLog = false;
+    _slots[i].hasSummary = false;
+  }
 }
 
 void FirebaseManager::begin() {
   Serial.printf("Firebase Client v%s\n", FIREBASE_CLIENT_VERSION);
 
-  // Set SSL client to insecure mode (no certificate validation)
-  _sslClient.setInsecure();
+  _instance = this;
+
+  // Devices that lost the server together should not retry in lockstep
+  _retry.seed(esp_random());
+
+  // Validate the server against the pinned CA when one is configured
+  if (_rootCa != NULL) {
+    _sslClient.setCACert(_rootCa);
+    Serial.println("TLS: validating server certificate (pinned CA).");
+  } else {
+    _sslClient.setInsecure();
+    Serial.println("TLS: no CA configured, server certificate NOT checked.");
+  }
+  _sslClient.setHandshakeTimeout(TLS_HANDSHAKE_TIMEOUT_S);
 
   Serial.println("Initializing Firebase app...");
   initializeApp(_aClient, _app, getAuth(_legacyToken));
@@ -24,151 +61,982 @@ void FirebaseManager::begin() {
 
 bool FirebaseManager::isReady() { return _app.ready(); }
 
-void FirebaseManager::loop() { _app.loop(); }
+bool FirebaseManager::isCircuitOpen() { return !_retry.isAllowed(millis()); }
 
-bool FirebaseManager::uploadBatch(SensorData *dataArray, int count,
-                                  unsigned long &lastSyncTime) {
-  if (!isReady() || count == 0) {
+void FirebaseManager::setBatchController(BatchController *controller) {
+  _batching = controller;
+}
+
+void FirebaseManager::setOfflineLogs(OfflineLog *sensorLog,
+                                     OfflineLog *eventLog) {
+  _sensorLog = sensorLog;
+  _eventLog = eventLog;
+}
+
+void FirebaseManager::setTimeSync(TimeSync *timeSync) {
+  _timeSync = timeSync;
+}
+
+void FirebaseManager::loop() {
+  // Runs queued async requests and their result callbacks. The async
+  // client keeps its connection open between requests; a loop iteration
+  // that opens a new one pays the TCP connect and full TLS handshake.
+  unsigned long loopStart = millis();
+  uint32_t minFreeHeap = ESP.getMinFreeHeap();
+  {
+    TRACE_SCOPE(TRACE_FIREBASE_LOOP);
+    _app.loop();
+  }
+  trackConnection(loopStart, minFreeHeap);
+
+  // Resend failed uploads with their original payload and push keys once
+  // their backoff has passed (only alarms while the circuit is open)
+  for (int i = 0; i < UPLOAD_WINDOW_SIZE; i++) {
+    UploadSlot &slot = _slots[i];
+    if (slot.inUse && !slot.inFlight && isReady() &&
+        millis() - slot.failedAt >= slot.retryDelay &&
+        (slot.kind == UPLOAD_ALARM || !isCircuitOpen())) {
+      Serial.printf("Retrying upload (attempt %d)...\n", slot.attempts + 1);
+      _retryCount++;
+      sendSlot(i);
+    }
+  }
+}
+
+bool FirebaseManager::uploadBatch(const WindowSummary *summary,
+                                  EventData *events, int eventCount,
+                                  unsigned long &lastSyncTime,
+                                  bool fromLog) {
+  int count = (summary != NULL) ? summary->readingCount : 0;
+  if (!isReady() || (summary == NULL && eventCount == 0)) {
+    return false;
+  }
+  if (eventCount > MAX_EVENTS_PER_UPLOAD) {
+    eventCount = MAX_EVENTS_PER_UPLOAD;
+  }
+
+  UploadSlot *slot = acquireSlot(UPLOAD_BATCH);
+  if (slot == NULL) {
     return false;
   }
 
   Serial.println("--------------------------------");
-  Serial.printf("Uploading batch of %d sensor readings...\n", count);
+  Serial.printf("Uploading summary of %d readings and %d events...\n",
+                count, eventCount);
 
-  // Build batch JSON
-  String batchJson = buildBatchJson(dataArray, count);
+  // Build batch JSON straight into the slot
+  unsigned long serializeStart = micros();
+  JsonWriter json(slot->payload, sizeof(slot->payload));
+  bool built;
+  {
+    TRACE_SCOPE(TRACE_BUILD_BATCH);
+    built = buildBatchJson(json, summary, events, eventCount, !fromLog);
+  }
+  if (!built) {
+    Serial.println("Batch JSON exceeds buffer, upload skipped.");
+    return false;
+  }
 
-  // Execute atomic batch update
-  bool success = _database.update<object_t>(_aClient, "", object_t(batchJson));
+  slot->inUse = true;
+  slot->kind = UPLOAD_BATCH;
+  slot->attempts = 0;
+  slot->readingCount = count;
+  slot->eventCount = eventCount;
+  slot->alarmCount = 0;
+  slot->oldestReading = (summary != NULL) ? summary->windowStart : 0;
+  slot->oldestEvent = (eventCount > 0) ? events[0].timestamp : 0;
+  slot->serializeTime = micros() - serializeStart;
+  slot->syncTarget = &lastSyncTime;
+  slot->fromLog = fromLog && _sensorLog != NULL && _eventLog != NULL;
+  if (slot->fromLog) {
+    slot->sensorPosition = _sensorLog->getReadPosition();
+    slot->eventPosition = _eventLog->getReadPosition();
+  }
+  slot->hasSummary = !slot->fromLog && summary != NULL;
+  if (slot->hasSummary) {
+    slot->summary = *summary;
+  }
+  if (!slot->fromLog && eventCount > 0) {
+    memcpy(slot->events, events, eventCount * sizeof(EventData));
+  }
+  slot->length = json.length();
 
-  if (success) {
-    Serial.println("Batch sensor data pushed successfully.");
-    lastSyncTime = millis();
-  } else {
-    Serial.println("Failed to push batch sensor data.");
+  sendSlot(slot - _slots);
+  return true;
+}
+
+bool FirebaseManager::uploadRaw(const SensorBatch &batch,
+                                unsigned long &lastSyncTime) {
+  int count = batch.count();
+  if (!isReady() || count == 0) {
+    return false;
+  }
+
+  UploadSlot *slot = acquireSlot(UPLOAD_RAW);
+  if (slot == NULL) {
+    return false;
+  }
+
+  Serial.printf("Uploading raw block of %d readings...\n", count);
+
+  unsigned long serializeStart = micros();
+  JsonWriter json(slot->payload, sizeof(slot->payload));
+  if (!buildRawJson(json, batch)) {
+    Serial.println("Raw block JSON exceeds buffer, upload skipped.");
+    return false;
+  }
+
+  slot->inUse = true;
+  slot->kind = UPLOAD_RAW;
+  slot->attempts = 0;
+  slot->readingCount = count;
+  slot->eventCount = 0;
+  slot->alarmCount = 0;
+  slot->oldestReading = batch.timestamps()[0];
+  slot->oldestEvent = 0;
+  slot->serializeTime = micros() - serializeStart;
+  slot->syncTarget = &lastSyncTime;
+  slot->fromLog = false;
+  slot->hasSummary = false;
+  slot->length = json.length();
+
+  sendSlot(slot - _slots);
+  return true;
+}
+
+bool FirebaseManager::uploadAlarms(const AlarmData *alarms, int count,
+                                   unsigned long &lastSyncTime) {
+  if (!isReady() || count == 0) {
+    return false;
+  }
+  if (count > MAX_ALARMS_PER_UPLOAD) {
+    count = MAX_ALARMS_PER_UPLOAD;
+  }
+
+  UploadSlot *slot = acquireSlot(UPLOAD_ALARM);
+  if (slot == NULL) {
+    return false;
+  }
+
+  Serial.printf("Uploading %d alarms...\n", count);
+
+  unsigned long serializeStart = micros();
+  JsonWriter json(slot->payload, sizeof(slot->payload));
+  if (!buildAlarmJson(json, alarms, count)) {
+    Serial.println("Alarm JSON exceeds buffer, upload skipped.");
+    return false;
   }
 
-  return success;
+  slot->inUse = true;
+  slot->kind = UPLOAD_ALARM;
+  slot->attempts = 0;
+  slot->readingCount = 0;
+  slot->eventCount = 0;
+  slot->alarmCount = count;
+  slot->oldestReading = 0;
+  slot->oldestEvent = 0;
+  slot->oldestAlarm = alarms[0].timestamp;
+  slot->serializeTime = micros() - serializeStart;
+  slot->syncTarget = &lastSyncTime;
+  slot->fromLog = false;
+  slot->hasSummary = false;
+  slot->length = json.length();
+
+  sendSlot(slot - _slots);
+  return true;
 }
 
-bool FirebaseManager::uploadEvent(const EventData &event) {
+bool FirebaseManager::uploadMetrics(const MetricsSnapshot &snapshot,
+                                    const char *deviceId) {
   if (!isReady()) {
     return false;
   }
 
-  String eventKey = generatePushId();
-  String eventJson = buildEventJson(event, eventKey);
+  UploadSlot *slot = acquireSlot(UPLOAD_METRICS);
+  if (slot == NULL) {
+    return false;
+  }
+
+  unsigned long serializeStart = micros();
+  JsonWriter json(slot->payload, sizeof(slot->payload));
+  if (!buildMetricsJson(json, snapshot, deviceId)) {
+    Serial.println("Metrics JSON exceeds buffer, upload skipped.");
+    return false;
+  }
+
+  slot->inUse = true;
+  slot->kind = UPLOAD_METRICS;
+  slot->attempts = 0;
+  slot->readingCount = 0;
+  slot->eventCount = 0;
+  slot->alarmCount = 0;
+  slot->oldestReading = 0;
+  slot->oldestEvent = 0;
+  slot->oldestAlarm = 0;
+  slot->serializeTime = micros() - serializeStart;
+  slot->syncTarget = NULL;
+  slot->fromLog = false;
+  slot->hasSummary = false;
+  slot->length = json.length();
+
+  sendSlot(slot - _slots);
+  return true;
+}
+
+bool FirebaseManager::canSubmit() {
+  return freeSlots() > ALARM_RESERVED_SLOTS;
+}
+
+bool FirebaseManager::isDrainPending() {
+  for (int i = 0; i < UPLOAD_WINDOW_SIZE; i++) {
+    if (_slots[i].inUse && _slots[i].fromLog) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int FirebaseManager::getPendingUploads() {
+  int pending = 0;
+  for (int i = 0; i < UPLOAD_WINDOW_SIZE; i++) {
+    if (_slots[i].inUse) {
+      pending++;
+    }
+  }
+  return pending;
+}
+
+uint32_t FirebaseManager::getRequestCount() { return _requestCount; }
+
+uint32_t FirebaseManager::getEventCount() { return _eventCount; }
+
+unsigned long FirebaseManager::getMaxEventLatency() { return _maxEventLatency; }
+
+uint32_t FirebaseManager::getAlarmCount() { return _alarmCount; }
+
+unsigned long FirebaseManager::getLastAlarmLatency() {
+  return _lastAlarmLatency;
+}
+
+unsigned long FirebaseManager::getMaxAlarmLatency() { return _maxAlarmLatency; }
 
-  const char *eventTypeName = (event.type == MOTION) ? "motion" : "vibration";
-  Serial.printf("%s event detected! Uploading...\n", eventTypeName);
+uint32_t FirebaseManager::getRetryCount() { return _retryCount; }
 
-  bool success = _database.update<object_t>(_aClient, "", object_t(eventJson));
+uint32_t FirebaseManager::getFailureCount() { return _failureCount; }
 
-  if (success) {
-    Serial.printf("%s event uploaded successfully.\n", eventTypeName);
+uint32_t FirebaseManager::getAbandonedCount() { return _abandonedCount; }
+
+uint32_t FirebaseManager::getBreakerTripCount() {
+  return _retry.getTripCount();
+}
+
+uint32_t FirebaseManager::getHandshakeCount() { return _handshakeCount; }
+
+uint32_t FirebaseManager::getReusedCount() { return _reusedCount; }
+
+uint32_t FirebaseManager::getDisconnectCount() { return _disconnectCount; }
+
+void FirebaseManager::trackConnection(unsigned long startMs,
+                                      uint32_t minFreeHeap) {
+  bool connected = _sslClient.connected();
+  if (connected == _connected) {
+    return;
+  }
+  _connected = connected;
+
+  if (connected) {
+    // No session resumption in this TLS stack: every connect is a full
+    // handshake, the largest transient heap user of the upload path
+    unsigned long handshakeTime = millis() - startMs;
+    _handshakeCount++;
+    _handshakeHistogram.add(handshakeTime);
+    _connectedAt = millis();
+    uint32_t lowWater = ESP.getMinFreeHeap();
+    Serial.printf("TLS connected (handshake #%u, %lu ms, heap low-water "
+                  "%u%s).\n",
+                  _handshakeCount, handshakeTime, lowWater,
+                  lowWater < minFreeHeap ? ", new low" : "");
   } else {
-    Serial.printf("Failed to upload %s event.\n", eventTypeName);
+    _disconnectCount++;
+    Serial.printf("TLS connection closed after %lu s and %u requests.\n",
+                  (millis() - _connectedAt) / 1000, _connectionRequests);
+    _connectionRequests = 0;
   }
+}
 
-  return success;
+UploadSlot *FirebaseManager::acquireSlot(UploadKind kind) {
+  if (kind != UPLOAD_ALARM &&
+      (freeSlots() <= ALARM_RESERVED_SLOTS || isCircuitOpen())) {
+    return NULL;
+  }
+  for (int i = 0; i < UPLOAD_WINDOW_SIZE; i++) {
+    if (!_slots[i].inUse) {
+      return &_slots[i];
+    }
+  }
+  return NULL;
 }
 
-String FirebaseManager::buildBatchJson(SensorData *dataArray, int count) {
-  // Calculate averages and max values across the batch
-  unsigned long lightSum = 0, gasSum = 0, flameSum = 0, soilSum = 0;
-  unsigned int soundMax = 0;
-  float tempSum = 0.0, humSum = 0.0;
-  int tempValidCount = 0, humValidCount = 0;
+int FirebaseManager::freeSlots() {
+  return UPLOAD_WINDOW_SIZE - getPendingUploads();
+}
 
-  for (int i = 0; i < count; i++) {
-    SensorData &data = dataArray[i];
+void FirebaseManager::sendSlot(int index) {
+  UploadSlot &slot = _slots[index];
+  slot.inFlight = true;
+  slot.attempts++;
+  slot.sentAt = millis();
 
-    // Sum analog sensor values
-    lightSum += data.lightValue;
-    gasSum += data.gasValue;
-    flameSum += data.flameValue;
-    soilSum += data.soilMoistureValue;
+  // While half-open, this upload is the probe
+  if (slot.kind != UPLOAD_ALARM) {
+    _retry.allowRequest(slot.sentAt);
+  }
+
+  // Requests on an open connection skip the handshake
+  if (_connected) {
+    _reusedCount++;
+  }
+  _connectionRequests++;
+
+  // Slot index travels as the task UID to route the result back
+  char uid[8];
+  snprintf(uid, sizeof(uid), "slot%d", index);
 
-    // Track maximum sound value (peak-to-peak)
-    if (data.soundValue > soundMax) {
-      soundMax = data.soundValue;
+  // The body is built on the first attempt only; retries resend it as is
+  TRACE_SCOPE(TRACE_DB_UPDATE);
+  if (slot.attempts == 1) {
+    slot.body = object_t(slot.payload);
+  }
+
+  // Multi-location update: paths are absolute, so the base path is empty
+  _database.update(_aClient, "", slot.body, onUploadResult, uid);
+}
+
+void FirebaseManager::releaseSlot(UploadSlot &slot) {
+  slot.inUse = false;
+
+  // Free the body's copy of the payload now rather than when the slot is
+  // reused (assigning an empty body would keep its buffer)
+  slot.body.~object_t();
+  new (&slot.body) object_t();
+}
+
+void FirebaseManager::settleLogRead(const UploadSlot &slot, bool consumed) {
+  if (!slot.fromLog) {
+    return;
+  }
+  if (consumed) {
+    _sensorLog->commit(slot.sensorPosition);
+    _eventLog->commit(slot.eventPosition);
+  } else {
+    _sensorLog->rewind();
+    _eventLog->rewind();
+  }
+}
+
+bool FirebaseManager::requeueToLogs(const UploadSlot &slot) {
+  if (slot.kind != UPLOAD_BATCH || _sensorLog == NULL || _eventLog == NULL) {
+    return false;
+  }
+  bool saved = true;
+  if (slot.hasSummary) {
+    saved = _sensorLog->append(&slot.summary, sizeof(WindowSummary));
+  }
+  for (int i = 0; i < slot.eventCount; i++) {
+    saved = _eventLog->append(&slot.events[i], sizeof(EventData)) && saved;
+  }
+  return saved;
+}
+
+bool FirebaseManager::isRejection(int code) {
+  return code >= 400 && code < 500 && code != 408 && code != 429;
+}
+
+const RetryPolicy &FirebaseManager::retryPolicy(UploadKind kind) {
+  return kind == UPLOAD_ALARM ? alarmRetryPolicy : uploadRetryPolicy;
+}
+
+void FirebaseManager::onUploadResult(AsyncResult &aResult) {
+  if (_instance != NULL) {
+    _instance->handleResult(aResult);
+  }
+}
+
+void FirebaseManager::handleResult(AsyncResult &aResult) {
+  // Only completion results matter (skip debug/event notifications)
+  if (!aResult.isError() && !aResult.available()) {
+    return;
+  }
+
+  String uid = aResult.uid();
+  if (strncmp(uid.c_str(), "slot", 4) != 0) {
+    return;
+  }
+  int index = atoi(uid.c_str() + 4);
+  if (index < 0 || index >= UPLOAD_WINDOW_SIZE || !_slots[index].inFlight) {
+    return;
+  }
+
+  UploadSlot &slot = _slots[index];
+  unsigned long ackTime = millis();
+  slot.inFlight = false;
+
+  if (aResult.isError()) {
+    _failureCount++;
+    if (_batching != NULL) {
+      _batching->addFailure();
     }
 
-    // Sum valid temperature and humidity readings
-    if (data.temperatureValid) {
-      tempSum += data.temperature;
-      tempValidCount++;
+    // HTTP 4xx: the server answered and refused this payload, which says
+    // nothing against the link (and ends a probe). Anything else (TCP/TLS
+    // errors, timeouts, 5xx) counts towards the circuit breaker.
+    int code = aResult.error().code();
+    bool rejected = isRejection(code);
+    if (rejected) {
+      _retry.recordRejected();
+    } else {
+      bool wasOpen = isCircuitOpen();
+      _retry.recordFailure(ackTime);
+      if (!wasOpen && isCircuitOpen()) {
+        Serial.printf("Circuit open after %u failures, uploads paused.\n",
+                      _retry.getConsecutiveFailures());
+      }
     }
-    if (data.humidityValid) {
-      humSum += data.humidity;
-      humValidCount++;
+
+    // An upload that keeps failing is given up after its attempt budget,
+    // but not during an outage (its probes would use the budget up)
+    const RetryPolicy &policy = retryPolicy(slot.kind);
+    if (!_retry.canRetry(policy, slot.attempts) &&
+        (rejected || _retry.getState(ackTime) == BREAKER_CLOSED)) {
+      _abandonedCount++;
+      if (rejected) {
+        // Only a payload the server refuses is dropped for good
+        Serial.printf("Upload rejected (HTTP %d: %s), dropped after %d "
+                      "attempts (%d readings, %d events, %d alarms).\n",
+                      code, aResult.error().message().c_str(),
+                      slot.attempts, slot.readingCount, slot.eventCount,
+                      slot.alarmCount);
+        settleLogRead(slot, true);
+      } else {
+        // Records from the offline log stay there, a live batch goes back
+        bool kept = slot.fromLog || requeueToLogs(slot);
+        Serial.printf("Upload failed (%s), given up after %d attempts "
+                      "(%d readings, %d events, %d alarms %s).\n",
+                      aResult.error().message().c_str(), slot.attempts,
+                      slot.readingCount, slot.eventCount, slot.alarmCount,
+                      kept ? "kept in offline log" : "lost");
+        settleLogRead(slot, false);
+      }
+      releaseSlot(slot);
+      return;
     }
+
+    slot.failedAt = ackTime;
+    slot.retryDelay = _retry.retryDelay(policy, slot.attempts);
+    Serial.printf("Upload failed (%s), retry in %lu ms.\n",
+                  aResult.error().message().c_str(), slot.retryDelay);
+    return;
   }
 
-  // Calculate averages
-  unsigned int lightAvg = lightSum / count;
-  unsigned int gasAvg = gasSum / count;
-  unsigned int flameAvg = flameSum / count;
-  unsigned int soilAvg = soilSum / count;
-  float tempAvg = (tempValidCount > 0) ? (tempSum / tempValidCount) : 0.0;
-  float humAvg = (humValidCount > 0) ? (humSum / humValidCount) : 0.0;
+  if (_retry.getState(ackTime) != BREAKER_CLOSED) {
+    Serial.println("Upload path recovered, circuit closed.");
+  }
+  _retry.recordSuccess();
 
-  // Build JSON with averaged values (one record per sensor type)
-  String batchJson = "{";
+  Serial.println("Upload acknowledged.");
+  if (slot.syncTarget != NULL) {
+    *slot.syncTarget = ackTime;
+  }
 
-  // Generate unique keys for each sensor type
-  String lightKey = generatePushId();
-  String gasKey = generatePushId();
-  String flameKey = generatePushId();
-  String soilKey = generatePushId();
-  String soundKey = generatePushId();
+  _requestCount++;
+  _rttHistogram.add(ackTime - slot.sentAt);
+  if (_batching != NULL) {
+    _batching->addRoundTrip(ackTime - slot.sentAt);
+  }
 
-  // Add analog sensor data with averaged values
-  batchJson += "\"/sensors/light/" + lightKey +
-               "\":{\"value\":" + String(lightAvg) +
-               ",\"timestamp\":{\".sv\":\"timestamp\"}},";
+  if (slot.kind == UPLOAD_METRICS) {
+    Serial.printf("Metrics uploaded (%u bytes).\n", (unsigned)slot.length);
+    releaseSlot(slot);
+    return;
+  }
 
-  batchJson += "\"/sensors/gas/" + gasKey + "\":{\"value\":" + String(gasAvg) +
-               ",\"timestamp\":{\".sv\":\"timestamp\"}},";
+  // Alarm uploads only carry alarms: report their end-to-end latency
+  if (slot.kind == UPLOAD_ALARM) {
+    _alarmCount += slot.alarmCount;
+    _lastAlarmLatency = ackTime - slot.oldestAlarm;
+    _alarmLatencyHistogram.add(_lastAlarmLatency);
+    if (_lastAlarmLatency > _maxAlarmLatency) {
+      _maxAlarmLatency = _lastAlarmLatency;
+    }
+    Serial.printf("Alarm stats: %d alarms, %u bytes, rtt=%lu ms, "
+                  "sensor->ack=%lu ms (worst %lu ms), attempts=%d\n",
+                  slot.alarmCount, (unsigned)slot.length,
+                  ackTime - slot.sentAt,
+                  _lastAlarmLatency, _maxAlarmLatency, slot.attempts);
+    releaseSlot(slot);
+    return;
+  }
+
+  _eventCount += slot.eventCount;
+  if (slot.eventCount > 0 && ackTime - slot.oldestEvent > _maxEventLatency) {
+    _maxEventLatency = ackTime - slot.oldestEvent;
+  }
+
+  // Upload pipeline stats: payload size, serialization cost, request round
+  // trip and end-to-end latency of the oldest reading in the upload
+  unsigned long latency =
+      ackTime -
+      (slot.readingCount > 0 ? slot.oldestReading : slot.oldestEvent);
+  _latencyHistogram.add(latency);
+  Serial.printf("Upload stats: %d readings, %d events, %u bytes, "
+                "serialize=%lu us, rtt=%lu ms, sensor->ack=%lu ms, "
+                "attempts=%d\n",
+                slot.readingCount, slot.eventCount, (unsigned)slot.length,
+                slot.serializeTime, ackTime - slot.sentAt, latency,
+                slot.attempts);
+  Serial.printf("Events/request: %.2f (%u events in %u requests), worst "
+                "event latency %lu ms\n",
+                (float)_eventCount / _requestCount, _eventCount,
+                _requestCount, _maxEventLatency);
+
+  // Buffered records are consumed only now that Firebase has them
+  settleLogRead(slot, true);
+  releaseSlot(slot);
+}
 
-  batchJson += "\"/sensors/flame/" + flameKey +
-               "\":{\"value\":" + String(flameAvg) +
-               ",\"timestamp\":{\".sv\":\"timestamp\"}},";
+uint64_t FirebaseManager::resolveEpochMs(uint64_t epochMs,
+                                         unsigned long localMs) {
+  if (epochMs != 0 || _timeSync == NULL) {
+    return epochMs;
+  }
+  return _timeSync->toEpochMs(localMs);
+}
 
-  batchJson += "\"/sensors/soil-moisture/" + soilKey +
-               "\":{\"value\":" + String(soilAvg) +
-               ",\"timestamp\":{\".sv\":\"timestamp\"}},";
+bool FirebaseManager::buildBatchJson(JsonWriter &json,
+                                     const WindowSummary *summary,
+                                     EventData *events, int eventCount,
+                                     bool resolveTimes) {
+  // Generate ordered keys for all records in one call (one per window
+  // channel, then one per event)
+  char keys[WINDOW_CHANNEL_COUNT + MAX_EVENTS_PER_UPLOAD][PUSH_ID_LENGTH + 1];
+  generatePushIds(keys, WINDOW_CHANNEL_COUNT + eventCount);
 
-  batchJson += "\"/sensors/sound/" + soundKey +
-               "\":{\"value\":" + String(soundMax) +
-               ",\"timestamp\":{\".sv\":\"timestamp\"}}";
+  json.reset();
+  json.append('{');
+
+  if (summary != NULL) {
+    uint64_t epochMs = summary->windowStartEpochMs;
+    if (resolveTimes) {
+      epochMs = resolveEpochMs(epochMs, summary->windowStart);
+    }
+    appendSummaryRecords(json, *summary, keys, epochMs);
+  }
+
+  for (int i = 0; i < eventCount; i++) {
+    if (summary != NULL || i > 0) {
+      json.append(',');
+    }
+    uint64_t epochMs = events[i].epochMs;
+    if (resolveTimes) {
+      epochMs = resolveEpochMs(epochMs, events[i].timestamp);
+    }
+    appendEventRecord(json, events[i], keys[WINDOW_CHANNEL_COUNT + i],
+                      epochMs);
+  }
+
+  json.append('}');
+  return !json.overflowed();
+}
+
+void FirebaseManager::appendSummaryRecords(JsonWriter &json,
+                                           const WindowSummary &summary,
+                                           char (*keys)[PUSH_ID_LENGTH + 1],
+                                           uint64_t epochMs) {
+  // Analog channels keep an integer "value" (mean, peak-to-peak maximum
+  // for sound) next to the window statistics
+  static const char *const analogPaths[] = {"light", "gas", "flame",
+                                            "soil-moisture", "sound"};
+
+  for (int c = WINDOW_LIGHT; c <= WINDOW_SOUND; c++) {
+    const ChannelSummary &channel = summary.channels[c];
+    if (c > WINDOW_LIGHT) {
+      json.append(',');
+    }
+    beginRecord(json, analogPaths[c], keys[c]);
+    json.appendUInt((unsigned long)((c == WINDOW_SOUND ? channel.max
+                                                       : channel.mean) +
+                                    0.5f));
+    appendChannelStats(json, channel);
+
+    if (c == WINDOW_SOUND) {
+      json.append(",\"rms\":");
+      json.appendUInt(summary.soundRms);
+      json.append(",\"peak\":");
+      json.appendUInt(summary.soundPeak);
+      json.append(",\"zcr\":");
+      json.appendUInt(summary.soundZcr);
+      json.append(",\"bands\":[");
+      for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+        if (b > 0) {
+          json.append(',');
+        }
+        json.appendUInt(summary.soundBands[b]);
+      }
+      json.append(']');
+    }
+    endRecord(json, epochMs);
+  }
 
   // Add temperature if any valid readings exist
-  if (tempValidCount > 0) {
-    String tempKey = generatePushId();
-    batchJson += ",\"/sensors/temperature/" + tempKey +
-                 "\":{\"value\":" + String(tempAvg, 1) +
-                 ",\"timestamp\":{\".sv\":\"timestamp\"}}";
+  const ChannelSummary &temperature = summary.channels[WINDOW_TEMPERATURE];
+  if (temperature.count > 0) {
+    json.append(',');
+    beginRecord(json, "temperature", keys[WINDOW_TEMPERATURE]);
+    json.appendFloat(temperature.mean, 1);
+    appendChannelStats(json, temperature);
+    endRecord(json, epochMs);
   }
 
   // Add humidity if any valid readings exist
-  if (humValidCount > 0) {
-    String humKey = generatePushId();
-    batchJson += ",\"/sensors/humidity/" + humKey +
-                 "\":{\"value\":" + String(humAvg, 1) +
-                 ",\"timestamp\":{\".sv\":\"timestamp\"}}";
+  const ChannelSummary &humidity = summary.channels[WINDOW_HUMIDITY];
+  if (humidity.count > 0) {
+    json.append(',');
+    beginRecord(json, "humidity", keys[WINDOW_HUMIDITY]);
+    json.appendFloat(humidity.mean, 1);
+    appendChannelStats(json, humidity);
+    endRecord(json, epochMs);
   }
+}
 
-  batchJson += "}";
-  return batchJson;
+void FirebaseManager::appendChannelStats(JsonWriter &json,
+                                         const ChannelSummary &channel) {
+  json.append(",\"n\":");
+  json.appendUInt(channel.count);
+  json.append(",\"min\":");
+  json.appendFloat(channel.min, 1);
+  json.append(",\"max\":");
+  json.appendFloat(channel.max, 1);
+  json.append(",\"mean\":");
+  json.appendFloat(channel.mean, 1);
+  json.append(",\"std\":");
+  json.appendFloat(channel.stddev, 1);
+  json.append(",\"p50\":");
+  json.appendFloat(channel.p50, 1);
+  json.append(",\"p90\":");
+  json.appendFloat(channel.p90, 1);
 }
 
-String FirebaseManager::buildEventJson(const EventData &event,
-                                       const String &key) {
+bool FirebaseManager::buildRawJson(JsonWriter &json,
+                                   const SensorBatch &batch) {
+  static const char *const columnNames[COLUMN_COUNT] = {
+      "light", "gas", "flame", "soil-moisture", "sound", "temperature",
+      "humidity"};
+
+  // One series at a time through a shared scratch buffer
+  uint8_t scratch[SENSOR_BATCH_CAPACITY * SERIES_MAX_VARINT_BYTES];
+  SeriesEncoder encoder(scratch, sizeof(scratch));
+
+  char key[PUSH_ID_LENGTH + 1];
+  generatePushId(key);
+
+  int count = batch.count();
+  json.reset();
+  json.append("{\"/sensors/raw/");
+  json.append(key);
+  json.append("\":{\"n\":");
+  json.appendUInt(count);
+
+  // Capture times as ms offsets from the first reading, whose wall-clock
+  // time is the record timestamp. If the clock cannot tell it yet, the
+  // server time stands in for the last reading ("anchor":"last") and the
+  // offsets count back from it.
+  const unsigned long *timestamps = batch.timestamps();
+  uint64_t epochMs = resolveEpochMs(batch.firstEpochMs(), timestamps[0]);
+  unsigned long anchor = timestamps[epochMs != 0 ? 0 : count - 1];
+  for (int i = 0; i < count; i++) {
+    encoder.add((int32_t)(timestamps[i] - anchor));
+  }
+  appendSeries(json, "t", encoder);
+  if (epochMs == 0) {
+    json.append(",\"anchor\":\"last\"");
+  }
+
+  // Missing samples are left out of the series (a gap would cost two large
+  // delta-of-deltas); channels with gaps get a presence bitmap, bit i of
+  // byte i / 8 set if reading i has a value. Temperature and humidity
+  // columns are already in tenths.
+  uint8_t presence[COLUMN_COUNT][(SENSOR_BATCH_CAPACITY + 7) / 8];
+  bool complete[COLUMN_COUNT];
+  bool allComplete = true;
+  for (int c = 0; c < COLUMN_COUNT; c++) {
+    const int16_t *values = batch.column((BatchColumn)c);
+    memset(presence[c], 0, sizeof(presence[c]));
+    complete[c] = true;
+    encoder.reset();
+    for (int i = 0; i < count; i++) {
+      if (values[i] == SENSOR_BATCH_MISSING) {
+        complete[c] = false;
+        continue;
+      }
+      presence[c][i / 8] |= 1 << (i % 8);
+      encoder.add(values[i]);
+    }
+    allComplete = allComplete && complete[c];
+    appendSeries(json, columnNames[c], encoder);
+  }
+
+  if (!allComplete) {
+    json.append(",\"present\":{");
+    bool first = true;
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+      if (complete[c]) {
+        continue;
+      }
+      if (!first) {
+        json.append(',');
+      }
+      first = false;
+      json.append('"');
+      json.append(columnNames[c]);
+      json.append("\":");
+      json.appendBase64(presence[c], (count + 7) / 8);
+    }
+    json.append('}');
+  }
+
+  endRecord(json, epochMs);
+  json.append('}');
+  return !json.overflowed();
+}
+
+void FirebaseManager::appendSeries(JsonWriter &json, const char *name,
+                                   const SeriesEncoder &encoder) {
+  json.append(",\"");
+  json.append(name);
+  json.append("\":");
+  json.appendBase64(encoder.data(), encoder.length());
+}
+
+bool FirebaseManager::buildMetricsJson(JsonWriter &json,
+                                       const MetricsSnapshot &snapshot,
+                                       const char *deviceId) {
+  json.reset();
+  json.append("{\"/metrics/");
+  json.append(deviceId);
+  json.append("\":{\"uptime\":");
+  json.appendUInt(snapshot.uptimeMs);
+
+  json.append(",\"heap\":{\"free\":");
+  json.appendUInt(snapshot.freeHeap);
+  json.append(",\"minFree\":");
+  json.appendUInt(snapshot.minFreeHeap);
+  json.append(",\"largestBlock\":");
+  json.appendUInt(snapshot.largestFreeBlock);
+
+  json.append("},\"tasks\":{");
+  for (uint8_t i = 0; i < snapshot.taskCount; i++) {
+    const TaskMetrics &task = snapshot.tasks[i];
+    if (i > 0) {
+      json.append(',');
+    }
+    json.append('"');
+    json.append(task.name);
+    json.append("\":{\"stack\":");
+    json.appendUInt(task.stackSize);
+    json.append(",\"stackFree\":");
+    json.appendUInt(task.stackFree);
+    if (task.cpuPermille >= 0) {
+      json.append(",\"cpu\":");
+      json.appendFloat(task.cpuPermille / 10.0f, 1);
+    }
+    json.append('}');
+  }
+
+  json.append("},\"queues\":{");
+  for (uint8_t i = 0; i < snapshot.queueCount; i++) {
+    const QueueMetrics &queue = snapshot.queues[i];
+    if (i > 0) {
+      json.append(',');
+    }
+    json.append('"');
+    json.append(queue.name);
+    json.append("\":{\"capacity\":");
+    json.appendUInt(queue.capacity);
+    json.append(",\"depth\":");
+    json.appendUInt(queue.depth);
+    json.append(",\"peak\":");
+    json.appendUInt(queue.peak);
+    json.append('}');
+  }
+
+  json.append("},\"uploads\":{\"requests\":");
+  json.appendUInt(_requestCount);
+  json.append(",\"retries\":");
+  json.appendUInt(_retryCount);
+  json.append(",\"failures\":");
+  json.appendUInt(_failureCount);
+  json.append(",\"abandoned\":");
+  json.appendUInt(_abandonedCount);
+  json.append(",\"breakerTrips\":");
+  json.appendUInt(_retry.getTripCount());
+  appendHistogram(json, "rtt", _rttHistogram);
+  appendHistogram(json, "latency", _latencyHistogram);
+  appendHistogram(json, "alarmLatency", _alarmLatencyHistogram);
+
+  // TLS connection reuse
+  json.append("},\"tls\":{\"handshakes\":");
+  json.appendUInt(_handshakeCount);
+  json.append(",\"reused\":");
+  json.appendUInt(_reusedCount);
+  json.append(",\"disconnects\":");
+  json.appendUInt(_disconnectCount);
+  json.append(",\"pinned\":");
+  json.append(_rootCa != NULL ? "true" : "false");
+  appendHistogram(json, "handshake", _handshakeHistogram);
+
+  // Current batching decision and the inputs it was made from
+  if (_batching != NULL) {
+    json.append("},\"batching\":{\"srtt\":");
+    json.appendUInt(_batching->getSmoothedRtt());
+    json.append(",\"failurePct\":");
+    json.appendUInt(_batching->getFailurePercent());
+    json.append(",\"backlogPct\":");
+    json.appendUInt(_batching->getBacklogPercent());
+    json.append(",\"flushMs\":");
+    json.appendUInt(_batching->getFlushMs());
+    json.append(",\"drainMs\":");
+    json.appendUInt(_batching->getDrainMs());
+  }
+
+#if TRACE_ENABLED
+  // Trace point latencies (us)
+  json.append("},\"trace\":{");
+  float rate = traceCyclesPerUs();
+  bool first = true;
+  for (int p = 0; p < TRACE_POINT_COUNT; p++) {
+    LatencyHistogram h = traceHistogram((TracePoint)p);
+    if (h.getCount() == 0) {
+      continue;
+    }
+    if (!first) {
+      json.append(',');
+    }
+    first = false;
+    json.append('"');
+    json.append(tracePointName((TracePoint)p));
+    json.append("\":{\"n\":");
+    json.appendUInt(h.getCount());
+    json.append(",\"p50\":");
+    json.appendFloat(h.getPercentile(0.5f) / rate, 1);
+    json.append(",\"p90\":");
+    json.appendFloat(h.getPercentile(0.9f) / rate, 1);
+    json.append(",\"max\":");
+    json.appendFloat(h.getMax() / rate, 1);
+    json.append('}');
+  }
+#endif
+
+  json.append("},\"dropped\":");
+  json.appendUInt(snapshot.droppedPackets);
+  endRecord(json, 0);
+  json.append('}');
+  return !json.overflowed();
+}
+
+void FirebaseManager::appendHistogram(JsonWriter &json, const char *name,
+                                      const LatencyHistogram &histogram) {
+  json.append(",\"");
+  json.append(name);
+  json.append("\":{\"n\":");
+  json.appendUInt(histogram.getCount());
+  json.append(",\"mean\":");
+  json.appendUInt(histogram.getMean());
+  json.append(",\"p50\":");
+  json.appendUInt(histogram.getPercentile(0.5f));
+  json.append(",\"p90\":");
+  json.appendUInt(histogram.getPercentile(0.9f));
+  json.append(",\"max\":");
+  json.appendUInt(histogram.getMax());
+
+  // Bucket i counts values in [2^(i-1), 2^i), bucket 0 zeros
+  json.append(",\"buckets\":[");
+  uint8_t used = histogram.getUsedBuckets();
+  for (uint8_t b = 0; b < used; b++) {
+    if (b > 0) {
+      json.append(',');
+    }
+    json.appendUInt(histogram.getBucket(b));
+  }
+  json.append("]}");
+}
+
+bool FirebaseManager::buildAlarmJson(JsonWriter &json,
+                                     const AlarmData *alarms, int count) {
+  char keys[MAX_ALARMS_PER_UPLOAD][PUSH_ID_LENGTH + 1];
+  generatePushIds(keys, count);
+
+  json.reset();
+  json.append('{');
+  for (int i = 0; i < count; i++) {
+    if (i > 0) {
+      json.append(',');
+    }
+    appendAlarmRecord(json, alarms[i], keys[i]);
+  }
+  json.append('}');
+  return !json.overflowed();
+}
+
+void FirebaseManager::appendAlarmRecord(JsonWriter &json,
+                                        const AlarmData &alarm,
+                                        const char *key) {
+  static const char *const channelNames[] = {
+      "light", "gas", "flame", "soil-moisture", "sound", "temperature"};
+
+  beginRecord(json, "alarm", key);
+  json.appendFloat(alarm.value, 1);
+  json.append(",\"sensor\":\"");
+  json.append(alarm.channel <= ALARM_TEMPERATURE
+                  ? channelNames[alarm.channel]
+                  : "unknown");
+  json.append("\",\"state\":\"");
+  json.append(alarm.active ? "raised" : "cleared");
+  json.append("\",\"cause\":\"");
+  json.append(alarm.cause == ALARM_CAUSE_RATE ? "rate" : "level");
+  json.append("\",\"rate\":");
+  json.appendFloat(alarm.rate, 2);
+  endRecord(json, resolveEpochMs(alarm.epochMs, alarm.timestamp));
+}
+
+void FirebaseManager::appendEventRecord(JsonWriter &json,
+                                        const EventData &event,
+                                        const char *key, uint64_t epochMs) {
   const char *eventPath = (event.type == MOTION) ? "motion" : "vibration";
 
-  String eventJson = "{\"/sensors/" + String(eventPath) + "/" + key +
-                     "\":{\"timestamp\":{\".sv\":\"timestamp\"}}}";
+  json.append("\"/sensors/");
+  json.append(eventPath);
+  json.append('/');
+  json.append(key);
+  json.append("\":{\"edges\":");
+  json.appendUInt(event.edgeCount);
+  endRecord(json, epochMs);
+}
+
+void FirebaseManager::beginRecord(JsonWriter &json, const char *sensorPath,
+                                  const char *key) {
+  json.append("\"/sensors/");
+  json.append(sensorPath);
+  json.append('/');
+  json.append(key);
+  json.append("\":{\"value\":");
+}
 
-  return eventJson;
+void FirebaseManager::endRecord(JsonWriter &json, uint64_t epochMs) {
+  if (epochMs != 0) {
+    json.append(",\"timestamp\":");
+    json.appendUInt64(epochMs);
+    json.append('}');
+  } else {
+    json.append(",\"timestamp\":{\".sv\":\"timestamp\"}}");
+  }
 }
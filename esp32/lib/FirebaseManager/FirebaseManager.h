@@ -10,12 +10,108 @@
 #include <FirebaseClient.h>
 
 #include "../../include/DataTypes.h"
+#include "AlarmEvaluator.h"
+#include "BatchController.h"
+#include "JsonWriter.h"
+#include "LatencyHistogram.h"
+#include "Metrics.h"
+#include "OfflineLog.h"
 #include "PushId.h"
+#include "RetryScheduler.h"
+#include "SensorBatch.h"
+#include "SeriesCodec.h"
+#include "TimeSync.h"
+#include "Trace.h"
+#include "WindowStats.h"
+
+// Maximum number of events merged into one upload
+#define MAX_EVENTS_PER_UPLOAD 16
+
+// Maximum number of alarms in one upload
+#define MAX_ALARMS_PER_UPLOAD 8
+
+// Size of one upload payload buffer (worst case is ~1300 bytes of window
+// summary records plus ~90 bytes per event)
+#define JSON_BUFFER_SIZE 3072
+
+// Maximum number of uploads queued in the async client at once. Its one
+// connection carries them one at a time; the window keeps it busy, it
+// does not add throughput.
+#define UPLOAD_WINDOW_SIZE 4
+
+// Slots only alarm uploads may take, so an alarm always gets a slot (on
+// the connection it still follows the batches queued before it)
+#define ALARM_RESERVED_SLOTS 1
+
+// Resending failed uploads: delay doubles per failed attempt (with
+// jitter) up to the maximum, and an upload is given up after its attempt
+// budget. Alarms are retried sooner and longer.
+#define UPLOAD_RETRY_BASE_MS 2000
+#define UPLOAD_RETRY_MAX_MS 60000
+#define UPLOAD_MAX_ATTEMPTS 8
+#define ALARM_RETRY_BASE_MS 250
+#define ALARM_RETRY_MAX_MS 4000
+#define ALARM_MAX_ATTEMPTS 30
+
+// Circuit breaker: after this many failures in a row uploads stop (new
+// data goes to the offline log) and a single probe is sent after the open
+// time, doubling per failed probe. Alarms are always sent.
+#define BREAKER_FAILURE_THRESHOLD 5
+#define BREAKER_OPEN_MS 15000
+#define BREAKER_MAX_OPEN_MS 240000
+
+// TLS handshake timeout (s); a stalled handshake must not hold the
+// pipeline for the client's default of 120 s
+#define TLS_HANDSHAKE_TIMEOUT_S 15
+
+// What an upload slot carries (alarms may use the reserved slots)
+enum UploadKind { UPLOAD_BATCH, UPLOAD_RAW, UPLOAD_ALARM, UPLOAD_METRICS };
+
+// One upload in the async pipeline. The payload (including its push keys)
+// is kept until acknowledged, so a retry rewrites the same locations and
+// is idempotent. body is the payload as the client takes it: filled once
+// on the first send, passed by reference to every send and retry, and
+// freed once the upload is acknowledged or given up.
+struct UploadSlot {
+  bool inUse;
+  bool inFlight;
+  UploadKind kind;
+  uint8_t attempts;
+  int readingCount;
+  int eventCount;
+  int alarmCount;
+  unsigned long oldestReading;
+  unsigned long oldestEvent;
+  unsigned long oldestAlarm;
+  unsigned long serializeTime;
+  unsigned long sentAt;
+  unsigned long failedAt;
+  unsigned long retryDelay;
+  unsigned long *syncTarget;
+
+  // Records read from the offline logs: the read positions after them,
+  // committed once Firebase has acknowledged the upload
+  bool fromLog;
+  OfflineLogPosition sensorPosition;
+  OfflineLogPosition eventPosition;
+
+  // Records of a live batch, put back into the offline logs if the upload
+  // is given up without the server refusing it
+  bool hasSummary;
+  WindowSummary summary;
+  EventData events[MAX_EVENTS_PER_UPLOAD];
+
+  size_t length;
+  char payload[JSON_BUFFER_SIZE];
+  object_t body;
+};
 
 class FirebaseManager {
 public:
-  // Constructor
-  FirebaseManager(const char *firebaseHost, const char *firebaseAuth);
+  // Constructor. With rootCa (PEM) the server certificate is validated
+  // against it; without, certificates are not checked
+  FirebaseManager(const char *firebaseHost, const char *firebaseAuth,
+                  const char *rootCa = NULL);
 
   // Initialize Firebase connection (must be called from task, not setup)
   void begin();
@@ -23,19 +119,92 @@ public:
   // Check if Firebase is ready
   bool isReady();
 
-  // Maintain Firebase connection (call regularly)
+  // Check if the circuit breaker holds back uploads (alarms still go out)
+  bool isCircuitOpen();
+
+  // Report request round trips and failures to a batching controller
+  // (its decisions are included in the metrics report)
+  void setBatchController(BatchController *controller);
+
+  // Offline logs that batch uploads with fromLog set were read from
+  void setOfflineLogs(OfflineLog *sensorLog, OfflineLog *eventLog);
+
+  // Wall clock for records captured before the first sync (epochMs 0):
+  // their capture time is resolved when they are serialized. Without it,
+  // or while unsynced, they carry the server time.
+  void setTimeSync(TimeSync *timeSync);
+
+  // Maintain Firebase connection and resend failed uploads (call regularly)
   void loop();
 
-  // Upload batch of sensor data to Firebase
-  bool uploadBatch(SensorData *dataArray, int count,
-                   unsigned long &lastSyncTime);
+  // Queue a window summary and events as one multi-location update
+  // (summary may be NULL, eventCount 0; returns false if window is full).
+  // lastSyncTime is updated when Firebase acknowledges it. With fromLog,
+  // the records were just read from the offline logs: the logs are
+  // committed up to them on acknowledgement and rewound if the upload is
+  // given up, so a reboot in between loses nothing. Their capture times
+  // are serialized as read: only the reader knows which were taken this
+  // boot and can still be resolved (see OfflineLog::isReadFromThisBoot).
+  bool uploadBatch(const WindowSummary *summary, EventData *events,
+                   int eventCount, unsigned long &lastSyncTime,
+                   bool fromLog = false);
+
+  // Check if an upload of offline log records awaits acknowledgement (the
+  // logs must not be read again until it completes)
+  bool isDrainPending();
+
+  // Queue every reading of a window as one compressed raw block under
+  // /sensors/raw (returns false if the window is full).
+  // lastSyncTime is updated when Firebase acknowledges it
+  bool uploadRaw(const SensorBatch &batch, unsigned long &lastSyncTime);
+
+  // Queue alarm records under /sensors/alarm right away, using the slots
+  // reserved for alarms if the rest are busy (returns false if none is
+  // free). lastSyncTime is updated when Firebase acknowledges it
+  bool uploadAlarms(const AlarmData *alarms, int count,
+                    unsigned long &lastSyncTime);
+
+  // Queue a metrics snapshot (plus the upload statistics) as
+  // /metrics/<deviceId>, replacing the previous one (returns false if the
+  // window is full)
+  bool uploadMetrics(const MetricsSnapshot &snapshot, const char *deviceId);
+
+  // Check if the upload window has a free slot for a non-alarm upload
+  bool canSubmit();
 
-  // Upload single event to Firebase
-  bool uploadEvent(const EventData &event);
+  // Number of uploads waiting for acknowledgement
+  int getPendingUploads();
+
+  // Upload counters (acknowledged requests and the events they carried)
+  uint32_t getRequestCount();
+  uint32_t getEventCount();
+
+  // Worst event detection -> acknowledgement latency seen so far
+  unsigned long getMaxEventLatency();
+
+  // Acknowledged alarms and their sample -> acknowledgement latency
+  uint32_t getAlarmCount();
+  unsigned long getLastAlarmLatency();
+  unsigned long getMaxAlarmLatency();
+
+  // Resent uploads and failed attempts
+  uint32_t getRetryCount();
+  uint32_t getFailureCount();
+
+  // Uploads given up after their attempt budget, and circuit breaker trips
+  uint32_t getAbandonedCount();
+  uint32_t getBreakerTripCount();
+
+  // TLS connection counters: full handshakes, requests sent on an already
+  // open connection, and connections lost
+  uint32_t getHandshakeCount();
+  uint32_t getReusedCount();
+  uint32_t getDisconnectCount();
 
 private:
   const char *_firebaseHost;
   const char *_firebaseAuth;
+  const char *_rootCa;
 
   // Firebase objects
   WiFiClientSecure _sslClient;
@@ -44,11 +213,146 @@ private:
   FirebaseApp _app;
   RealtimeDatabase _database;
 
-  // Build JSON for batch update
-  String buildBatchJson(SensorData *dataArray, int count);
+  // Upload window. Payloads are serialized into the slots' fixed buffers
+  // without allocating; handing one to the client costs one copy into the
+  // slot's body per upload (FirebaseClient takes an object_t), none per
+  // retry, held only while the upload is pending.
+  UploadSlot _slots[UPLOAD_WINDOW_SIZE];
+
+  // Upload counters
+  uint32_t _requestCount;
+  uint32_t _eventCount;
+  unsigned long _maxEventLatency;
+  uint32_t _alarmCount;
+  unsigned long _lastAlarmLatency;
+  unsigned long _maxAlarmLatency;
+  uint32_t _retryCount;
+  uint32_t _failureCount;
+  uint32_t _abandonedCount;
+
+  // Retry delays, attempt budgets and circuit breaker
+  RetryScheduler _retry;
+
+  // Batching controller fed with request results (optional)
+  BatchController *_batching;
+
+  // Offline logs drained through batch uploads (optional)
+  OfflineLog *_sensorLog;
+  OfflineLog *_eventLog;
+
+  // Wall clock for capture times not known at capture (optional)
+  TimeSync *_timeSync;
+
+  // TLS connection state and counters
+  bool _connected;
+  unsigned long _connectedAt;
+  uint32_t _connectionRequests;
+  uint32_t _handshakeCount;
+  uint32_t _reusedCount;
+  uint32_t _disconnectCount;
+
+  // Latency histograms (ms): request round trip, oldest reading or event
+  // to acknowledgement, alarm sample to acknowledgement
+  LatencyHistogram _rttHistogram;
+  LatencyHistogram _latencyHistogram;
+  LatencyHistogram _alarmLatencyHistogram;
+
+  // Duration (ms) of the loop iterations that opened a connection, i.e.
+  // TCP connect plus full TLS handshake
+  LatencyHistogram _handshakeHistogram;
+
+  // Instance for the static result callback
+  static FirebaseManager *_instance;
+
+  // Async result callback (runs inside _app.loop() on CloudTask)
+  static void onUploadResult(AsyncResult &aResult);
+
+  // Handle completion of the upload in a slot
+  void handleResult(AsyncResult &aResult);
+
+  // Follow the TLS connection after a loop iteration that started at
+  // startMs with the given minimum free heap
+  void trackConnection(unsigned long startMs, uint32_t minFreeHeap);
+
+  // Find a free slot, or NULL if the window is full (only alarm uploads
+  // may take the reserved slots)
+  UploadSlot *acquireSlot(UploadKind kind);
+
+  // Number of slots not in use
+  int freeSlots();
+
+  // Hand a slot's payload to the async client
+  void sendSlot(int index);
+
+  // Commit the offline logs up to a slot's records (consumed), or rewind
+  // them to be read again
+  void settleLogRead(const UploadSlot &slot, bool consumed);
+
+  // Free a slot whose upload is done, with its body
+  void releaseSlot(UploadSlot &slot);
+
+  // Append the records of a live batch slot to the offline logs, returns
+  // false if any of them could not be saved
+  bool requeueToLogs(const UploadSlot &slot);
+
+  // Retry policy of an upload kind
+  static const RetryPolicy &retryPolicy(UploadKind kind);
+
+  // Check if an error code is the server refusing the payload: HTTP 4xx
+  // except 408 (timeout) and 429 (rate limit), which are worth a retry
+  static bool isRejection(int code);
+
+  // Wall-clock time of a record captured at localMs this boot: epochMs
+  // if it was known at capture, else resolved now (0 while unsynced)
+  uint64_t resolveEpochMs(uint64_t epochMs, unsigned long localMs);
+
+  // Build JSON for batch update (summary records followed by events),
+  // resolving capture times not known at capture if resolveTimes is set
+  bool buildBatchJson(JsonWriter &json, const WindowSummary *summary,
+                      EventData *events, int eventCount, bool resolveTimes);
+
+  // Append one record per sensor for a window stamped with epochMs,
+  // consuming keys from the array
+  void appendSummaryRecords(JsonWriter &json, const WindowSummary &summary,
+                            char (*keys)[PUSH_ID_LENGTH + 1],
+                            uint64_t epochMs);
+
+  // Append the window statistics of one channel (after "value")
+  void appendChannelStats(JsonWriter &json, const ChannelSummary &channel);
+
+  // Build JSON for a raw block: one delta-of-delta/varint/base64 series
+  // per channel (present samples only), the capture time offsets and a
+  // presence bitmap per channel with missing samples
+  bool buildRawJson(JsonWriter &json, const SensorBatch &batch);
+
+  // Append one encoded series as "name":"<base64>"
+  void appendSeries(JsonWriter &json, const char *name,
+                    const SeriesEncoder &encoder);
+
+  // Build JSON for a metrics snapshot
+  bool buildMetricsJson(JsonWriter &json, const MetricsSnapshot &snapshot,
+                        const char *deviceId);
+
+  // Append "name":{n, mean, p50, p90, max, buckets} of a histogram
+  void appendHistogram(JsonWriter &json, const char *name,
+                       const LatencyHistogram &histogram);
+
+  // Build JSON for alarm records
+  bool buildAlarmJson(JsonWriter &json, const AlarmData *alarms, int count);
+
+  // Append one alarm record
+  void appendAlarmRecord(JsonWriter &json, const AlarmData &alarm,
+                         const char *key);
+
+  // Append one event record stamped with epochMs
+  void appendEventRecord(JsonWriter &json, const EventData &event,
+                         const char *key, uint64_t epochMs);
 
-  // Build JSON for single event
-  String buildEventJson(const EventData &event, const String &key);
+  // Append one "/sensors/<path>/<key>":{"value":...} record (value is
+  // written by the caller between the two calls). The record is stamped
+  // with epochMs, or with the server time if it is 0 (time not synced).
+  void beginRecord(JsonWriter &json, const char *sensorPath, const char *key);
+  void endRecord(JsonWriter &json, uint64_t epochMs);
 };
 
 #endif // FIREBASE_MANAGER_H
@@ -0,0 +1,140 @@
+#include "JsonWriter.h"
+
+JsonWriter::JsonWriter(char *buffer, size_t capacity)
+    : _buffer(buffer), _capacity(capacity), _length(0), _overflow(false) {
+  reset();
+}
+
+void JsonWriter::reset() {
+  _length = 0;
+  _overflow = false;
+  if (_capacity > 0) {
+    _buffer[0] = '\0';
+  }
+}
+
+void JsonWriter::append(char c) {
+  // Keep one byte for the terminating NUL
+  if (_length + 1 >= _capacity) {
+    _overflow = true;
+    return;
+  }
+  _buffer[_length++] = c;
+  _buffer[_length] = '\0';
+}
+
+void JsonWriter::append(const char *text) {
+  while (*text != '\0') {
+    append(*text++);
+  }
+}
+
+void JsonWriter::appendString(const char *text) {
+  append('"');
+  append(text);
+  append('"');
+}
+
+void JsonWriter::appendBase64(const uint8_t *data, size_t length) {
+  static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  append('"');
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t group = (uint32_t)data[i] << 16;
+    if (i + 1 < length) {
+      group |= (uint32_t)data[i + 1] << 8;
+    }
+    if (i + 2 < length) {
+      group |= data[i + 2];
+    }
+
+    append(alphabet[(group >> 18) & 0x3F]);
+    append(alphabet[(group >> 12) & 0x3F]);
+    append(i + 1 < length ? alphabet[(group >> 6) & 0x3F] : '=');
+    append(i + 2 < length ? alphabet[group & 0x3F] : '=');
+  }
+  append('"');
+}
+
+void JsonWriter::appendInt(long value) {
+  if (value < 0) {
+    append('-');
+    // Negate in unsigned space so LONG_MIN does not overflow
+    appendUInt(0UL - (unsigned long)value);
+  } else {
+    appendUInt((unsigned long)value);
+  }
+}
+
+void JsonWriter::appendUInt(unsigned long value) {
+  // Emit digits in reverse into a scratch buffer, then copy forward
+  char digits[20];
+  int count = 0;
+  do {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  while (count > 0) {
+    append(digits[--count]);
+  }
+}
+
+void JsonWriter::appendUInt64(uint64_t value) {
+  // 32-bit values take the cheaper path
+  if (value <= 0xFFFFFFFFUL) {
+    appendUInt((unsigned long)value);
+    return;
+  }
+
+  char digits[20];
+  int count = 0;
+  do {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  while (count > 0) {
+    append(digits[--count]);
+  }
+}
+
+void JsonWriter::appendFloat(float value, uint8_t decimals) {
+  // JSON has no NaN/Infinity, emit null instead
+  if (value != value || value > 3.4e38f || value < -3.4e38f) {
+    append("null");
+    return;
+  }
+
+  unsigned long scale = 1;
+  for (uint8_t i = 0; i < decimals; i++) {
+    scale *= 10;
+  }
+
+  bool negative = value < 0;
+  float magnitude = negative ? -value : value;
+  unsigned long scaled = (unsigned long)(magnitude * scale + 0.5f);
+
+  if (negative && scaled > 0) {
+    append('-');
+  }
+  appendUInt(scaled / scale);
+
+  if (decimals > 0) {
+    append('.');
+    unsigned long fraction = scaled % scale;
+    // Leading zeros of the fractional part
+    for (unsigned long div = scale / 10; div > 1 && fraction < div;
+         div /= 10) {
+      append('0');
+    }
+    appendUInt(fraction);
+  }
+}
+
+const char *JsonWriter::c_str() const { return _buffer; }
+
+size_t JsonWriter::length() const { return _length; }
+
+bool JsonWriter::overflowed() const { return _overflow; }
@@ -0,0 +1,48 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming JSON text writer over a caller-owned buffer.
+// Never allocates: output that does not fit is truncated and the writer is
+// flagged as overflowed, so callers can detect and skip the upload.
+class JsonWriter {
+public:
+  // Constructor (buffer must outlive the writer)
+  JsonWriter(char *buffer, size_t capacity);
+
+  // Discard current contents and start over
+  void reset();
+
+  // Append raw text (caller is responsible for JSON escaping)
+  void append(const char *text);
+  void append(char c);
+
+  // Append a quoted string (no escaping, keys/paths are plain ASCII)
+  void appendString(const char *text);
+
+  // Append binary data as a quoted base64 string (standard alphabet)
+  void appendBase64(const uint8_t *data, size_t length);
+
+  // Format numbers in place
+  void appendInt(long value);
+  void appendUInt(unsigned long value);
+  void appendUInt64(uint64_t value); // e.g. epoch milliseconds
+  void appendFloat(float value, uint8_t decimals);
+
+  // Access the NUL-terminated output
+  const char *c_str() const;
+  size_t length() const;
+
+  // True if any append did not fit in the buffer
+  bool overflowed() const;
+
+private:
+  char *_buffer;
+  size_t _capacity;
+  size_t _length;
+  bool _overflow;
+};
+
+#endif // JSON_WRITER_H
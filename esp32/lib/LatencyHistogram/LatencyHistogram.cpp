@@ -0,0 +1,67 @@
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram() { reset(); }
+
+void LatencyHistogram::reset() {
+  for (uint8_t b = 0; b < LATENCY_HISTOGRAM_BUCKETS; b++) {
+    _buckets[b] = 0;
+  }
+  _count = 0;
+  _max = 0;
+  _sum = 0;
+}
+
+void LatencyHistogram::add(uint32_t value) {
+  // Bucket = number of significant bits
+  uint8_t bucket = (value == 0) ? 0 : 32 - __builtin_clz(value);
+  if (bucket >= LATENCY_HISTOGRAM_BUCKETS) {
+    bucket = LATENCY_HISTOGRAM_BUCKETS - 1;
+  }
+  _buckets[bucket]++;
+  _count++;
+  _sum += value;
+  if (value > _max) {
+    _max = value;
+  }
+}
+
+uint32_t LatencyHistogram::getCount() const { return _count; }
+
+uint32_t LatencyHistogram::getMax() const { return _max; }
+
+uint32_t LatencyHistogram::getMean() const {
+  return _count > 0 ? (uint32_t)(_sum / _count) : 0;
+}
+
+uint32_t LatencyHistogram::getBucket(uint8_t bucket) const {
+  return bucket < LATENCY_HISTOGRAM_BUCKETS ? _buckets[bucket] : 0;
+}
+
+uint8_t LatencyHistogram::getUsedBuckets() const {
+  uint8_t used = LATENCY_HISTOGRAM_BUCKETS;
+  while (used > 0 && _buckets[used - 1] == 0) {
+    used--;
+  }
+  return used;
+}
+
+uint32_t LatencyHistogram::getPercentile(float p) const {
+  if (_count == 0) {
+    return 0;
+  }
+  uint32_t rank = (uint32_t)(p * _count);
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < LATENCY_HISTOGRAM_BUCKETS; b++) {
+    seen += _buckets[b];
+    if (seen > rank) {
+      // Never report more than the largest sample
+      uint32_t upper = (b == 0) ? 0 : bucketFloor(b) * 2 - 1;
+      return upper < _max ? upper : _max;
+    }
+  }
+  return _max;
+}
+
+uint32_t LatencyHistogram::bucketFloor(uint8_t bucket) {
+  return bucket == 0 ? 0 : (uint32_t)1 << (bucket - 1);
+}
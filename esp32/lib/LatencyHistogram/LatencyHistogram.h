@@ -0,0 +1,44 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+// Number of log2 buckets (covers the whole uint32 range)
+#define LATENCY_HISTOGRAM_BUCKETS 32
+
+// Fixed-size log-scale histogram of durations (any unit). Bucket 0 holds
+// zeros, bucket i holds [2^(i-1), 2^i), the last bucket everything above.
+// Pure logic, constant memory and O(1) per sample.
+class LatencyHistogram {
+public:
+  // Constructor
+  LatencyHistogram();
+
+  // Remove all samples
+  void reset();
+
+  // Record one sample
+  void add(uint32_t value);
+
+  uint32_t getCount() const;
+  uint32_t getMax() const;
+  uint32_t getMean() const;
+  uint32_t getBucket(uint8_t bucket) const;
+
+  // Number of buckets up to the last non-empty one
+  uint8_t getUsedBuckets() const;
+
+  // Upper bound of the bucket holding the p-quantile (0..1)
+  uint32_t getPercentile(float p) const;
+
+  // Lower bound of a bucket
+  static uint32_t bucketFloor(uint8_t bucket);
+
+private:
+  uint32_t _buckets[LATENCY_HISTOGRAM_BUCKETS];
+  uint32_t _count;
+  uint32_t _max;
+  uint64_t _sum;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,61 @@
+#include "LcdFrame.h"
+#include <string.h>
+
+LcdFrame::LcdFrame() { clear(); }
+
+void LcdFrame::clear() { memset(_cells, ' ', sizeof(_cells)); }
+
+void LcdFrame::setChar(uint8_t row, uint8_t col, char c) {
+  if (row < LCD_ROWS && col < LCD_COLS) {
+    _cells[row][col] = c;
+  }
+}
+
+uint8_t LcdFrame::print(uint8_t row, uint8_t col, const char *text) {
+  if (row >= LCD_ROWS) {
+    return col;
+  }
+  while (col < LCD_COLS && *text != '\0') {
+    _cells[row][col++] = *text++;
+  }
+  return col;
+}
+
+char LcdFrame::get(uint8_t row, uint8_t col) const {
+  return (row < LCD_ROWS && col < LCD_COLS) ? _cells[row][col] : ' ';
+}
+
+uint8_t LcdFrame::diff(const LcdFrame &shown, LcdRun *runs,
+                       uint8_t maxRuns) const {
+  uint8_t count = 0;
+  for (uint8_t row = 0; row < LCD_ROWS; row++) {
+    LcdRun *open = NULL;
+    for (uint8_t col = 0; col < LCD_COLS; col++) {
+      if (_cells[row][col] == shown._cells[row][col]) {
+        continue;
+      }
+
+      // Extend the open run over a short gap, otherwise start a new one
+      if (open != NULL &&
+          col - (open->col + open->length) <= LCD_RUN_MERGE_GAP) {
+        open->length = col - open->col + 1;
+      } else if (count < maxRuns) {
+        open = &runs[count++];
+        open->row = row;
+        open->col = col;
+        open->length = 1;
+      } else {
+        return count; // rest is left for the next diff
+      }
+    }
+  }
+  return count;
+}
+
+uint16_t LcdFrame::writeCount(const LcdRun *runs, uint8_t count) {
+  uint16_t writes = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    writes += 1 + runs[i].length;
+  }
+  return writes;
+}
@@ -0,0 +1,58 @@
+#ifndef LCD_FRAME_H
+#define LCD_FRAME_H
+
+#include <stdint.h>
+
+// LCD Display configuration
+#define LCD_COLS 20
+#define LCD_ROWS 4
+
+// Unchanged cells between two changes that are rewritten rather than
+// skipped: a cursor move costs as much as writing one cell
+#define LCD_RUN_MERGE_GAP 1
+
+// Upper bound on the runs of one diff
+#define LCD_MAX_RUNS (LCD_ROWS * LCD_COLS / 2)
+
+// Consecutive changed cells of one row
+struct LcdRun {
+  uint8_t row;
+  uint8_t col;
+  uint8_t length;
+};
+
+// Character framebuffer of the LCD. Frames are composed in RAM and
+// diffed against the frame on the display, so only changed cells are
+// sent. Pure logic, no display access.
+class LcdFrame {
+public:
+  // Constructor (all blanks)
+  LcdFrame();
+
+  // Fill with blanks
+  void clear();
+
+  // Set one cell (custom characters are 0-7)
+  void setChar(uint8_t row, uint8_t col, char c);
+
+  // Write text from a cell on, truncated at the end of the row; returns
+  // the column after the text
+  uint8_t print(uint8_t row, uint8_t col, const char *text);
+
+  // Cell content
+  char get(uint8_t row, uint8_t col) const;
+
+  // Runs of cells that differ from shown (runs closer than
+  // LCD_RUN_MERGE_GAP are merged); returns the number of runs. With fewer
+  // than LCD_MAX_RUNS slots, later changes may be left out
+  uint8_t diff(const LcdFrame &shown, LcdRun *runs, uint8_t maxRuns) const;
+
+  // LCD writes needed for the runs (one cursor command per run plus one
+  // write per cell)
+  static uint16_t writeCount(const LcdRun *runs, uint8_t count);
+
+private:
+  char _cells[LCD_ROWS][LCD_COLS];
+};
+
+#endif // LCD_FRAME_H
@@ -0,0 +1,161 @@
+#include "Metrics.h"
+
+Metrics::Metrics()
+    : _taskCount(0), _queueCount(0), _lastTotalRunTime(0),
+      _lock(portMUX_INITIALIZER_UNLOCKED) {
+  _deviceId[0] = '\0';
+}
+
+void Metrics::begin() {
+  uint64_t mac = ESP.getEfuseMac();
+  snprintf(_deviceId, sizeof(_deviceId), "esp32-%012llx",
+           (unsigned long long)(mac & 0xFFFFFFFFFFFFULL));
+}
+
+void Metrics::addTask(const char *name, TaskHandle_t handle,
+                      uint32_t stackSize) {
+  if (_taskCount >= METRICS_MAX_TASKS || handle == NULL) {
+    return;
+  }
+  TaskEntry &entry = _tasks[_taskCount++];
+  entry.name = name;
+  entry.handle = handle;
+  entry.stackSize = stackSize;
+  entry.lastRunTime = 0;
+}
+
+void Metrics::addQueue(const char *name, QueueHandle_t queue,
+                       uint16_t capacity) {
+  if (_queueCount >= METRICS_MAX_QUEUES || queue == NULL) {
+    return;
+  }
+  QueueEntry &entry = _queues[_queueCount++];
+  entry.name = name;
+  entry.queue = queue;
+  entry.ring = NULL;
+  entry.capacity = capacity;
+  entry.peak = 0;
+}
+
+void Metrics::addRing(const char *name, const SpscRing *ring) {
+  if (_queueCount >= METRICS_MAX_QUEUES || ring == NULL) {
+    return;
+  }
+  QueueEntry &entry = _queues[_queueCount++];
+  entry.name = name;
+  entry.queue = NULL;
+  entry.ring = ring;
+  entry.capacity = ring->capacity();
+  entry.peak = 0;
+}
+
+void Metrics::sample() {
+  for (uint8_t i = 0; i < _queueCount; i++) {
+    uint16_t waiting = depth(_queues[i]);
+    portENTER_CRITICAL(&_lock);
+    if (waiting > _queues[i].peak) {
+      _queues[i].peak = waiting;
+    }
+    portEXIT_CRITICAL(&_lock);
+  }
+}
+
+void Metrics::collect(MetricsSnapshot &snapshot) {
+  snapshot.uptimeMs = millis();
+  snapshot.droppedPackets = 0;
+  snapshot.freeHeap = ESP.getFreeHeap();
+  snapshot.minFreeHeap = ESP.getMinFreeHeap();
+  snapshot.largestFreeBlock = ESP.getMaxAllocHeap();
+
+  // Stack high-water marks are in bytes on ESP32
+  snapshot.taskCount = _taskCount;
+  for (uint8_t i = 0; i < _taskCount; i++) {
+    TaskMetrics &task = snapshot.tasks[i];
+    task.name = _tasks[i].name;
+    task.stackSize = _tasks[i].stackSize;
+    task.stackFree = uxTaskGetStackHighWaterMark(_tasks[i].handle);
+    task.cpuPermille = -1;
+  }
+  collectCpu(snapshot);
+
+  snapshot.queueCount = _queueCount;
+  for (uint8_t i = 0; i < _queueCount; i++) {
+    QueueMetrics &queue = snapshot.queues[i];
+    queue.name = _queues[i].name;
+    queue.capacity = _queues[i].capacity;
+    queue.depth = depth(_queues[i]);
+    portENTER_CRITICAL(&_lock);
+    queue.peak = _queues[i].peak > queue.depth ? _queues[i].peak
+                                               : queue.depth;
+    _queues[i].peak = 0;
+    portEXIT_CRITICAL(&_lock);
+  }
+}
+
+const char *Metrics::getDeviceId() { return _deviceId; }
+
+void Metrics::print(const MetricsSnapshot &snapshot) {
+  Serial.println("\n=== Metrics ===");
+  Serial.printf("Heap: free %u, min free %u, largest block %u\n",
+                snapshot.freeHeap, snapshot.minFreeHeap,
+                snapshot.largestFreeBlock);
+  for (uint8_t i = 0; i < snapshot.taskCount; i++) {
+    const TaskMetrics &task = snapshot.tasks[i];
+    Serial.printf("%-10s stack %u/%u free", task.name, task.stackFree,
+                  task.stackSize);
+    if (task.cpuPermille >= 0) {
+      Serial.printf(", cpu %d.%d%%", task.cpuPermille / 10,
+                    task.cpuPermille % 10);
+    }
+    Serial.println();
+  }
+  for (uint8_t i = 0; i < snapshot.queueCount; i++) {
+    const QueueMetrics &queue = snapshot.queues[i];
+    Serial.printf("%-10s queue %u/%u (peak %u)\n", queue.name, queue.depth,
+                  queue.capacity, queue.peak);
+  }
+  Serial.printf("Dropped packets: %u\n", snapshot.droppedPackets);
+  Serial.println("===============\n");
+}
+
+uint16_t Metrics::depth(const QueueEntry &entry) {
+  if (entry.ring != NULL) {
+    return entry.ring->size();
+  }
+  return uxQueueMessagesWaiting(entry.queue);
+}
+
+void Metrics::collectCpu(MetricsSnapshot &snapshot) {
+#if configGENERATE_RUN_TIME_STATS == 1 && configUSE_TRACE_FACILITY == 1
+  // Static: too large for the caller's stack, only used from one task
+  static TaskStatus_t status[METRICS_MAX_SYSTEM_TASKS];
+  uint32_t totalRunTime;
+  UBaseType_t count =
+      uxTaskGetSystemState(status, METRICS_MAX_SYSTEM_TASKS, &totalRunTime);
+  if (count == 0) {
+    return; // more tasks than METRICS_MAX_SYSTEM_TASKS
+  }
+
+  // Per-task counters run on the task's core, so shares are of one core
+  uint32_t elapsed = totalRunTime - _lastTotalRunTime;
+  _lastTotalRunTime = totalRunTime;
+
+  for (uint8_t i = 0; i < _taskCount; i++) {
+    for (UBaseType_t j = 0; j < count; j++) {
+      if (status[j].xHandle != _tasks[i].handle) {
+        continue;
+      }
+      uint32_t runTime = status[j].ulRunTimeCounter;
+      if (elapsed > 0) {
+        snapshot.tasks[i].cpuPermille =
+            (int16_t)((uint64_t)(runTime - _tasks[i].lastRunTime) * 1000 /
+                      elapsed);
+      }
+      _tasks[i].lastRunTime = runTime;
+      break;
+    }
+  }
+#else
+  (void)snapshot; // no runtime stats: shares stay unknown
+#endif
+}
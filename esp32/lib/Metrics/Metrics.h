@@ -0,0 +1,105 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "SpscRing.h"
+#include <Arduino.h>
+
+// Registered tasks and queues (FreeRTOS queues and rings)
+#define METRICS_MAX_TASKS 8
+#define METRICS_MAX_QUEUES 4
+
+// Tasks read from FreeRTOS per collection (all tasks in the system)
+#define METRICS_MAX_SYSTEM_TASKS 24
+
+// Length of the device id ("esp32-" + 12 hex digits of the MAC)
+#define METRICS_DEVICE_ID_LENGTH 18
+
+// Snapshot of one task
+struct TaskMetrics {
+  const char *name;
+  uint32_t stackSize; // bytes, 0 if unknown
+  uint32_t stackFree; // lowest free stack seen (high-water mark, bytes)
+  int16_t cpuPermille; // share of one core since the last collection, -1
+                       // if runtime stats are not enabled
+};
+
+// Snapshot of one queue
+struct QueueMetrics {
+  const char *name;
+  uint16_t capacity;
+  uint16_t depth; // items waiting at collection time
+  uint16_t peak;  // most items seen waiting since the last collection
+};
+
+// Device metrics at one point in time
+struct MetricsSnapshot {
+  unsigned long uptimeMs;
+  uint32_t freeHeap;
+  uint32_t minFreeHeap;      // lowest free heap since boot
+  uint32_t largestFreeBlock; // largest allocatable block
+  uint8_t taskCount;
+  TaskMetrics tasks[METRICS_MAX_TASKS];
+  uint8_t queueCount;
+  QueueMetrics queues[METRICS_MAX_QUEUES];
+  uint32_t droppedPackets; // filled in by the caller
+};
+
+// Runtime instrumentation: task stacks and CPU, heap and queue depths.
+// sample() runs often (queue peaks), collect() once per report.
+class Metrics {
+public:
+  // Constructor
+  Metrics();
+
+  // Build the device id from the MAC address
+  void begin();
+
+  // Register a task or queue to report (name must stay valid)
+  void addTask(const char *name, TaskHandle_t handle, uint32_t stackSize);
+  void addQueue(const char *name, QueueHandle_t queue, uint16_t capacity);
+  void addRing(const char *name, const SpscRing *ring);
+
+  // Record queue depths (call periodically, e.g. every second)
+  void sample();
+
+  // Fill a snapshot and start the next CPU/peak interval
+  void collect(MetricsSnapshot &snapshot);
+
+  // Device id used in the metrics path
+  const char *getDeviceId();
+
+  // Print a snapshot to serial
+  static void print(const MetricsSnapshot &snapshot);
+
+private:
+  struct TaskEntry {
+    const char *name;
+    TaskHandle_t handle;
+    uint32_t stackSize;
+    uint32_t lastRunTime;
+  };
+
+  struct QueueEntry {
+    const char *name;
+    QueueHandle_t queue;  // NULL for a ring
+    const SpscRing *ring; // NULL for a FreeRTOS queue
+    uint16_t capacity;
+    uint16_t peak;
+  };
+
+  char _deviceId[METRICS_DEVICE_ID_LENGTH + 1];
+  TaskEntry _tasks[METRICS_MAX_TASKS];
+  uint8_t _taskCount;
+  QueueEntry _queues[METRICS_MAX_QUEUES];
+  uint8_t _queueCount;
+  uint32_t _lastTotalRunTime;
+  portMUX_TYPE _lock;
+
+  // Items waiting in a queue or ring
+  static uint16_t depth(const QueueEntry &entry);
+
+  // Fill per-task CPU shares from the FreeRTOS runtime counters
+  void collectCpu(MetricsSnapshot &snapshot);
+};
+
+#endif // METRICS_H
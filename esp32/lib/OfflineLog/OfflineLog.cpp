@@ -0,0 +1,369 @@
+#include "OfflineLog.h"
+
+// Record overhead: magic + length byte in front, CRC-32 behind
+#define RECORD_HEADER_SIZE 2
+#define RECORD_CRC_SIZE 4
+
+// A payload length must fit the record's length byte, and a record of the
+// largest payload only a small part of a segment: segments rotate once
+// they reach their size, so a record may run past it, never by more
+static_assert(OFFLINE_LOG_MAX_PAYLOAD <= UINT8_MAX,
+              "Payload length does not fit the length byte");
+static_assert(RECORD_HEADER_SIZE + OFFLINE_LOG_MAX_PAYLOAD + RECORD_CRC_SIZE <=
+                  OFFLINE_LOG_SEGMENT_SIZE / 16,
+              "Offline log records too large for the segment size");
+
+// Persisted read cursor
+struct LogCursor {
+  uint32_t seq;
+  uint32_t offset;
+  uint32_t crc;
+};
+
+OfflineLog::OfflineLog(const char *dir)
+    : _dir(dir), _fs(NULL), _ready(false), _firstSeq(1), _writeSeq(1),
+      _bootSeq(1), _cursorSeq(1), _cursorOffset(0), _readSeq(1), _readOffset(0),
+      _readLive(false), _droppedSegments(0) {}
+
+bool OfflineLog::begin(fs::FS &fs) {
+  _fs = &fs;
+
+  if (!_fs->exists(_dir)) {
+    _fs->mkdir(_dir);
+  }
+
+  // Find the range of segment files left from previous boots
+  uint32_t minSeq = 0, maxSeq = 0;
+  fs::File dir = _fs->open(_dir);
+  if (dir && dir.isDirectory()) {
+    fs::File entry = dir.openNextFile();
+    while (entry) {
+      const char *name = entry.name();
+      const char *slash = strrchr(name, '/');
+      if (slash != NULL) {
+        name = slash + 1;
+      }
+      if (strstr(name, ".bin") != NULL) {
+        uint32_t seq = strtoul(name, NULL, 10);
+        if (seq > 0) {
+          if (minSeq == 0 || seq < minSeq) {
+            minSeq = seq;
+          }
+          if (seq > maxSeq) {
+            maxSeq = seq;
+          }
+        }
+      }
+      entry.close();
+      entry = dir.openNextFile();
+    }
+    dir.close();
+  }
+
+  // Always write into a fresh segment: the tail of the previous one may
+  // hold a partially written record
+  if (maxSeq > 0) {
+    _firstSeq = minSeq;
+    _writeSeq = maxSeq + 1;
+  } else {
+    _firstSeq = 1;
+    _writeSeq = 1;
+  }
+  _bootSeq = _writeSeq;
+
+  loadCursor();
+  _readSeq = _cursorSeq;
+  _readOffset = _cursorOffset;
+
+  char path[48];
+  segmentPath(_writeSeq, path, sizeof(path));
+  _writeFile = _fs->open(path, FILE_APPEND);
+  if (!_writeFile) {
+    Serial.printf("Offline log %s: failed to open write segment.\n", _dir);
+    return false;
+  }
+
+  _ready = true;
+  enforceCapacity();
+
+  Serial.printf("Offline log %s ready (segments %u-%u).\n", _dir, _firstSeq,
+                _writeSeq);
+  return true;
+}
+
+bool OfflineLog::append(const void *payload, uint8_t length) {
+  if (!_ready) {
+    return false;
+  }
+
+  // Assemble the whole record so it goes out in a single write
+  uint8_t record[RECORD_HEADER_SIZE + OFFLINE_LOG_MAX_PAYLOAD +
+                 RECORD_CRC_SIZE];
+  record[0] = OFFLINE_LOG_RECORD_MAGIC;
+  record[1] = length;
+  memcpy(record + RECORD_HEADER_SIZE, payload, length);
+
+  uint32_t crc = crc32(0, record + 1, length + 1);
+  uint8_t *crcBytes = record + RECORD_HEADER_SIZE + length;
+  for (int i = 0; i < RECORD_CRC_SIZE; i++) {
+    crcBytes[i] = (crc >> (8 * i)) & 0xFF;
+  }
+
+  size_t recordSize = RECORD_HEADER_SIZE + length + RECORD_CRC_SIZE;
+  size_t written = _writeFile.write(record, recordSize);
+  _writeFile.flush();
+
+  if (written != recordSize) {
+    // A torn record ends its segment: later records go to the next one
+    Serial.printf("Offline log %s: write failed.\n", _dir);
+    rotate();
+    return false;
+  }
+
+  if (_writeFile.size() >= OFFLINE_LOG_SEGMENT_SIZE) {
+    rotate();
+  }
+  return true;
+}
+
+int OfflineLog::read(void *payload, uint8_t maxLength) {
+  if (!_ready) {
+    return -1;
+  }
+
+  while (true) {
+    if (!_readFile) {
+      // Caught up with the writer
+      if (_readSeq >= _writeSeq && _readOffset >= _writeFile.size()) {
+        return -1;
+      }
+
+      char path[48];
+      segmentPath(_readSeq, path, sizeof(path));
+      _readFile = _fs->open(path, FILE_READ);
+      if (!_readFile || !_readFile.seek(_readOffset)) {
+        // Missing segment, skip to the next one
+        _readFile.close();
+        if (_readSeq >= _writeSeq) {
+          return -1;
+        }
+        _readSeq++;
+        _readOffset = 0;
+        continue;
+      }
+      _readLive = (_readSeq == _writeSeq);
+    }
+
+    uint8_t record[RECORD_HEADER_SIZE + OFFLINE_LOG_MAX_PAYLOAD +
+                   RECORD_CRC_SIZE];
+    bool valid = _readFile.read(record, RECORD_HEADER_SIZE) ==
+                     RECORD_HEADER_SIZE &&
+                 record[0] == OFFLINE_LOG_RECORD_MAGIC;
+
+    uint8_t length = valid ? record[1] : 0;
+    if (valid) {
+      size_t bodySize = length + RECORD_CRC_SIZE;
+      valid =
+          _readFile.read(record + RECORD_HEADER_SIZE, bodySize) == bodySize;
+    }
+    if (valid) {
+      const uint8_t *crcBytes = record + RECORD_HEADER_SIZE + length;
+      uint32_t stored = 0;
+      for (int i = 0; i < RECORD_CRC_SIZE; i++) {
+        stored |= (uint32_t)crcBytes[i] << (8 * i);
+      }
+      valid = stored == crc32(0, record + 1, length + 1);
+    }
+
+    if (!valid) {
+      _readFile.close();
+      if (_readSeq >= _writeSeq) {
+        // End of the write segment: no more records for now (a torn
+        // record there rotates the writer, see append())
+        return -1;
+      }
+      if (_readLive) {
+        // The writer moved on since this handle was opened: look again
+        // through a fresh one before leaving the segment
+        _readLive = false;
+        continue;
+      }
+
+      // End of segment (or torn record): continue with the next one
+      _readSeq++;
+      _readOffset = 0;
+      continue;
+    }
+
+    _readOffset += RECORD_HEADER_SIZE + length + RECORD_CRC_SIZE;
+
+    if (length > maxLength) {
+      // Record from an incompatible firmware, skip it
+      continue;
+    }
+
+    memcpy(payload, record + RECORD_HEADER_SIZE, length);
+    return length;
+  }
+}
+
+void OfflineLog::commit() { commit(getReadPosition()); }
+
+OfflineLogPosition OfflineLog::getReadPosition() {
+  OfflineLogPosition position = {_readSeq, _readOffset};
+  return position;
+}
+
+void OfflineLog::commit(const OfflineLogPosition &position) {
+  if (!_ready) {
+    return;
+  }
+
+  // Segments dropped for capacity meanwhile are gone anyway
+  uint32_t seq = position.seq;
+  uint32_t offset = position.offset;
+  if (seq < _firstSeq) {
+    seq = _firstSeq;
+    offset = 0;
+  }
+
+  // Segments before the committed position are fully consumed
+  while (_firstSeq < seq) {
+    char path[48];
+    segmentPath(_firstSeq, path, sizeof(path));
+    _fs->remove(path);
+    _firstSeq++;
+  }
+
+  _cursorSeq = seq;
+  _cursorOffset = offset;
+  saveCursor();
+}
+
+void OfflineLog::rewind() {
+  _readFile.close();
+  _readSeq = _cursorSeq;
+  _readOffset = _cursorOffset;
+}
+
+bool OfflineLog::isEmpty() {
+  if (!_ready) {
+    return true;
+  }
+  return _cursorSeq >= _writeSeq && _cursorOffset >= _writeFile.size();
+}
+
+bool OfflineLog::isReadFromThisBoot() { return _readSeq >= _bootSeq; }
+
+uint32_t OfflineLog::getDroppedSegments() { return _droppedSegments; }
+
+void OfflineLog::segmentPath(uint32_t seq, char *buffer, size_t size) {
+  snprintf(buffer, size, "%s/%08u.bin", _dir, seq);
+}
+
+bool OfflineLog::rotate() {
+  _writeFile.close();
+  _writeSeq++;
+
+  char path[48];
+  segmentPath(_writeSeq, path, sizeof(path));
+  _writeFile = _fs->open(path, FILE_APPEND);
+  if (!_writeFile) {
+    Serial.printf("Offline log %s: failed to rotate segment.\n", _dir);
+    _ready = false;
+    return false;
+  }
+
+  enforceCapacity();
+  return true;
+}
+
+void OfflineLog::enforceCapacity() {
+  bool cursorMoved = false;
+
+  // Drop the oldest segment until the ring fits again
+  while (_writeSeq - _firstSeq + 1 > OFFLINE_LOG_MAX_SEGMENTS) {
+    char path[48];
+    segmentPath(_firstSeq, path, sizeof(path));
+    _fs->remove(path);
+    _firstSeq++;
+    _droppedSegments++;
+
+    if (_cursorSeq < _firstSeq) {
+      _cursorSeq = _firstSeq;
+      _cursorOffset = 0;
+      cursorMoved = true;
+    }
+    if (_readSeq < _firstSeq) {
+      _readFile.close();
+      _readSeq = _firstSeq;
+      _readOffset = 0;
+    }
+  }
+
+  if (cursorMoved) {
+    Serial.printf("Offline log %s full, oldest segment dropped.\n", _dir);
+    saveCursor();
+  }
+}
+
+void OfflineLog::loadCursor() {
+  _cursorSeq = _firstSeq;
+  _cursorOffset = 0;
+
+  char path[48];
+  snprintf(path, sizeof(path), "%s/cursor", _dir);
+  fs::File file = _fs->open(path, FILE_READ);
+  if (!file) {
+    return;
+  }
+
+  LogCursor cursor;
+  bool valid = file.read((uint8_t *)&cursor, sizeof(cursor)) ==
+                   sizeof(cursor) &&
+               cursor.crc == crc32(0, (const uint8_t *)&cursor,
+                                   offsetof(LogCursor, crc));
+  file.close();
+
+  // Ignore cursors pointing outside the segments on flash
+  if (valid && cursor.seq >= _firstSeq && cursor.seq <= _writeSeq) {
+    _cursorSeq = cursor.seq;
+    _cursorOffset = cursor.offset;
+  }
+}
+
+void OfflineLog::saveCursor() {
+  LogCursor cursor;
+  cursor.seq = _cursorSeq;
+  cursor.offset = _cursorOffset;
+  cursor.crc = crc32(0, (const uint8_t *)&cursor, offsetof(LogCursor, crc));
+
+  // Write a new file and rename it over the old one, so power lost
+  // mid-write leaves the previous cursor intact
+  char path[48];
+  char tempPath[48];
+  snprintf(path, sizeof(path), "%s/cursor", _dir);
+  snprintf(tempPath, sizeof(tempPath), "%s/cursor.tmp", _dir);
+  fs::File file = _fs->open(tempPath, FILE_WRITE);
+  if (!file) {
+    return;
+  }
+  bool written = file.write((const uint8_t *)&cursor, sizeof(cursor)) ==
+                 sizeof(cursor);
+  file.close();
+  if (!written || !_fs->rename(tempPath, path)) {
+    Serial.printf("Offline log %s: failed to save cursor.\n", _dir);
+    _fs->remove(tempPath);
+  }
+}
+
+uint32_t OfflineLog::crc32(uint32_t crc, const uint8_t *data, size_t length) {
+  crc = ~crc;
+  while (length--) {
+    crc ^= *data++;
+    for (int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
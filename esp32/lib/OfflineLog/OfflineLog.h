@@ -0,0 +1,111 @@
+#ifndef OFFLINE_LOG_H
+#define OFFLINE_LOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Segment configuration (ring of segment files, oldest dropped when full)
+#define OFFLINE_LOG_SEGMENT_SIZE 16384
+#define OFFLINE_LOG_MAX_SEGMENTS 24
+
+// Largest payload a single record may carry (the most its length byte
+// holds; callers check their record types against it at compile time)
+#define OFFLINE_LOG_MAX_PAYLOAD 255
+
+// Record layout: [magic][length][payload...][crc32 (4 bytes, LE)]
+#define OFFLINE_LOG_RECORD_MAGIC 0xA5
+
+// Position in a log: segment number and byte offset in it
+struct OfflineLogPosition {
+  uint32_t seq;
+  uint32_t offset;
+};
+
+// Append-only store-and-forward log on flash.
+// Records are written to numbered segment files inside one directory. A
+// record whose magic, length or CRC does not check out (e.g. power lost
+// mid-write) ends its segment, so a reboot never corrupts older records.
+// Reads are transactional: read() advances a volatile position, commit()
+// persists it, rewind() returns to the last committed position. The
+// segment being written is read through a second handle, so reading
+// never seals a segment early.
+class OfflineLog {
+public:
+  // Constructor (dir is the directory holding this log's segments)
+  OfflineLog(const char *dir);
+
+  // Scan existing segments and open a fresh write segment
+  bool begin(fs::FS &fs);
+
+  // Append one record (flushed to flash before returning); length is at
+  // most OFFLINE_LOG_MAX_PAYLOAD by its type
+  bool append(const void *payload, uint8_t length);
+
+  // Read next record into payload, returns its length or -1 if none left
+  int read(void *payload, uint8_t maxLength);
+
+  // Persist read position and delete fully consumed segments
+  void commit();
+
+  // Position after the last record read, and committing one taken
+  // earlier (records read after it are read again after a rewind)
+  OfflineLogPosition getReadPosition();
+  void commit(const OfflineLogPosition &position);
+
+  // Return to the last committed read position
+  void rewind();
+
+  // Check if there are no unconsumed records
+  bool isEmpty();
+
+  // Check if the record last read was appended since begin(), i.e. its
+  // millis() timestamps are from this boot
+  bool isReadFromThisBoot();
+
+  // Number of segments dropped because the ring was full
+  uint32_t getDroppedSegments();
+
+private:
+  const char *_dir;
+  fs::FS *_fs;
+  bool _ready;
+
+  // Segment range currently on flash [_firstSeq, _writeSeq]
+  uint32_t _firstSeq;
+  uint32_t _writeSeq;
+  fs::File _writeFile;
+
+  // First segment written since begin()
+  uint32_t _bootSeq;
+
+  // Committed (persisted) and volatile read positions
+  uint32_t _cursorSeq;
+  uint32_t _cursorOffset;
+  uint32_t _readSeq;
+  uint32_t _readOffset;
+  fs::File _readFile;
+
+  // _readFile was opened while its segment was the write segment, so it
+  // may not see later appends
+  bool _readLive;
+
+  uint32_t _droppedSegments;
+
+  // Build "<dir>/<seq>.bin" into buffer
+  void segmentPath(uint32_t seq, char *buffer, size_t size);
+
+  // Close current write segment and start the next one
+  bool rotate();
+
+  // Delete oldest segment when the ring is full
+  void enforceCapacity();
+
+  // Load/store the committed cursor
+  void loadCursor();
+  void saveCursor();
+
+  // CRC-32 (IEEE) over a byte range
+  static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t length);
+};
+
+#endif // OFFLINE_LOG_H
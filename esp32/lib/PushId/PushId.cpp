@@ -4,40 +4,68 @@
 static const char PUSH_CHARS[] =
     "-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz";
 static unsigned long lastPushTime = 0;
-static int lastRandChars[12];
+static uint8_t lastRandChars[12];
 
-String generatePushId() {
-  unsigned long now = millis();
-  bool duplicateTime = (now == lastPushTime);
-  lastPushTime = now;
-
-  char timeStampChars[9];
+// Encode the timestamp part (8 chars, most significant first)
+static void writeTimestampChars(char *out, unsigned long now) {
   for (int i = 7; i >= 0; i--) {
-    timeStampChars[i] = PUSH_CHARS[now % 64];
+    out[i] = PUSH_CHARS[now % 64];
     now = now / 64;
   }
-  timeStampChars[8] = '\0';
+}
 
-  String id = String(timeStampChars);
+// Increment the last random chars to ensure uniqueness within a millisecond
+static void incrementRandChars() {
+  int i;
+  for (i = 11; i >= 0 && lastRandChars[i] == 63; i--) {
+    lastRandChars[i] = 0;
+  }
+  if (i >= 0) {
+    lastRandChars[i]++;
+  }
+}
+
+// Advance the generator state and return the timestamp to encode
+static unsigned long nextPushState() {
+  unsigned long now = millis();
+  bool duplicateTime = (now == lastPushTime);
+  lastPushTime = now;
 
   if (!duplicateTime) {
     for (int i = 0; i < 12; i++) {
       lastRandChars[i] = random(64);
     }
   } else {
-    // Increment the last random chars to ensure uniqueness
-    int i;
-    for (i = 11; i >= 0 && lastRandChars[i] == 63; i--) {
-      lastRandChars[i] = 0;
-    }
-    if (i >= 0) {
-      lastRandChars[i]++;
-    }
+    incrementRandChars();
   }
+  return now;
+}
 
+static void writeRandChars(char *out) {
   for (int i = 0; i < 12; i++) {
-    id += PUSH_CHARS[lastRandChars[i]];
+    out[i] = PUSH_CHARS[lastRandChars[i]];
   }
+}
 
-  return id;
+void generatePushId(char *out) {
+  writeTimestampChars(out, nextPushState());
+  writeRandChars(out + 8);
+  out[PUSH_ID_LENGTH] = '\0';
+}
+
+void generatePushIds(char (*out)[PUSH_ID_LENGTH + 1], int count) {
+  if (count <= 0) {
+    return;
+  }
+
+  // First key follows the normal path (fresh random or increment)
+  generatePushId(out[0]);
+
+  // Remaining keys reuse the timestamp chars and bump the random part
+  for (int k = 1; k < count; k++) {
+    incrementRandChars();
+    memcpy(out[k], out[0], 8);
+    writeRandChars(out[k] + 8);
+    out[k][PUSH_ID_LENGTH] = '\0';
+  }
 }
@@ -3,8 +3,15 @@
 
 #include <Arduino.h>
 
+// Length of a push ID (8 timestamp chars + 12 random chars)
+#define PUSH_ID_LENGTH 20
+
 // Generate a unique push ID locally (similar to Firebase push keys)
-// Returns a 20-character unique ID string
-String generatePushId();
+// Writes 20 characters plus NUL into out (must hold PUSH_ID_LENGTH + 1)
+void generatePushId(char *out);
+
+// Generate count push IDs in one call, strictly increasing in lexical order
+// (all share the same timestamp, random part is incremented per key)
+void generatePushIds(char (*out)[PUSH_ID_LENGTH + 1], int count);
 
 #endif
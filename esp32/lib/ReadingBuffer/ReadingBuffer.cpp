@@ -0,0 +1,240 @@
+#include "ReadingBuffer.h"
+#include <math.h>
+
+// Merge cost added for a pair that spans a window boundary, so such a pair
+// is only merged when every pair does
+#define READING_CROSS_WINDOW_COST 0x10000UL
+
+static void setRecordValue(SensorData &data, uint8_t channel, int value) {
+  switch (channel) {
+  case ANALOG_LIGHT:
+    data.lightValue = value;
+    break;
+  case ANALOG_GAS:
+    data.gasValue = value;
+    break;
+  case ANALOG_FLAME:
+    data.flameValue = value;
+    break;
+  case ANALOG_SOIL_MOISTURE:
+    data.soilMoistureValue = value;
+    break;
+  case ANALOG_SOUND:
+    data.soundValue = value;
+    break;
+  case RECORD_TEMPERATURE:
+    data.temperatureTenths = value;
+    break;
+  default:
+    data.humidityTenths = value;
+    break;
+  }
+}
+
+static bool isRecordSampled(const SensorData &data, uint8_t channel) {
+  if (channel < ANALOG_CHANNEL_COUNT) {
+    return data.isSampled((AnalogChannel)channel);
+  }
+  return channel == RECORD_TEMPERATURE ? data.temperatureValid
+                                       : data.humidityValid;
+}
+
+// Mean of two values weighted by their counts, rounded
+static int weightedMean(int a, uint32_t countA, int b, uint32_t countB) {
+  return (int)lroundf(((float)a * countA + (float)b * countB) /
+                      (countA + countB));
+}
+
+// Value of a record channel (tenths for temperature and humidity)
+static int recordValue(const SensorData &data, uint8_t channel) {
+  switch (channel) {
+  case ANALOG_LIGHT:
+    return data.lightValue;
+  case ANALOG_GAS:
+    return data.gasValue;
+  case ANALOG_FLAME:
+    return data.flameValue;
+  case ANALOG_SOIL_MOISTURE:
+    return data.soilMoistureValue;
+  case ANALOG_SOUND:
+    return data.soundValue;
+  case RECORD_TEMPERATURE:
+    return data.temperatureTenths;
+  default:
+    return data.humidityTenths;
+  }
+}
+
+void makeRecord(const SensorData &data, SensorRecord &record) {
+  record.data = data;
+  record.lastTimestamp = data.timestamp;
+  record.readingCount = 1;
+  for (uint8_t c = 0; c < RECORD_CHANNEL_COUNT; c++) {
+    int value = recordValue(data, c);
+    record.count[c] = isRecordSampled(data, c) ? 1 : 0;
+    record.min[c] = value;
+    record.max[c] = value;
+    record.sum[c] = record.count[c] > 0 ? value : 0;
+  }
+}
+
+void mergeRecords(SensorRecord &record, const SensorRecord &next) {
+  SensorData &data = record.data;
+
+  // Sound features: energy-weighted RMS, peak maximum, the rest averaged
+  uint32_t soundA = record.count[ANALOG_SOUND];
+  uint32_t soundB = next.count[ANALOG_SOUND];
+  if (soundB > 0) {
+    const SensorData &later = next.data;
+    if (soundA == 0) {
+      data.soundRms = later.soundRms;
+      data.soundPeak = later.soundPeak;
+      data.soundZcr = later.soundZcr;
+      for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+        data.soundBands[b] = later.soundBands[b];
+      }
+    } else {
+      float energy = (float)data.soundRms * data.soundRms * soundA +
+                     (float)later.soundRms * later.soundRms * soundB;
+      data.soundRms = (uint16_t)lroundf(sqrtf(energy / (soundA + soundB)));
+      if (later.soundPeak > data.soundPeak) {
+        data.soundPeak = later.soundPeak;
+      }
+      data.soundZcr =
+          weightedMean(data.soundZcr, soundA, later.soundZcr, soundB);
+      for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+        data.soundBands[b] = weightedMean(data.soundBands[b], soundA,
+                                          later.soundBands[b], soundB);
+      }
+    }
+  }
+
+  // Channel sums and ranges; the means follow from the exact sums
+  // (channels never sampled keep the later value)
+  for (uint8_t c = 0; c < RECORD_CHANNEL_COUNT; c++) {
+    uint32_t countA = record.count[c];
+    uint32_t countB = next.count[c];
+    if (countB == 0) {
+      if (countA == 0) {
+        setRecordValue(data, c, recordValue(next.data, c));
+        record.min[c] = next.min[c];
+        record.max[c] = next.max[c];
+      }
+      continue;
+    }
+    if (countA == 0) {
+      record.min[c] = next.min[c];
+      record.max[c] = next.max[c];
+    } else {
+      if (next.min[c] < record.min[c]) {
+        record.min[c] = next.min[c];
+      }
+      if (next.max[c] > record.max[c]) {
+        record.max[c] = next.max[c];
+      }
+    }
+    // Counts saturate long after the sums would overflow a window
+    uint32_t total = countA + countB;
+    record.count[c] = total > UINT16_MAX ? UINT16_MAX : total;
+    record.sum[c] += next.sum[c];
+    setRecordValue(data, c,
+                   (int)lroundf((float)record.sum[c] / record.count[c]));
+  }
+
+  data.analogSampled |= next.data.analogSampled;
+  data.temperatureValid |= next.data.temperatureValid;
+  data.humidityValid |= next.data.humidityValid;
+
+  uint32_t readings = (uint32_t)record.readingCount + next.readingCount;
+  record.readingCount = readings > UINT16_MAX ? UINT16_MAX : readings;
+  record.lastTimestamp = next.lastTimestamp;
+}
+
+ReadingBuffer::ReadingBuffer(unsigned long windowMs)
+    : _head(0), _count(0), _mergeCount(0), _windowMs(windowMs),
+      _clockEpochMs(0), _clockLocalMs(0) {}
+
+void ReadingBuffer::setClock(uint64_t epochMs, unsigned long localMs) {
+  _clockEpochMs = epochMs;
+  _clockLocalMs = localMs;
+}
+
+void ReadingBuffer::push(const SensorRecord &record) {
+  if (_count == READING_BUFFER_CAPACITY) {
+    mergeCheapestPair();
+  }
+  at(_count) = record;
+  _count++;
+}
+
+const SensorRecord &ReadingBuffer::front() const { return at(0); }
+
+void ReadingBuffer::pop() {
+  if (_count == 0) {
+    return;
+  }
+  _head = (_head + 1) % READING_BUFFER_CAPACITY;
+  _count--;
+}
+
+uint16_t ReadingBuffer::count() const { return _count; }
+
+uint32_t ReadingBuffer::getReadingCount() const {
+  uint32_t readings = 0;
+  for (uint16_t i = 0; i < _count; i++) {
+    readings += at(i).readingCount;
+  }
+  return readings;
+}
+
+bool ReadingBuffer::isEmpty() const { return _count == 0; }
+
+uint32_t ReadingBuffer::getMergeCount() const { return _mergeCount; }
+
+SensorRecord &ReadingBuffer::at(uint16_t i) {
+  return _records[(_head + i) % READING_BUFFER_CAPACITY];
+}
+
+const SensorRecord &ReadingBuffer::at(uint16_t i) const {
+  return _records[(_head + i) % READING_BUFFER_CAPACITY];
+}
+
+uint64_t ReadingBuffer::windowOf(unsigned long localMs) const {
+  if (_clockEpochMs == 0) {
+    return localMs / _windowMs;
+  }
+  return (_clockEpochMs + (long)(localMs - _clockLocalMs)) / _windowMs;
+}
+
+bool ReadingBuffer::sameWindow(const SensorRecord &a,
+                               const SensorRecord &b) const {
+  // Window of the first reading of a and of the last reading of b, on
+  // the wall clock once synced and on uptime before
+  return windowOf(a.data.timestamp) == windowOf(b.lastTimestamp);
+}
+
+void ReadingBuffer::mergeCheapestPair() {
+  uint16_t best = 0;
+  uint32_t bestCost = UINT32_MAX;
+  for (uint16_t i = 0; i + 1 < _count; i++) {
+    const SensorRecord &a = at(i);
+    const SensorRecord &b = at(i + 1);
+    uint32_t cost = (uint32_t)a.readingCount + b.readingCount;
+    if (!sameWindow(a, b)) {
+      cost += READING_CROSS_WINDOW_COST;
+    }
+    if (cost < bestCost) {
+      best = i;
+      bestCost = cost;
+    }
+  }
+
+  mergeRecords(at(best), at(best + 1));
+
+  // Close the gap (later records move one place towards the head)
+  for (uint16_t i = best + 1; i + 1 < _count; i++) {
+    at(i) = at(i + 1);
+  }
+  _count--;
+  _mergeCount++;
+}
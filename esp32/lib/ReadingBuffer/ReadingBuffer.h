@@ -0,0 +1,69 @@
+#ifndef READING_BUFFER_H
+#define READING_BUFFER_H
+
+#include "../../include/DataTypes.h"
+
+// Records held at most (108 bytes each on the ESP32)
+#define READING_BUFFER_CAPACITY 64
+
+// Turn one reading into a record of one reading
+void makeRecord(const SensorData &data, SensorRecord &record);
+
+// Merge next (the later record) into record: counts and sums add up,
+// ranges widen, sound features are weighted by their sample counts
+void mergeRecords(SensorRecord &record, const SensorRecord &next);
+
+// FIFO of records that never refuses a reading: when it is full, the two
+// adjacent records holding the fewest readings are merged first (oldest
+// pair on ties, pairs within one summary window before pairs across a
+// boundary). A long stall thus costs resolution, oldest first, but never
+// a stretch of time.
+class ReadingBuffer {
+public:
+  // Constructor (merged records stay within windows of windowMs, aligned
+  // as in WindowAggregator)
+  ReadingBuffer(unsigned long windowMs);
+
+  // Wall-clock time (0 while unsynced) at local time localMs, for the
+  // window alignment of the records pushed next
+  void setClock(uint64_t epochMs, unsigned long localMs);
+
+  // Append a record, merging the cheapest pair first if full
+  void push(const SensorRecord &record);
+
+  // Oldest record (buffer must not be empty) and its removal
+  const SensorRecord &front() const;
+  void pop();
+
+  // Records and readings held
+  uint16_t count() const;
+  uint32_t getReadingCount() const;
+  bool isEmpty() const;
+
+  // Merges performed so far
+  uint32_t getMergeCount() const;
+
+private:
+  SensorRecord _records[READING_BUFFER_CAPACITY];
+  uint16_t _head;
+  uint16_t _count;
+  uint32_t _mergeCount;
+  unsigned long _windowMs;
+  uint64_t _clockEpochMs;
+  unsigned long _clockLocalMs;
+
+  // Record i positions after the oldest
+  SensorRecord &at(uint16_t i);
+  const SensorRecord &at(uint16_t i) const;
+
+  // Window of a local timestamp (on uptime while unsynced)
+  uint64_t windowOf(unsigned long localMs) const;
+
+  // Check if two records start in the same summary window
+  bool sameWindow(const SensorRecord &a, const SensorRecord &b) const;
+
+  // Merge the cheapest adjacent pair, freeing one record
+  void mergeCheapestPair();
+};
+
+#endif // READING_BUFFER_H
@@ -0,0 +1,106 @@
+#include "RetryScheduler.h"
+
+RetryScheduler::RetryScheduler(const BreakerPolicy &breaker)
+    : _breaker(breaker), _state(BREAKER_CLOSED), _failures(0), _openedAt(0),
+      _openMs(breaker.openMs), _probeInFlight(false), _tripCount(0),
+      _random(1) {}
+
+void RetryScheduler::seed(uint32_t seed) {
+  // xorshift never leaves zero
+  _random = (seed != 0) ? seed : 1;
+}
+
+uint32_t RetryScheduler::retryDelay(const RetryPolicy &policy,
+                                    uint8_t attempts) {
+  // Exponential: base, 2x base, 4x base ... capped at the maximum
+  uint32_t delay = policy.baseDelayMs;
+  for (uint8_t i = 1; i < attempts && delay < policy.maxDelayMs; i++) {
+    delay *= 2;
+  }
+  if (delay > policy.maxDelayMs) {
+    delay = policy.maxDelayMs;
+  }
+
+  // Equal jitter: between half and all of the delay, so devices that
+  // failed together do not retry together
+  uint32_t half = delay / 2;
+  return half + nextRandom() % (half + 1);
+}
+
+bool RetryScheduler::canRetry(const RetryPolicy &policy,
+                              uint8_t attempts) const {
+  return attempts < policy.maxAttempts;
+}
+
+bool RetryScheduler::isAllowed(uint32_t nowMs) const {
+  BreakerState state = getState(nowMs);
+  return state == BREAKER_CLOSED ||
+         (state == BREAKER_HALF_OPEN && !_probeInFlight);
+}
+
+bool RetryScheduler::allowRequest(uint32_t nowMs) {
+  if (!isAllowed(nowMs)) {
+    return false;
+  }
+  if (getState(nowMs) == BREAKER_HALF_OPEN) {
+    _state = BREAKER_HALF_OPEN;
+    _probeInFlight = true;
+  }
+  return true;
+}
+
+void RetryScheduler::recordSuccess() {
+  // Any success shows the server is reachable again
+  _state = BREAKER_CLOSED;
+  _failures = 0;
+  _openMs = _breaker.openMs;
+  _probeInFlight = false;
+}
+
+void RetryScheduler::recordRejected() {
+  // The refusal says nothing against the link; only the payload is bad
+  recordSuccess();
+}
+
+void RetryScheduler::recordFailure(uint32_t nowMs) {
+  if (_failures < UINT8_MAX) {
+    _failures++;
+  }
+
+  if (_state == BREAKER_HALF_OPEN && _probeInFlight) {
+    // Failed probe: back off longer before the next one
+    _probeInFlight = false;
+    _openMs *= 2;
+    if (_openMs > _breaker.maxOpenMs) {
+      _openMs = _breaker.maxOpenMs;
+    }
+    trip(nowMs);
+  } else if (_state == BREAKER_CLOSED &&
+             _failures >= _breaker.failureThreshold) {
+    trip(nowMs);
+  }
+}
+
+BreakerState RetryScheduler::getState(uint32_t nowMs) const {
+  if (_state == BREAKER_OPEN && nowMs - _openedAt >= _openMs) {
+    return BREAKER_HALF_OPEN;
+  }
+  return _state;
+}
+
+uint8_t RetryScheduler::getConsecutiveFailures() const { return _failures; }
+
+uint32_t RetryScheduler::getTripCount() const { return _tripCount; }
+
+void RetryScheduler::trip(uint32_t nowMs) {
+  _state = BREAKER_OPEN;
+  _openedAt = nowMs;
+  _tripCount++;
+}
+
+uint32_t RetryScheduler::nextRandom() {
+  _random ^= _random << 13;
+  _random ^= _random >> 17;
+  _random ^= _random << 5;
+  return _random;
+}
@@ -0,0 +1,85 @@
+#ifndef RETRY_SCHEDULER_H
+#define RETRY_SCHEDULER_H
+
+#include <stdint.h>
+
+// Retry policy of one kind of request. The delay before a retry doubles
+// with each failed attempt from baseDelayMs up to maxDelayMs (equal
+// jitter: a random point in the upper half). After maxAttempts the
+// request is given up.
+struct RetryPolicy {
+  uint32_t baseDelayMs;
+  uint32_t maxDelayMs;
+  uint8_t maxAttempts;
+};
+
+// Circuit breaker policy. After failureThreshold consecutive failures the
+// circuit opens and requests are held back for openMs; then a single
+// probe is let through (half-open). A failed probe reopens the circuit
+// for twice as long, up to maxOpenMs.
+struct BreakerPolicy {
+  uint8_t failureThreshold;
+  uint32_t openMs;
+  uint32_t maxOpenMs;
+};
+
+enum BreakerState { BREAKER_CLOSED, BREAKER_OPEN, BREAKER_HALF_OPEN };
+
+// Retry delays, attempt budgets and a circuit breaker shared by all
+// requests to one server. Pure logic, all times are passed in and the
+// jitter comes from a seeded generator, so a policy can be replayed
+// against scripted failure sequences on the host.
+class RetryScheduler {
+public:
+  // Constructor
+  RetryScheduler(const BreakerPolicy &breaker);
+
+  // Seed the jitter generator
+  void seed(uint32_t seed);
+
+  // Delay before the next attempt of a request that failed attempts times
+  uint32_t retryDelay(const RetryPolicy &policy, uint8_t attempts);
+
+  // Check if a request that was sent attempts times may be sent again
+  bool canRetry(const RetryPolicy &policy, uint8_t attempts) const;
+
+  // Check if a request may be sent at nowMs, without taking the probe
+  bool isAllowed(uint32_t nowMs) const;
+
+  // Check if a request may be sent at nowMs. In the half-open state this
+  // takes the single probe, so call it right before sending.
+  bool allowRequest(uint32_t nowMs);
+
+  // Report the outcome of a request
+  void recordSuccess();
+  void recordFailure(uint32_t nowMs);
+
+  // Report a request the server answered but refused (HTTP 4xx): the
+  // server is reachable, so this ends a probe and closes the circuit
+  void recordRejected();
+
+  // Breaker state (open turns half-open once its time is up)
+  BreakerState getState(uint32_t nowMs) const;
+
+  // Failures in a row and number of times the circuit opened
+  uint8_t getConsecutiveFailures() const;
+  uint32_t getTripCount() const;
+
+private:
+  BreakerPolicy _breaker;
+  BreakerState _state;
+  uint8_t _failures;
+  uint32_t _openedAt;
+  uint32_t _openMs;
+  bool _probeInFlight;
+  uint32_t _tripCount;
+  uint32_t _random;
+
+  // Open the circuit at nowMs for the current open time
+  void trip(uint32_t nowMs);
+
+  // Next value of the jitter generator (xorshift32)
+  uint32_t nextRandom();
+};
+
+#endif // RETRY_SCHEDULER_H
@@ -0,0 +1,125 @@
+#include "SamplingScheduler.h"
+#include <stdlib.h>
+
+SamplingScheduler::SamplingScheduler() : _configured(0), _origin(0) {}
+
+void SamplingScheduler::configure(uint8_t channel,
+                                  const SamplingPolicy &policy) {
+  if (channel >= SAMPLING_MAX_CHANNELS || policy.minPeriodMs == 0) {
+    return;
+  }
+  Channel &c = _channels[channel];
+  c.policy = policy;
+  c.period = policy.minPeriodMs;
+  c.nextDue = 0;
+  c.lastTime = 0;
+  c.lastValue = 0;
+  c.moveTime = 0;
+  c.moveValue = 0;
+  c.samples = 0;
+  _configured |= (1 << channel);
+}
+
+void SamplingScheduler::start(uint32_t nowMs) {
+  _origin = nowMs;
+  for (uint8_t i = 0; i < SAMPLING_MAX_CHANNELS; i++) {
+    _channels[i].nextDue = nowMs;
+  }
+}
+
+uint8_t SamplingScheduler::due(uint32_t nowMs) const {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < SAMPLING_MAX_CHANNELS; i++) {
+    // Wraparound-safe: due once nowMs is at or past nextDue
+    if ((_configured & (1 << i)) &&
+        (int32_t)(nowMs - _channels[i].nextDue) >= 0) {
+      mask |= (1 << i);
+    }
+  }
+  return mask;
+}
+
+uint32_t SamplingScheduler::msUntilNext(uint32_t nowMs) const {
+  uint32_t wait = UINT32_MAX;
+  for (uint8_t i = 0; i < SAMPLING_MAX_CHANNELS; i++) {
+    if (!(_configured & (1 << i))) {
+      continue;
+    }
+    int32_t remaining = (int32_t)(_channels[i].nextDue - nowMs);
+    if (remaining <= 0) {
+      return 0;
+    }
+    if ((uint32_t)remaining < wait) {
+      wait = remaining;
+    }
+  }
+  return wait;
+}
+
+void SamplingScheduler::update(uint8_t channel, int value, uint32_t nowMs) {
+  if (channel >= SAMPLING_MAX_CHANNELS || !(_configured & (1 << channel))) {
+    return;
+  }
+  Channel &c = _channels[channel];
+
+  // Change rate: a change within the deadband of the last sample past it
+  // is noise. Past it, the faster of the last step and the drift since
+  // then, so a ramp that moves less than the deadband per sample still
+  // counts as fast.
+  float rate = 0.0f;
+  bool moved = false;
+  uint32_t sinceMove = nowMs - c.moveTime;
+  uint32_t sinceLast = nowMs - c.lastTime;
+  int drift = abs(value - c.moveValue);
+  if (c.samples > 0 && sinceMove > 0 && sinceLast > 0) {
+    rate = drift * 1000.0f / sinceMove;
+    moved = drift > c.policy.deadband;
+    float step = abs(value - c.lastValue) * 1000.0f / sinceLast;
+    if (moved && step > rate) {
+      rate = step;
+    }
+  }
+
+  c.period = nextPeriod(c, value, rate, moved);
+  if (c.samples == 0 || moved) {
+    c.moveTime = nowMs;
+    c.moveValue = value;
+  }
+  c.lastTime = nowMs;
+  c.lastValue = value;
+  c.samples++;
+
+  // Next multiple of the period since start, so that channels with
+  // related periods fall due together and late wakeups do not drift
+  c.nextDue = nowMs - (nowMs - _origin) % c.period + c.period;
+}
+
+uint32_t SamplingScheduler::getPeriod(uint8_t channel) const {
+  return channel < SAMPLING_MAX_CHANNELS ? _channels[channel].period : 0;
+}
+
+uint32_t SamplingScheduler::getSampleCount(uint8_t channel) const {
+  return channel < SAMPLING_MAX_CHANNELS ? _channels[channel].samples : 0;
+}
+
+uint32_t SamplingScheduler::nextPeriod(const Channel &channel, int value,
+                                       float rate, bool moved) const {
+  const SamplingPolicy &policy = channel.policy;
+
+  bool alarm = false;
+  if (policy.threshold != SAMPLING_NO_THRESHOLD) {
+    alarm = policy.alarmBelow ? value <= policy.threshold
+                              : value >= policy.threshold;
+  }
+
+  // Tighten at once, relax one step per quiet sample. Changes within the
+  // deadband never tighten, but hold the period while their rate is high.
+  if (alarm || (moved && rate >= policy.fastRate)) {
+    return policy.minPeriodMs;
+  }
+  if (rate < policy.fastRate / 4) {
+    uint32_t period = channel.period * 2;
+    return period < policy.maxPeriodMs ? period : policy.maxPeriodMs;
+  }
+  return channel.period;
+}
@@ -0,0 +1,78 @@
+#ifndef SAMPLING_SCHEDULER_H
+#define SAMPLING_SCHEDULER_H
+
+#include <stdint.h>
+
+// Maximum number of scheduled channels (one bit each in a due mask)
+#define SAMPLING_MAX_CHANNELS 8
+
+// Threshold value that disables the threshold rule of a channel
+#define SAMPLING_NO_THRESHOLD -1
+
+// Sampling policy of one channel. The period snaps to minPeriodMs while
+// the value changes faster than fastRate or is past the threshold, and
+// doubles per quiet sample (change below a quarter of fastRate) up to
+// maxPeriodMs. Changes within the deadband never tighten the period, and
+// rates are measured from the last sample past the deadband, so a slow
+// ramp still counts as fast. Periods should be power-of-two multiples of
+// a common base so that channels fall due together.
+struct SamplingPolicy {
+  uint32_t minPeriodMs;
+  uint32_t maxPeriodMs;
+  float fastRate;  // change per second that counts as fast
+  int deadband;    // largest change that counts as no change
+  int threshold;   // alarm level, or SAMPLING_NO_THRESHOLD
+  bool alarmBelow; // true if values at or below threshold are the alarm
+};
+
+// Per-channel sampling scheduler. Pure logic, all times are passed in, so
+// a policy can be replayed against recorded traces on the host: call
+// due() at each step, feed the trace values of the due channels to
+// update() and advance to msUntilNext().
+class SamplingScheduler {
+public:
+  // Constructor
+  SamplingScheduler();
+
+  // Set a channel's policy (channels start at their minimum period)
+  void configure(uint8_t channel, const SamplingPolicy &policy);
+
+  // Make every configured channel due at nowMs
+  void start(uint32_t nowMs);
+
+  // Bit mask of channels due at nowMs
+  uint8_t due(uint32_t nowMs) const;
+
+  // Time until the next channel falls due (0 if one is due)
+  uint32_t msUntilNext(uint32_t nowMs) const;
+
+  // Record a sample of a due channel and schedule its next one
+  void update(uint8_t channel, int value, uint32_t nowMs);
+
+  // Current period and number of samples taken
+  uint32_t getPeriod(uint8_t channel) const;
+  uint32_t getSampleCount(uint8_t channel) const;
+
+private:
+  struct Channel {
+    SamplingPolicy policy;
+    uint32_t period;
+    uint32_t nextDue;
+    uint32_t lastTime;
+    int lastValue;
+    uint32_t moveTime; // last sample past the deadband
+    int moveValue;
+    uint32_t samples;
+  };
+
+  Channel _channels[SAMPLING_MAX_CHANNELS];
+  uint8_t _configured;
+  uint32_t _origin; // start time, due times are multiples of periods after
+
+  // Period after a sample that changed at rate (per second), moved if the
+  // change was past the deadband
+  uint32_t nextPeriod(const Channel &channel, int value, float rate,
+                      bool moved) const;
+};
+
+#endif // SAMPLING_SCHEDULER_H
@@ -0,0 +1,54 @@
+#include "SensorBatch.h"
+
+SensorBatch::SensorBatch() { clear(); }
+
+void SensorBatch::clear() {
+  _count = 0;
+  _firstEpochMs = 0;
+}
+
+static int16_t sampledOrMissing(const SensorData &data,
+                                AnalogChannel channel, uint16_t value) {
+  return data.isSampled(channel) ? value : SENSOR_BATCH_MISSING;
+}
+
+bool SensorBatch::append(const SensorData &data) {
+  if (_count >= SENSOR_BATCH_CAPACITY) {
+    return false;
+  }
+
+  // Channels not sampled for this reading are marked missing
+  uint16_t i = _count++;
+  _timestamps[i] = data.timestamp;
+  _columns[COLUMN_LIGHT][i] = sampledOrMissing(data, ANALOG_LIGHT,
+                                               data.lightValue);
+  _columns[COLUMN_GAS][i] = sampledOrMissing(data, ANALOG_GAS,
+                                             data.gasValue);
+  _columns[COLUMN_FLAME][i] = sampledOrMissing(data, ANALOG_FLAME,
+                                               data.flameValue);
+  _columns[COLUMN_SOIL_MOISTURE][i] =
+      sampledOrMissing(data, ANALOG_SOIL_MOISTURE, data.soilMoistureValue);
+  _columns[COLUMN_SOUND][i] = sampledOrMissing(data, ANALOG_SOUND,
+                                               data.soundValue);
+  _columns[COLUMN_TEMPERATURE][i] =
+      data.temperatureValid ? data.temperatureTenths : SENSOR_BATCH_MISSING;
+  _columns[COLUMN_HUMIDITY][i] =
+      data.humidityValid ? data.humidityTenths : SENSOR_BATCH_MISSING;
+  return true;
+}
+
+uint16_t SensorBatch::count() const { return _count; }
+
+bool SensorBatch::isFull() const { return _count >= SENSOR_BATCH_CAPACITY; }
+
+const unsigned long *SensorBatch::timestamps() const { return _timestamps; }
+
+void SensorBatch::setFirstEpochMs(uint64_t epochMs) {
+  _firstEpochMs = epochMs;
+}
+
+uint64_t SensorBatch::firstEpochMs() const { return _firstEpochMs; }
+
+const int16_t *SensorBatch::column(BatchColumn column) const {
+  return _columns[column];
+}
@@ -0,0 +1,58 @@
+#ifndef SENSOR_BATCH_H
+#define SENSOR_BATCH_H
+
+#include "../../include/DataTypes.h"
+
+// Readings one batch can hold
+#define SENSOR_BATCH_CAPACITY 120
+
+// Column value of a channel not sampled (or invalid) for a reading
+#define SENSOR_BATCH_MISSING INT16_MIN
+
+// Value columns of a batch (ADC counts, tenths for temperature/humidity)
+enum BatchColumn {
+  COLUMN_LIGHT,
+  COLUMN_GAS,
+  COLUMN_FLAME,
+  COLUMN_SOIL_MOISTURE,
+  COLUMN_SOUND,
+  COLUMN_TEMPERATURE,
+  COLUMN_HUMIDITY,
+  COLUMN_COUNT
+};
+
+// Structure-of-arrays batch of readings. Each channel is one contiguous
+// int16 array, so per-channel loops (encoding, reductions) stream through
+// memory instead of striding over whole records.
+class SensorBatch {
+public:
+  // Constructor
+  SensorBatch();
+
+  // Remove all readings
+  void clear();
+
+  // Append one reading, false if the batch is full
+  bool append(const SensorData &data);
+
+  // Wall-clock time of the first reading (0: unknown), set once per batch
+  void setFirstEpochMs(uint64_t epochMs);
+
+  uint16_t count() const;
+  bool isFull() const;
+
+  // Capture times (millis) and wall-clock time of the first reading
+  const unsigned long *timestamps() const;
+  uint64_t firstEpochMs() const;
+
+  // Values of one channel
+  const int16_t *column(BatchColumn column) const;
+
+private:
+  uint16_t _count;
+  uint64_t _firstEpochMs;
+  unsigned long _timestamps[SENSOR_BATCH_CAPACITY];
+  int16_t _columns[COLUMN_COUNT][SENSOR_BATCH_CAPACITY];
+};
+
+#endif // SENSOR_BATCH_H
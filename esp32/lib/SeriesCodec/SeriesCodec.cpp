@@ -0,0 +1,99 @@
+#include "SeriesCodec.h"
+
+// Differences are taken in uint32_t, so overflow wraps instead of being
+// undefined behavior
+static inline int32_t wrapSub(int32_t a, int32_t b) {
+  return (int32_t)((uint32_t)a - (uint32_t)b);
+}
+
+static inline int32_t wrapAdd(int32_t a, int32_t b) {
+  return (int32_t)((uint32_t)a + (uint32_t)b);
+}
+
+SeriesEncoder::SeriesEncoder(uint8_t *buffer, size_t capacity)
+    : _buffer(buffer), _capacity(capacity) {
+  reset();
+}
+
+void SeriesEncoder::reset() {
+  _length = 0;
+  _overflow = false;
+  _count = 0;
+  _previous = 0;
+  _previousDelta = 0;
+}
+
+void SeriesEncoder::add(int32_t value) {
+  if (_count == 0) {
+    writeVarint(value);
+  } else {
+    int32_t delta = wrapSub(value, _previous);
+    writeVarint(_count == 1 ? delta : wrapSub(delta, _previousDelta));
+    _previousDelta = delta;
+  }
+  _previous = value;
+  _count++;
+}
+
+const uint8_t *SeriesEncoder::data() const { return _buffer; }
+
+size_t SeriesEncoder::length() const { return _length; }
+
+bool SeriesEncoder::overflowed() const { return _overflow; }
+
+void SeriesEncoder::writeVarint(int32_t value) {
+  // Zigzag: small magnitudes of either sign become small unsigned values
+  uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+
+  do {
+    uint8_t byte = zigzag & 0x7F;
+    zigzag >>= 7;
+    if (zigzag != 0) {
+      byte |= 0x80;
+    }
+    if (_length >= _capacity) {
+      _overflow = true;
+      return;
+    }
+    _buffer[_length++] = byte;
+  } while (zigzag != 0);
+}
+
+SeriesDecoder::SeriesDecoder(const uint8_t *data, size_t length)
+    : _data(data), _length(length), _position(0), _count(0), _previous(0),
+      _previousDelta(0) {}
+
+bool SeriesDecoder::next(int32_t &value) {
+  int32_t decoded;
+  if (!readVarint(decoded)) {
+    return false;
+  }
+
+  if (_count == 0) {
+    value = decoded;
+  } else {
+    int32_t delta =
+        (_count == 1) ? decoded : wrapAdd(_previousDelta, decoded);
+    value = wrapAdd(_previous, delta);
+    _previousDelta = delta;
+  }
+  _previous = value;
+  _count++;
+  return true;
+}
+
+bool SeriesDecoder::readVarint(int32_t &value) {
+  uint32_t zigzag = 0;
+  for (int shift = 0; shift < 7 * SERIES_MAX_VARINT_BYTES; shift += 7) {
+    if (_position >= _length) {
+      return false;
+    }
+    uint8_t byte = _data[_position++];
+    zigzag |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      value = (int32_t)((zigzag >> 1) ^ (0U - (zigzag & 1)));
+      return true;
+    }
+  }
+  return false;
+}
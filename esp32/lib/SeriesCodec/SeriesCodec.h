@@ -0,0 +1,73 @@
+#ifndef SERIES_CODEC_H
+#define SERIES_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact integer time-series encoding for raw uploads.
+// The stream holds the first value, then the first delta, then the
+// delta-of-delta of every following value, each as a zigzag LEB128
+// varint. Regularly spaced timestamps and slowly drifting sensor values
+// encode to one byte per sample. Arithmetic wraps modulo 2^32 on both
+// sides, so any int32 series round-trips exactly.
+// (The dashboard-side decoder is web/src/lib/series-codec.ts.)
+
+// Worst case encoded size of one value
+#define SERIES_MAX_VARINT_BYTES 5
+
+// Streaming encoder into a caller-owned buffer
+class SeriesEncoder {
+public:
+  // Constructor (buffer must outlive the encoder)
+  SeriesEncoder(uint8_t *buffer, size_t capacity);
+
+  // Discard current contents and start a new series
+  void reset();
+
+  // Append the next value of the series
+  void add(int32_t value);
+
+  // Encoded bytes
+  const uint8_t *data() const;
+  size_t length() const;
+
+  // True if a value did not fit in the buffer
+  bool overflowed() const;
+
+private:
+  uint8_t *_buffer;
+  size_t _capacity;
+  size_t _length;
+  bool _overflow;
+
+  uint32_t _count;
+  int32_t _previous;
+  int32_t _previousDelta;
+
+  // Append one zigzag varint
+  void writeVarint(int32_t value);
+};
+
+// Streaming decoder over an encoded buffer
+class SeriesDecoder {
+public:
+  // Constructor (data must outlive the decoder)
+  SeriesDecoder(const uint8_t *data, size_t length);
+
+  // Decode the next value, false at the end or on a malformed varint
+  bool next(int32_t &value);
+
+private:
+  const uint8_t *_data;
+  size_t _length;
+  size_t _position;
+
+  uint32_t _count;
+  int32_t _previous;
+  int32_t _previousDelta;
+
+  // Read one zigzag varint
+  bool readVarint(int32_t &value);
+};
+
+#endif // SERIES_CODEC_H
@@ -0,0 +1,146 @@
+#include "SoundAnalyzer.h"
+#include <math.h>
+#include <string.h>
+
+// Upper edges of the frequency bands (last band ends at Nyquist)
+static const float BAND_UPPER_HZ[SOUND_ANALYZER_BANDS - 1] = {250.0f, 500.0f,
+                                                              1000.0f};
+
+SoundAnalyzer::SoundAnalyzer(float sampleRateHz)
+    : _sampleRate(sampleRateHz), _count(0) {
+  const float twoPi = 6.28318530718f;
+
+  // Hann window reduces leakage between bands
+  for (int i = 0; i < SOUND_WINDOW_SIZE; i++) {
+    _hann[i] = 0.5f - 0.5f * cosf(twoPi * i / (SOUND_WINDOW_SIZE - 1));
+  }
+
+  // Twiddle factors
+  for (int k = 0; k < SOUND_WINDOW_SIZE / 2; k++) {
+    _cos[k] = cosf(twoPi * k / SOUND_WINDOW_SIZE);
+    _sin[k] = -sinf(twoPi * k / SOUND_WINDOW_SIZE);
+  }
+
+  // Band edges as FFT bins (bin 0 is DC and is skipped)
+  float binWidth = _sampleRate / SOUND_WINDOW_SIZE;
+  _bandEdges[0] = 1;
+  for (int b = 0; b < SOUND_ANALYZER_BANDS - 1; b++) {
+    int bin = (int)(BAND_UPPER_HZ[b] / binWidth + 0.5f);
+    if (bin < _bandEdges[b]) {
+      bin = _bandEdges[b];
+    }
+    if (bin > SOUND_WINDOW_SIZE / 2) {
+      bin = SOUND_WINDOW_SIZE / 2;
+    }
+    _bandEdges[b + 1] = bin;
+  }
+  _bandEdges[SOUND_ANALYZER_BANDS] = SOUND_WINDOW_SIZE / 2 + 1;
+
+  memset(&_features, 0, sizeof(_features));
+}
+
+bool SoundAnalyzer::addSample(uint16_t sample) {
+  _samples[_count++] = sample;
+  if (_count < SOUND_WINDOW_SIZE) {
+    return false;
+  }
+
+  analyzeWindow();
+  _count = 0;
+  return true;
+}
+
+const SoundFeatures &SoundAnalyzer::getFeatures() const { return _features; }
+
+void SoundAnalyzer::analyzeWindow() {
+  // DC level of the microphone bias
+  uint32_t sum = 0;
+  for (int i = 0; i < SOUND_WINDOW_SIZE; i++) {
+    sum += _samples[i];
+  }
+  float mean = (float)sum / SOUND_WINDOW_SIZE;
+
+  // Time-domain features on the AC signal
+  float energy = 0.0f;
+  float peak = 0.0f;
+  int crossings = 0;
+  float previous = _samples[0] - mean;
+  for (int i = 0; i < SOUND_WINDOW_SIZE; i++) {
+    float x = _samples[i] - mean;
+    energy += x * x;
+    float magnitude = fabsf(x);
+    if (magnitude > peak) {
+      peak = magnitude;
+    }
+    if ((x >= 0.0f) != (previous >= 0.0f)) {
+      crossings++;
+    }
+    previous = x;
+
+    _re[i] = x * _hann[i];
+    _im[i] = 0.0f;
+  }
+
+  _features.rms = sqrtf(energy / SOUND_WINDOW_SIZE);
+  _features.peak = peak;
+  _features.zcr = (float)crossings / SOUND_WINDOW_SIZE;
+
+  // Spectral energy per band (one-sided power spectrum)
+  fft();
+
+  float bandPower[SOUND_ANALYZER_BANDS];
+  float totalPower = 0.0f;
+  for (int b = 0; b < SOUND_ANALYZER_BANDS; b++) {
+    bandPower[b] = 0.0f;
+    for (int k = _bandEdges[b]; k < _bandEdges[b + 1]; k++) {
+      bandPower[b] += _re[k] * _re[k] + _im[k] * _im[k];
+    }
+    totalPower += bandPower[b];
+  }
+
+  for (int b = 0; b < SOUND_ANALYZER_BANDS; b++) {
+    _features.bandEnergy[b] =
+        (totalPower > 0.0f) ? bandPower[b] / totalPower : 0.0f;
+  }
+}
+
+void SoundAnalyzer::fft() {
+  const int n = SOUND_WINDOW_SIZE;
+
+  // Bit-reversal permutation
+  for (int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      float t = _re[i];
+      _re[i] = _re[j];
+      _re[j] = t;
+      t = _im[i];
+      _im[i] = _im[j];
+      _im[j] = t;
+    }
+  }
+
+  // Butterflies
+  for (int len = 2; len <= n; len <<= 1) {
+    int half = len >> 1;
+    int step = n / len;
+    for (int start = 0; start < n; start += len) {
+      for (int k = 0; k < half; k++) {
+        float wr = _cos[k * step];
+        float wi = _sin[k * step];
+        int a = start + k;
+        int b = a + half;
+        float tr = _re[b] * wr - _im[b] * wi;
+        float ti = _re[b] * wi + _im[b] * wr;
+        _re[b] = _re[a] - tr;
+        _im[b] = _im[a] - ti;
+        _re[a] += tr;
+        _im[a] += ti;
+      }
+    }
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef SOUND_ANALYZER_H
+#define SOUND_ANALYZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Analysis window (power of two for the FFT)
+#define SOUND_WINDOW_SIZE 256
+
+// Number of frequency bands reported per window
+#define SOUND_ANALYZER_BANDS 4
+
+// Features of one analysis window (amplitudes in ADC counts)
+struct SoundFeatures {
+  float rms;         // RMS of the signal with DC removed
+  float peak;        // largest deviation from DC
+  float zcr;         // zero crossings per sample (0..1)
+  float bandEnergy[SOUND_ANALYZER_BANDS]; // fraction of AC energy per band
+};
+
+// Windowed sound feature extraction over a continuous sample stream.
+// Bands split the spectrum at 250 / 500 / 1000 Hz (up to Nyquist), so
+// broadband wind noise and the harmonics of engines and saws land in
+// different bands. Pure logic, no driver calls.
+class SoundAnalyzer {
+public:
+  // Constructor (sample rate of the stream fed to addSample)
+  SoundAnalyzer(float sampleRateHz);
+
+  // Add one raw sample, returns true when a window has been analyzed
+  bool addSample(uint16_t sample);
+
+  // Features of the most recently completed window
+  const SoundFeatures &getFeatures() const;
+
+private:
+  float _sampleRate;
+  uint16_t _samples[SOUND_WINDOW_SIZE];
+  int _count;
+
+  // FFT work buffers and precomputed tables
+  float _re[SOUND_WINDOW_SIZE];
+  float _im[SOUND_WINDOW_SIZE];
+  float _hann[SOUND_WINDOW_SIZE];
+  float _cos[SOUND_WINDOW_SIZE / 2];
+  float _sin[SOUND_WINDOW_SIZE / 2];
+  int _bandEdges[SOUND_ANALYZER_BANDS + 1]; // FFT bin index per edge
+
+  SoundFeatures _features;
+
+  // Compute time-domain and spectral features of the full window
+  void analyzeWindow();
+
+  // In-place iterative radix-2 FFT of _re/_im
+  void fft();
+};
+
+#endif // SOUND_ANALYZER_H
@@ -0,0 +1,111 @@
+#include "SpscRing.h"
+#include <string.h>
+
+SpscRing::SpscRing(void *storage, size_t itemSize, uint32_t capacity)
+    : _storage((uint8_t *)storage), _itemSize(itemSize), _capacity(capacity),
+      _head(0), _tailCache(0), _tail(0), _headCache(0), _waiting(false) {}
+
+void *SpscRing::reserve(uint32_t &count) {
+  uint32_t head = _head.load(std::memory_order_relaxed);
+
+  // Re-read the consumer's index only when the cached one says full
+  if (head - _tailCache >= _capacity) {
+    _tailCache = _tail.load(std::memory_order_acquire);
+    if (head - _tailCache >= _capacity) {
+      count = 0;
+      return NULL;
+    }
+  }
+
+  uint32_t free = _capacity - (head - _tailCache);
+  uint32_t toEnd = _capacity - (head & (_capacity - 1));
+  count = free < toEnd ? free : toEnd;
+  return slot(head);
+}
+
+void SpscRing::commit(uint32_t count) {
+  uint32_t head = _head.load(std::memory_order_relaxed);
+  _head.store(head + count, std::memory_order_release);
+}
+
+bool SpscRing::push(const void *item) {
+  uint32_t count;
+  void *target = reserve(count);
+  if (target == NULL) {
+    return false;
+  }
+  memcpy(target, item, _itemSize);
+  commit(1);
+  return true;
+}
+
+bool SpscRing::takeWaiter() {
+  // Orders the head update before reading the flag, pairing with the
+  // flag store before the head read in prepareWait()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return _waiting.load(std::memory_order_relaxed) &&
+         _waiting.exchange(false, std::memory_order_relaxed);
+}
+
+const void *SpscRing::peek(uint32_t &count) {
+  uint32_t tail = _tail.load(std::memory_order_relaxed);
+
+  // Re-read the producer's index only when the cached one says empty
+  if (tail == _headCache) {
+    _headCache = _head.load(std::memory_order_acquire);
+    if (tail == _headCache) {
+      count = 0;
+      return NULL;
+    }
+  }
+
+  uint32_t used = _headCache - tail;
+  uint32_t toEnd = _capacity - (tail & (_capacity - 1));
+  count = used < toEnd ? used : toEnd;
+  return slot(tail);
+}
+
+void SpscRing::release(uint32_t count) {
+  uint32_t tail = _tail.load(std::memory_order_relaxed);
+  _tail.store(tail + count, std::memory_order_release);
+}
+
+bool SpscRing::pop(void *item) {
+  uint32_t count;
+  const void *source = peek(count);
+  if (source == NULL) {
+    return false;
+  }
+  memcpy(item, source, _itemSize);
+  release(1);
+  return true;
+}
+
+bool SpscRing::prepareWait() {
+  _waiting.store(true, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_head.load(std::memory_order_acquire) !=
+      _tail.load(std::memory_order_relaxed)) {
+    _waiting.store(false, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void SpscRing::cancelWait() {
+  _waiting.store(false, std::memory_order_relaxed);
+}
+
+uint32_t SpscRing::size() const {
+  // Tail first: head never falls behind it. Either side may move while
+  // another task reads this, so clamp to the capacity.
+  uint32_t tail = _tail.load(std::memory_order_acquire);
+  uint32_t used = _head.load(std::memory_order_acquire) - tail;
+  return used < _capacity ? used : _capacity;
+}
+
+uint32_t SpscRing::capacity() const { return _capacity; }
+
+uint8_t *SpscRing::slot(uint32_t index) const {
+  return _storage + (size_t)(index & (_capacity - 1)) * _itemSize;
+}
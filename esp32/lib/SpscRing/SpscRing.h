@@ -0,0 +1,79 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Distance between the producer and consumer indices. Internal SRAM of
+// the ESP32 is not cached, so there is no false sharing to avoid on the
+// device; on a host the two sides get their own cache lines.
+#ifdef ARDUINO
+#define SPSC_CACHE_LINE 4
+#else
+#define SPSC_CACHE_LINE 64
+#endif
+
+// Lock-free single-producer/single-consumer ring of fixed-size items, for
+// handing data from one task to another (also across cores) without a
+// critical section. Head/tail are free-running counters; the capacity
+// must be a power of two. Items can be written and read in place
+// (reserve/commit, peek/release), so a batch costs one index update and
+// no extra copy.
+//
+// Wake-up: the consumer announces that it is about to sleep with
+// prepareWait(); a producer that then adds items gets true from
+// takeWaiter() and notifies it. While the consumer is busy, producers
+// never pay for a notification.
+class SpscRing {
+public:
+  // Constructor (storage holds capacity items of itemSize bytes)
+  SpscRing(void *storage, size_t itemSize, uint32_t capacity);
+
+  // Producer: free slots from the first free one up to the end of the
+  // storage (count), or NULL if full. Write them, then commit.
+  void *reserve(uint32_t &count);
+  void commit(uint32_t count);
+
+  // Producer: copy one item in, false if full
+  bool push(const void *item);
+
+  // Producer: check (and clear) whether the consumer is waiting for items
+  bool takeWaiter();
+
+  // Consumer: items from the oldest one up to the end of the storage
+  // (count), or NULL if empty. Read them, then release.
+  const void *peek(uint32_t &count);
+  void release(uint32_t count);
+
+  // Consumer: copy the oldest item out, false if empty
+  bool pop(void *item);
+
+  // Consumer: announce a wait. Returns false (no wait needed) if items
+  // are already there; otherwise sleep, then call cancelWait()
+  bool prepareWait();
+  void cancelWait();
+
+  // Items queued and capacity
+  uint32_t size() const;
+  uint32_t capacity() const;
+
+private:
+  uint8_t *_storage;
+  size_t _itemSize;
+  uint32_t _capacity;
+
+  // Producer side: next index to write, last tail seen
+  alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> _head;
+  uint32_t _tailCache;
+
+  // Consumer side: next index to read, last head seen, wait flag
+  alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> _tail;
+  uint32_t _headCache;
+  std::atomic<bool> _waiting;
+
+  // Address of the item at a free-running index
+  uint8_t *slot(uint32_t index) const;
+};
+
+#endif // SPSC_RING_H
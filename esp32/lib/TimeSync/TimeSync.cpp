@@ -0,0 +1,67 @@
+#include "TimeSync.h"
+#include <esp_sntp.h>
+
+// Initialize static member
+TimeSync *TimeSync::_instance = NULL;
+
+TimeSync::TimeSync() : _lock(portMUX_INITIALIZER_UNLOCKED) {}
+
+void TimeSync::begin() {
+  _instance = this;
+
+  sntp_set_time_sync_notification_cb(onTimeSync);
+  sntp_set_sync_interval(NTP_SYNC_INTERVAL_MS);
+  configTime(0, 0, NTP_SERVER_PRIMARY, NTP_SERVER_SECONDARY);
+
+  Serial.println("SNTP started.");
+}
+
+bool TimeSync::isSynced() {
+  portENTER_CRITICAL(&_lock);
+  bool synced = _clock.isSynced();
+  portEXIT_CRITICAL(&_lock);
+  return synced;
+}
+
+uint64_t TimeSync::toEpochMs(unsigned long localMs) {
+  portENTER_CRITICAL(&_lock);
+  uint64_t epochMs = _clock.toEpochMs(localMs);
+  portEXIT_CRITICAL(&_lock);
+  return epochMs;
+}
+
+uint32_t TimeSync::getSyncCount() {
+  portENTER_CRITICAL(&_lock);
+  uint32_t count = _clock.getSyncCount();
+  portEXIT_CRITICAL(&_lock);
+  return count;
+}
+
+int32_t TimeSync::getLastCorrection() {
+  portENTER_CRITICAL(&_lock);
+  int32_t correction = _clock.getLastCorrection();
+  portEXIT_CRITICAL(&_lock);
+  return correction;
+}
+
+void TimeSync::onTimeSync(struct timeval *tv) {
+  if (_instance == NULL) {
+    return;
+  }
+
+  unsigned long localMs = millis();
+  uint64_t epochMs = (uint64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000;
+
+  portENTER_CRITICAL(&_instance->_lock);
+  _instance->_clock.sync(epochMs, localMs);
+  uint32_t count = _instance->_clock.getSyncCount();
+  int32_t correction = _instance->_clock.getLastCorrection();
+  portEXIT_CRITICAL(&_instance->_lock);
+
+  if (count == 1) {
+    Serial.printf("Time synced: %lu s since epoch\n",
+                  (unsigned long)tv->tv_sec);
+  } else {
+    Serial.printf("Time re-synced, corrected by %ld ms\n", (long)correction);
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include "EpochClock.h"
+#include <Arduino.h>
+
+// NTP servers (UTC, the dashboard formats local time)
+#define NTP_SERVER_PRIMARY "pool.ntp.org"
+#define NTP_SERVER_SECONDARY "time.google.com"
+
+// SNTP re-sync interval
+#define NTP_SYNC_INTERVAL_MS 3600000 // 1 hour
+
+// Device wall-clock time via SNTP. Sync results arrive on the lwIP task
+// and are applied to a shared EpochClock; any task may convert.
+class TimeSync {
+public:
+  // Constructor
+  TimeSync();
+
+  // Start SNTP (runs in the background, needs WiFi to complete)
+  void begin();
+
+  // True once the first sync has completed
+  bool isSynced();
+
+  // Epoch milliseconds of a millis() timestamp, 0 while unsynced
+  uint64_t toEpochMs(unsigned long localMs);
+
+  // Sync statistics
+  uint32_t getSyncCount();
+  int32_t getLastCorrection();
+
+private:
+  EpochClock _clock;
+  portMUX_TYPE _lock;
+
+  // Instance for the static SNTP callback
+  static TimeSync *_instance;
+
+  // SNTP notification (runs on the lwIP task)
+  static void onTimeSync(struct timeval *tv);
+};
+
+#endif // TIME_SYNC_H
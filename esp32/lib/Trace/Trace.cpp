@@ -0,0 +1,100 @@
+#include "Trace.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define TRACE_PRINTF Serial.printf
+
+// Points are recorded from tasks on both cores
+static portMUX_TYPE traceLock = portMUX_INITIALIZER_UNLOCKED;
+#define TRACE_LOCK() portENTER_CRITICAL(&traceLock)
+#define TRACE_UNLOCK() portEXIT_CRITICAL(&traceLock)
+#else
+#include <chrono>
+#include <stdio.h>
+#define TRACE_PRINTF printf
+#define TRACE_LOCK()
+#define TRACE_UNLOCK()
+#endif
+
+static LatencyHistogram traceHistograms[TRACE_POINT_COUNT];
+
+static const char *const traceNames[TRACE_POINT_COUNT] = {
+    "sound-read", "dht-acquire", "dht-read",    "sensor-enqueue",
+    "queue-wait", "build-batch", "db-update", "firebase-loop",
+    "lcd-update"};
+
+uint32_t traceNow() {
+#ifdef ARDUINO
+  return ESP.getCycleCount();
+#else
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+uint32_t traceCyclesPerUs() {
+#ifdef ARDUINO
+  return getCpuFrequencyMhz();
+#else
+  return 1000;
+#endif
+}
+
+void traceRecord(TracePoint point, uint32_t cycles) {
+  if (point >= TRACE_POINT_COUNT) {
+    return;
+  }
+  TRACE_LOCK();
+  traceHistograms[point].add(cycles);
+  TRACE_UNLOCK();
+}
+
+void traceRecordUs(TracePoint point, uint32_t us) {
+  uint32_t rate = traceCyclesPerUs();
+  traceRecord(point, us < UINT32_MAX / rate ? us * rate : UINT32_MAX);
+}
+
+LatencyHistogram traceHistogram(TracePoint point) {
+  LatencyHistogram copy;
+  if (point < TRACE_POINT_COUNT) {
+    TRACE_LOCK();
+    copy = traceHistograms[point];
+    TRACE_UNLOCK();
+  }
+  return copy;
+}
+
+const char *tracePointName(TracePoint point) {
+  return point < TRACE_POINT_COUNT ? traceNames[point] : "unknown";
+}
+
+void traceReset() {
+  for (int p = 0; p < TRACE_POINT_COUNT; p++) {
+    TRACE_LOCK();
+    traceHistograms[p].reset();
+    TRACE_UNLOCK();
+  }
+}
+
+void tracePrint() {
+#if TRACE_ENABLED
+  float rate = traceCyclesPerUs();
+  TRACE_PRINTF("\n=== Trace (us) ===\n");
+  TRACE_PRINTF("%-15s %8s %10s %10s %10s %10s\n", "point", "n", "mean", "p50",
+               "p90", "max");
+  for (int p = 0; p < TRACE_POINT_COUNT; p++) {
+    LatencyHistogram h = traceHistogram((TracePoint)p);
+    if (h.getCount() == 0) {
+      continue;
+    }
+    TRACE_PRINTF("%-15s %8u %10.1f %10.1f %10.1f %10.1f\n", traceNames[p],
+                 (unsigned)h.getCount(), h.getMean() / rate,
+                 h.getPercentile(0.5f) / rate, h.getPercentile(0.9f) / rate,
+                 h.getMax() / rate);
+  }
+  TRACE_PRINTF("==================\n");
+#else
+  TRACE_PRINTF("Tracing disabled (build with -DTRACE_ENABLED=1)\n");
+#endif
+}
@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "LatencyHistogram.h"
+#include <stdint.h>
+
+// Scoped trace points, compiled out unless built with -DTRACE_ENABLED=1
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+// Instrumented spots on the path from sensor read to Firebase ack
+enum TracePoint {
+  TRACE_SOUND_READ,      // AnalogSensors::readSoundValue()
+  TRACE_DHT_ACQUIRE,     // DHT11 measurement in the DHT task
+  TRACE_DHT_READ,        // cached DHT11 read in SensorTask
+  TRACE_SENSOR_ENQUEUE,  // xQueueSend of a reading
+  TRACE_QUEUE_RESIDENCY, // reading capture -> CloudTask receive
+  TRACE_BUILD_BATCH,     // FirebaseManager::buildBatchJson()
+  TRACE_DB_UPDATE,       // RealtimeDatabase::update() call
+  TRACE_FIREBASE_LOOP,   // FirebaseApp::loop() (TLS I/O, callbacks)
+  TRACE_LCD_UPDATE,      // DisplayManager::updateStatus()
+  TRACE_POINT_COUNT
+};
+
+// Free-running cycle counter (CCOUNT on ESP32, ns on the host) and its
+// rate
+uint32_t traceNow();
+uint32_t traceCyclesPerUs();
+
+// Add one duration in cycles (or microseconds, saturating) to a point
+void traceRecord(TracePoint point, uint32_t cycles);
+void traceRecordUs(TracePoint point, uint32_t us);
+
+// Copy of a point's histogram (cycles) and its name
+LatencyHistogram traceHistogram(TracePoint point);
+const char *tracePointName(TracePoint point);
+
+// Clear all histograms
+void traceReset();
+
+// Print count, mean, p50, p90 and max (us) of every point
+void tracePrint();
+
+// Records the lifetime of a scope into a trace point
+class TraceScope {
+public:
+  explicit TraceScope(TracePoint point) : _point(point), _start(traceNow()) {}
+  ~TraceScope() { traceRecord(_point, traceNow() - _start); }
+
+private:
+  TracePoint _point;
+  uint32_t _start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#if TRACE_ENABLED
+#define TRACE_SCOPE(point) TraceScope TRACE_CONCAT(traceScope, __LINE__)(point)
+#define TRACE_VALUE_US(point, us) traceRecordUs(point, us)
+#else
+#define TRACE_SCOPE(point) ((void)0)
+#define TRACE_VALUE_US(point, us) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -1,5 +1,8 @@
 #include "WiFiManager.h"
 
+// Initialize static member
+WiFiManager *WiFiManager::_instance = NULL;
+
 WiFiManager::WiFiManager(const char *primarySsid, const char *primaryPassword,
                          const char *secondarySsid,
                          const char *secondaryIdentity,
@@ -8,74 +11,145 @@ WiFiManager::WiFiManager(const char *primarySsid, const char *primaryPassword,
     : _primarySsid(primarySsid), _primaryPassword(primaryPassword),
       _secondarySsid(secondarySsid), _secondaryIdentity(secondaryIdentity),
       _secondaryUsername(secondaryUsername),
-      _secondaryPassword(secondaryPassword), _usingPrimaryWiFi(false),
-      _lastConnectionAttempt(0), _reconnectDelay(500) {}
-
-void WiFiManager::connectWithFallback() {
-  if (connectPrimary()) {
-    _usingPrimaryWiFi = true;
-    Serial.println("Connected to primary WiFi");
-    resetReconnectDelay();
-  } else if (connectSecondary()) {
-    _usingPrimaryWiFi = false;
-    Serial.println("Connected to secondary WiFi (enterprise)");
-    resetReconnectDelay();
-  } else {
-    Serial.println("All WiFi connections failed. Restarting...");
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    ESP.restart();
-  }
-  Serial.print("IP address: ");
-  Serial.println(WiFi.localIP());
+      _secondaryPassword(secondaryPassword), _state(WIFI_IDLE),
+      _usingPrimaryWiFi(false), _stateEnteredAt(0),
+      _backoffDelay(WIFI_BACKOFF_MIN_MS),
+      _nextBackoffDelay(WIFI_BACKOFF_MIN_MS), _gotIp(false),
+      _linkLost(false) {}
+
+void WiFiManager::begin() {
+  _instance = this;
+  WiFi.onEvent(onWiFiEvent);
+  startPrimary();
 }
 
-void WiFiManager::checkConnection() {
-  if (WiFi.status() != WL_CONNECTED) {
-    unsigned long now = millis();
-    if (now - _lastConnectionAttempt >= _reconnectDelay) {
-      _lastConnectionAttempt = now;
+void WiFiManager::loop() {
+  unsigned long elapsed = millis() - _stateEnteredAt;
+
+  switch (_state) {
+  case WIFI_IDLE:
+    startPrimary();
+    break;
+
+  case WIFI_CONNECTING_PRIMARY:
+    if (_gotIp) {
+      _usingPrimaryWiFi = true;
+      enterState(WIFI_CONNECTED);
+      resetReconnectDelay();
+      Serial.println("Connected to primary WiFi");
+      Serial.print("IP address: ");
+      Serial.println(WiFi.localIP());
+    } else if (elapsed >= WIFI_PRIMARY_TIMEOUT_MS) {
+      Serial.println("Primary WiFi timed out.");
+      startSecondary();
+    }
+    break;
+
+  case WIFI_CONNECTING_SECONDARY:
+    if (_gotIp) {
+      _usingPrimaryWiFi = false;
+      enterState(WIFI_CONNECTED);
+      resetReconnectDelay();
+      Serial.println("Connected to secondary WiFi (enterprise)");
+      Serial.print("IP address: ");
+      Serial.println(WiFi.localIP());
+    } else if (elapsed >= WIFI_SECONDARY_TIMEOUT_MS) {
+      Serial.println("Secondary WiFi timed out.");
+      startBackoff();
+    }
+    break;
+
+  case WIFI_CONNECTED:
+    if (_linkLost || WiFi.status() != WL_CONNECTED) {
       Serial.println("WiFi connection lost. Reconnecting...");
-      connectWithFallback();
+      startPrimary();
+    }
+    break;
 
-      // If still not connected, increase delay for next attempt
-      if (WiFi.status() != WL_CONNECTED) {
-        _reconnectDelay = getNextReconnectDelay();
-      }
+  case WIFI_BACKOFF:
+    if (elapsed >= _backoffDelay) {
+      startPrimary();
     }
+    break;
   }
 }
 
-bool WiFiManager::isConnected() { return WiFi.status() == WL_CONNECTED; }
+bool WiFiManager::isConnected() {
+  return _state == WIFI_CONNECTED && WiFi.status() == WL_CONNECTED;
+}
 
 String WiFiManager::getSSID() { return WiFi.SSID(); }
 
 String WiFiManager::getIP() { return WiFi.localIP().toString(); }
 
+const char *WiFiManager::getSSIDName() {
+  return _usingPrimaryWiFi ? _primarySsid : _secondarySsid;
+}
+
+void WiFiManager::formatIP(char *buffer, size_t size) {
+  IPAddress ip = WiFi.localIP();
+  snprintf(buffer, size, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
 bool WiFiManager::isUsingPrimary() { return _usingPrimaryWiFi; }
 
-bool WiFiManager::connectPrimary() {
+WiFiState WiFiManager::getState() { return _state; }
+
+const char *WiFiManager::getStateName() {
+  switch (_state) {
+  case WIFI_CONNECTING_PRIMARY:
+    return "Connecting (pri)";
+  case WIFI_CONNECTING_SECONDARY:
+    return "Connecting (ent)";
+  case WIFI_CONNECTED:
+    return "Connected";
+  case WIFI_BACKOFF:
+    return "Retry pending";
+  default:
+    return "Disconnected";
+  }
+}
+
+void WiFiManager::onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  if (_instance == NULL) {
+    return;
+  }
+
+  switch (event) {
+  case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+    // Clears any stale disconnect queued by our own WiFi.disconnect()
+    _instance->_linkLost = false;
+    _instance->_gotIp = true;
+    break;
+  case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+  case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+    _instance->_linkLost = true;
+    break;
+  default:
+    break;
+  }
+}
+
+void WiFiManager::startPrimary() {
   Serial.println("Attempting primary WiFi (WPA2-Personal)...");
   Serial.print("SSID: ");
   Serial.println(_primarySsid);
 
+  _gotIp = false;
   WiFi.disconnect(true);
   WiFi.mode(WIFI_STA);
+  esp_wifi_sta_wpa2_ent_disable();
   WiFi.begin(_primarySsid, _primaryPassword);
 
-  int attempts = 20; // 10 seconds (20 * 500ms)
-  while (WiFi.status() != WL_CONNECTED && attempts-- > 0) {
-    vTaskDelay(pdMS_TO_TICKS(500));
-    Serial.print(".");
-  }
-  Serial.println();
-  return WiFi.status() == WL_CONNECTED;
+  enterState(WIFI_CONNECTING_PRIMARY);
 }
 
-bool WiFiManager::connectSecondary() {
+void WiFiManager::startSecondary() {
   Serial.println("Attempting secondary WiFi (WPA2-Enterprise)...");
   Serial.print("SSID: ");
   Serial.println(_secondarySsid);
 
+  _gotIp = false;
   WiFi.disconnect(true);
   WiFi.mode(WIFI_STA);
 
@@ -89,19 +163,31 @@ bool WiFiManager::connectSecondary() {
 
   WiFi.begin(_secondarySsid);
 
-  int attempts = 40; // 20 seconds (40 * 500ms)
-  while (WiFi.status() != WL_CONNECTED && attempts-- > 0) {
-    vTaskDelay(pdMS_TO_TICKS(500));
-    Serial.print(".");
+  enterState(WIFI_CONNECTING_SECONDARY);
+}
+
+void WiFiManager::startBackoff() {
+  // Equal jitter: wait between half and all of the current delay so that
+  // devices sharing an AP do not reconnect in lockstep
+  unsigned long half = _nextBackoffDelay / 2;
+  _backoffDelay = half + (esp_random() % (half + 1));
+
+  // Exponential backoff: 1s -> 2s -> 4s ... -> 60s (max)
+  _nextBackoffDelay *= 2;
+  if (_nextBackoffDelay > WIFI_BACKOFF_MAX_MS) {
+    _nextBackoffDelay = WIFI_BACKOFF_MAX_MS;
   }
-  Serial.println();
-  return WiFi.status() == WL_CONNECTED;
+
+  Serial.printf("All WiFi connections failed. Retrying in %lu ms.\n",
+                _backoffDelay);
+  enterState(WIFI_BACKOFF);
 }
 
-void WiFiManager::resetReconnectDelay() { _reconnectDelay = 500; }
+void WiFiManager::enterState(WiFiState state) {
+  _state = state;
+  _stateEnteredAt = millis();
+}
 
-int WiFiManager::getNextReconnectDelay() {
-  // Exponential backoff: 500ms -> 1s -> 2s -> 4s (max)
-  int nextDelay = _reconnectDelay * 2;
-  return (nextDelay > 4000) ? 4000 : nextDelay;
+void WiFiManager::resetReconnectDelay() {
+  _nextBackoffDelay = WIFI_BACKOFF_MIN_MS;
 }
@@ -5,6 +5,23 @@
 #include <Arduino.h>
 #include <WiFi.h>
 
+// Connection attempt timeouts
+#define WIFI_PRIMARY_TIMEOUT_MS 10000
+#define WIFI_SECONDARY_TIMEOUT_MS 20000
+
+// Backoff between failed rounds (primary + secondary)
+#define WIFI_BACKOFF_MIN_MS 1000
+#define WIFI_BACKOFF_MAX_MS 60000
+
+// Connection state machine states
+enum WiFiState {
+  WIFI_IDLE,
+  WIFI_CONNECTING_PRIMARY,
+  WIFI_CONNECTING_SECONDARY,
+  WIFI_CONNECTED,
+  WIFI_BACKOFF
+};
+
 class WiFiManager {
 public:
   // Constructor
@@ -12,11 +29,11 @@ public:
               const char *secondarySsid, const char *secondaryIdentity,
               const char *secondaryUsername, const char *secondaryPassword);
 
-  // Connect to WiFi with fallback (primary -> secondary -> restart)
-  void connectWithFallback();
+  // Register WiFi event handlers and start the first connection attempt
+  void begin();
 
-  // Check connection and reconnect if needed
-  void checkConnection();
+  // Advance the connection state machine (non-blocking, call regularly)
+  void loop();
 
   // Check if currently connected
   bool isConnected();
@@ -27,9 +44,20 @@ public:
   // Get current IP address
   String getIP();
 
+  // SSID of the network in use and dotted IP address, without String
+  // allocations (for the periodic LCD update)
+  const char *getSSIDName();
+  void formatIP(char *buffer, size_t size);
+
   // Check if using primary network
   bool isUsingPrimary();
 
+  // Get current state (safe to call from any task)
+  WiFiState getState();
+
+  // Get short human-readable state for the LCD
+  const char *getStateName();
+
 private:
   // WiFi credentials
   const char *_primarySsid;
@@ -40,21 +68,36 @@ private:
   const char *_secondaryPassword;
 
   // Connection state
+  volatile WiFiState _state;
   bool _usingPrimaryWiFi;
-  unsigned long _lastConnectionAttempt;
-  int _reconnectDelay;
+  unsigned long _stateEnteredAt;
+  unsigned long _backoffDelay;
+  unsigned long _nextBackoffDelay;
 
-  // Connect to primary WiFi (WPA2-Personal)
-  bool connectPrimary();
+  // Flags set from the WiFi event task, consumed in loop()
+  volatile bool _gotIp;
+  volatile bool _linkLost;
 
-  // Connect to secondary WiFi (WPA2-Enterprise)
-  bool connectSecondary();
+  // Instance for the static event handler
+  static WiFiManager *_instance;
+
+  // WiFi event handler (runs in the WiFi event task)
+  static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+
+  // Start connecting to primary WiFi (WPA2-Personal)
+  void startPrimary();
+
+  // Start connecting to secondary WiFi (WPA2-Enterprise)
+  void startSecondary();
+
+  // Wait before the next round, with jittered exponential backoff
+  void startBackoff();
+
+  // Switch state and remember when it happened
+  void enterState(WiFiState state);
 
   // Reset reconnect delay for exponential backoff
   void resetReconnectDelay();
-
-  // Get next reconnect delay with exponential backoff
-  int getNextReconnectDelay();
 };
 
 #endif // WIFI_MANAGER_H
@@ -0,0 +1,168 @@
+#include "StreamingStats.h"
+#include <math.h>
+
+RunningStats::RunningStats() { reset(); }
+
+void RunningStats::reset() {
+  _count = 0;
+  _mean = 0.0f;
+  _m2 = 0.0f;
+  _min = 0.0f;
+  _max = 0.0f;
+}
+
+void RunningStats::add(float x) {
+  _count++;
+  if (_count == 1) {
+    _min = x;
+    _max = x;
+  } else if (x < _min) {
+    _min = x;
+  } else if (x > _max) {
+    _max = x;
+  }
+
+  float delta = x - _mean;
+  _mean += delta / _count;
+  _m2 += delta * (x - _mean);
+}
+
+void RunningStats::addMerged(float mean, float min, float max, uint32_t n) {
+  if (n == 0) {
+    return;
+  }
+  if (_count == 0) {
+    _min = min;
+    _max = max;
+  } else {
+    if (min < _min) {
+      _min = min;
+    }
+    if (max > _max) {
+      _max = max;
+    }
+  }
+
+  // Combine with a group of zero spread (Chan et al.)
+  uint32_t total = _count + n;
+  float delta = mean - _mean;
+  _mean += delta * n / total;
+  _m2 += delta * delta * ((float)_count * n / total);
+  _count = total;
+}
+
+uint32_t RunningStats::count() const { return _count; }
+
+float RunningStats::min() const { return _min; }
+
+float RunningStats::max() const { return _max; }
+
+float RunningStats::mean() const { return _mean; }
+
+float RunningStats::variance() const {
+  return (_count > 1) ? _m2 / (_count - 1) : 0.0f;
+}
+
+float RunningStats::stddev() const { return sqrtf(variance()); }
+
+P2Quantile::P2Quantile(float p) : _p(p) { reset(); }
+
+void P2Quantile::reset() {
+  _count = 0;
+  for (int i = 0; i < 5; i++) {
+    _height[i] = 0.0f;
+    _position[i] = i + 1;
+  }
+  _desired[0] = 1.0f;
+  _desired[1] = 1.0f + 2.0f * _p;
+  _desired[2] = 1.0f + 4.0f * _p;
+  _desired[3] = 3.0f + 2.0f * _p;
+  _desired[4] = 5.0f;
+  _increment[0] = 0.0f;
+  _increment[1] = _p / 2.0f;
+  _increment[2] = _p;
+  _increment[3] = (1.0f + _p) / 2.0f;
+  _increment[4] = 1.0f;
+}
+
+void P2Quantile::add(float x) {
+  // The first five samples become the initial markers (kept sorted)
+  if (_count < 5) {
+    int i = _count++;
+    while (i > 0 && _height[i - 1] > x) {
+      _height[i] = _height[i - 1];
+      i--;
+    }
+    _height[i] = x;
+    return;
+  }
+  _count++;
+
+  // Find the cell containing x, extending the extremes if needed
+  int k;
+  if (x < _height[0]) {
+    _height[0] = x;
+    k = 0;
+  } else if (x >= _height[4]) {
+    _height[4] = x;
+    k = 3;
+  } else {
+    k = 0;
+    while (x >= _height[k + 1]) {
+      k++;
+    }
+  }
+
+  for (int i = k + 1; i < 5; i++) {
+    _position[i] += 1.0f;
+  }
+  for (int i = 0; i < 5; i++) {
+    _desired[i] += _increment[i];
+  }
+
+  // Move the middle markers one step towards their desired positions
+  for (int i = 1; i <= 3; i++) {
+    float offset = _desired[i] - _position[i];
+    if ((offset >= 1.0f && _position[i + 1] - _position[i] > 1.0f) ||
+        (offset <= -1.0f && _position[i - 1] - _position[i] < -1.0f)) {
+      int d = (offset >= 0.0f) ? 1 : -1;
+      float h = parabolic(i, d);
+      if (_height[i - 1] < h && h < _height[i + 1]) {
+        _height[i] = h;
+      } else {
+        _height[i] = linear(i, d);
+      }
+      _position[i] += d;
+    }
+  }
+}
+
+float P2Quantile::value() const {
+  if (_count == 0) {
+    return 0.0f;
+  }
+  if (_count < 5) {
+    // Exact nearest-rank quantile of the (sorted) samples seen so far
+    int rank = (int)ceilf(_p * _count);
+    if (rank < 1) {
+      rank = 1;
+    }
+    return _height[rank - 1];
+  }
+  return _height[2];
+}
+
+float P2Quantile::parabolic(int i, float d) const {
+  const float *n = _position;
+  const float *q = _height;
+  return q[i] + d / (n[i + 1] - n[i - 1]) *
+                    ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) /
+                         (n[i + 1] - n[i]) +
+                     (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) /
+                         (n[i] - n[i - 1]));
+}
+
+float P2Quantile::linear(int i, int d) const {
+  return _height[i] +
+         d * (_height[i + d] - _height[i]) / (_position[i + d] - _position[i]);
+}
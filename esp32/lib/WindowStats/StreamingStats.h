@@ -0,0 +1,70 @@
+#ifndef STREAMING_STATS_H
+#define STREAMING_STATS_H
+
+#include <stdint.h>
+
+// Count, min, max, mean and variance of a stream (Welford's algorithm:
+// numerically stable, O(1) memory, one division per sample)
+class RunningStats {
+public:
+  // Constructor
+  RunningStats();
+
+  // Forget all samples
+  void reset();
+
+  // Add one sample
+  void add(float x);
+
+  // Add n samples known only by their mean and range (their spread
+  // around the mean is lost, so the variance comes out low)
+  void addMerged(float mean, float min, float max, uint32_t n);
+
+  uint32_t count() const;
+  float min() const;
+  float max() const;
+  float mean() const;
+
+  // Sample variance / standard deviation (0 for fewer than 2 samples)
+  float variance() const;
+  float stddev() const;
+
+private:
+  uint32_t _count;
+  float _mean;
+  float _m2; // sum of squared deviations from the mean
+  float _min;
+  float _max;
+};
+
+// Streaming estimate of one quantile (P² algorithm, Jain & Chlamtac).
+// Keeps five markers whose heights track the min, p/2, p, (1+p)/2 and
+// max quantiles; exact while fewer than five samples have been seen.
+class P2Quantile {
+public:
+  // Constructor (p in 0..1, e.g. 0.5 for the median)
+  P2Quantile(float p);
+
+  // Forget all samples
+  void reset();
+
+  // Add one sample
+  void add(float x);
+
+  // Current estimate (0 if no samples)
+  float value() const;
+
+private:
+  float _p;
+  uint32_t _count;
+  float _height[5];    // marker heights
+  float _position[5];  // actual marker positions (1-based)
+  float _desired[5];   // desired marker positions
+  float _increment[5]; // desired position increment per sample
+
+  // Piecewise-parabolic and linear height prediction for marker i
+  float parabolic(int i, float d) const;
+  float linear(int i, int d) const;
+};
+
+#endif // STREAMING_STATS_H
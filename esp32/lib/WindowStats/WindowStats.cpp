@@ -0,0 +1,150 @@
+#include "WindowStats.h"
+#include <math.h>
+
+ChannelStats::ChannelStats() : _median(0.5f), _p90(0.9f) {}
+
+void ChannelStats::reset() {
+  _stats.reset();
+  _median.reset();
+  _p90.reset();
+}
+
+void ChannelStats::add(float x) {
+  _stats.add(x);
+  _median.add(x);
+  _p90.add(x);
+}
+
+void ChannelStats::addMerged(float mean, float min, float max,
+                             uint16_t count) {
+  _stats.addMerged(mean, min, max, count);
+  _median.add(mean);
+  _p90.add(mean);
+}
+
+void ChannelStats::summarize(ChannelSummary &summary) const {
+  summary.count = _stats.count();
+  summary.min = _stats.min();
+  summary.max = _stats.max();
+  summary.mean = _stats.mean();
+  summary.stddev = _stats.stddev();
+  summary.p50 = _median.value();
+  summary.p90 = _p90.value();
+}
+
+WindowAggregator::WindowAggregator(unsigned long windowMs)
+    : _windowMs(windowMs), _open(false), _epochAligned(false), _windowKey(0),
+      _windowStart(0), _readingCount(0), _clockEpochMs(0), _clockLocalMs(0),
+      _soundCount(0), _soundEnergySum(0.0f), _soundPeakMax(0), _soundZcrSum(0) {
+  for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+    _soundBandSum[b] = 0;
+  }
+}
+
+void WindowAggregator::setClock(uint64_t epochMs, unsigned long localMs) {
+  _clockEpochMs = epochMs;
+  _clockLocalMs = localMs;
+}
+
+bool WindowAggregator::add(const SensorRecord &record,
+                           WindowSummary &summary) {
+  const SensorData &data = record.data;
+
+  // Align on the wall clock once synced, on uptime before
+  bool epochAligned = (_clockEpochMs != 0);
+  uint64_t time = data.timestamp;
+  if (epochAligned) {
+    time = _clockEpochMs + (long)(data.timestamp - _clockLocalMs);
+  }
+  unsigned long offset = time % _windowMs;
+
+  bool closed = false;
+  if (_open && (epochAligned != _epochAligned ||
+                time - offset != _windowKey)) {
+    close(summary);
+    closed = true;
+  }
+  if (!_open) {
+    _open = true;
+    _epochAligned = epochAligned;
+    _windowKey = time - offset;
+    _windowStart = data.timestamp - offset;
+  }
+
+  // Channels that were not sampled repeat their last value, skip them
+  _readingCount += record.readingCount;
+  addChannel(WINDOW_LIGHT, record, ANALOG_LIGHT, 1.0f);
+  addChannel(WINDOW_GAS, record, ANALOG_GAS, 1.0f);
+  addChannel(WINDOW_FLAME, record, ANALOG_FLAME, 1.0f);
+  addChannel(WINDOW_SOIL_MOISTURE, record, ANALOG_SOIL_MOISTURE, 1.0f);
+  addChannel(WINDOW_SOUND, record, ANALOG_SOUND, 1.0f);
+  addChannel(WINDOW_TEMPERATURE, record, RECORD_TEMPERATURE, 0.1f);
+  addChannel(WINDOW_HUMIDITY, record, RECORD_HUMIDITY, 0.1f);
+
+  // Sound features of merged readings are already weighted means
+  uint16_t soundCount = record.count[ANALOG_SOUND];
+  if (soundCount == 0) {
+    return closed;
+  }
+  _soundCount += soundCount;
+  _soundEnergySum += (float)data.soundRms * data.soundRms * soundCount;
+  if (data.soundPeak > _soundPeakMax) {
+    _soundPeakMax = data.soundPeak;
+  }
+  _soundZcrSum += (uint32_t)data.soundZcr * soundCount;
+  for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+    _soundBandSum[b] += (uint32_t)data.soundBands[b] * soundCount;
+  }
+
+  return closed;
+}
+
+void WindowAggregator::addChannel(WindowChannel channel,
+                                  const SensorRecord &record,
+                                  uint8_t recordChannel, float scale) {
+  uint16_t count = record.count[recordChannel];
+  if (count == 1) {
+    _channels[channel].add(record.sum[recordChannel] * scale);
+  } else if (count > 1) {
+    float mean = (float)record.sum[recordChannel] / count * scale;
+    _channels[channel].addMerged(mean, record.min[recordChannel] * scale,
+                                 record.max[recordChannel] * scale, count);
+  }
+}
+
+bool WindowAggregator::closeIfDue(unsigned long now, WindowSummary &summary) {
+  if (!_open || now - _windowStart < _windowMs + WINDOW_CLOSE_GRACE_MS) {
+    return false;
+  }
+  close(summary);
+  return true;
+}
+
+uint16_t WindowAggregator::getReadingCount() { return _readingCount; }
+
+void WindowAggregator::close(WindowSummary &summary) {
+  summary.windowStartEpochMs = _epochAligned ? _windowKey : 0;
+  summary.windowStart = _windowStart;
+  summary.readingCount = _readingCount;
+  for (int c = 0; c < WINDOW_CHANNEL_COUNT; c++) {
+    _channels[c].summarize(summary.channels[c]);
+    _channels[c].reset();
+  }
+
+  // Energy and spectrum averaged, peak is the maximum
+  uint16_t soundCount = _soundCount > 0 ? _soundCount : 1;
+  summary.soundRms = (uint16_t)(sqrtf(_soundEnergySum / soundCount) + 0.5f);
+  summary.soundPeak = _soundPeakMax;
+  summary.soundZcr = _soundZcrSum / soundCount;
+  for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+    summary.soundBands[b] = _soundBandSum[b] / soundCount;
+    _soundBandSum[b] = 0;
+  }
+
+  _open = false;
+  _readingCount = 0;
+  _soundCount = 0;
+  _soundEnergySum = 0.0f;
+  _soundPeakMax = 0;
+  _soundZcrSum = 0;
+}
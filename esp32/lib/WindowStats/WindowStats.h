@@ -0,0 +1,130 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include "../../include/DataTypes.h"
+#include "StreamingStats.h"
+
+// A window with no newer reading is closed this long after its end, so
+// readings still in flight through the queue land in the right window
+#define WINDOW_CLOSE_GRACE_MS 2000
+
+// Length of the summary windows (readings are merged under backpressure
+// within these windows too, see ReadingBuffer)
+#define SUMMARY_WINDOW_MS 60000 // 1 minute
+
+// Channels summarized per window
+enum WindowChannel {
+  WINDOW_LIGHT,
+  WINDOW_GAS,
+  WINDOW_FLAME,
+  WINDOW_SOIL_MOISTURE,
+  WINDOW_SOUND,
+  WINDOW_TEMPERATURE,
+  WINDOW_HUMIDITY,
+  WINDOW_CHANNEL_COUNT
+};
+
+// Statistics of one channel over one window (count 0: no valid readings)
+struct ChannelSummary {
+  uint16_t count;
+  float min;
+  float max;
+  float mean;
+  float stddev;
+  float p50;
+  float p90;
+};
+
+// Everything uploaded for one window. Plain data, so it can be written
+// to the offline log as is.
+struct WindowSummary {
+  uint64_t windowStartEpochMs; // aligned window start, 0 if not synced
+  unsigned long windowStart;   // millis() at the window start
+  uint16_t readingCount;
+  ChannelSummary channels[WINDOW_CHANNEL_COUNT];
+
+  // Sound features over the window (same units as SensorData)
+  uint16_t soundRms;
+  uint16_t soundPeak;
+  uint16_t soundZcr;
+  uint16_t soundBands[SOUND_BAND_COUNT];
+};
+
+// Streaming statistics of one channel: min/max/mean/variance plus median
+// and 90th percentile estimates, constant memory however long the window
+class ChannelStats {
+public:
+  // Constructor
+  ChannelStats();
+
+  // Forget all samples
+  void reset();
+
+  // Add one sample
+  void add(float x);
+
+  // Add count samples merged into their mean and range. The quantile
+  // estimates see them as one sample at the mean.
+  void addMerged(float mean, float min, float max, uint16_t count);
+
+  // Write the current statistics into summary
+  void summarize(ChannelSummary &summary) const;
+
+private:
+  RunningStats _stats;
+  P2Quantile _median;
+  P2Quantile _p90;
+};
+
+// Aggregates readings over windows aligned to multiples of the window
+// length on the wall clock (uptime until time is synced), so every device
+// reports the same window boundaries. Readings are folded in as they
+// arrive; nothing is buffered.
+class WindowAggregator {
+public:
+  // Constructor
+  WindowAggregator(unsigned long windowMs);
+
+  // Wall-clock time (0 while unsynced) at local time localMs, set once
+  // per batch of records: record times are derived from it
+  void setClock(uint64_t epochMs, unsigned long localMs);
+
+  // Add one record (a reading, or merged readings). If it belongs to a
+  // later window, the open window is closed into summary first and true
+  // is returned.
+  bool add(const SensorRecord &record, WindowSummary &summary);
+
+  // Close the open window once its end (plus grace) has passed at now
+  bool closeIfDue(unsigned long now, WindowSummary &summary);
+
+  // Readings in the open window
+  uint16_t getReadingCount();
+
+private:
+  unsigned long _windowMs;
+  bool _open;
+  bool _epochAligned;
+  uint64_t _windowKey; // window start in the clock used for alignment
+  unsigned long _windowStart;
+  uint16_t _readingCount;
+  uint64_t _clockEpochMs;
+  unsigned long _clockLocalMs;
+
+  ChannelStats _channels[WINDOW_CHANNEL_COUNT];
+
+  // Sound feature accumulators (over readings that sampled sound)
+  uint16_t _soundCount;
+  float _soundEnergySum;
+  uint16_t _soundPeakMax;
+  uint32_t _soundZcrSum;
+  uint32_t _soundBandSum[SOUND_BAND_COUNT];
+
+  // Write the open window into summary and reset the accumulators
+  void close(WindowSummary &summary);
+
+  // Add the samples of one record channel to a window channel
+  void addChannel(WindowChannel channel, const SensorRecord &record,
+                  uint8_t recordChannel, float scale);
+};
+
+#endif // WINDOW_STATS_H
@@ -0,0 +1,107 @@
+#include "driver/adc.h"
+#include "esp_timer.h"
+
+static uint16_t midScale(adc1_channel_t channel, uint64_t timeUs) {
+  return 2048;
+}
+
+static ShimAdcSource adcSource = midScale;
+static adc1_channel_t pattern[SOC_ADC_PATT_LEN_MAX];
+static uint32_t patternLength = 0;
+static uint32_t sampleRate = 0;
+static uint32_t frameBytes = 0;
+static uint32_t bufferSamples = 0;
+static bool converting = false;
+
+// Conversions since the start, those handed out or lost so far
+static uint64_t startUs = 0;
+static uint64_t consumed = 0;
+static uint32_t lost = 0;
+
+// Time the first n conversions are complete
+static uint64_t timeOfSamples(uint64_t n) {
+  return startUs + (n * 1000000 + sampleRate - 1) / sampleRate;
+}
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *config) {
+  frameBytes = config->conv_num_each_intr;
+  bufferSamples = config->max_store_buf_size / 2;
+  return ESP_OK;
+}
+
+esp_err_t
+adc_digi_controller_configure(const adc_digi_configuration_t *config) {
+  if (config->pattern_num == 0 || config->pattern_num > SOC_ADC_PATT_LEN_MAX ||
+      config->sample_freq_hz == 0 ||
+      config->format != ADC_DIGI_OUTPUT_FORMAT_TYPE1) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (uint32_t i = 0; i < config->pattern_num; i++) {
+    pattern[i] = (adc1_channel_t)config->adc_pattern[i].channel;
+  }
+  patternLength = config->pattern_num;
+  sampleRate = config->sample_freq_hz;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_start() {
+  if (patternLength == 0 || frameBytes == 0) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  startUs = esp_timer_get_time();
+  consumed = 0;
+  converting = true;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_stop() {
+  converting = false;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_read_bytes(uint8_t *buffer, uint32_t length,
+                              uint32_t *outLength, uint32_t timeoutMs) {
+  *outLength = 0;
+  if (!converting) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  // Whole frames, as the DMA interrupt hands them over
+  uint32_t words = (length < frameBytes ? length : frameBytes) / 2;
+  uint64_t readyAt = timeOfSamples(consumed + words);
+  uint64_t deadline = esp_timer_get_time() + (uint64_t)timeoutMs * 1000;
+  if (readyAt > deadline) {
+    shimWaitUntilMicros(deadline);
+    return ESP_ERR_TIMEOUT;
+  }
+  shimWaitUntilMicros(readyAt);
+
+  // Conversions beyond the driver buffer overwrite the oldest
+  esp_err_t result = ESP_OK;
+  uint64_t converted =
+      (esp_timer_get_time() - startUs) * sampleRate / 1000000;
+  if (converted - consumed > bufferSamples) {
+    uint64_t dropped = converted - consumed - bufferSamples;
+    lost += dropped;
+    consumed += dropped;
+    result = ESP_ERR_INVALID_STATE;
+  }
+
+  for (uint32_t i = 0; i < words; i++) {
+    uint64_t n = consumed + i;
+    adc1_channel_t channel = pattern[n % patternLength];
+    uint16_t value = adcSource(channel, timeOfSamples(n + 1)) & 0x0FFF;
+    uint16_t word = (uint16_t)(channel << 12) | value;
+    buffer[2 * i] = word & 0xFF;
+    buffer[2 * i + 1] = word >> 8;
+  }
+  consumed += words;
+  *outLength = words * 2;
+  return result;
+}
+
+void shimAdcSetSource(ShimAdcSource source) {
+  adcSource = source != NULL ? source : midScale;
+}
+
+uint32_t shimAdcLostSamples() { return lost; }
@@ -0,0 +1,202 @@
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+// Minimal Arduino/FreeRTOS API for the native (host) build: enough for the
+// libraries and the firmware tasks in src/. Time is virtual and only moves
+// when a test advances it; queues and task notifications are real and
+// work across std::threads.
+//
+// Once a test calls shimStartScheduling(), the tasks created through the
+// shim and the test itself run one at a time like on a single core: a
+// task runs until it blocks, blocking calls wait in virtual time, and the
+// clock jumps to the next deadline when every task is blocked. Runs are
+// repeatable and hours of firmware time take seconds. Peripherals
+// (driver/adc.h, driver/rmt.h, WiFi.h, GPIO interrupts) follow the
+// virtual clock and need it.
+
+#include "esp_err.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define IRAM_ATTR
+
+typedef uint8_t byte;
+
+// Virtual clock
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// Host-side control of the shim (not part of the Arduino API). While
+// scheduling, advancing the clock lets the tasks run through the time.
+void shimSetMillis(unsigned long ms);
+void shimAdvanceMillis(unsigned long ms);
+void shimSetSerialOutput(bool enabled);
+
+// Pseudo-random numbers (seeded, so runs are repeatable)
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+// Arduino String, as far as the firmware (and the String code the
+// benchmarks compare against) uses it
+class String {
+public:
+  String() {}
+  String(const char *text) : _text(text != NULL ? text : "") {}
+  String(const std::string &text) : _text(text) {}
+
+  const char *c_str() const { return _text.c_str(); }
+  unsigned int length() const { return _text.length(); }
+  bool operator==(const char *text) const { return _text == text; }
+  String &operator+=(char c) {
+    _text += c;
+    return *this;
+  }
+
+private:
+  std::string _text;
+};
+
+// Objects the serial port can print (IPAddress)
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual String toString() const = 0;
+};
+
+// Serial port (stdout)
+class HardwareSerial {
+public:
+  void begin(unsigned long baud) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  size_t print(const char *text);
+  size_t println(const char *text = "");
+  size_t println(const Printable &value);
+  size_t printf(const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+// Chip information (plausible values; the heap follows shimHeapUse())
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap() { return 110000; }
+  uint64_t getEfuseMac() { return 0x0000AABBCCDDEEFFULL; }
+  uint32_t getCycleCount();
+};
+
+extern EspClass ESP;
+
+uint32_t getCpuFrequencyMhz();
+
+// Host-side control: heap taken (bytes > 0) or given back (bytes < 0) by
+// a stand-in, and the low-water mark back to its boot value
+void shimHeapUse(int32_t bytes);
+void shimHeapResetLowWater();
+
+// Digital pins. Interrupt handlers run in the task that changes the pin
+// level with shimSetPin().
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LOW 0
+#define HIGH 1
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(int interrupt, void (*handler)(), int mode);
+
+// Host-side control: drive an input pin (runs its interrupt handler)
+void shimSetPin(uint8_t pin, int level);
+
+// FreeRTOS: one tick per millisecond
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef struct ShimQueue *QueueHandle_t;
+typedef struct ShimTask *TaskHandle_t;
+typedef struct ShimQueue *SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portTICK_PERIOD_MS 1
+
+// Critical sections map to one process-wide lock
+typedef struct {
+  int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+void shimEnterCritical(portMUX_TYPE *mux);
+void shimExitCritical(portMUX_TYPE *mux);
+#define portENTER_CRITICAL(mux) shimEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) shimExitCritical(mux)
+
+// No preemption on the host: a woken task runs once the current one
+// blocks
+#define portYIELD_FROM_ISR() ((void)0)
+
+// Queues (timeouts are in real time until scheduling starts)
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                      TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+// Mutexes are queues of one empty item
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
+
+// Tasks run on std::threads; notifications are counting semaphores
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name,
+                                   uint32_t stackSize, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TaskHandle_t xTaskGetIdleTaskHandleForCPU(UBaseType_t cpu);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+// Host-side control: run tasks one at a time on the virtual clock from
+// now on (the calling thread becomes a task too; call before creating
+// the tasks to schedule)
+void shimStartScheduling();
+
+// Host-side control: block the calling task until the virtual clock
+// reaches us (for peripherals that work in microseconds)
+void shimWaitUntilMicros(uint64_t us);
+
+// Longest single wait of a task in a blocking call (virtual ms, while
+// scheduling)
+uint32_t shimLongestBlockMs(TaskHandle_t task);
+
+#endif // ARDUINO_SHIM_H
@@ -0,0 +1,582 @@
+#include "Arduino.h"
+#include "Wire.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+EspClass ESP;
+TwoWire Wire;
+
+static uint64_t shimMicros = 0;
+
+// Heap: free at boot and its low-water mark after boot
+#define SHIM_HEAP_FREE 180000
+#define SHIM_HEAP_BOOT_LOW_WATER 150000
+static uint32_t heapFree = SHIM_HEAP_FREE;
+static uint32_t heapLowWater = SHIM_HEAP_BOOT_LOW_WATER;
+static bool serialOutput = true;
+static std::mt19937 shimRandom(12345);
+static std::recursive_mutex criticalLock;
+
+// A task: its thread, notification count and scheduling state
+struct ShimTask {
+  std::mutex lock;
+  std::condition_variable notified;
+  uint32_t notifications = 0;
+
+  // While scheduling (all guarded by schedLock)
+  std::condition_variable turn; // signalled when the task may run
+  UBaseType_t priority = 0;
+  bool controller = false; // the test thread that started scheduling
+  bool blocked = false;
+  uint64_t wakeAtUs = 0;        // UINT64_MAX: no timeout
+  const void *waitingOn = NULL; // queue or task whose change wakes it
+  uint64_t blockOrder = 0;      // ties between equal deadlines
+  uint64_t longestBlockUs = 0;
+};
+
+static thread_local ShimTask *currentTask = NULL;
+
+// Scheduler state, guarded by schedLock. Never destroyed: parked task
+// threads still wait on it when the process exits.
+static std::mutex &schedLock = *new std::mutex();
+static std::vector<ShimTask *> &schedTasks = *new std::vector<ShimTask *>();
+static std::deque<ShimTask *> &readyTasks = *new std::deque<ShimTask *>();
+static bool scheduling = false;
+static ShimTask *running = NULL;
+static uint64_t blockCount = 0;
+
+// Queue a task to run after the running one, behind tasks of its
+// priority and above
+static void makeReady(ShimTask *task) {
+  task->blocked = false;
+  task->waitingOn = NULL;
+  std::deque<ShimTask *>::iterator it = readyTasks.begin();
+  while (it != readyTasks.end() && (*it)->priority >= task->priority) {
+    ++it;
+  }
+  readyTasks.insert(it, task);
+}
+
+// Which of two blocked tasks wakes first: the earlier deadline, at equal
+// deadlines tasks before the test thread, then in order of blocking
+static bool wakesBefore(const ShimTask *a, const ShimTask *b) {
+  if (a->wakeAtUs != b->wakeAtUs) {
+    return a->wakeAtUs < b->wakeAtUs;
+  }
+  if (a->controller != b->controller) {
+    return b->controller;
+  }
+  return a->blockOrder < b->blockOrder;
+}
+
+// Hand the CPU to the next ready task; with none, move the clock to the
+// earliest deadline and wake that task (schedLock held)
+static void dispatch() {
+  if (!readyTasks.empty()) {
+    running = readyTasks.front();
+    readyTasks.pop_front();
+  } else {
+    ShimTask *next = NULL;
+    for (ShimTask *task : schedTasks) {
+      if (task->blocked && task->wakeAtUs != UINT64_MAX &&
+          (next == NULL || wakesBefore(task, next))) {
+        next = task;
+      }
+    }
+    if (next == NULL) {
+      fprintf(stderr, "shim: every task waits forever\n");
+      abort();
+    }
+    if (next->wakeAtUs > shimMicros) {
+      shimMicros = next->wakeAtUs;
+    }
+    next->blocked = false;
+    next->waitingOn = NULL;
+    running = next;
+  }
+  running->turn.notify_one();
+}
+
+// Block the running task until wakeAtUs or a change of channel, run the
+// others meanwhile (schedLock held)
+static void block(std::unique_lock<std::mutex> &guard, ShimTask *self,
+                  uint64_t wakeAtUs, const void *channel) {
+  uint64_t since = shimMicros;
+  self->blocked = true;
+  self->wakeAtUs = wakeAtUs;
+  self->waitingOn = channel;
+  self->blockOrder = blockCount++;
+  dispatch();
+  self->turn.wait(guard, [&] { return running == self; });
+  self->longestBlockUs = std::max(self->longestBlockUs, shimMicros - since);
+}
+
+// Wake every task blocked on channel (schedLock held)
+static void wakeWaiters(const void *channel) {
+  for (ShimTask *task : schedTasks) {
+    if (task->blocked && task->waitingOn == channel) {
+      makeReady(task);
+    }
+  }
+}
+
+// Wait in virtual time until ready() holds or ticks have passed, woken
+// by changes of channel (schedLock held)
+template <typename Predicate>
+static bool scheduledWait(std::unique_lock<std::mutex> &guard,
+                          const void *channel, TickType_t ticks,
+                          Predicate ready) {
+  ShimTask *self = xTaskGetCurrentTaskHandle();
+  uint64_t deadline = ticks == portMAX_DELAY
+                          ? UINT64_MAX
+                          : shimMicros + (uint64_t)ticks * 1000;
+  while (!ready()) {
+    if (shimMicros >= deadline) {
+      return false;
+    }
+    block(guard, self, deadline, channel);
+  }
+  return true;
+}
+
+unsigned long millis() { return (unsigned long)(shimMicros / 1000); }
+
+unsigned long micros() { return (unsigned long)shimMicros; }
+
+int64_t esp_timer_get_time() { return (int64_t)shimMicros; }
+
+void delay(unsigned long ms) {
+  if (scheduling) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void shimSetMillis(unsigned long ms) {
+  shimMicros = (uint64_t)ms * 1000;
+}
+
+void shimAdvanceMillis(unsigned long ms) {
+  if (scheduling) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    return;
+  }
+  shimMicros += (uint64_t)ms * 1000;
+}
+
+void shimSetSerialOutput(bool enabled) { serialOutput = enabled; }
+
+long random(long max) { return max > 0 ? (long)(shimRandom() % max) : 0; }
+
+long random(long min, long max) {
+  return max > min ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed) { shimRandom.seed(seed); }
+
+uint32_t esp_random() { return shimRandom(); }
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_INVALID_ARG:
+    return "ESP_ERR_INVALID_ARG";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_TIMEOUT:
+    return "ESP_ERR_TIMEOUT";
+  default:
+    return "UNKNOWN ERROR";
+  }
+}
+
+size_t HardwareSerial::print(const char *text) {
+  if (!serialOutput) {
+    return 0;
+  }
+  fputs(text, stdout);
+  return strlen(text);
+}
+
+size_t HardwareSerial::println(const char *text) {
+  if (!serialOutput) {
+    return 0;
+  }
+  return ::printf("%s\n", text);
+}
+
+size_t HardwareSerial::println(const Printable &value) {
+  return println(value.toString().c_str());
+}
+
+size_t HardwareSerial::printf(const char *format, ...) {
+  if (!serialOutput) {
+    return 0;
+  }
+  va_list args;
+  va_start(args, format);
+  int written = vprintf(format, args);
+  va_end(args);
+  return written > 0 ? written : 0;
+}
+
+uint32_t EspClass::getCycleCount() {
+  // Nanoseconds, so one "cycle" per ns at getCpuFrequencyMhz() = 1000
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint32_t getCpuFrequencyMhz() { return 1000; }
+
+uint32_t EspClass::getFreeHeap() { return heapFree; }
+
+uint32_t EspClass::getMinFreeHeap() { return heapLowWater; }
+
+void shimHeapUse(int32_t bytes) {
+  heapFree -= bytes;
+  if (heapFree < heapLowWater) {
+    heapLowWater = heapFree;
+  }
+}
+
+void shimHeapResetLowWater() { heapLowWater = SHIM_HEAP_BOOT_LOW_WATER; }
+
+// Digital pins: level, mode and interrupt handler
+struct ShimPin {
+  int level;
+  uint8_t mode;
+  void (*handler)();
+  int interruptMode;
+};
+
+#define SHIM_PIN_COUNT 40
+static ShimPin pins[SHIM_PIN_COUNT];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < SHIM_PIN_COUNT) {
+    pins[pin].mode = mode;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < SHIM_PIN_COUNT ? pins[pin].level : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin < SHIM_PIN_COUNT) {
+    pins[pin].level = level;
+  }
+}
+
+int digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+void attachInterrupt(int interrupt, void (*handler)(), int mode) {
+  if (interrupt >= 0 && interrupt < SHIM_PIN_COUNT) {
+    pins[interrupt].handler = handler;
+    pins[interrupt].interruptMode = mode;
+  }
+}
+
+void shimSetPin(uint8_t pin, int level) {
+  if (pin >= SHIM_PIN_COUNT) {
+    return;
+  }
+  ShimPin &state = pins[pin];
+  int previous = state.level;
+  state.level = level;
+  bool rising = !previous && level;
+  bool falling = previous && !level;
+  if (state.handler != NULL &&
+      ((rising && (state.interruptMode & RISING)) ||
+       (falling && (state.interruptMode & FALLING)))) {
+    state.handler();
+  }
+}
+
+void shimEnterCritical(portMUX_TYPE *mux) { criticalLock.lock(); }
+
+void shimExitCritical(portMUX_TYPE *mux) { criticalLock.unlock(); }
+
+// Bounded FIFO of fixed-size items
+struct ShimQueue {
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+
+// Wait on a condition for up to ticks (ms, portMAX_DELAY: forever)
+template <typename Predicate>
+static bool waitFor(std::condition_variable &changed,
+                    std::unique_lock<std::mutex> &guard, TickType_t ticks,
+                    Predicate ready) {
+  if (ticks == portMAX_DELAY) {
+    changed.wait(guard, ready);
+    return true;
+  }
+  return changed.wait_for(guard, std::chrono::milliseconds(ticks), ready);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  ShimQueue *queue = new ShimQueue();
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+// Append an item and wake the waiters (queue lock or schedLock held)
+static void pushItem(QueueHandle_t queue, const void *item) {
+  const uint8_t *bytes = (const uint8_t *)item;
+  queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  if (scheduling) {
+    wakeWaiters(queue);
+  } else {
+    queue->changed.notify_all();
+  }
+}
+
+// Remove the oldest item into item and wake the waiters
+static void popItem(QueueHandle_t queue, void *item) {
+  if (queue->itemSize > 0) {
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+  }
+  queue->items.pop_front();
+  if (scheduling) {
+    wakeWaiters(queue);
+  } else {
+    queue->changed.notify_all();
+  }
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                      TickType_t ticks) {
+  if (scheduling) {
+    std::unique_lock<std::mutex> guard(schedLock);
+    if (!scheduledWait(guard, queue, ticks, [&] {
+          return queue->items.size() < queue->length;
+        })) {
+      return pdFALSE;
+    }
+    pushItem(queue, item);
+    return pdTRUE;
+  }
+  std::unique_lock<std::mutex> guard(queue->lock);
+  if (!waitFor(queue->changed, guard, ticks,
+               [&] { return queue->items.size() < queue->length; })) {
+    return pdFALSE;
+  }
+  pushItem(queue, item);
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+  if (scheduling) {
+    std::unique_lock<std::mutex> guard(schedLock);
+    if (!scheduledWait(guard, queue, ticks,
+                       [&] { return !queue->items.empty(); })) {
+      return pdFALSE;
+    }
+    popItem(queue, item);
+    return pdTRUE;
+  }
+  std::unique_lock<std::mutex> guard(queue->lock);
+  if (!waitFor(queue->changed, guard, ticks,
+               [&] { return !queue->items.empty(); })) {
+    return pdFALSE;
+  }
+  popItem(queue, item);
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return queue->length - queue->items.size();
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+  xQueueSend(mutex, NULL, 0);
+  return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks) {
+  return xQueueReceive(mutex, NULL, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+  return xQueueSend(mutex, NULL, 0);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  // Threads not created through the shim get a task on first use
+  if (currentTask == NULL) {
+    currentTask = new ShimTask();
+  }
+  return currentTask;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandleForCPU(UBaseType_t cpu) {
+  static ShimTask idleTasks[2];
+  return &idleTasks[cpu % 2];
+}
+
+void shimStartScheduling() {
+  ShimTask *self = xTaskGetCurrentTaskHandle();
+  std::lock_guard<std::mutex> guard(schedLock);
+  self->controller = true;
+  schedTasks.push_back(self);
+  running = self;
+  scheduling = true;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name,
+                                   uint32_t stackSize, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  ShimTask *task = new ShimTask();
+  task->priority = priority;
+  if (handle != NULL) {
+    *handle = task;
+  }
+  if (!scheduling) {
+    std::thread([=] {
+      currentTask = task;
+      function(parameter);
+    }).detach();
+    return pdPASS;
+  }
+
+  // Runs once the creating task blocks
+  {
+    std::lock_guard<std::mutex> guard(schedLock);
+    schedTasks.push_back(task);
+    makeReady(task);
+  }
+  std::thread([=] {
+    currentTask = task;
+    {
+      std::unique_lock<std::mutex> guard(schedLock);
+      task->turn.wait(guard, [&] { return running == task; });
+    }
+    function(parameter);
+    vTaskDelete(NULL);
+  }).detach();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  ShimTask *self = xTaskGetCurrentTaskHandle();
+  if (task == NULL) {
+    task = self;
+  }
+  std::unique_lock<std::mutex> guard(schedLock);
+  if (scheduling) {
+    schedTasks.erase(std::remove(schedTasks.begin(), schedTasks.end(), task),
+                     schedTasks.end());
+    readyTasks.erase(
+        std::remove(readyTasks.begin(), readyTasks.end(), task),
+        readyTasks.end());
+    if (task == self) {
+      dispatch();
+    }
+  }
+
+  // A deleted task never runs again; its thread parks for good
+  if (task == self) {
+    self->turn.wait(guard, [] { return false; });
+  }
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  if (scheduling) {
+    std::lock_guard<std::mutex> guard(schedLock);
+    task->notifications++;
+    wakeWaiters(task);
+    return pdPASS;
+  }
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->notifications++;
+  task->notified.notify_one();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+  xTaskNotifyGive(task);
+  if (woken != NULL) {
+    *woken = pdTRUE;
+  }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  ShimTask *task = xTaskGetCurrentTaskHandle();
+  if (scheduling) {
+    std::unique_lock<std::mutex> guard(schedLock);
+    scheduledWait(guard, task, ticks,
+                  [&] { return task->notifications > 0; });
+  } else {
+    std::unique_lock<std::mutex> guard(task->lock);
+    waitFor(task->notified, guard, ticks,
+            [&] { return task->notifications > 0; });
+  }
+  uint32_t value = task->notifications;
+  if (value > 0) {
+    task->notifications = clearOnExit ? 0 : value - 1;
+  }
+  return value;
+}
+
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+
+void shimWaitUntilMicros(uint64_t us) {
+  if (!scheduling) {
+    return;
+  }
+  ShimTask *self = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> guard(schedLock);
+  while (shimMicros < us) {
+    block(guard, self, us, NULL);
+  }
+}
+
+void vTaskDelay(TickType_t ticks) {
+  if (scheduling) {
+    shimWaitUntilMicros(shimMicros + (uint64_t)ticks * 1000);
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment) {
+  TickType_t wake = *previousWake + increment;
+  *previousWake = wake;
+  int32_t remaining = (int32_t)(wake - xTaskGetTickCount());
+  if (remaining > 0) {
+    vTaskDelay((TickType_t)remaining);
+  }
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return 0; }
+
+uint32_t shimLongestBlockMs(TaskHandle_t task) {
+  std::lock_guard<std::mutex> guard(schedLock);
+  return (uint32_t)(task->longestBlockUs / 1000);
+}
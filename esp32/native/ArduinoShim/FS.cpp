@@ -0,0 +1,154 @@
+#include "FS.h"
+#include "LittleFS.h"
+#include <dirent.h>
+#include <sys/stat.h>
+
+static long writeBudget = -1;
+
+void shimFsLimitWrites(long budget) { writeBudget = budget; }
+
+namespace fs {
+
+// An open file or directory
+struct FileImpl {
+  FILE *file = NULL;
+  DIR *dir = NULL;
+  std::string hostPath;
+  std::string name; // path as the firmware sees it
+
+  ~FileImpl() {
+    if (file != NULL) {
+      fclose(file);
+    }
+    if (dir != NULL) {
+      closedir(dir);
+    }
+  }
+};
+
+File::operator bool() const {
+  return _impl && (_impl->file != NULL || _impl->dir != NULL);
+}
+
+size_t File::write(const uint8_t *data, size_t length) {
+  if (!*this || _impl->file == NULL) {
+    return 0;
+  }
+  size_t allowed = length;
+  if (writeBudget >= 0 && (long)length > writeBudget) {
+    allowed = writeBudget;
+  }
+  size_t written = fwrite(data, 1, allowed, _impl->file);
+  if (writeBudget >= 0) {
+    writeBudget -= written;
+  }
+
+  // What was written reaches the "flash" even if the rest never does
+  fflush(_impl->file);
+  return written;
+}
+
+size_t File::read(uint8_t *data, size_t length) {
+  if (!*this || _impl->file == NULL) {
+    return 0;
+  }
+  return fread(data, 1, length, _impl->file);
+}
+
+bool File::seek(uint32_t position) {
+  return *this && _impl->file != NULL &&
+         position <= size() && fseek(_impl->file, position, SEEK_SET) == 0;
+}
+
+size_t File::size() const {
+  struct stat info;
+  if (!*this || stat(_impl->hostPath.c_str(), &info) != 0) {
+    return 0;
+  }
+  return info.st_size;
+}
+
+void File::flush() {
+  if (*this && _impl->file != NULL) {
+    fflush(_impl->file);
+  }
+}
+
+void File::close() { _impl.reset(); }
+
+const char *File::name() const { return _impl ? _impl->name.c_str() : ""; }
+
+bool File::isDirectory() const { return _impl && _impl->dir != NULL; }
+
+File File::openNextFile() {
+  if (!isDirectory()) {
+    return File();
+  }
+  struct dirent *entry;
+  while ((entry = readdir(_impl->dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+    std::shared_ptr<FileImpl> impl = std::make_shared<FileImpl>();
+    impl->hostPath = _impl->hostPath + "/" + entry->d_name;
+    impl->name = _impl->name + "/" + entry->d_name;
+    impl->file = fopen(impl->hostPath.c_str(), "rb");
+    if (impl->file == NULL) {
+      impl->dir = opendir(impl->hostPath.c_str());
+    }
+    return File(impl);
+  }
+  return File();
+}
+
+File FS::open(const char *path, const char *mode) {
+  std::shared_ptr<FileImpl> impl = std::make_shared<FileImpl>();
+  impl->hostPath = _root + path;
+  impl->name = path;
+
+  struct stat info;
+  if (strcmp(mode, FILE_READ) == 0 &&
+      stat(impl->hostPath.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+    impl->dir = opendir(impl->hostPath.c_str());
+  } else {
+    const char *hostMode = strcmp(mode, FILE_WRITE) == 0    ? "wb"
+                           : strcmp(mode, FILE_APPEND) == 0 ? "ab"
+                                                            : "rb";
+    impl->file = fopen(impl->hostPath.c_str(), hostMode);
+  }
+  return File(impl);
+}
+
+bool FS::exists(const char *path) {
+  struct stat info;
+  return stat((_root + path).c_str(), &info) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+  return ::mkdir((_root + path).c_str(), 0755) == 0;
+}
+
+bool FS::remove(const char *path) {
+  return ::remove((_root + path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+  return ::rename((_root + from).c_str(), (_root + to).c_str()) == 0;
+}
+
+} // namespace fs
+
+fs::LittleFSFS LittleFS;
+
+bool fs::LittleFSFS::begin(bool formatOnFail, const char *basePath,
+                           uint8_t maxOpenFiles, const char *label) {
+  if (!_root.empty()) {
+    return true;
+  }
+  char root[] = "/tmp/littlefs-XXXXXX";
+  if (mkdtemp(root) == NULL) {
+    return false;
+  }
+  _root = root;
+  return true;
+}
@@ -0,0 +1,60 @@
+#ifndef FS_SHIM_H
+#define FS_SHIM_H
+
+// Arduino FS API of the native build, backed by a directory on the host.
+// Writes can be cut short to simulate power loss in the middle of one.
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+// Host-side control: after budget more bytes, writes are cut short and
+// fail (negative: unlimited)
+void shimFsLimitWrites(long budget);
+
+namespace fs {
+
+struct FileImpl;
+
+class File {
+public:
+  File() {}
+  File(std::shared_ptr<FileImpl> impl) : _impl(impl) {}
+
+  operator bool() const;
+  size_t write(const uint8_t *data, size_t length);
+  size_t read(uint8_t *data, size_t length);
+  bool seek(uint32_t position);
+  size_t size() const;
+  void flush();
+  void close();
+  const char *name() const;
+  bool isDirectory() const;
+  File openNextFile();
+
+private:
+  std::shared_ptr<FileImpl> _impl;
+};
+
+class FS {
+public:
+  // Paths are relative to root, a directory on the host
+  FS(const char *root) : _root(root) {}
+
+  File open(const char *path, const char *mode = FILE_READ);
+  bool exists(const char *path);
+  bool mkdir(const char *path);
+  bool remove(const char *path);
+  bool rename(const char *from, const char *to);
+
+protected:
+  std::string _root;
+};
+
+} // namespace fs
+
+#endif // FS_SHIM_H
@@ -0,0 +1,60 @@
+#ifndef LIQUID_CRYSTAL_I2C_SHIM_H
+#define LIQUID_CRYSTAL_I2C_SHIM_H
+
+// HD44780 LCD behind a PCF8574 of the native build: keeps the characters
+// written, so a test can read the display back
+
+#include <Arduino.h>
+
+class LiquidCrystal_I2C {
+public:
+  LiquidCrystal_I2C(uint8_t address, uint8_t columns, uint8_t rows)
+      : _columns(columns < 20 ? columns : 20), _rows(rows < 4 ? rows : 4),
+        _column(0), _row(0) {
+    clear();
+  }
+
+  void init() {}
+  void backlight() {}
+  void createChar(uint8_t location, uint8_t charmap[]) {}
+
+  void clear() {
+    memset(_text, ' ', sizeof(_text));
+    for (int row = 0; row < 4; row++) {
+      _text[row][20] = '\0';
+    }
+    setCursor(0, 0);
+  }
+
+  void setCursor(uint8_t column, uint8_t row) {
+    _column = column;
+    _row = row;
+  }
+
+  size_t write(uint8_t value) {
+    if (_row < _rows && _column < _columns) {
+      _text[_row][_column++] = value;
+    }
+    return 1;
+  }
+
+  size_t print(const char *text) {
+    size_t count = 0;
+    while (*text != '\0') {
+      count += write((uint8_t)*text++);
+    }
+    return count;
+  }
+
+  // Host-side: one row of the display (custom characters as codes 0-7)
+  const char *shimRow(uint8_t row) const { return _text[row % 4]; }
+
+private:
+  uint8_t _columns;
+  uint8_t _rows;
+  uint8_t _column;
+  uint8_t _row;
+  char _text[4][21];
+};
+
+#endif // LIQUID_CRYSTAL_I2C_SHIM_H
@@ -0,0 +1,23 @@
+#ifndef LITTLEFS_SHIM_H
+#define LITTLEFS_SHIM_H
+
+// LittleFS of the native build: a fresh temporary directory on the host,
+// created when the firmware mounts it
+
+#include "FS.h"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+public:
+  LittleFSFS() : FS("") {}
+
+  bool begin(bool formatOnFail = false, const char *basePath = "/littlefs",
+             uint8_t maxOpenFiles = 10, const char *label = "spiffs");
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif // LITTLEFS_SHIM_H
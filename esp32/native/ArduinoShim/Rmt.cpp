@@ -0,0 +1,124 @@
+#include "driver/rmt.h"
+#include "esp_timer.h"
+
+// DHT11 frame: response (80 µs low, 80 µs high), 40 bits of 50 µs low
+// and 26 or 70 µs high, a closing low; one RMT item per low/high pair
+#define DHT_FRAME_ITEMS 42
+
+// The one capture of the ring buffer, delivered once the frame is over
+struct ShimRingbuf {
+  rmt_item32_t items[DHT_FRAME_ITEMS];
+  size_t itemCount;
+  uint64_t readyAtUs;
+  bool capturing;
+  bool handedOut;
+};
+
+static ShimRingbuf dhtRingbuf;
+static uint16_t idleThresholdUs = 12000;
+static float dhtTemperature = 21.0f;
+static float dhtHumidity = 45.0f;
+static bool dhtPresent = true;
+
+esp_err_t rmt_config(const rmt_config_t *config) {
+  if (config->rmt_mode != RMT_MODE_RX || config->clk_div != 80) {
+    return ESP_ERR_INVALID_ARG; // only 1 µs ticks are modelled
+  }
+  idleThresholdUs = config->rx_config.idle_threshold;
+  return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t ringbufSize,
+                             int interruptFlags) {
+  return ESP_OK;
+}
+
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel,
+                                 RingbufHandle_t *ringbuf) {
+  *ringbuf = &dhtRingbuf;
+  return ESP_OK;
+}
+
+// Set one item: a low and a high level of the given lengths (µs)
+static void setItem(rmt_item32_t &item, uint16_t lowUs, uint16_t highUs) {
+  item.level0 = 0;
+  item.duration0 = lowUs;
+  item.level1 = 1;
+  item.duration1 = highUs;
+}
+
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool resetMemory) {
+  ShimRingbuf &ringbuf = dhtRingbuf;
+  ringbuf.capturing = false;
+  if (!dhtPresent) {
+    return ESP_OK;
+  }
+
+  // DHT11 bytes: humidity and temperature as integral and tenths, the
+  // sign in bit 7 of the temperature tenths, then the checksum
+  int humidity = (int)lroundf(dhtHumidity * 10);
+  int temperature = (int)lroundf(fabsf(dhtTemperature) * 10);
+  uint8_t bytes[5] = {(uint8_t)(humidity / 10), (uint8_t)(humidity % 10),
+                      (uint8_t)(temperature / 10),
+                      (uint8_t)(temperature % 10), 0};
+  if (dhtTemperature < 0) {
+    bytes[3] |= 0x80;
+  }
+  bytes[4] = bytes[0] + bytes[1] + bytes[2] + bytes[3];
+
+  uint32_t frameUs = 0;
+  setItem(ringbuf.items[0], 80, 80);
+  frameUs += 160;
+  for (int bit = 0; bit < 40; bit++) {
+    bool one = bytes[bit / 8] & (0x80 >> (bit % 8));
+    uint16_t high = one ? 70 : 26;
+    setItem(ringbuf.items[1 + bit], 50, high);
+    frameUs += 50 + high;
+  }
+  // Closing low, then the line idles high until the capture ends
+  setItem(ringbuf.items[DHT_FRAME_ITEMS - 1], 50, 0);
+  frameUs += 50;
+
+  ringbuf.itemCount = DHT_FRAME_ITEMS;
+  ringbuf.readyAtUs = esp_timer_get_time() + frameUs + idleThresholdUs;
+  ringbuf.capturing = true;
+  ringbuf.handedOut = false;
+  return ESP_OK;
+}
+
+esp_err_t rmt_rx_stop(rmt_channel_t channel) {
+  // A capture not complete by now is lost
+  if (esp_timer_get_time() < (int64_t)dhtRingbuf.readyAtUs) {
+    dhtRingbuf.capturing = false;
+  }
+  return ESP_OK;
+}
+
+void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *itemSize,
+                         TickType_t ticks) {
+  uint64_t now = esp_timer_get_time();
+  uint64_t deadline =
+      ticks == portMAX_DELAY ? UINT64_MAX : now + (uint64_t)ticks * 1000;
+  if (ringbuf->capturing && !ringbuf->handedOut &&
+      ringbuf->readyAtUs <= deadline) {
+    shimWaitUntilMicros(ringbuf->readyAtUs);
+    ringbuf->handedOut = true;
+    *itemSize = ringbuf->itemCount * sizeof(rmt_item32_t);
+    return ringbuf->items;
+  }
+  if (deadline != UINT64_MAX) {
+    shimWaitUntilMicros(deadline);
+  }
+  return NULL;
+}
+
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item) {
+  ringbuf->capturing = false;
+}
+
+void shimDhtSetReading(float temperature, float humidity) {
+  dhtTemperature = temperature;
+  dhtHumidity = humidity;
+}
+
+void shimDhtSetPresent(bool present) { dhtPresent = present; }
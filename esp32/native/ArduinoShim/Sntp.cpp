@@ -0,0 +1,22 @@
+#include "esp_sntp.h"
+
+static sntp_sync_time_cb_t syncCallback = NULL;
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {
+  syncCallback = callback;
+}
+
+void sntp_set_sync_interval(uint32_t intervalMs) {}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec,
+                const char *server1, const char *server2) {}
+
+void shimSntpSync(uint64_t epochMs) {
+  if (syncCallback == NULL) {
+    return;
+  }
+  struct timeval tv;
+  tv.tv_sec = epochMs / 1000;
+  tv.tv_usec = (epochMs % 1000) * 1000;
+  syncCallback(&tv);
+}
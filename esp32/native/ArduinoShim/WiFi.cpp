@@ -0,0 +1,220 @@
+#include "WiFi.h"
+#include "esp_wpa2.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+WiFiClass WiFi;
+
+// An event waiting for the event task
+struct ShimWiFiEvent {
+  arduino_event_id_t id;
+  arduino_event_info_t info;
+};
+
+// Station state, guarded by wifiLock
+static std::mutex wifiLock;
+static std::vector<std::string> networksInRange;
+static std::vector<WiFiEventFuncCb> handlers;
+static std::vector<ShimWiFiEvent> events;
+static unsigned long joinTimeMs = 2000;
+static std::string joining; // network being joined, empty if none
+static unsigned long joinDoneAt = 0;
+static std::string joined; // network of the link, empty if down
+static wl_status_t stationStatus = WL_IDLE_STATUS;
+static uint32_t attempts = 0;
+static TaskHandle_t eventTask = NULL;
+
+static bool inRange(const std::string &ssid) {
+  for (const std::string &network : networksInRange) {
+    if (network == ssid) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Queue an event for the handlers (wifiLock held)
+static void postEvent(arduino_event_id_t id, uint8_t reason = 0) {
+  ShimWiFiEvent event;
+  event.id = id;
+  event.info.wifi_sta_disconnected.reason = reason;
+  events.push_back(event);
+}
+
+// Finish a join whose time has come (wifiLock held)
+static void completeJoin() {
+  if (joining.empty() || (long)(millis() - joinDoneAt) < 0) {
+    return;
+  }
+  if (inRange(joining)) {
+    joined = joining;
+    stationStatus = WL_CONNECTED;
+    postEvent(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    postEvent(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  } else {
+    stationStatus = WL_NO_SSID_AVAIL;
+    postEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+  }
+  joining.clear();
+}
+
+// Event task: completes joins on time and runs the handlers outside the
+// lock, like the Arduino core's event task
+static void wifiEventTask(void *parameter) {
+  while (true) {
+    std::vector<ShimWiFiEvent> due;
+    std::vector<WiFiEventFuncCb> callbacks;
+    TickType_t wait = portMAX_DELAY;
+    {
+      std::lock_guard<std::mutex> guard(wifiLock);
+      completeJoin();
+      due.swap(events);
+      callbacks = handlers;
+      if (!joining.empty()) {
+        wait = pdMS_TO_TICKS(joinDoneAt - millis());
+      }
+    }
+    for (const ShimWiFiEvent &event : due) {
+      for (WiFiEventFuncCb callback : callbacks) {
+        callback(event.id, event.info);
+      }
+    }
+    if (due.empty()) {
+      ulTaskNotifyTake(pdTRUE, wait);
+    }
+  }
+}
+
+// Start the event task on first use, wake it for new events or joins
+static void wakeEventTask() {
+  if (eventTask == NULL) {
+    xTaskCreatePinnedToCore(wifiEventTask, "arduino_events", 4096, NULL, 5,
+                            &eventTask, 1);
+  }
+  xTaskNotifyGive(eventTask);
+}
+
+String IPAddress::toString() const {
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", _bytes[0], _bytes[1],
+           _bytes[2], _bytes[3]);
+  return String(text);
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase) {
+  {
+    std::lock_guard<std::mutex> guard(wifiLock);
+    if (!joined.empty()) {
+      postEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+      joined.clear();
+    }
+    joining = ssid;
+    joinDoneAt = millis() + joinTimeMs;
+    stationStatus = WL_DISCONNECTED;
+    attempts++;
+  }
+  wakeEventTask();
+  return WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+  {
+    std::lock_guard<std::mutex> guard(wifiLock);
+    if (!joined.empty()) {
+      postEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+    }
+    joined.clear();
+    joining.clear();
+    stationStatus = WL_DISCONNECTED;
+  }
+  wakeEventTask();
+  return true;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) { return true; }
+
+wl_status_t WiFiClass::status() {
+  std::lock_guard<std::mutex> guard(wifiLock);
+  return stationStatus;
+}
+
+String WiFiClass::SSID() {
+  std::lock_guard<std::mutex> guard(wifiLock);
+  return String(joined);
+}
+
+IPAddress WiFiClass::localIP() {
+  std::lock_guard<std::mutex> guard(wifiLock);
+  return joined.empty() ? IPAddress() : IPAddress(192, 168, 1, 50);
+}
+
+int8_t WiFiClass::RSSI() {
+  std::lock_guard<std::mutex> guard(wifiLock);
+  return joined.empty() ? 0 : -60;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb callback,
+                                   arduino_event_id_t event) {
+  std::lock_guard<std::mutex> guard(wifiLock);
+  handlers.push_back(callback);
+  return handlers.size();
+}
+
+void shimWiFiSetInRange(const char *ssid, bool available) {
+  {
+    std::lock_guard<std::mutex> guard(wifiLock);
+    if (available == inRange(ssid)) {
+      return;
+    }
+    if (available) {
+      networksInRange.push_back(ssid);
+    } else {
+      for (size_t i = 0; i < networksInRange.size(); i++) {
+        if (networksInRange[i] == ssid) {
+          networksInRange.erase(networksInRange.begin() + i);
+          break;
+        }
+      }
+      if (joined == ssid) {
+        // Beacons stop, the station notices the link is gone
+        joined.clear();
+        stationStatus = WL_CONNECTION_LOST;
+        postEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+                  WIFI_REASON_BEACON_TIMEOUT);
+      }
+    }
+  }
+  if (eventTask != NULL) {
+    xTaskNotifyGive(eventTask);
+  }
+}
+
+void shimWiFiSetJoinTime(unsigned long ms) {
+  std::lock_guard<std::mutex> guard(wifiLock);
+  joinTimeMs = ms;
+}
+
+uint32_t shimWiFiAttempts() {
+  std::lock_guard<std::mutex> guard(wifiLock);
+  return attempts;
+}
+
+esp_err_t esp_wifi_sta_wpa2_ent_set_identity(const unsigned char *identity,
+                                             int length) {
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_wpa2_ent_set_username(const unsigned char *username,
+                                             int length) {
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_wpa2_ent_set_password(const unsigned char *password,
+                                             int length) {
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_wpa2_ent_enable() { return ESP_OK; }
+
+esp_err_t esp_wifi_sta_wpa2_ent_disable() { return ESP_OK; }
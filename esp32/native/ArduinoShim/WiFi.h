@@ -0,0 +1,94 @@
+#ifndef WIFI_SHIM_H
+#define WIFI_SHIM_H
+
+// Arduino WiFi station API of the native build. Joining a network takes
+// a scripted time on the virtual clock and only succeeds for networks
+// the test put in range; taking the joined network out of range drops
+// the link. Events are delivered from an event task, as the Arduino
+// core's, so the clock has to be scheduled (shimStartScheduling()).
+
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF,
+  WIFI_STA,
+  WIFI_AP,
+  WIFI_AP_STA,
+} wifi_mode_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_STA_START,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP,
+  ARDUINO_EVENT_MAX,
+} arduino_event_id_t;
+
+// Disconnect reasons the shim reports
+#define WIFI_REASON_ASSOC_LEAVE 8
+#define WIFI_REASON_BEACON_TIMEOUT 200
+#define WIFI_REASON_NO_AP_FOUND 201
+
+typedef struct {
+  uint8_t reason;
+} wifi_event_sta_disconnected_t;
+
+typedef union {
+  wifi_event_sta_disconnected_t wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef void (*WiFiEventFuncCb)(WiFiEvent_t event, WiFiEventInfo_t info);
+typedef size_t wifi_event_id_t;
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : _bytes{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : _bytes{a, b, c, d} {}
+
+  uint8_t operator[](int index) const { return _bytes[index]; }
+  String toString() const;
+
+private:
+  uint8_t _bytes[4];
+};
+
+class WiFiClass {
+public:
+  wl_status_t begin(const char *ssid, const char *passphrase = NULL);
+  bool disconnect(bool wifiOff = false, bool eraseAp = false);
+  bool mode(wifi_mode_t mode);
+  wl_status_t status();
+  String SSID();
+  IPAddress localIP();
+  int8_t RSSI();
+
+  // All events go to every handler (the filter of the real API is not
+  // modelled)
+  wifi_event_id_t onEvent(WiFiEventFuncCb callback,
+                          arduino_event_id_t event = ARDUINO_EVENT_MAX);
+};
+
+extern WiFiClass WiFi;
+
+// Host-side control: put a network in or out of range (none are at
+// first) and set how long joining one takes (default 2 s)
+void shimWiFiSetInRange(const char *ssid, bool inRange);
+void shimWiFiSetJoinTime(unsigned long ms);
+
+// Connection attempts (WiFi.begin() calls) so far
+uint32_t shimWiFiAttempts();
+
+#endif // WIFI_SHIM_H
@@ -0,0 +1,18 @@
+#ifndef WIRE_SHIM_H
+#define WIRE_SHIM_H
+
+// I2C bus of the native build (nothing is attached)
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+    return true;
+  }
+  void setClock(uint32_t frequency) {}
+};
+
+extern TwoWire Wire;
+
+#endif // WIRE_SHIM_H
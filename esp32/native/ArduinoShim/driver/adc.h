@@ -0,0 +1,87 @@
+#ifndef ADC_SHIM_H
+#define ADC_SHIM_H
+
+// ESP-IDF ADC DMA ("digi") driver of the native build. Conversions run
+// at the configured rate on the virtual clock, scanning the pattern
+// table; values come from a scripted source. A read waits (virtual time)
+// until a whole frame is converted; frames not read in time overflow
+// the driver buffer as on the device.
+
+#include <Arduino.h>
+
+typedef enum {
+  ADC1_CHANNEL_0,
+  ADC1_CHANNEL_1,
+  ADC1_CHANNEL_2,
+  ADC1_CHANNEL_3,
+  ADC1_CHANNEL_4,
+  ADC1_CHANNEL_5,
+  ADC1_CHANNEL_6,
+  ADC1_CHANNEL_7,
+  ADC1_CHANNEL_MAX,
+} adc1_channel_t;
+
+typedef enum {
+  ADC_ATTEN_DB_0,
+  ADC_ATTEN_DB_2_5,
+  ADC_ATTEN_DB_6,
+  ADC_ATTEN_DB_11,
+} adc_atten_t;
+
+typedef enum {
+  ADC_CONV_SINGLE_UNIT_1 = 1,
+  ADC_CONV_SINGLE_UNIT_2 = 2,
+} adc_digi_convert_mode_t;
+
+// Type 1: little-endian 16-bit words, channel << 12 | 12-bit value
+typedef enum {
+  ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+  ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+} adc_digi_output_format_t;
+
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+#define SOC_ADC_PATT_LEN_MAX 16
+
+typedef struct {
+  uint32_t max_store_buf_size;
+  uint32_t conv_num_each_intr;
+  uint32_t adc1_chan_mask;
+  uint32_t adc2_chan_mask;
+} adc_digi_init_config_t;
+
+typedef struct {
+  uint8_t atten;
+  uint8_t channel;
+  uint8_t unit;
+  uint8_t bit_width;
+} adc_digi_pattern_config_t;
+
+typedef struct {
+  bool conv_limit_en;
+  uint32_t conv_limit_num;
+  uint32_t pattern_num;
+  adc_digi_pattern_config_t *adc_pattern;
+  uint32_t sample_freq_hz;
+  adc_digi_convert_mode_t conv_mode;
+  adc_digi_output_format_t format;
+} adc_digi_configuration_t;
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *config);
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config);
+esp_err_t adc_digi_start();
+esp_err_t adc_digi_stop();
+
+// Wait up to timeoutMs for a frame; ESP_ERR_INVALID_STATE if conversions
+// were lost since the last read (the frame is still returned)
+esp_err_t adc_digi_read_bytes(uint8_t *buffer, uint32_t length,
+                              uint32_t *outLength, uint32_t timeoutMs);
+
+// Host-side control: value (0-4095) of a channel at a time of the
+// virtual clock (default: mid-scale on every channel)
+typedef uint16_t (*ShimAdcSource)(adc1_channel_t channel, uint64_t timeUs);
+void shimAdcSetSource(ShimAdcSource source);
+
+// Conversions lost to driver buffer overflows so far
+uint32_t shimAdcLostSamples();
+
+#endif // ADC_SHIM_H
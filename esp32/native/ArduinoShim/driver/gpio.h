@@ -0,0 +1,37 @@
+#ifndef GPIO_SHIM_H
+#define GPIO_SHIM_H
+
+// ESP-IDF GPIO driver of the native build, on the Arduino pin state
+
+#include <Arduino.h>
+
+typedef int gpio_num_t;
+
+typedef enum {
+  GPIO_MODE_DISABLE,
+  GPIO_MODE_INPUT,
+  GPIO_MODE_OUTPUT,
+  GPIO_MODE_INPUT_OUTPUT_OD,
+} gpio_mode_t;
+
+typedef enum {
+  GPIO_PULLUP_ONLY,
+  GPIO_PULLDOWN_ONLY,
+  GPIO_PULLUP_PULLDOWN,
+  GPIO_FLOATING,
+} gpio_pull_mode_t;
+
+inline esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode) {
+  return ESP_OK;
+}
+
+inline esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+  digitalWrite(pin, level);
+  return ESP_OK;
+}
+
+inline esp_err_t gpio_set_pull_mode(gpio_num_t pin, gpio_pull_mode_t pull) {
+  return ESP_OK;
+}
+
+#endif // GPIO_SHIM_H
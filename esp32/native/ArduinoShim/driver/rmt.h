@@ -0,0 +1,78 @@
+#ifndef RMT_SHIM_H
+#define RMT_SHIM_H
+
+// ESP-IDF RMT receiver of the native build with a DHT11 on the line: a
+// capture started with rmt_rx_start() yields the sensor's pulse train in
+// the channel's ring buffer once the frame is over (virtual time), as
+// the hardware would record it.
+
+#include "driver/gpio.h"
+#include "freertos/ringbuf.h"
+#include <Arduino.h>
+
+typedef enum {
+  RMT_CHANNEL_0,
+  RMT_CHANNEL_1,
+  RMT_CHANNEL_2,
+  RMT_CHANNEL_3,
+  RMT_CHANNEL_4,
+  RMT_CHANNEL_5,
+  RMT_CHANNEL_6,
+  RMT_CHANNEL_7,
+  RMT_CHANNEL_MAX,
+} rmt_channel_t;
+
+typedef enum {
+  RMT_MODE_TX,
+  RMT_MODE_RX,
+} rmt_mode_t;
+
+// Two levels and their durations in ticks; a zero duration ends the
+// capture
+typedef struct {
+  union {
+    struct {
+      uint32_t duration0 : 15;
+      uint32_t level0 : 1;
+      uint32_t duration1 : 15;
+      uint32_t level1 : 1;
+    };
+    uint32_t val;
+  };
+} rmt_item32_t;
+
+typedef struct {
+  uint16_t idle_threshold;
+  uint8_t filter_ticks_thresh;
+  bool filter_en;
+} rmt_rx_config_t;
+
+typedef struct {
+  rmt_mode_t rmt_mode;
+  rmt_channel_t channel;
+  gpio_num_t gpio_num;
+  uint8_t clk_div;
+  uint8_t mem_block_num;
+  uint32_t flags;
+  rmt_rx_config_t rx_config;
+} rmt_config_t;
+
+#define RMT_DEFAULT_CONFIG_RX(gpio, channel_id)                             \
+  {                                                                         \
+    RMT_MODE_RX, channel_id, gpio, 80, 1, 0, { 12000, 100, true }           \
+  }
+
+esp_err_t rmt_config(const rmt_config_t *config);
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t ringbufSize,
+                             int interruptFlags);
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel,
+                                 RingbufHandle_t *ringbuf);
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool resetMemory);
+esp_err_t rmt_rx_stop(rmt_channel_t channel);
+
+// Host-side control: what the DHT11 measures (default 21.0 °C, 45 %RH)
+// and whether it answers at all
+void shimDhtSetReading(float temperature, float humidity);
+void shimDhtSetPresent(bool present);
+
+#endif // RMT_SHIM_H
@@ -0,0 +1,16 @@
+#ifndef ESP_ERR_SHIM_H
+#define ESP_ERR_SHIM_H
+
+// ESP-IDF error codes used by the firmware (native build)
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_TIMEOUT 0x107
+
+const char *esp_err_to_name(esp_err_t code);
+
+#endif // ESP_ERR_SHIM_H
@@ -0,0 +1,21 @@
+#ifndef ESP_SNTP_SHIM_H
+#define ESP_SNTP_SHIM_H
+
+// SNTP API of the native build. Nothing goes to the network: a test
+// reports a sync with shimSntpSync() and the registered callback runs as
+// it would on the lwIP task.
+
+#include <Arduino.h>
+#include <sys/time.h>
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
+void sntp_set_sync_interval(uint32_t intervalMs);
+void configTime(long gmtOffsetSec, int daylightOffsetSec,
+                const char *server1, const char *server2 = NULL);
+
+// Host-side control: SNTP read the wall clock as epochMs just now
+void shimSntpSync(uint64_t epochMs);
+
+#endif // ESP_SNTP_SHIM_H
@@ -0,0 +1,9 @@
+#ifndef ESP_TIMER_SHIM_H
+#define ESP_TIMER_SHIM_H
+
+#include <Arduino.h>
+
+// Microseconds of the virtual clock (same time base as millis())
+int64_t esp_timer_get_time();
+
+#endif // ESP_TIMER_SHIM_H
@@ -0,0 +1,17 @@
+#ifndef ESP_WPA2_SHIM_H
+#define ESP_WPA2_SHIM_H
+
+// WPA2-Enterprise credentials of the native build (accepted, not checked)
+
+#include <Arduino.h>
+
+esp_err_t esp_wifi_sta_wpa2_ent_set_identity(const unsigned char *identity,
+                                             int length);
+esp_err_t esp_wifi_sta_wpa2_ent_set_username(const unsigned char *username,
+                                             int length);
+esp_err_t esp_wifi_sta_wpa2_ent_set_password(const unsigned char *password,
+                                             int length);
+esp_err_t esp_wifi_sta_wpa2_ent_enable();
+esp_err_t esp_wifi_sta_wpa2_ent_disable();
+
+#endif // ESP_WPA2_SHIM_H
@@ -0,0 +1,16 @@
+#ifndef RINGBUF_SHIM_H
+#define RINGBUF_SHIM_H
+
+// FreeRTOS ring buffer of the native build, as far as the RMT driver
+// hands captures through it (see driver/rmt.h)
+
+#include <Arduino.h>
+
+typedef struct ShimRingbuf *RingbufHandle_t;
+
+// Next item, waiting up to ticks for one (virtual time); NULL if none
+void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *itemSize,
+                         TickType_t ticks);
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item);
+
+#endif // RINGBUF_SHIM_H
@@ -0,0 +1,163 @@
+#ifndef FIREBASE_CLIENT_STAND_IN_H
+#define FIREBASE_CLIENT_STAND_IN_H
+
+// Stand-in for the FirebaseClient library in the native build: an
+// in-process fake, not an HTTP endpoint. It keeps the API FirebaseManager
+// uses and replaces the HTTPS transport with a scripted Realtime
+// Database: each update is recorded, checked for being a JSON object
+// (HTTP 400 if not), and answered from FirebaseApp::loop() after a
+// simulated round trip (virtual millis()), with a success or a scripted
+// error. Like the real AsyncClient, a client carries one request at a
+// time: requests queued on it are answered one round trip apart. Opening
+// the connection costs nothing unless standIn::setHandshakeCost() says so.
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <string>
+#include <vector>
+
+#define FIREBASE_CLIENT_VERSION "native-stand-in"
+
+// JSON body of an update (the real library keeps a String too)
+class object_t {
+public:
+  object_t() {}
+  object_t(const char *json) : _json(json) {}
+
+  const char *c_str() const { return _json.c_str(); }
+
+private:
+  std::string _json;
+};
+
+class FirebaseError {
+public:
+  FirebaseError() : _code(0) {}
+  FirebaseError(int code, const char *message)
+      : _code(code), _message(message) {}
+
+  int code() const { return _code; }
+  String message() const { return String(_message); }
+
+private:
+  int _code;
+  std::string _message;
+};
+
+class AsyncResult {
+public:
+  AsyncResult(const std::string &uid, bool failed, const FirebaseError &error)
+      : _uid(uid), _failed(failed), _error(error) {}
+
+  bool isError() { return _failed; }
+  bool available() { return !_failed; }
+  String uid() { return String(_uid); }
+  FirebaseError &error() { return _error; }
+
+private:
+  std::string _uid;
+  bool _failed;
+  FirebaseError _error;
+};
+
+typedef void (*AsyncResultCallback)(AsyncResult &result);
+
+class AsyncClientClass {
+public:
+  AsyncClientClass(WiFiClientSecure &client) {}
+};
+
+class LegacyToken {
+public:
+  LegacyToken(const char *token) {}
+};
+
+struct AuthStandIn {};
+
+AuthStandIn getAuth(LegacyToken &token);
+
+class RealtimeDatabase {
+public:
+  void url(const char *host) {}
+
+  // Multi-location update of the JSON object in value
+  void update(AsyncClientClass &client, const char *path,
+              const object_t &value, AsyncResultCallback callback,
+              const char *uid);
+};
+
+class FirebaseApp {
+public:
+  bool ready();
+
+  // Deliver the results of requests whose round trip has passed
+  void loop();
+
+  template <typename T> void getApp(T &app) {}
+};
+
+void initializeApp(AsyncClientClass &client, FirebaseApp &app,
+                   const AuthStandIn &auth);
+
+// One update as the stand-in received it
+struct StandInRequest {
+  std::string uid;
+  std::string body;
+  bool validJson;
+  unsigned long sentAt;
+  unsigned long answeredAt; // 0 until answered
+  int errorCode;            // 0: acknowledged
+};
+
+// Script and inspect the stand-in
+namespace standIn {
+
+// Forget all requests and scripted failures, link up, given round trip
+void reset(unsigned long roundTripMs);
+
+// Keep copies of the requests (default). Off, update() allocates nothing,
+// so allocation counts only see the caller.
+void setRecording(bool enabled);
+
+// Round trip of the requests sent from now on
+void setRoundTrip(unsigned long roundTripMs);
+
+// Answer the next count requests with an error (HTTP status, or a
+// negative transport error code)
+void failNext(int errorCode, int count);
+
+// Answer a share of the requests (percent, drawn with random()) with an
+// error, after any failNext() ones
+void failRandomly(int errorCode, int percent);
+
+// Cost of a TLS handshake: a request that opens the connection blocks
+// FirebaseApp::loop() for ms, like the real connect, with heapBytes of
+// heap taken meanwhile (see shimHeapUse). Free (0, 0) after reset().
+void setHandshakeCost(unsigned long ms, uint32_t heapBytes);
+
+// Keep the connection open between requests (default), or close it after
+// every answer, so that each request pays the handshake
+void setKeepAlive(bool enabled);
+
+// Handshakes paid since reset()
+uint32_t handshakeCount();
+
+// Take the link down (requests fail with a transport error, TLS drops)
+void setLinkUp(bool up);
+
+// Requests recorded so far (answered or not)
+const std::vector<StandInRequest> &requests();
+
+// Requests and body bytes received, recorded or not
+uint32_t requestCount();
+size_t bytesSent();
+
+// Requests not answered yet
+int pending();
+
+// Check that text is one well-formed JSON value
+bool isValidJson(const char *text);
+
+} // namespace standIn
+
+#endif // FIREBASE_CLIENT_STAND_IN_H
@@ -0,0 +1,372 @@
+#include "FirebaseClient.h"
+#include <ctype.h>
+#include <map>
+
+// Transport error of a request sent while the link is down (the async
+// client reports TCP errors with negative codes)
+#define STAND_IN_CONNECTION_REFUSED -1
+
+// A request waiting for its round trip
+struct PendingRequest {
+  char uid[16];
+  unsigned long sentAt;
+  unsigned long dueAt; // when its answer arrives
+  int errorCode;
+  int recorded; // index in received, -1 if not recorded
+  bool handshake;              // opens the connection first
+  unsigned long handshakeStart; // once the client is free
+  AsyncResultCallback callback;
+};
+
+// Requests in flight at once (more than any upload window)
+#define STAND_IN_MAX_PENDING 64
+
+static std::vector<StandInRequest> received;
+static std::vector<PendingRequest> pendingRequests;
+
+// A client has one connection and sends one request at a time, like the
+// real AsyncClient: a request queued behind others starts when the one
+// before it is answered. Time the last queued request of each client is
+// answered.
+static std::map<const AsyncClientClass *, unsigned long> clientBusyUntil;
+static bool recording = true;
+static uint32_t requestTotal = 0;
+static size_t byteTotal = 0;
+static unsigned long roundTrip = 0;
+static int failCode = 0;
+static int failCount = 0;
+static int randomFailCode = 0;
+static int randomFailPercent = 0;
+static bool linkUp = true;
+static bool initialized = false;
+
+// The connection opens with the first request after the link came up
+static bool connectionOpen = false;
+
+// Cost of opening it (see standIn::setHandshakeCost), and whether the
+// server keeps it open between requests
+static unsigned long handshakeMs = 0;
+static uint32_t handshakeHeap = 0;
+static bool keepAlive = true;
+static uint32_t handshakeTotal = 0;
+
+AuthStandIn getAuth(LegacyToken &token) { return AuthStandIn(); }
+
+void initializeApp(AsyncClientClass &client, FirebaseApp &app,
+                   const AuthStandIn &auth) {
+  initialized = true;
+}
+
+bool FirebaseApp::ready() { return initialized; }
+
+void FirebaseApp::loop() {
+  // Answer in order of sending; a request is answered once its round
+  // trip (after those queued before it on its client) has passed
+  size_t kept = 0;
+  for (size_t i = 0; i < pendingRequests.size(); i++) {
+    PendingRequest request = pendingRequests[i];
+
+    // The handshake blocks the loop, like the real client's connect, and
+    // holds its heap until done
+    if (request.handshake &&
+        (long)(millis() - request.handshakeStart) >= 0) {
+      request.handshake = false;
+      shimHeapUse(handshakeHeap);
+      shimAdvanceMillis(handshakeMs);
+      shimHeapUse(-(int32_t)handshakeHeap);
+    }
+    if ((long)(millis() - request.dueAt) < 0) {
+      pendingRequests[kept++] = request;
+      continue;
+    }
+    if (request.recorded >= 0) {
+      StandInRequest &sent = received[request.recorded];
+      sent.answeredAt = millis() != 0 ? millis() : 1;
+    }
+    FirebaseError error;
+    if (request.errorCode != 0) {
+      error = FirebaseError(request.errorCode, request.errorCode > 0
+                                                   ? "HTTP error"
+                                                   : "connection refused");
+    }
+    AsyncResult result(request.uid, request.errorCode != 0, error);
+    if (request.callback != NULL) {
+      request.callback(result);
+    }
+    if (!keepAlive) {
+      connectionOpen = false;
+    }
+  }
+  pendingRequests.resize(kept);
+}
+
+void RealtimeDatabase::update(AsyncClientClass &client, const char *path,
+                              const object_t &value,
+                              AsyncResultCallback callback,
+                              const char *uid) {
+  const char *body = value.c_str();
+  bool validJson = body[0] == '{' && standIn::isValidJson(body);
+  requestTotal++;
+  byteTotal += strlen(body);
+
+  PendingRequest request;
+  snprintf(request.uid, sizeof(request.uid), "%s", uid);
+  request.sentAt = millis();
+  std::map<const AsyncClientClass *, unsigned long>::iterator busy =
+      clientBusyUntil.find(&client);
+  unsigned long startAt = request.sentAt;
+  if (busy != clientBusyUntil.end() && (long)(busy->second - startAt) > 0) {
+    startAt = busy->second;
+  }
+  // Without keep-alive every request opens the connection again
+  request.handshake = linkUp && (!connectionOpen || !keepAlive) &&
+                      (handshakeMs > 0 || handshakeHeap > 0);
+  request.handshakeStart = startAt;
+  if (request.handshake) {
+    handshakeTotal++;
+    startAt += handshakeMs;
+  }
+  request.dueAt = startAt + roundTrip;
+  clientBusyUntil[&client] = request.dueAt;
+  request.errorCode = 0;
+  request.recorded = -1;
+  request.callback = callback;
+  if (!linkUp) {
+    request.errorCode = STAND_IN_CONNECTION_REFUSED;
+  } else if (failCount > 0) {
+    request.errorCode = failCode;
+    failCount--;
+  } else if (randomFailPercent > 0 && random(100) < randomFailPercent) {
+    request.errorCode = randomFailCode;
+  } else if (!validJson) {
+    request.errorCode = 400;
+  }
+  connectionOpen = linkUp;
+
+  if (recording) {
+    StandInRequest sent;
+    sent.uid = uid;
+    sent.body = body;
+    sent.validJson = validJson;
+    sent.sentAt = request.sentAt;
+    sent.answeredAt = 0;
+    sent.errorCode = request.errorCode;
+    received.push_back(sent);
+    request.recorded = received.size() - 1;
+  }
+  pendingRequests.push_back(request);
+}
+
+bool WiFiClientSecure::connected() { return linkUp && connectionOpen; }
+
+namespace standIn {
+
+void reset(unsigned long roundTripMs) {
+  received.clear();
+  pendingRequests.clear();
+  clientBusyUntil.clear();
+  pendingRequests.reserve(STAND_IN_MAX_PENDING);
+  recording = true;
+  requestTotal = 0;
+  byteTotal = 0;
+  roundTrip = roundTripMs;
+  failCode = 0;
+  failCount = 0;
+  randomFailPercent = 0;
+  linkUp = true;
+  connectionOpen = false;
+  handshakeMs = 0;
+  handshakeHeap = 0;
+  keepAlive = true;
+  handshakeTotal = 0;
+}
+
+void setRecording(bool enabled) { recording = enabled; }
+
+void setRoundTrip(unsigned long roundTripMs) { roundTrip = roundTripMs; }
+
+void failNext(int errorCode, int count) {
+  failCode = errorCode;
+  failCount = count;
+}
+
+void failRandomly(int errorCode, int percent) {
+  randomFailCode = errorCode;
+  randomFailPercent = percent;
+}
+
+void setHandshakeCost(unsigned long ms, uint32_t heapBytes) {
+  handshakeMs = ms;
+  handshakeHeap = heapBytes;
+}
+
+void setKeepAlive(bool enabled) { keepAlive = enabled; }
+
+uint32_t handshakeCount() { return handshakeTotal; }
+
+void setLinkUp(bool up) {
+  linkUp = up;
+  if (!up) {
+    connectionOpen = false;
+  }
+}
+
+const std::vector<StandInRequest> &requests() { return received; }
+
+int pending() { return pendingRequests.size(); }
+
+uint32_t requestCount() { return requestTotal; }
+
+size_t bytesSent() { return byteTotal; }
+
+// Recursive descent over one JSON value; advances text past it
+static bool parseValue(const char *&text, int depth);
+
+static void skipSpace(const char *&text) {
+  while (isspace((unsigned char)*text)) {
+    text++;
+  }
+}
+
+static bool parseString(const char *&text) {
+  if (*text != '"') {
+    return false;
+  }
+  text++;
+  while (*text != '"') {
+    if (*text == '\0' || (unsigned char)*text < 0x20) {
+      return false;
+    }
+    if (*text == '\\') {
+      text++;
+      if (*text == 'u') {
+        for (int i = 1; i <= 4; i++) {
+          if (!isxdigit((unsigned char)text[i])) {
+            return false;
+          }
+        }
+        text += 4;
+      } else if (strchr("\"\\/bfnrt", *text) == NULL || *text == '\0') {
+        return false;
+      }
+    }
+    text++;
+  }
+  text++;
+  return true;
+}
+
+static bool parseNumber(const char *&text) {
+  const char *start = text;
+  if (*text == '-') {
+    text++;
+  }
+  if (!isdigit((unsigned char)*text)) {
+    return false;
+  }
+  if (*text == '0' && isdigit((unsigned char)text[1])) {
+    return false;
+  }
+  while (isdigit((unsigned char)*text)) {
+    text++;
+  }
+  if (*text == '.') {
+    text++;
+    if (!isdigit((unsigned char)*text)) {
+      return false;
+    }
+    while (isdigit((unsigned char)*text)) {
+      text++;
+    }
+  }
+  if (*text == 'e' || *text == 'E') {
+    text++;
+    if (*text == '+' || *text == '-') {
+      text++;
+    }
+    if (!isdigit((unsigned char)*text)) {
+      return false;
+    }
+    while (isdigit((unsigned char)*text)) {
+      text++;
+    }
+  }
+  return text > start;
+}
+
+static bool parseLiteral(const char *&text, const char *literal) {
+  size_t length = strlen(literal);
+  if (strncmp(text, literal, length) != 0) {
+    return false;
+  }
+  text += length;
+  return true;
+}
+
+static bool parseContainer(const char *&text, char close, bool object,
+                           int depth) {
+  text++;
+  skipSpace(text);
+  if (*text == close) {
+    text++;
+    return true;
+  }
+  while (true) {
+    skipSpace(text);
+    if (object) {
+      if (!parseString(text)) {
+        return false;
+      }
+      skipSpace(text);
+      if (*text != ':') {
+        return false;
+      }
+      text++;
+    }
+    if (!parseValue(text, depth + 1)) {
+      return false;
+    }
+    skipSpace(text);
+    if (*text == close) {
+      text++;
+      return true;
+    }
+    if (*text != ',') {
+      return false;
+    }
+    text++;
+  }
+}
+
+static bool parseValue(const char *&text, int depth) {
+  if (depth > 32) {
+    return false;
+  }
+  skipSpace(text);
+  switch (*text) {
+  case '{':
+    return parseContainer(text, '}', true, depth);
+  case '[':
+    return parseContainer(text, ']', false, depth);
+  case '"':
+    return parseString(text);
+  case 't':
+    return parseLiteral(text, "true");
+  case 'f':
+    return parseLiteral(text, "false");
+  case 'n':
+    return parseLiteral(text, "null");
+  default:
+    return parseNumber(text);
+  }
+}
+
+bool isValidJson(const char *text) {
+  if (!parseValue(text, 0)) {
+    return false;
+  }
+  skipSpace(text);
+  return *text == '\0';
+}
+
+} // namespace standIn
@@ -0,0 +1,16 @@
+#ifndef WIFI_CLIENT_SECURE_STAND_IN_H
+#define WIFI_CLIENT_SECURE_STAND_IN_H
+
+#include <Arduino.h>
+
+// TLS client of the native build: the connection follows the stand-in's
+// link state and keep-alive setting (see FirebaseClient.h)
+class WiFiClientSecure {
+public:
+  void setCACert(const char *rootCa) {}
+  void setInsecure() {}
+  void setHandshakeTimeout(unsigned long seconds) {}
+  bool connected();
+};
+
+#endif // WIFI_CLIENT_SECURE_STAND_IN_H
@@ -0,0 +1,19 @@
+#pragma once
+
+// Credentials of the native build (include/secrets.h is not checked in).
+// The WiFi and Firebase stand-ins accept anything; tests put these
+// networks in range.
+
+// Primary WiFi (WPA2-Personal)
+#define PRIMARY_WIFI_SSID "host-primary"
+#define PRIMARY_WIFI_PASSWORD "host-password"
+
+// Secondary WiFi (WPA2-Enterprise - fallback)
+#define SECONDARY_WIFI_SSID "host-enterprise"
+#define SECONDARY_WIFI_IDENTITY "host@example.test"
+#define SECONDARY_WIFI_USERNAME "host@example.test"
+#define SECONDARY_WIFI_PASSWORD "host-password"
+
+// Firebase Realtime Database (the in-process stand-in)
+#define FIREBASE_HOST_URL "https://host.firebaseio.test"
+#define FIREBASE_AUTH_TOKEN "host-token"
@@ -0,0 +1,6 @@
+# ThreadSanitizer for the native-tsan env. PlatformIO passes build_flags
+# to the compiler only, the sanitizer runtime also has to be linked.
+Import("env")
+
+env.Append(CCFLAGS=["-fsanitize=thread", "-Wno-tsan"],
+           LINKFLAGS=["-fsanitize=thread"])
@@ -5,6 +5,10 @@
 // Include custom modules
 #include "DisplayManager.h"
 #include "FirebaseManager.h"
+#include "Metrics.h"
+#include "SpscRing.h"
+#include "TimeSync.h"
+#include "Trace.h"
 #include "WiFiManager.h"
 #include <DataTypes.h>
 
@@ -12,18 +16,65 @@
 extern void sensorTask(void *parameter);
 extern void cloudTask(void *parameter);
 extern void uiTask(void *parameter);
+extern void eventTask(void *parameter);
+extern void adcTask(void *parameter);
+extern void dhtTask(void *parameter);
+
+// Queue lengths (also reported in the metrics; powers of two for the
+// rings). The sensor ring only covers short hiccups; longer stalls are
+// absorbed by SensorTask's merging backlog.
+#define SENSOR_QUEUE_SIZE 16
+#define EVENT_QUEUE_SIZE 128
+#define ALARM_QUEUE_SIZE 16
+
+// Task stack sizes in bytes (also reported in the metrics)
+#define EVENT_TASK_STACK 3072
+#define ADC_TASK_STACK 3072
+#define DHT_TASK_STACK 2048
+#define SENSOR_TASK_STACK 4096
+#define CLOUD_TASK_STACK 8192
+#define UI_TASK_STACK 2048
+
+// Queue depths are sampled for the metrics at this interval
+#define METRICS_SAMPLE_INTERVAL_MS 1000
+
+static_assert((SENSOR_QUEUE_SIZE & (SENSOR_QUEUE_SIZE - 1)) == 0 &&
+                  (EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1)) == 0,
+              "Ring sizes must be powers of two");
+
+// Readings and events cross from core 1 to CloudTask on core 0 through
+// lock-free rings (one producer, one consumer each; static storage)
+SensorRecord sensorRingStorage[SENSOR_QUEUE_SIZE];
+SpscRing sensorRing(sensorRingStorage, sizeof(SensorRecord),
+                    SENSOR_QUEUE_SIZE);
+EventData eventRingStorage[EVENT_QUEUE_SIZE];
+SpscRing eventRing(eventRingStorage, sizeof(EventData), EVENT_QUEUE_SIZE);
 
 // FreeRTOS Queue and Mutex handles
-QueueHandle_t sensorDataQueue;
-QueueHandle_t eventQueue;
+QueueHandle_t alarmQueue;
 SemaphoreHandle_t i2cMutex;
 
+// Task handles (ISRs notify the event task, metrics read the rest)
+TaskHandle_t eventTaskHandle = NULL;
+TaskHandle_t adcTaskHandle = NULL;
+TaskHandle_t dhtTaskHandle = NULL;
+TaskHandle_t sensorTaskHandle = NULL;
+TaskHandle_t cloudTaskHandle = NULL;
+TaskHandle_t uiTaskHandle = NULL;
+
 // Global manager objects
 WiFiManager wifiManager(PRIMARY_WIFI_SSID, PRIMARY_WIFI_PASSWORD,
                         SECONDARY_WIFI_SSID, SECONDARY_WIFI_IDENTITY,
                         SECONDARY_WIFI_USERNAME, SECONDARY_WIFI_PASSWORD);
+#ifdef FIREBASE_ROOT_CA
+FirebaseManager firebaseManager(FIREBASE_HOST_URL, FIREBASE_AUTH_TOKEN,
+                                FIREBASE_ROOT_CA);
+#else
 FirebaseManager firebaseManager(FIREBASE_HOST_URL, FIREBASE_AUTH_TOKEN);
+#endif
 DisplayManager displayManager;
+TimeSync timeSync;
+Metrics metrics;
 
 // Shared state variables
 unsigned long lastSuccessfulSync = 0;
@@ -49,35 +100,84 @@ void setup() {
   displayManager.begin(i2cMutex);
   displayManager.showInitMessage();
 
-  // Create sensor data queue (size 100)
-  sensorDataQueue = xQueueCreate(100, sizeof(SensorData));
-  if (sensorDataQueue == NULL) {
-    Serial.println("ERROR: Failed to create sensor data queue!");
+  // Create alarm queue (size 16, priority path ahead of batched data)
+  alarmQueue = xQueueCreate(ALARM_QUEUE_SIZE, sizeof(AlarmData));
+  if (alarmQueue == NULL) {
+    Serial.println("ERROR: Failed to create alarm queue!");
     while (true) {
       delay(1000);
     }
   }
 
-  // Create event queue (size 100)
-  eventQueue = xQueueCreate(100, sizeof(EventData));
-  if (eventQueue == NULL) {
-    Serial.println("ERROR: Failed to create event queue!");
+  Serial.println("Queues and mutex created successfully.");
+
+  // Create Event Task (Core 1, Priority 3, Stack 3072)
+  // Created before SensorTask, which attaches the ISRs that notify it
+  BaseType_t eventTaskResult =
+      xTaskCreatePinnedToCore(eventTask,        // Task function
+                              "EventTask",      // Task name
+                              EVENT_TASK_STACK, // Stack size (bytes)
+                              NULL,             // Parameters
+                              3,                // Priority
+                              &eventTaskHandle, // Task handle
+                              1                 // Core ID (Core 1)
+      );
+
+  if (eventTaskResult != pdPASS) {
+    Serial.println("ERROR: Failed to create Event Task!");
     while (true) {
       delay(1000);
     }
   }
+  Serial.println("Event Task created on Core 1 (Priority 3)");
 
-  Serial.println("Queues and mutex created successfully.");
+  // Create ADC Task (Core 1, Priority 2, Stack 3072)
+  BaseType_t adcTaskResult =
+      xTaskCreatePinnedToCore(adcTask,        // Task function
+                              "AdcTask",      // Task name
+                              ADC_TASK_STACK, // Stack size (bytes)
+                              NULL,           // Parameters
+                              2,              // Priority
+                              &adcTaskHandle, // Task handle
+                              1               // Core ID (Core 1)
+      );
+
+  if (adcTaskResult != pdPASS) {
+    Serial.println("ERROR: Failed to create ADC Task!");
+    while (true) {
+      delay(1000);
+    }
+  }
+  Serial.println("ADC Task created on Core 1 (Priority 2)");
+
+  // Create DHT Task (Core 0, Priority 1, Stack 2048)
+  BaseType_t dhtTaskResult =
+      xTaskCreatePinnedToCore(dhtTask,        // Task function
+                              "DhtTask",      // Task name
+                              DHT_TASK_STACK, // Stack size (bytes)
+                              NULL,           // Parameters
+                              1,              // Priority
+                              &dhtTaskHandle, // Task handle
+                              0               // Core ID (Core 0)
+      );
+
+  if (dhtTaskResult != pdPASS) {
+    Serial.println("ERROR: Failed to create DHT Task!");
+    while (true) {
+      delay(1000);
+    }
+  }
+  Serial.println("DHT Task created on Core 0 (Priority 1)");
 
   // Create Sensor Task (Core 1, Priority 2, Stack 4096)
   BaseType_t sensorTaskResult =
-      xTaskCreatePinnedToCore(sensorTask,   // Task function
-                              "SensorTask", // Task name
-                              4096,         // Stack size (bytes)
-                              NULL,         // Parameters
-                              2,            // Priority
-                              NULL,         // Task handle
-                              1             // Core ID (Core 1)
+      xTaskCreatePinnedToCore(sensorTask,        // Task function
+                              "SensorTask",      // Task name
+                              SENSOR_TASK_STACK, // Stack size (bytes)
+                              NULL,              // Parameters
+                              2,                 // Priority
+                              &sensorTaskHandle, // Task handle
+                              1                  // Core ID (Core 1)
       );
 
   if (sensorTaskResult != pdPASS) {
@@ -90,13 +190,13 @@ void setup() {
 
   // Create Cloud Task (Core 0, Priority 1, Stack 8192)
   BaseType_t cloudTaskResult =
-      xTaskCreatePinnedToCore(cloudTask,   // Task function
-                              "CloudTask", // Task name
-                              8192,        // Stack size (bytes)
-                              NULL,        // Parameters
-                              1,           // Priority
-                              NULL,        // Task handle
-                              0            // Core ID (Core 0)
+      xTaskCreatePinnedToCore(cloudTask,        // Task function
+                              "CloudTask",      // Task name
+                              CLOUD_TASK_STACK, // Stack size (bytes)
+                              NULL,             // Parameters
+                              1,                // Priority
+                              &cloudTaskHandle, // Task handle
+                              0                 // Core ID (Core 0)
       );
 
   if (cloudTaskResult != pdPASS) {
@@ -108,14 +208,15 @@ void setup() {
   Serial.println("Cloud Task created on Core 0 (Priority 1)");
 
   // Create UI Task (Core 1, Priority 1, Stack 2048)
-  BaseType_t uiTaskResult = xTaskCreatePinnedToCore(uiTask,   // Task function
-                                                    "UITask", // Task name
-                                                    2048, // Stack size (bytes)
-                                                    NULL, // Parameters
-                                                    1,    // Priority
-                                                    NULL, // Task handle
-                                                    1     // Core ID (Core 1)
-  );
+  BaseType_t uiTaskResult =
+      xTaskCreatePinnedToCore(uiTask,        // Task function
+                              "UITask",      // Task name
+                              UI_TASK_STACK, // Stack size (bytes)
+                              NULL,          // Parameters
+                              1,             // Priority
+                              &uiTaskHandle, // Task handle
+                              1              // Core ID (Core 1)
+      );
 
   if (uiTaskResult != pdPASS) {
     Serial.println("ERROR: Failed to create UI Task!");
@@ -126,23 +227,32 @@ void setup() {
   Serial.println("UI Task created on Core 1 (Priority 1)");
 
   Serial.println("\n=== All tasks started successfully ===\n");
+
+  // Register everything the metrics report (uploaded by CloudTask)
+  metrics.begin();
+  metrics.addTask("EventTask", eventTaskHandle, EVENT_TASK_STACK);
+  metrics.addTask("AdcTask", adcTaskHandle, ADC_TASK_STACK);
+  metrics.addTask("DhtTask", dhtTaskHandle, DHT_TASK_STACK);
+  metrics.addTask("SensorTask", sensorTaskHandle, SENSOR_TASK_STACK);
+  metrics.addTask("CloudTask", cloudTaskHandle, CLOUD_TASK_STACK);
+  metrics.addTask("UITask", uiTaskHandle, UI_TASK_STACK);
+  metrics.addTask("IDLE0", xTaskGetIdleTaskHandleForCPU(0), 0);
+  metrics.addTask("IDLE1", xTaskGetIdleTaskHandleForCPU(1), 0);
+  metrics.addRing("sensor", &sensorRing);
+  metrics.addRing("event", &eventRing);
+  metrics.addQueue("alarm", alarmQueue, ALARM_QUEUE_SIZE);
 }
 
-// Loop function: All work is done by tasks, just yield
+// Loop function: All work is done by tasks; only samples queue depths
+// for the metrics and prints the trace histograms when 't' is received
 void loop() {
-  // All functionality is now handled by FreeRTOS tasks
-  // Just delay to yield CPU time to other tasks
-  vTaskDelay(pdMS_TO_TICKS(1000));
-
-  // Optional: Monitor task stack usage (for debugging)
-  // Uncomment to see stack high water marks periodically
-  /*
-  static unsigned long lastStackCheck = 0;
-  if (millis() - lastStackCheck > 30000) { // Every 30 seconds
-    lastStackCheck = millis();
-    Serial.println("\n=== Stack Usage Report ===");
-    // Note: Would need task handles to check stack usage
-    Serial.println("==========================\n");
+  metrics.sample();
+
+  while (Serial.available() > 0) {
+    if (Serial.read() == 't') {
+      tracePrint();
+    }
   }
-  */
+
+  vTaskDelay(pdMS_TO_TICKS(METRICS_SAMPLE_INTERVAL_MS));
 }
@@ -0,0 +1,21 @@
+#include "AnalogSensors.h"
+#include <Arduino.h>
+
+// External references to global objects
+extern AnalogSensors analogSensors; // defined in SensorTask.cpp
+
+// Task function declaration
+void adcTask(void *parameter);
+
+// ADC task: drains DMA frames into the per-channel windows
+void adcTask(void *parameter) {
+  Serial.println("ADC Task started on Core 1");
+
+  // Start continuous sampling of all analog channels
+  analogSensors.begin();
+
+  while (true) {
+    // Blocks on the DMA driver, no busy polling
+    analogSensors.processSamples();
+  }
+}
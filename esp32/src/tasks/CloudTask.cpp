@@ -1,102 +1,422 @@
 #include "FirebaseManager.h"
+#include "BatchController.h"
+#include "Metrics.h"
+#include "OfflineLog.h"
+#include "SensorBatch.h"
+#include "SpscRing.h"
+#include "TimeSync.h"
+#include "Trace.h"
 #include "WiFiManager.h"
+#include "WindowStats.h"
 #include "secrets.h"
 #include <Arduino.h>
 #include <DataTypes.h>
+#include <LittleFS.h>
 
 // External references to global objects (defined in main.cpp)
-extern QueueHandle_t sensorDataQueue;
-extern QueueHandle_t eventQueue;
+extern SpscRing sensorRing;
+extern SpscRing eventRing;
+extern QueueHandle_t alarmQueue;
 extern WiFiManager wifiManager;
 extern FirebaseManager firebaseManager;
+extern TimeSync timeSync;
+extern Metrics metrics;
 extern unsigned long lastSuccessfulSync;
+extern uint32_t droppedPacketCount;
 
-// Batch configuration
-#define BATCH_SIZE 10
-#define UPLOAD_INTERVAL_MS 10000 // 10 seconds
+// Raw mode: additionally upload every reading of a window as one
+// compressed block (enable with -DRAW_UPLOAD_MODE=1 in build_flags)
+#ifndef RAW_UPLOAD_MODE
+#define RAW_UPLOAD_MODE 0
+#endif
+
+// Loop iterations slower than this are reported (uploads must not block)
+#define LOOP_BUDGET_MS 100
+
+// Longest sleep while both rings are empty (producers wake the task
+// earlier; pending uploads and window closes need the loop to run)
+#define IDLE_WAIT_MS 40
+
+// Events ride along with the next batch, but never wait longer than the
+// flush time, and the offline log is caught up one buffered upload per
+// drain interval. Both adapt to the link within these bounds (see
+// BatchController).
+#define EVENT_FLUSH_MIN_MS 500
+#define EVENT_FLUSH_MAX_MS 10000
+#define DRAIN_INTERVAL_MIN_MS 1000
+#define DRAIN_INTERVAL_MAX_MS 30000
+
+// While the upload window is full, a full set of pending events waits for
+// a slot and the event ring holds the rest; only once the ring is this
+// full do they go to flash
+#define EVENT_SPILL_BACKLOG_PERCENT 50
+
+// Uploads wait this long after the link comes up for the first SNTP sync,
+// so records go out with their capture time; after it, records not yet
+// resolved carry the server time
+#define TIME_SYNC_WAIT_MS 30000
+
+// Metrics are collected and uploaded at this interval (not buffered
+// offline: a missed report is simply skipped)
+#define METRICS_INTERVAL_MS 300000 // 5 minutes
+
+// Store-and-forward logs on flash, used while Firebase is unreachable
+OfflineLog sensorLog("/offline-sensors");
+OfflineLog eventLog("/offline-events");
+
+// Window summaries and events are stored in the offline log as is (the
+// record length is one byte: a larger type would be cut short silently)
+static_assert(sizeof(WindowSummary) <= OFFLINE_LOG_MAX_PAYLOAD,
+              "Window summary does not fit an offline log record");
+static_assert(sizeof(EventData) <= OFFLINE_LOG_MAX_PAYLOAD,
+              "Event does not fit an offline log record");
+
+#if RAW_UPLOAD_MODE
+// Readings of the open window, one column per channel (static, too large
+// for the task stack)
+SensorBatch rawBatch;
+#endif
 
 // Task function declaration
 void cloudTask(void *parameter);
 
+// Save a window summary to the offline log
+void spillSummary(const WindowSummary &summary) {
+  if (sensorLog.append(&summary, sizeof(WindowSummary))) {
+    Serial.printf("Saved window summary (%d readings) to offline log.\n",
+                  summary.readingCount);
+  } else {
+    droppedPacketCount += summary.readingCount;
+  }
+}
+
+// Save pending events to the offline log
+void spillEvents(EventData *events, int count) {
+  int saved = 0;
+  for (int i = 0; i < count; i++) {
+    if (eventLog.append(&events[i], sizeof(EventData))) {
+      saved++;
+    }
+  }
+  Serial.printf("Saved %d/%d events to offline log.\n", saved, count);
+}
+
+// Share of a ring's capacity in use
+uint8_t ringFillPercent(const SpscRing &ring) {
+  return (uint8_t)(ring.size() * 100 / ring.capacity());
+}
+
+// Sleep until a producer adds to either ring (or the timeout). The task
+// only sleeps if both rings are still empty once it has announced the
+// wait, so no wake-up is lost.
+void waitForRings(uint32_t timeoutMs) {
+  if (sensorRing.prepareWait()) {
+    if (eventRing.prepareWait()) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+      eventRing.cancelWait();
+    }
+    sensorRing.cancelWait();
+  }
+}
+
+#if RAW_UPLOAD_MODE
+// Upload the buffered raw readings (not kept offline, the window summary
+// is)
+void flushRawBatch(bool cloudReady) {
+  if (rawBatch.count() == 0) {
+    return;
+  }
+  if (!cloudReady || !firebaseManager.uploadRaw(rawBatch, lastSuccessfulSync)) {
+    Serial.printf("Raw block of %d readings dropped.\n", rawBatch.count());
+  }
+  rawBatch.clear();
+}
+#endif
+
+// Upload one buffered window summary and buffered events together
+void drainOfflineLogs() {
+  WindowSummary drainSummary;
+  bool hasSummary = false;
+
+  // Records of another size (older firmware) are skipped. Capture times
+  // of this boot are resolved now if the clock was not synced at capture;
+  // those of earlier boots cannot be and carry the server time.
+  while (!hasSummary) {
+    int length = sensorLog.read(&drainSummary, sizeof(WindowSummary));
+    if (length < 0) {
+      break;
+    }
+    hasSummary = (length == sizeof(WindowSummary));
+  }
+  if (hasSummary && drainSummary.windowStartEpochMs == 0 &&
+      sensorLog.isReadFromThisBoot()) {
+    drainSummary.windowStartEpochMs =
+        timeSync.toEpochMs(drainSummary.windowStart);
+  }
+
+  EventData drainEvents[MAX_EVENTS_PER_UPLOAD];
+  int drainEventCount = 0;
+
+  while (drainEventCount < MAX_EVENTS_PER_UPLOAD) {
+    int length =
+        eventLog.read(&drainEvents[drainEventCount], sizeof(EventData));
+    if (length < 0) {
+      break;
+    }
+    if (length == sizeof(EventData)) {
+      EventData &event = drainEvents[drainEventCount++];
+      if (event.epochMs == 0 && eventLog.isReadFromThisBoot()) {
+        event.epochMs = timeSync.toEpochMs(event.timestamp);
+      }
+    }
+  }
+
+  if (!hasSummary && drainEventCount == 0) {
+    // Nothing left, drop consumed segments
+    sensorLog.commit();
+    eventLog.commit();
+    return;
+  }
+
+  Serial.printf("Uploading %d buffered windows and %d events...\n",
+                hasSummary ? 1 : 0, drainEventCount);
+
+  // Once queued, the upload pipeline retries the records and commits the
+  // logs past them when Firebase acknowledges them (see FirebaseManager)
+  if (!firebaseManager.uploadBatch(hasSummary ? &drainSummary : NULL,
+                                   drainEvents, drainEventCount,
+                                   lastSuccessfulSync, true)) {
+    sensorLog.rewind();
+    eventLog.rewind();
+  }
+}
+
 // Cloud task: WiFi management and Firebase uploads
 void cloudTask(void *parameter) {
   Serial.println("Cloud Task started on Core 0");
 
-  // Initialize WiFi
-  wifiManager.connectWithFallback();
+  // Start WiFi connection (completes in the background)
+  wifiManager.begin();
+
+  // Start SNTP; capture times taken before it syncs are resolved when
+  // they are uploaded
+  timeSync.begin();
 
   // Initialize Firebase
   firebaseManager.begin();
+  firebaseManager.setTimeSync(&timeSync);
+
+  // Mount flash filesystem for the offline logs (format on first use)
+  if (LittleFS.begin(true)) {
+    sensorLog.begin(LittleFS);
+    eventLog.begin(LittleFS);
+    firebaseManager.setOfflineLogs(&sensorLog, &eventLog);
+  } else {
+    Serial.println("LittleFS mount failed, offline buffering disabled.");
+  }
+
+  // Streaming per-window statistics (constant memory per channel)
+  WindowAggregator aggregator(SUMMARY_WINDOW_MS);
+
+  // Event flush time and drain rate, adapted to round trip, failures and
+  // queue backlog
+  static const BatchBounds batchBounds = {
+      EVENT_FLUSH_MIN_MS, EVENT_FLUSH_MAX_MS, DRAIN_INTERVAL_MIN_MS,
+      DRAIN_INTERVAL_MAX_MS};
+  BatchController batching(batchBounds);
+  firebaseManager.setBatchController(&batching);
+
+  // Events waiting to be merged into the next upload
+  EventData pendingEvents[MAX_EVENTS_PER_UPLOAD];
+  int pendingEventCount = 0;
 
-  // Batch storage
-  SensorData batchData[BATCH_SIZE];
-  int batchCount = 0;
+  // Alarms waiting for a link (uploaded ahead of everything else)
+  AlarmData pendingAlarms[MAX_ALARMS_PER_UPLOAD];
+  int pendingAlarmCount = 0;
 
-  unsigned long lastUploadTime = millis();
-  unsigned long lastWifiCheck = millis();
+  unsigned long lastDrainTime = millis();
+  unsigned long lastMetricsTime = millis();
+
+  // When the link last came up (uploads wait a while for the clock)
+  bool wasLinkReady = false;
+  unsigned long linkReadySince = 0;
+
+  // Every upload slot was in flight at the last attempt (logged once)
+  bool windowFull = false;
 
   while (true) {
-    // Maintain Firebase connection
+    unsigned long iterationStart = millis();
+
+    // Advance WiFi state machine (never blocks)
+    wifiManager.loop();
+
+    // Maintain Firebase connection, run async uploads and their retries
     firebaseManager.loop();
 
-    // Check WiFi connection every 5 seconds
-    if (millis() - lastWifiCheck >= 5000) {
-      lastWifiCheck = millis();
-      wifiManager.checkConnection();
+    // Uploads only make sense with a link, and not while the circuit
+    // breaker holds them back after repeated failures or the clock is
+    // still syncing; otherwise buffer to flash. Alarms only need the link.
+    bool linkReady = wifiManager.isConnected() && firebaseManager.isReady();
+    if (linkReady && !wasLinkReady) {
+      linkReadySince = millis();
+    }
+    wasLinkReady = linkReady;
+    bool clockReady = timeSync.isSynced() ||
+                      millis() - linkReadySince >= TIME_SYNC_WAIT_MS;
+    bool cloudReady =
+        linkReady && clockReady && !firebaseManager.isCircuitOpen();
+
+    // Batching follows the fuller of the two reading rings
+    uint8_t backlog = ringFillPercent(sensorRing);
+    uint8_t eventBacklog = ringFillPercent(eventRing);
+    batching.update(eventBacklog > backlog ? eventBacklog : backlog);
+
+    // Priority path: alarms go out at once, on a slot batches cannot take
+    AlarmData alarm;
+    while (pendingAlarmCount < MAX_ALARMS_PER_UPLOAD &&
+           xQueueReceive(alarmQueue, &alarm, 0) == pdTRUE) {
+      pendingAlarms[pendingAlarmCount++] = alarm;
+    }
+    if (pendingAlarmCount > 0 && linkReady &&
+        firebaseManager.uploadAlarms(pendingAlarms, pendingAlarmCount,
+                                     lastSuccessfulSync)) {
+      pendingAlarmCount = 0;
+    }
+
+    // Nothing to do until readings or events arrive
+    waitForRings(IDLE_WAIT_MS);
+
+    // Aggregate all waiting sensor records in place, one batch per pass. A
+    // record from a later window closes the open one and ends the batch;
+    // without records, the window is closed once its end has passed. The
+    // records stay in the ring until they are released below. Their
+    // wall-clock times come from one clock reading per batch.
+    unsigned long now = millis();
+    aggregator.setClock(timeSync.toEpochMs(now), now);
+    WindowSummary summary;
+    bool summaryDue = false;
+    uint32_t available;
+    uint32_t received = 0;
+    const SensorRecord *records =
+        (const SensorRecord *)sensorRing.peek(available);
+    while (received < available && !summaryDue) {
+      const SensorRecord &record = records[received++];
+      TRACE_VALUE_US(TRACE_QUEUE_RESIDENCY,
+                     (millis() - record.lastTimestamp) * 1000);
+      summaryDue = aggregator.add(record, summary);
+    }
+    if (received > 0) {
+      Serial.printf("Added %u records to window (%d readings)\n", received,
+                    aggregator.getReadingCount());
+    } else {
+      summaryDue = aggregator.closeIfDue(millis(), summary);
     }
 
-    // Try to receive sensor data (non-blocking with timeout)
-    SensorData data;
-    if (xQueueReceive(sensorDataQueue, &data, pdMS_TO_TICKS(100)) == pdTRUE) {
-      // Add to batch
-      if (batchCount < BATCH_SIZE) {
-        batchData[batchCount++] = data;
-        Serial.printf("Added to batch (%d/%d)\n", batchCount, BATCH_SIZE);
+    // Collect events (non-blocking); they ride along with the next upload
+    while (pendingEventCount < MAX_EVENTS_PER_UPLOAD) {
+      uint32_t count;
+      const EventData *events = (const EventData *)eventRing.peek(count);
+      if (events == NULL) {
+        break;
+      }
+      uint32_t room = MAX_EVENTS_PER_UPLOAD - pendingEventCount;
+      if (count > room) {
+        count = room;
+      }
+      for (uint32_t i = 0; i < count; i++) {
+        pendingEvents[pendingEventCount++] = events[i];
       }
+      eventRing.release(count);
     }
 
-    // Upload batch when:
-    // 1. Batch is full, OR
-    // 2. 10 seconds have passed since last upload (and batch has data)
-    bool batchFull = (batchCount >= BATCH_SIZE);
-    bool uploadIntervalPassed =
-        (millis() - lastUploadTime >= UPLOAD_INTERVAL_MS);
-
-    if (batchCount > 0 && (batchFull || uploadIntervalPassed)) {
-      if (firebaseManager.isReady()) {
-        Serial.printf("Uploading batch of %d readings...\n", batchCount);
-
-        if (firebaseManager.uploadBatch(batchData, batchCount,
-                                        lastSuccessfulSync)) {
-          Serial.println("Batch uploaded successfully!");
-          batchCount = 0; // Clear batch
-          lastUploadTime = millis();
-        } else {
-          Serial.println("Batch upload failed, will retry.");
-        }
+    // Flush events on their own once the oldest exceeds its latency budget
+    bool eventsFull = (pendingEventCount >= MAX_EVENTS_PER_UPLOAD);
+    bool eventsDue =
+        pendingEventCount > 0 &&
+        (eventsFull ||
+         millis() - pendingEvents[0].timestamp >= batching.getFlushMs());
+
+    if (summaryDue || eventsDue) {
+      // Events ride along with a closed window, or go on their own
+      const WindowSummary *uploadSummary = summaryDue ? &summary : NULL;
+
+      // Queued uploads complete asynchronously (see FirebaseManager)
+      if (cloudReady &&
+          firebaseManager.uploadBatch(uploadSummary, pendingEvents,
+                                      pendingEventCount, lastSuccessfulSync)) {
+        Serial.println("Upload queued.");
+        pendingEventCount = 0;
+        windowFull = false;
       } else {
-        Serial.println("Firebase not ready, skipping upload.");
+        if (!linkReady) {
+          Serial.println("Firebase not ready, saving to offline log.");
+        } else if (!clockReady) {
+          Serial.println("Waiting for time sync, saving to offline log.");
+        } else if (!cloudReady) {
+          Serial.println("Uploads paused, saving to offline log.");
+        } else if (!windowFull) {
+          Serial.println("Upload window full.");
+        }
+        windowFull = cloudReady;
+
+        // A closed window is never held back; keep it (and events, when
+        // offline or when the event ring backs up) on flash
+        if (summaryDue) {
+          spillSummary(summary);
+        }
+        if (!cloudReady ||
+            (eventsFull && eventBacklog >= EVENT_SPILL_BACKLOG_PERCENT)) {
+          spillEvents(pendingEvents, pendingEventCount);
+          pendingEventCount = 0;
+        }
       }
+    }
 
-      // Reset upload timer even if upload failed to prevent continuous retry
-      // spam
-      if (uploadIntervalPassed) {
-        lastUploadTime = millis();
+#if RAW_UPLOAD_MODE
+    // Raw block follows its window's summary (or goes early when full); a
+    // record that closed a window is the first of the next one. Merged
+    // records go in as their means.
+    bool closedByRecord = summaryDue && received > 0;
+    if (summaryDue && !closedByRecord) {
+      flushRawBatch(cloudReady);
+    }
+    for (uint32_t i = 0; i < received; i++) {
+      if ((closedByRecord && i == received - 1) || rawBatch.isFull()) {
+        flushRawBatch(cloudReady);
       }
+      rawBatch.append(records[i].data);
     }
+#endif
+    sensorRing.release(received);
 
-    // Process event queue (non-blocking)
-    EventData event;
-    while (xQueueReceive(eventQueue, &event, 0) == pdTRUE) {
-      // Upload events immediately (not batched)
-      if (firebaseManager.isReady()) {
-        firebaseManager.uploadEvent(event);
-      } else {
-        Serial.println("Firebase not ready, event dropped.");
+    // Catch up on data buffered while offline (rate limited, one upload
+    // at a time, never while alarms are waiting)
+    if (cloudReady && pendingAlarmCount == 0 && firebaseManager.canSubmit() &&
+        !firebaseManager.isDrainPending() &&
+        millis() - lastDrainTime >= batching.getDrainMs() &&
+        (!sensorLog.isEmpty() || !eventLog.isEmpty())) {
+      lastDrainTime = millis();
+      drainOfflineLogs();
+    }
+
+    // Periodic device metrics (serial and /metrics/<device>)
+    if (millis() - lastMetricsTime >= METRICS_INTERVAL_MS) {
+      lastMetricsTime = millis();
+      MetricsSnapshot snapshot;
+      metrics.collect(snapshot);
+      snapshot.droppedPackets = droppedPacketCount;
+      Metrics::print(snapshot);
+      if (cloudReady) {
+        firebaseManager.uploadMetrics(snapshot, metrics.getDeviceId());
       }
     }
 
+    unsigned long iterationTime = millis() - iterationStart;
+    if (iterationTime > LOOP_BUDGET_MS) {
+      Serial.printf("Cloud loop iteration took %lu ms\n", iterationTime);
+    }
+
     // Small delay to prevent tight loop
-    vTaskDelay(pdMS_TO_TICKS(50));
+    vTaskDelay(pdMS_TO_TICKS(10));
   }
 }
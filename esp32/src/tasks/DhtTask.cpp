@@ -0,0 +1,32 @@
+#include "DhtReader.h"
+#include "Trace.h"
+#include <Arduino.h>
+
+// External references to global objects
+extern DhtReader dhtReader; // defined in SensorTask.cpp
+
+// Task function declaration
+void dhtTask(void *parameter);
+
+// DHT task: measures temperature/humidity in the background
+void dhtTask(void *parameter) {
+  Serial.println("DHT Task started on Core 0");
+
+  if (!dhtReader.begin()) {
+    Serial.println("DHT11 unavailable, temperature/humidity disabled.");
+    vTaskDelete(NULL);
+  }
+
+  TickType_t lastWakeTime = xTaskGetTickCount();
+  const TickType_t readInterval = pdMS_TO_TICKS(DHT_READ_INTERVAL_MS);
+
+  while (true) {
+    // Start signal and capture wait yield, decoding takes microseconds
+    {
+      TRACE_SCOPE(TRACE_DHT_ACQUIRE);
+      dhtReader.acquire();
+    }
+
+    vTaskDelayUntil(&lastWakeTime, readInterval);
+  }
+}
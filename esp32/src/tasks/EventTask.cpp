@@ -0,0 +1,111 @@
+#include "DigitalSensors.h"
+#include "SpscRing.h"
+#include "TimeSync.h"
+#include <Arduino.h>
+#include <DataTypes.h>
+#include <esp_timer.h>
+
+// External references to global objects
+extern SpscRing eventRing;
+extern TaskHandle_t cloudTaskHandle;
+extern DigitalSensors digitalSensors; // defined in SensorTask.cpp
+extern TimeSync timeSync;
+
+// Debounce tracking (per event type)
+#define EVENT_DEBOUNCE_MS 3000
+
+// Debounce state of one event type
+struct DebounceState {
+  int64_t lastEventUs;   // edge time of the last event queued (0: none)
+  int64_t lastEdgeUs;    // time of the last edge seen
+  uint16_t pendingEdges; // edges not yet reported in an event
+};
+DebounceState motionDebounce = {0, 0, 0};
+DebounceState vibrationDebounce = {0, 0, 0};
+
+// Task function declaration
+void eventTask(void *parameter);
+
+// Queue an event carrying the edges counted since the previous one
+void queueEvent(EventType type, int64_t timestampUs, DebounceState &state) {
+  const char *eventTypeName = (type == MOTION) ? "Motion" : "Vibration";
+
+  // Timestamp comes from the ISR (same time base as millis())
+  EventData event(type, (unsigned long)(timestampUs / 1000),
+                  state.pendingEdges);
+  event.epochMs = timeSync.toEpochMs(event.timestamp);
+  state.pendingEdges = 0;
+
+  // Try to send to the event ring (non-blocking), waking CloudTask if it
+  // sleeps
+  if (!eventRing.push(&event)) {
+    Serial.printf("Event ring full! %s event dropped.\n", eventTypeName);
+    return;
+  }
+  if (eventRing.takeWaiter()) {
+    xTaskNotifyGive(cloudTaskHandle);
+  }
+  Serial.printf("%s event queued (%u edges).\n", eventTypeName,
+                event.edgeCount);
+}
+
+// Apply debouncing to one captured edge and queue an event if it passes
+void handleEdge(const EdgeRecord &edge) {
+  DebounceState &state =
+      (edge.type == MOTION) ? motionDebounce : vibrationDebounce;
+
+  // Every edge is counted, even those suppressed by the debounce window
+  if (state.pendingEdges < UINT16_MAX) {
+    state.pendingEdges++;
+  }
+  state.lastEdgeUs = edge.timestampUs;
+
+  if (state.lastEventUs != 0 &&
+      edge.timestampUs - state.lastEventUs <
+          (int64_t)EVENT_DEBOUNCE_MS * 1000) {
+    return;
+  }
+  state.lastEventUs = edge.timestampUs;
+  queueEvent(edge.type, edge.timestampUs, state);
+}
+
+// Edges suppressed by a debounce window are reported with the next event;
+// once the window has passed without one, they go out on their own,
+// stamped with the last of them. Returns how long to wait for the next
+// window to pass (portMAX_DELAY if no edges are held back).
+TickType_t flushSuppressedEdges(EventType type, DebounceState &state,
+                                int64_t nowUs) {
+  if (state.pendingEdges == 0) {
+    return portMAX_DELAY;
+  }
+  int64_t windowEndUs = state.lastEventUs + (int64_t)EVENT_DEBOUNCE_MS * 1000;
+  if (nowUs < windowEndUs) {
+    return pdMS_TO_TICKS((windowEndUs - nowUs + 999) / 1000);
+  }
+  queueEvent(type, state.lastEdgeUs, state);
+  return portMAX_DELAY;
+}
+
+// Event task: turns ISR-captured edges into debounced events
+void eventTask(void *parameter) {
+  Serial.println("Event Task started on Core 1");
+
+  TickType_t wait = portMAX_DELAY;
+  while (true) {
+    // Sleep until an ISR records an edge, or a debounce window holding
+    // suppressed edges has passed
+    ulTaskNotifyTake(pdTRUE, wait);
+
+    EdgeRecord edge;
+    while (digitalSensors.popEdge(edge)) {
+      handleEdge(edge);
+    }
+
+    int64_t nowUs = esp_timer_get_time();
+    TickType_t motionWait =
+        flushSuppressedEdges(MOTION, motionDebounce, nowUs);
+    TickType_t vibrationWait =
+        flushSuppressedEdges(VIBRATION, vibrationDebounce, nowUs);
+    wait = motionWait < vibrationWait ? motionWait : vibrationWait;
+  }
+}
@@ -1,125 +1,251 @@
+#include "AlarmEvaluator.h"
 #include "AnalogSensors.h"
+#include "DhtReader.h"
 #include "DigitalSensors.h"
+#include "ReadingBuffer.h"
+#include "SamplingScheduler.h"
+#include "SpscRing.h"
+#include "TimeSync.h"
+#include "Trace.h"
+#include "WindowStats.h"
 #include <Arduino.h>
 #include <DataTypes.h>
 
 // External references to global objects (defined in main.cpp)
-extern QueueHandle_t sensorDataQueue;
-extern QueueHandle_t eventQueue;
+extern SpscRing sensorRing;
+extern QueueHandle_t alarmQueue;
 extern SemaphoreHandle_t i2cMutex;
-extern uint32_t droppedPacketCount;
+extern TaskHandle_t eventTaskHandle;
+extern TaskHandle_t cloudTaskHandle;
+extern TimeSync timeSync;
 
 // Sensor objects
 AnalogSensors analogSensors;
 DigitalSensors digitalSensors;
-
-// Debounce tracking
-#define EVENT_DEBOUNCE_MS 3000
-unsigned long lastMotionEventTime = 0;
-unsigned long lastVibrationEventTime = 0;
+DhtReader dhtReader; // measured in the background by the DHT task
+
+// Scheduler channel of the DHT11 cache (after the analog channels)
+#define SAMPLE_DHT ANALOG_CHANNEL_COUNT
+
+// Sampling policies: {min period, max period (ms), fast change per second,
+// noise deadband, alarm threshold, alarm below}. Periods are power-of-two
+// multiples of 250 ms so that channels fall due together. Gas and flame
+// drop to 4 Hz as soon as they move or cross their alarm level.
+const SamplingPolicy samplingPolicies[ANALOG_CHANNEL_COUNT + 1] = {
+    {1000, 16000, 200.0f, 32, SAMPLING_NO_THRESHOLD, false}, // light
+    {250, 2000, 20.0f, 16, 2000, false},                      // gas (high)
+    {250, 2000, 20.0f, 16, 1500, true},                       // flame (low)
+    {2000, 32000, 100.0f, 32, SAMPLING_NO_THRESHOLD, false}, // soil
+    {500, 4000, 300.0f, 64, SAMPLING_NO_THRESHOLD, false},   // sound
+    {2000, 2000, 0.0f, 0, SAMPLING_NO_THRESHOLD, false},     // DHT11 cache
+};
+
+// Per-channel sampling schedule
+SamplingScheduler samplingScheduler;
+
+// Alarm rules: {raise level, clear level, alarm below, rate toward the
+// alarm per second, rate window (ms), minimum hold (ms)}. Temperature
+// follows heat detector practice: 57°C fixed or 8°C/min rate of rise.
+const AlarmRule gasAlarmRule = {2000, 1800, false, 100.0f, 1000, 10000};
+const AlarmRule flameAlarmRule = {1500, 1700, true, 100.0f, 1000, 10000};
+const AlarmRule temperatureAlarmRule = {57.0f, 50.0f, false, 8.0f / 60,
+                                        60000, 30000};
+
+// Alarm state per channel (evaluated on every sample of the channel)
+AlarmEvaluator alarmEvaluator;
+
+// Readings waiting for room in the sensor ring while CloudTask is
+// stalled; merged rather than dropped when it fills (static, ~6.9 KB)
+ReadingBuffer backlog(SUMMARY_WINDOW_MS);
 
 // Task function declaration
 void sensorTask(void *parameter);
 
-// Handle event notifications from ISRs with debouncing
-void handleEventNotifications(uint32_t notificationValue) {
-  unsigned long now = millis();
-
-  // Check for motion event
-  if (notificationValue & MOTION_EVENT_BIT) {
-    // Apply debouncing
-    if (now - lastMotionEventTime >= EVENT_DEBOUNCE_MS) {
-      lastMotionEventTime = now;
-
-      // Create event data
-      EventData event(MOTION, now);
+// Wake CloudTask if it went to sleep on an empty ring
+void notifyCloudTask() {
+  if (sensorRing.takeWaiter()) {
+    xTaskNotifyGive(cloudTaskHandle);
+  }
+}
 
-      // Try to send to event queue (non-blocking)
-      if (xQueueSend(eventQueue, &event, 0) != pdTRUE) {
-        Serial.println("Event queue full! Motion event dropped.");
-      } else {
-        Serial.println("Motion event queued.");
-      }
-    }
+// Move backlog records to the sensor ring while it has room
+void drainBacklog() {
+  if (backlog.isEmpty()) {
+    return;
+  }
+  while (!backlog.isEmpty() && sensorRing.push(&backlog.front())) {
+    backlog.pop();
   }
+  notifyCloudTask();
+  if (backlog.isEmpty()) {
+    Serial.printf("Sensor backlog sent (%u merges so far).\n",
+                  backlog.getMergeCount());
+  } else {
+    Serial.printf("Sensor backlog: %u readings in %u records.\n",
+                  backlog.getReadingCount(), backlog.count());
+  }
+}
 
-  // Check for vibration event
-  if (notificationValue & VIBRATION_EVENT_BIT) {
-    // Apply debouncing
-    if (now - lastVibrationEventTime >= EVENT_DEBOUNCE_MS) {
-      lastVibrationEventTime = now;
+// Read one analog channel (mean/peak-to-peak since its previous read)
+int readAnalog(uint8_t channel) {
+  switch (channel) {
+  case ANALOG_LIGHT:
+    return analogSensors.readLight();
+  case ANALOG_GAS:
+    return analogSensors.readGas();
+  case ANALOG_FLAME:
+    return analogSensors.readFlame();
+  case ANALOG_SOIL_MOISTURE:
+    return analogSensors.readSoilMoisture();
+  default: {
+    TRACE_SCOPE(TRACE_SOUND_READ);
+    return analogSensors.readSoundValue();
+  }
+  }
+}
 
-      // Create event data
-      EventData event(VIBRATION, now);
+// Evaluate the alarm rule of a channel and send state changes ahead of
+// the batched readings
+void checkAlarm(uint8_t channel, float value, uint32_t now) {
+  AlarmTransition transition = alarmEvaluator.evaluate(channel, value, now);
+  if (transition == ALARM_NONE) {
+    return;
+  }
 
-      // Try to send to event queue (non-blocking)
-      if (xQueueSend(eventQueue, &event, 0) != pdTRUE) {
-        Serial.println("Event queue full! Vibration event dropped.");
-      } else {
-        Serial.println("Vibration event queued.");
-      }
-    }
+  AlarmData alarm;
+  alarm.channel = channel;
+  alarm.cause = alarmEvaluator.getCause(channel);
+  alarm.active = (transition == ALARM_RAISED);
+  alarm.value = value;
+  alarm.rate = alarmEvaluator.getRate(channel);
+  alarm.timestamp = now;
+  alarm.epochMs = timeSync.toEpochMs(now);
+
+  if (xQueueSend(alarmQueue, &alarm, 0) != pdTRUE) {
+    Serial.println("Alarm queue full! Alarm dropped.");
+    return;
   }
+  Serial.printf("ALARM %s on channel %d (value %.1f, rate %.2f/s)\n",
+                alarm.active ? "raised" : "cleared", channel, value,
+                alarm.rate);
 }
 
-// Sensor task: Reads all sensors and pushes to queue
+// Sensor task: Samples each sensor on its own schedule and pushes
+// readings to the queue
 void sensorTask(void *parameter) {
   Serial.println("Sensor Task started on Core 1");
 
-  // Initialize sensors
-  analogSensors.begin();
+  // Initialize sensors (analog sampling is started by the ADC task)
   digitalSensors.begin();
 
-  // Setup interrupts (this task's handle is already available)
-  digitalSensors.setupInterrupts(xTaskGetCurrentTaskHandle());
+  // Setup interrupts (edges are consumed by the event task)
+  digitalSensors.setupInterrupts(eventTaskHandle);
+
+  for (uint8_t c = 0; c <= SAMPLE_DHT; c++) {
+    samplingScheduler.configure(c, samplingPolicies[c]);
+  }
+  samplingScheduler.start(millis());
 
-  TickType_t lastWakeTime = xTaskGetTickCount();
-  const TickType_t readInterval = pdMS_TO_TICKS(1000); // 1 second
+  alarmEvaluator.configure(ANALOG_GAS, gasAlarmRule);
+  alarmEvaluator.configure(ANALOG_FLAME, flameAlarmRule);
+  alarmEvaluator.configure(ALARM_TEMPERATURE, temperatureAlarmRule);
+
+  // Last value of every analog channel, repeated while it is not due
+  uint16_t analogValues[ANALOG_CHANNEL_COUNT] = {0};
 
   while (true) {
-    // Read all analog sensors
+    // Sleep until the next channel is due
+    uint32_t wait = samplingScheduler.msUntilNext(millis());
+    if (wait > 0) {
+      vTaskDelay(pdMS_TO_TICKS(wait));
+      continue;
+    }
+
+    uint32_t now = millis();
+    uint8_t due = samplingScheduler.due(now);
+
+    // Read the due analog channels (DMA windows keep averaging the others)
     SensorData data;
-    data.lightValue = analogSensors.readLight();
-    data.gasValue = analogSensors.readGas();
-    data.flameValue = analogSensors.readFlame();
-    data.soilMoistureValue = analogSensors.readSoilMoisture();
-    data.soundValue = analogSensors.readSoundValue();
-
-    // Read DHT11 sensor (single-wire protocol, no mutex needed)
-    data.temperature = digitalSensors.readTemperature();
-    data.humidity = digitalSensors.readHumidity();
-
-    // Validate readings
-    data.temperatureValid = digitalSensors.isValidReading(data.temperature);
-    data.humidityValid = digitalSensors.isValidReading(data.humidity);
-
-    data.timestamp = millis();
-
-    // Try to send to queue (non-blocking, implement queue full detection)
-    if (xQueueSend(sensorDataQueue, &data, 0) != pdTRUE) {
-      // Queue is full, drop data and increment counter
-      droppedPacketCount++;
-      Serial.printf(
-          "Sensor data queue full! Packet dropped. Total dropped: %u\n",
-          droppedPacketCount);
-    } else {
+    for (uint8_t c = 0; c < ANALOG_CHANNEL_COUNT; c++) {
+      if (due & (1 << c)) {
+        analogValues[c] = readAnalog(c);
+        samplingScheduler.update(c, analogValues[c], now);
+        checkAlarm(c, analogValues[c], now);
+      }
+    }
+    data.analogSampled = due & ((1 << ANALOG_CHANNEL_COUNT) - 1);
+    data.lightValue = analogValues[ANALOG_LIGHT];
+    data.gasValue = analogValues[ANALOG_GAS];
+    data.flameValue = analogValues[ANALOG_FLAME];
+    data.soilMoistureValue = analogValues[ANALOG_SOIL_MOISTURE];
+    data.soundValue = analogValues[ANALOG_SOUND];
+    if (data.isSampled(ANALOG_SOUND)) {
+      analogSensors.readSoundFeatures(data);
+    }
+
+    // Latest DHT11 measurement (cached, invalid once stale)
+    if (due & (1 << SAMPLE_DHT)) {
+      float temperature, humidity;
+      uint32_t temperatureAge, humidityAge;
+      bool temperatureValid, humidityValid;
+      {
+        TRACE_SCOPE(TRACE_DHT_READ);
+        temperatureValid =
+            dhtReader.getTemperature(temperature, temperatureAge);
+        humidityValid = dhtReader.getHumidity(humidity, humidityAge);
+      }
+      if (temperatureValid) {
+        data.setTemperature(temperature);
+        data.temperatureValid = 1;
+        checkAlarm(ALARM_TEMPERATURE, temperature, now);
+      }
+      if (humidityValid) {
+        data.setHumidity(humidity);
+        data.humidityValid = 1;
+      }
+      samplingScheduler.update(SAMPLE_DHT, 0, now);
+    }
+
+    data.timestamp = now;
+
+    // Queue the reading (non-blocking), built in place in the ring. While
+    // the ring is full, readings wait in the backlog, in order, and go out
+    // as soon as there is room.
+    bool queued = false;
+    {
+      TRACE_SCOPE(TRACE_SENSOR_ENQUEUE);
+      uint32_t room;
+      SensorRecord *slot =
+          backlog.isEmpty() ? (SensorRecord *)sensorRing.reserve(room) : NULL;
+      if (slot != NULL) {
+        makeRecord(data, *slot);
+        sensorRing.commit(1);
+        notifyCloudTask();
+        queued = true;
+      }
+    }
+    if (!queued) {
+      if (backlog.isEmpty()) {
+        Serial.println("Sensor ring full, buffering readings.");
+        backlog.setClock(timeSync.toEpochMs(now), now);
+      }
+      SensorRecord record;
+      makeRecord(data, record);
+      backlog.push(record);
+    }
+    drainBacklog();
+
+    if (queued) {
       Serial.printf(
-          "Sensor data queued: Light=%d, Gas=%d, Flame=%d, Soil=%d, Sound=%d\n",
+          "Sensor data queued: Light=%d, Gas=%d, Flame=%d, Soil=%d, Sound=%d "
+          "(sampled 0x%02x)\n",
           data.lightValue, data.gasValue, data.flameValue,
-          data.soilMoistureValue, data.soundValue);
+          data.soilMoistureValue, data.soundValue,
+          (unsigned)data.analogSampled);
       if (data.temperatureValid && data.humidityValid) {
         Serial.printf("Temperature: %.1f°C, Humidity: %.1f%%\n",
-                      data.temperature, data.humidity);
+                      data.getTemperature(), data.getHumidity());
       }
     }
-
-    // Check for event notifications from ISRs (non-blocking)
-    uint32_t notificationValue = 0;
-    if (xTaskNotifyWait(0, 0xFFFFFFFF, &notificationValue, 0) == pdTRUE) {
-      handleEventNotifications(notificationValue);
-    }
-
-    // Wait for next read interval (precise timing)
-    vTaskDelayUntil(&lastWakeTime, readInterval);
   }
 }
@@ -1,5 +1,6 @@
 #include "DisplayManager.h"
 #include "FirebaseManager.h"
+#include "Trace.h"
 #include "WiFiManager.h"
 #include <Arduino.h>
 
@@ -22,14 +23,23 @@ void uiTask(void *parameter) {
   const TickType_t updateInterval = pdMS_TO_TICKS(500); // 500ms
 
   while (true) {
-    // Get current status information
-    String ssid = wifiManager.isConnected() ? wifiManager.getSSID() : "";
-    String ip = wifiManager.isConnected() ? wifiManager.getIP() : "";
+    // Get current status information into fixed buffers (no String
+    // temporaries). While reconnecting, show the connection state in place
+    // of the SSID
+    char ip[16] = "";
+    const char *ssid = wifiManager.getStateName();
+    if (wifiManager.isConnected()) {
+      ssid = wifiManager.getSSIDName();
+      wifiManager.formatIP(ip, sizeof(ip));
+    }
     bool firebaseReady = firebaseManager.isReady();
 
     // Update display (mutex is handled inside DisplayManager)
-    displayManager.updateStatus(ssid, ip, firebaseReady, lastSuccessfulSync,
-                                droppedPacketCount);
+    {
+      TRACE_SCOPE(TRACE_LCD_UPDATE);
+      displayManager.updateStatus(ssid, ip, firebaseReady,
+                                  lastSuccessfulSync, droppedPacketCount);
+    }
 
     // Wait for next update interval (precise timing)
     vTaskDelayUntil(&lastWakeTime, updateInterval);
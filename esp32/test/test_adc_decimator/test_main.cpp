@@ -0,0 +1,161 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "AdcDecimator.h"
+
+// Scan order of the DMA pattern table: GPIO 36/39/34/35/32
+static const uint8_t SCAN[] = {0, 3, 6, 7, 4};
+static const int SCAN_COUNT = sizeof(SCAN) / sizeof(SCAN[0]);
+
+// Two scan rounds as captured from the DMA buffer ("type 1" words,
+// little-endian: channel in bits 12-15, sample in bits 0-11)
+static const uint8_t CAPTURE[] = {
+    0x10, 0x08, // ch 0: 2064
+    0x20, 0x34, // ch 3: 1056
+    0xFF, 0x6F, // ch 6: 4095
+    0x00, 0x70, // ch 7: 0
+    0x00, 0x48, // ch 4: 2048
+    0x12, 0x08, // ch 0: 2066
+    0x1E, 0x34, // ch 3: 1054
+    0xFE, 0x6F, // ch 6: 4094
+    0x03, 0x70, // ch 7: 3
+    0x80, 0x47, // ch 4: 1920
+};
+
+static AdcDecimator decimator;
+
+// Append one type 1 word to a stream
+static void putWord(uint8_t *stream, size_t &length, uint8_t channel,
+                    uint16_t value) {
+  uint16_t word = (channel << 12) | (value & 0x0FFF);
+  stream[length++] = word & 0xFF;
+  stream[length++] = word >> 8;
+}
+
+void setUp() { decimator = AdcDecimator(); }
+
+void tearDown() {}
+
+void test_capture_demultiplexed() {
+  decimator.process(CAPTURE, sizeof(CAPTURE));
+
+  AdcWindow window;
+  TEST_ASSERT_TRUE(decimator.takeWindow(0, window));
+  TEST_ASSERT_EQUAL(2065, window.mean);
+  TEST_ASSERT_EQUAL(2064, window.min);
+  TEST_ASSERT_EQUAL(2066, window.max);
+  TEST_ASSERT_EQUAL(2, window.count);
+
+  TEST_ASSERT_TRUE(decimator.takeWindow(3, window));
+  TEST_ASSERT_EQUAL(1055, window.mean);
+
+  TEST_ASSERT_TRUE(decimator.takeWindow(6, window));
+  TEST_ASSERT_EQUAL(4095, window.max);
+  TEST_ASSERT_EQUAL(4094, window.min);
+
+  TEST_ASSERT_TRUE(decimator.takeWindow(7, window));
+  TEST_ASSERT_EQUAL(0, window.min);
+  TEST_ASSERT_EQUAL(3, window.max);
+  TEST_ASSERT_EQUAL(2, window.mean); // 1.5 rounds up
+
+  TEST_ASSERT_TRUE(decimator.takeWindow(4, window));
+  TEST_ASSERT_EQUAL(1984, window.mean);
+
+  // Channels outside the scan saw nothing
+  TEST_ASSERT_FALSE(decimator.takeWindow(1, window));
+  TEST_ASSERT_FALSE(decimator.takeWindow(5, window));
+}
+
+void test_take_window_starts_new_one() {
+  decimator.addSample(0, 100);
+  decimator.addSample(0, 300);
+
+  AdcWindow window;
+  TEST_ASSERT_TRUE(decimator.takeWindow(0, window));
+  TEST_ASSERT_EQUAL(200, window.mean);
+  TEST_ASSERT_FALSE(decimator.takeWindow(0, window));
+
+  decimator.addSample(0, 50);
+  TEST_ASSERT_TRUE(decimator.takeWindow(0, window));
+  TEST_ASSERT_EQUAL(50, window.mean);
+  TEST_ASSERT_EQUAL(50, window.min);
+  TEST_ASSERT_EQUAL(50, window.max);
+  TEST_ASSERT_EQUAL(1, window.count);
+}
+
+void test_invalid_channels_ignored() {
+  // Words with channel 8-15 (not on ADC1) and a trailing half word
+  uint8_t stream[8];
+  size_t length = 0;
+  putWord(stream, length, 9, 1234);
+  putWord(stream, length, 15, 4000);
+  putWord(stream, length, 2, 777);
+  stream[length++] = 0x55;
+  decimator.process(stream, length);
+
+  AdcWindow window;
+  TEST_ASSERT_FALSE(decimator.takeWindow(9, window));
+  TEST_ASSERT_FALSE(decimator.takeWindow(15, window));
+  TEST_ASSERT_TRUE(decimator.takeWindow(2, window));
+  TEST_ASSERT_EQUAL(777, window.mean);
+  TEST_ASSERT_EQUAL(1, window.count);
+}
+
+void test_oversampling_recovers_level() {
+  // One second of round-robin scanning at 1 kHz per channel, fed in DMA
+  // frames of 256 bytes: each channel is a fixed level plus +-40 LSB of
+  // deterministic noise, which averages out
+  const uint16_t levels[SCAN_COUNT] = {1200, 3500, 20, 2700, 2048};
+  const int rounds = 1000;
+  uint8_t frame[256];
+  size_t length = 0;
+  uint32_t seed = 12345;
+  for (int r = 0; r < rounds; r++) {
+    for (int c = 0; c < SCAN_COUNT; c++) {
+      seed = seed * 1103515245 + 12345;
+      int noise = (int)((seed >> 16) % 81) - 40;
+      int value = levels[c] + noise;
+      if (value < 0) {
+        value = 0;
+      }
+      putWord(frame, length, SCAN[c], value);
+      if (length == sizeof(frame)) {
+        decimator.process(frame, length);
+        length = 0;
+      }
+    }
+  }
+  decimator.process(frame, length);
+
+  for (int c = 0; c < SCAN_COUNT; c++) {
+    AdcWindow window;
+    TEST_ASSERT_TRUE(decimator.takeWindow(SCAN[c], window));
+    TEST_ASSERT_EQUAL(rounds, window.count);
+    TEST_ASSERT_INT_WITHIN(4, levels[c], window.mean);
+    TEST_ASSERT_LESS_OR_EQUAL(levels[c] + 40, window.max);
+    TEST_ASSERT_GREATER_OR_EQUAL(levels[c] > 40 ? levels[c] - 40 : 0,
+                                 window.min);
+  }
+}
+
+void test_full_scale_window_does_not_overflow() {
+  // Five minutes of full-scale samples at 4 kHz (a 32-bit sum wraps
+  // after ~262 s)
+  for (uint32_t i = 0; i < 1200000; i++) {
+    decimator.addSample(4, 4095);
+  }
+  AdcWindow window;
+  TEST_ASSERT_TRUE(decimator.takeWindow(4, window));
+  TEST_ASSERT_EQUAL(4095, window.mean);
+  TEST_ASSERT_EQUAL(1200000, window.count);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_capture_demultiplexed);
+  RUN_TEST(test_take_window_starts_new_one);
+  RUN_TEST(test_invalid_channels_ignored);
+  RUN_TEST(test_oversampling_recovers_level);
+  RUN_TEST(test_full_scale_window_does_not_overflow);
+  return UNITY_END();
+}
@@ -0,0 +1,250 @@
+// AlarmEvaluator rules against synthetic fire traces (flaming fire,
+// smouldering fire, heat rise, nuisance noise), and the sample -> ack
+// latency of an alarm upload behind a full batch window.
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <math.h>
+#include <unity.h>
+
+#include "AlarmEvaluator.h"
+#include "FirebaseManager.h"
+
+#define CH_GAS 1
+#define CH_FLAME 2
+#define CH_TEMPERATURE 5
+
+// Same rules as SensorTask
+static const AlarmRule gasRule = {2000, 1800, false, 100.0f, 1000, 10000};
+static const AlarmRule flameRule = {1500, 1700, true, 100.0f, 1000, 10000};
+static const AlarmRule temperatureRule = {57.0f, 50.0f, false, 8.0f / 60,
+                                          60000, 30000};
+
+static AlarmEvaluator evaluator;
+
+// Outcome of feeding a trace to one channel
+struct TraceResult {
+  uint32_t raises;
+  uint32_t clears;
+  uint32_t firstRaiseMs; // UINT32_MAX if never raised
+  AlarmCause firstCause;
+};
+
+// Sample a trace every stepMs for durationMs
+static TraceResult runTrace(uint8_t channel, float (*trace)(uint32_t),
+                            uint32_t stepMs, uint32_t durationMs) {
+  TraceResult result = {0, 0, UINT32_MAX, ALARM_CAUSE_LEVEL};
+  for (uint32_t t = 0; t <= durationMs; t += stepMs) {
+    AlarmTransition transition = evaluator.evaluate(channel, trace(t), t);
+    if (transition == ALARM_RAISED) {
+      if (result.raises == 0) {
+        result.firstRaiseMs = t;
+        result.firstCause = evaluator.getCause(channel);
+      }
+      result.raises++;
+    } else if (transition == ALARM_CLEARED) {
+      result.clears++;
+    }
+  }
+  return result;
+}
+
+// Deterministic noise in [-1, 1]
+static float noise(uint32_t t) {
+  uint32_t hash = (t / 250 + 1) * 2654435761UL;
+  return (hash >> 16) / 32767.5f - 1.0f;
+}
+
+// Flame sensor: quiet, then a flame in view from 60 s (falls 350/s)
+static float flamingFire(uint32_t t) {
+  if (t < 60000) {
+    return 4000 + 20 * noise(t);
+  }
+  float value = 4000 - 0.35f * (t - 60000);
+  return value > 300 ? value : 300;
+}
+
+// Gas sensor: smoke builds up slowly from 60 s (10 counts/s)
+static float smoulderingFire(uint32_t t) {
+  float value = t < 60000 ? 400 : 400 + 0.01f * (t - 60000);
+  return value + 20 * noise(t);
+}
+
+// Temperature: 25 °C, rising 10 °C per minute from 5 min
+static float heatRise(uint32_t t) {
+  if (t < 300000) {
+    return 25.0f;
+  }
+  return 25.0f + (t - 300000) / 6000.0f;
+}
+
+// Gas sensor: an hour of baseline with noise and drift, no fire
+static float nuisance(uint32_t t) {
+  return 600 + 200 * sinf(t / 600000.0f) + 60 * noise(t);
+}
+
+// Gas sensor: hovers around the alarm level, then falls back
+static float hovering(uint32_t t) {
+  if (t < 60000) {
+    return 1980 + 40 * (t / 250 % 2);
+  }
+  return 1000;
+}
+
+// Gas sensor: one-second spike (a lighter held under the sensor)
+static float spike(uint32_t t) {
+  return t >= 10000 && t < 11000 ? 2600 : 450;
+}
+
+void setUp() {
+  evaluator = AlarmEvaluator();
+  evaluator.configure(CH_GAS, gasRule);
+  evaluator.configure(CH_FLAME, flameRule);
+  evaluator.configure(CH_TEMPERATURE, temperatureRule);
+}
+
+void tearDown() {}
+
+void test_unconfigured_channel_never_alarms() {
+  TEST_ASSERT_EQUAL(ALARM_NONE, evaluator.evaluate(0, 1e6f, 0));
+  TEST_ASSERT_EQUAL(ALARM_NONE,
+                    evaluator.evaluate(ALARM_MAX_CHANNELS, 1e6f, 0));
+  TEST_ASSERT_FALSE(evaluator.isActive(0));
+  TEST_ASSERT_EQUAL_UINT32(0, evaluator.getRaiseCount());
+}
+
+void test_level_raises_on_first_sample() {
+  TEST_ASSERT_EQUAL(ALARM_RAISED, evaluator.evaluate(CH_GAS, 2000, 0));
+  TEST_ASSERT_TRUE(evaluator.isActive(CH_GAS));
+  TEST_ASSERT_EQUAL(ALARM_CAUSE_LEVEL, evaluator.getCause(CH_GAS));
+  TEST_ASSERT_EQUAL(ALARM_NONE, evaluator.evaluate(CH_GAS, 2500, 250));
+  TEST_ASSERT_EQUAL_UINT32(1, evaluator.getRaiseCount());
+}
+
+void test_flaming_fire_raises_on_rate_first() {
+  TraceResult result = runTrace(CH_FLAME, flamingFire, 250, 120000);
+
+  // 350/s is past 100/s within the first full rate window, ~7 s before
+  // the flame reading reaches the level
+  TEST_ASSERT_EQUAL_UINT32(1, result.raises);
+  TEST_ASSERT_EQUAL(ALARM_CAUSE_RATE, result.firstCause);
+  TEST_ASSERT_GREATER_OR_EQUAL(60000, result.firstRaiseMs);
+  TEST_ASSERT_LESS_OR_EQUAL(62000, result.firstRaiseMs);
+  TEST_ASSERT_TRUE(evaluator.isActive(CH_FLAME));
+  TEST_ASSERT_EQUAL_UINT32(0, result.clears);
+}
+
+void test_smouldering_fire_raises_on_level() {
+  TraceResult result = runTrace(CH_GAS, smoulderingFire, 250, 300000);
+
+  // 10 counts/s never counts as a fast rise; 2000 is reached ~160 s
+  // into the build-up
+  TEST_ASSERT_EQUAL_UINT32(1, result.raises);
+  TEST_ASSERT_EQUAL(ALARM_CAUSE_LEVEL, result.firstCause);
+  TEST_ASSERT_UINT32_WITHIN(5000, 218000, result.firstRaiseMs);
+}
+
+void test_heat_rise_raises_before_fixed_level() {
+  TraceResult result = runTrace(CH_TEMPERATURE, heatRise, 2000, 900000);
+
+  // 10 °C/min is past 8 °C/min: raised within two rate windows of the
+  // rise, long before 57 °C (~8 min in)
+  TEST_ASSERT_EQUAL_UINT32(1, result.raises);
+  TEST_ASSERT_EQUAL(ALARM_CAUSE_RATE, result.firstCause);
+  TEST_ASSERT_LESS_OR_EQUAL(300000 + 120000, result.firstRaiseMs);
+  TEST_ASSERT_FLOAT_WITHIN(0.02f, 10.0f / 60,
+                           evaluator.getRate(CH_TEMPERATURE));
+}
+
+void test_nuisance_trace_never_alarms() {
+  TraceResult result = runTrace(CH_GAS, nuisance, 250, 3600000);
+  TEST_ASSERT_EQUAL_UINT32(0, result.raises);
+  TEST_ASSERT_FALSE(evaluator.isActive(CH_GAS));
+}
+
+void test_hysteresis_prevents_chatter() {
+  TraceResult result = runTrace(CH_GAS, hovering, 250, 120000);
+
+  // One raise while hovering around the level, one clear after the fall
+  TEST_ASSERT_EQUAL_UINT32(1, result.raises);
+  TEST_ASSERT_EQUAL_UINT32(1, result.clears);
+  TEST_ASSERT_FALSE(evaluator.isActive(CH_GAS));
+}
+
+void test_alarm_held_for_minimum_time() {
+  TraceResult result = runTrace(CH_GAS, spike, 250, 15000);
+  TEST_ASSERT_EQUAL_UINT32(1, result.raises);
+  TEST_ASSERT_EQUAL_UINT32(10000, result.firstRaiseMs);
+
+  // Back to normal after 1 s, but the alarm stays for holdMs
+  TEST_ASSERT_TRUE(evaluator.isActive(CH_GAS));
+  TEST_ASSERT_EQUAL(ALARM_NONE, evaluator.evaluate(CH_GAS, 450, 19750));
+  TEST_ASSERT_EQUAL(ALARM_CLEARED, evaluator.evaluate(CH_GAS, 450, 20000));
+}
+
+void test_clear_waits_for_rate_to_calm() {
+  // Falling flame readings raise on rate (300/s). Past the hold time and
+  // above the clear level, 70/s toward the alarm still keeps it raised
+  evaluator.evaluate(CH_FLAME, 4000, 0);
+  TEST_ASSERT_EQUAL(ALARM_RAISED, evaluator.evaluate(CH_FLAME, 3700, 1000));
+  TEST_ASSERT_EQUAL(ALARM_NONE, evaluator.evaluate(CH_FLAME, 3000, 11000));
+  TEST_ASSERT_TRUE(evaluator.isActive(CH_FLAME));
+  TEST_ASSERT_EQUAL(ALARM_CLEARED, evaluator.evaluate(CH_FLAME, 3000, 12000));
+}
+
+void test_alarm_latency_behind_full_window() {
+  shimSetSerialOutput(false);
+  shimSetMillis(60000);
+  standIn::reset(300);
+  FirebaseManager manager("alarm.firebaseio.test", "token");
+  manager.begin();
+  unsigned long lastSync = 0;
+
+  // Batches take every slot alarms may not use
+  EventData event(MOTION, 60000);
+  while (manager.canSubmit()) {
+    TEST_ASSERT_TRUE(manager.uploadBatch(NULL, &event, 1, lastSync));
+  }
+
+  // Flame trace through the evaluator into the priority path
+  for (uint32_t t = 60000; t <= 63000 && manager.getAlarmCount() == 0;
+       t += 250) {
+    shimSetMillis(t);
+    manager.loop();
+    if (evaluator.evaluate(CH_FLAME, flamingFire(t), t) == ALARM_RAISED) {
+      AlarmData alarm;
+      alarm.channel = CH_FLAME;
+      alarm.cause = evaluator.getCause(CH_FLAME);
+      alarm.active = true;
+      alarm.value = flamingFire(t);
+      alarm.timestamp = t;
+      TEST_ASSERT_TRUE(manager.uploadAlarms(&alarm, 1, lastSync));
+      for (int i = 0; i < 100 && manager.getAlarmCount() == 0; i++) {
+        shimAdvanceMillis(10);
+        manager.loop();
+      }
+    }
+  }
+
+  ::printf("alarm sample -> ack: %lu ms at 300 ms round trip\n",
+           manager.getLastAlarmLatency());
+  TEST_ASSERT_EQUAL_UINT32(1, manager.getAlarmCount());
+  TEST_ASSERT_GREATER_OR_EQUAL(300, manager.getLastAlarmLatency());
+  TEST_ASSERT_LESS_OR_EQUAL(320, manager.getLastAlarmLatency());
+  shimSetSerialOutput(true);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_unconfigured_channel_never_alarms);
+  RUN_TEST(test_level_raises_on_first_sample);
+  RUN_TEST(test_flaming_fire_raises_on_rate_first);
+  RUN_TEST(test_smouldering_fire_raises_on_level);
+  RUN_TEST(test_heat_rise_raises_before_fixed_level);
+  RUN_TEST(test_nuisance_trace_never_alarms);
+  RUN_TEST(test_hysteresis_prevents_chatter);
+  RUN_TEST(test_alarm_held_for_minimum_time);
+  RUN_TEST(test_clear_waits_for_rate_to_calm);
+  RUN_TEST(test_alarm_latency_behind_full_window);
+  return UNITY_END();
+}
@@ -0,0 +1,298 @@
+// BatchController decisions from round trip, failures and backlog, and
+// the event flush loop of CloudTask run against the Firebase stand-in at
+// different injected latencies
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <string>
+#include <unity.h>
+
+#include "BatchController.h"
+#include "FirebaseManager.h"
+
+// CloudTask's bounds
+static const BatchBounds bounds = {500, 10000, 1000, 30000};
+
+// Simulation step and event rate of the link runs
+#define STEP_MS 10
+#define EVENT_PERIOD_MS 500
+
+void setUp() {
+  shimSetSerialOutput(false);
+  shimSetMillis(5000);
+}
+
+void tearDown() { shimSetSerialOutput(true); }
+
+// Feed count round trips of rttMs and recompute
+static void feed(BatchController &controller, uint32_t rttMs, int count,
+                 uint8_t backlog = 0) {
+  for (int i = 0; i < count; i++) {
+    controller.addRoundTrip(rttMs);
+  }
+  controller.update(backlog);
+}
+
+void test_starts_at_lower_bounds() {
+  BatchController controller(bounds);
+  TEST_ASSERT_EQUAL_UINT32(500, controller.getFlushMs());
+  TEST_ASSERT_EQUAL_UINT32(1000, controller.getDrainMs());
+  controller.update(0);
+  TEST_ASSERT_EQUAL_UINT32(500, controller.getFlushMs());
+  TEST_ASSERT_EQUAL_UINT32(1000, controller.getDrainMs());
+}
+
+void test_round_trip_smoothing() {
+  // The first round trip is taken as is, later ones with weight 1/8
+  BatchController controller(bounds);
+  controller.addRoundTrip(1000);
+  TEST_ASSERT_EQUAL_UINT32(1000, controller.getSmoothedRtt());
+  controller.addRoundTrip(1800);
+  TEST_ASSERT_EQUAL_UINT32(1100, controller.getSmoothedRtt());
+
+  // One outlier moves it little, a lasting change all the way
+  feed(controller, 1100, 50);
+  controller.addRoundTrip(9100);
+  TEST_ASSERT_UINT32_WITHIN(10, 2100, controller.getSmoothedRtt());
+  feed(controller, 200, 100);
+  TEST_ASSERT_UINT32_WITHIN(10, 200, controller.getSmoothedRtt());
+}
+
+void test_fast_link_stays_at_lower_bounds() {
+  BatchController controller(bounds);
+  feed(controller, 50, 20);
+  TEST_ASSERT_EQUAL_UINT32(500, controller.getFlushMs());
+  TEST_ASSERT_EQUAL_UINT32(1000, controller.getDrainMs());
+  feed(controller, 400, 100);
+  TEST_ASSERT_EQUAL_UINT32(500, controller.getFlushMs());
+  TEST_ASSERT_EQUAL_UINT32(1000, controller.getDrainMs());
+}
+
+void test_slow_link_paces_by_round_trip() {
+  BatchController controller(bounds);
+  feed(controller, 3000, 20);
+  TEST_ASSERT_EQUAL_UINT32(3000, controller.getFlushMs());
+  TEST_ASSERT_EQUAL_UINT32(6000, controller.getDrainMs());
+
+  // Within the upper bounds however slow
+  feed(controller, 60000, 200);
+  TEST_ASSERT_EQUAL_UINT32(10000, controller.getFlushMs());
+  TEST_ASSERT_EQUAL_UINT32(30000, controller.getDrainMs());
+}
+
+void test_failures_stretch_up_to_four_times() {
+  BatchController controller(bounds);
+  feed(controller, 1000, 20);
+  TEST_ASSERT_EQUAL(0, controller.getFailurePercent());
+
+  // Half the requests failing: about 2.5x
+  for (int i = 0; i < 100; i++) {
+    controller.addFailure();
+    controller.addRoundTrip(1000);
+  }
+  controller.update(0);
+  TEST_ASSERT_UINT32_WITHIN(5, 50, controller.getFailurePercent());
+  TEST_ASSERT_UINT32_WITHIN(150, 2500, controller.getFlushMs());
+
+  // All failing: 4x, then back down once requests get through
+  for (int i = 0; i < 100; i++) {
+    controller.addFailure();
+  }
+  controller.update(0);
+  TEST_ASSERT_EQUAL(100, controller.getFailurePercent());
+  TEST_ASSERT_UINT32_WITHIN(40, 4000, controller.getFlushMs());
+  TEST_ASSERT_UINT32_WITHIN(80, 8000, controller.getDrainMs());
+  feed(controller, 1000, 100);
+  TEST_ASSERT_EQUAL(0, controller.getFailurePercent());
+  TEST_ASSERT_UINT32_WITHIN(10, 1000, controller.getFlushMs());
+}
+
+void test_backlog_batches_longer_and_drains_slower() {
+  BatchController controller(bounds);
+  feed(controller, 1000, 20, 50);
+  TEST_ASSERT_EQUAL(50, controller.getBacklogPercent());
+  TEST_ASSERT_EQUAL_UINT32(2000, controller.getFlushMs());
+  TEST_ASSERT_EQUAL_UINT32(6000, controller.getDrainMs());
+
+  // A full queue: 3x flush, 5x drain (over 100% counts as full)
+  controller.update(255);
+  TEST_ASSERT_EQUAL(100, controller.getBacklogPercent());
+  TEST_ASSERT_EQUAL_UINT32(3000, controller.getFlushMs());
+  TEST_ASSERT_EQUAL_UINT32(10000, controller.getDrainMs());
+
+  // Even a fast link slows the catch-up down while the queue is full
+  feed(controller, 50, 200, 100);
+  TEST_ASSERT_EQUAL_UINT32(500, controller.getFlushMs());
+  TEST_ASSERT_EQUAL_UINT32(1000, controller.getDrainMs());
+  feed(controller, 200, 200, 100);
+  TEST_ASSERT_UINT32_WITHIN(30, 600, controller.getFlushMs());
+  TEST_ASSERT_UINT32_WITHIN(100, 2000, controller.getDrainMs());
+}
+
+// Result of a simulated run of the event flush loop
+struct LinkRun {
+  uint32_t requests;
+  uint32_t events;
+  uint32_t flushMs;
+  uint32_t srtt;
+};
+
+// A manager and controller over a stand-in with the given round trip
+struct Link {
+  FirebaseManager manager;
+  BatchController batching;
+
+  // Events waiting for the next upload
+  EventData pending[MAX_EVENTS_PER_UPLOAD];
+  int pendingCount;
+  unsigned long lastSync;
+
+  Link(unsigned long rttMs)
+      : manager("test.firebaseio.test", "token"), batching(bounds),
+        pendingCount(0), lastSync(0) {
+    standIn::reset(rttMs);
+    manager.begin();
+    manager.setBatchController(&batching);
+  }
+};
+
+// Run CloudTask's event flush for durationMs: an event every
+// EVENT_PERIOD_MS, flushed once the oldest waited the flush time or a
+// batch is full, over the stand-in answering after its round trip
+static LinkRun runLink(Link &link, unsigned long durationMs) {
+  FirebaseManager &manager = link.manager;
+  BatchController &batching = link.batching;
+  EventData *pending = link.pending;
+  int &pendingCount = link.pendingCount;
+  uint32_t requests = manager.getRequestCount();
+  uint32_t events = manager.getEventCount();
+
+  for (unsigned long t = 0; t < durationMs; t += STEP_MS) {
+    shimAdvanceMillis(STEP_MS);
+    manager.loop();
+    batching.update(0);
+
+    if (t % EVENT_PERIOD_MS == 0 && pendingCount < MAX_EVENTS_PER_UPLOAD) {
+      pending[pendingCount++] = EventData(MOTION, millis());
+    }
+    bool due = pendingCount > 0 &&
+               (pendingCount >= MAX_EVENTS_PER_UPLOAD ||
+                millis() - pending[0].timestamp >= batching.getFlushMs());
+    if (due && manager.canSubmit() &&
+        manager.uploadBatch(NULL, pending, pendingCount, link.lastSync)) {
+      pendingCount = 0;
+    }
+  }
+
+  LinkRun run;
+  run.requests = manager.getRequestCount() - requests;
+  run.events = manager.getEventCount() - events;
+  run.flushMs = batching.getFlushMs();
+  run.srtt = batching.getSmoothedRtt();
+  return run;
+}
+
+// Events per request of a run
+static float eventsPerRequest(const LinkRun &run) {
+  return run.requests > 0 ? (float)run.events / run.requests : 0;
+}
+
+
+void test_stand_in_fast_link_keeps_latency_low() {
+  Link link(50);
+  LinkRun run = runLink(link, 120000);
+  TEST_ASSERT_UINT32_WITHIN(10, 50, run.srtt);
+  TEST_ASSERT_EQUAL_UINT32(500, run.flushMs);
+
+  // The oldest event goes after 500 ms, with the one just arrived
+  TEST_ASSERT_FLOAT_WITHIN(0.2f, 2.0f, eventsPerRequest(run));
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(600 + 50,
+                                   link.manager.getMaxEventLatency());
+}
+
+void test_stand_in_slow_link_grows_batches() {
+  Link fast(50);
+  LinkRun fastRun = runLink(fast, 120000);
+  Link slow(3000);
+  LinkRun slowRun = runLink(slow, 120000);
+  // A flush every round trip sometimes queues behind the request before
+  // it on the connection, which the measured round trip includes
+  TEST_ASSERT_UINT32_WITHIN(60, 3030, slowRun.srtt);
+  TEST_ASSERT_UINT32_WITHIN(60, 3030, slowRun.flushMs);
+
+  // Over three times the events per request, under a third of the
+  // requests
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 6.5f, eventsPerRequest(slowRun));
+  TEST_ASSERT_LESS_THAN(fastRun.requests / 3, slowRun.requests);
+  TEST_ASSERT_UINT32_WITHIN(20, fastRun.events, slowRun.events);
+
+  // Until the first round trip is measured, flushes every 500 ms queue a
+  // window of requests on the connection, answered one round trip apart
+  int window = UPLOAD_WINDOW_SIZE - ALARM_RESERVED_SLOTS;
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(500 + window * 3000 + 100,
+                                   slow.manager.getMaxEventLatency());
+}
+
+void test_stand_in_follows_latency_changes() {
+  // The link slows down and recovers: the flush time follows both ways
+  Link link(100);
+  LinkRun run = runLink(link, 30000);
+  TEST_ASSERT_EQUAL_UINT32(500, run.flushMs);
+
+  standIn::setRoundTrip(2000);
+  run = runLink(link, 120000);
+  TEST_ASSERT_UINT32_WITHIN(100, 2000, run.flushMs);
+  TEST_ASSERT_GREATER_THAN(3.0f, eventsPerRequest(run));
+
+  standIn::setRoundTrip(100);
+  run = runLink(link, 60000);
+  TEST_ASSERT_EQUAL_UINT32(500, run.flushMs);
+  TEST_ASSERT_FLOAT_WITHIN(0.3f, 2.0f, eventsPerRequest(run));
+}
+
+void test_stand_in_failures_stretch_flush() {
+  // Half the requests fail (kept below the breaker with single failures)
+  Link link(1000);
+  runLink(link, 30000);
+  uint32_t steadyFlush = link.batching.getFlushMs();
+  for (int i = 0; i < 20; i++) {
+    standIn::failNext(503, 1);
+    runLink(link, 4000);
+  }
+  TEST_ASSERT_GREATER_THAN(0, link.batching.getFailurePercent());
+  TEST_ASSERT_GREATER_THAN(steadyFlush, link.batching.getFlushMs());
+  TEST_ASSERT_FALSE(link.manager.isCircuitOpen());
+}
+
+void test_decision_in_metrics() {
+  Link link(3000);
+  runLink(link, 60000);
+  link.batching.update(40);
+
+  MetricsSnapshot snapshot = {};
+  TEST_ASSERT_TRUE(link.manager.uploadMetrics(snapshot, "device"));
+  std::string body = standIn::requests().back().body;
+  char expected[128];
+  snprintf(expected, sizeof(expected),
+           "\"batching\":{\"srtt\":%u,\"failurePct\":0,\"backlogPct\":40,"
+           "\"flushMs\":%u,\"drainMs\":%u}",
+           link.batching.getSmoothedRtt(), link.batching.getFlushMs(),
+           link.batching.getDrainMs());
+  TEST_ASSERT_TRUE(body.find(expected) != std::string::npos);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_starts_at_lower_bounds);
+  RUN_TEST(test_round_trip_smoothing);
+  RUN_TEST(test_fast_link_stays_at_lower_bounds);
+  RUN_TEST(test_slow_link_paces_by_round_trip);
+  RUN_TEST(test_failures_stretch_up_to_four_times);
+  RUN_TEST(test_backlog_batches_longer_and_drains_slower);
+  RUN_TEST(test_stand_in_fast_link_keeps_latency_low);
+  RUN_TEST(test_stand_in_slow_link_grows_batches);
+  RUN_TEST(test_stand_in_follows_latency_changes);
+  RUN_TEST(test_stand_in_failures_stretch_flush);
+  RUN_TEST(test_decision_in_metrics);
+  return UNITY_END();
+}
@@ -0,0 +1,242 @@
+// Pipeline benchmark: the firmware itself (setup() and the tasks in src/)
+// on the shim's virtual-time scheduler, from scripted ADC, DHT11 and
+// PIR/vibration inputs through SensorTask, EventTask and CloudTask into
+// the Firebase stand-in. Reports firmware time simulated per second of
+// host CPU, bytes per upload and the p99 latency from capture to
+// acknowledgement, on a clean and then on a lossy link, and the trace
+// points hit on the way (native-bench builds them in).
+// Run with: pio test -e native-bench -f test_bench_pipeline
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <WiFi.h>
+#include <chrono>
+#include <driver/adc.h>
+#include <driver/rmt.h>
+#include <esp_sntp.h>
+#include <unity.h>
+
+#include "DigitalSensors.h"
+#include "FirebaseManager.h"
+#include "LatencyHistogram.h"
+#include "Trace.h"
+#include "secrets.h"
+
+// Simulated time and load
+#define BENCH_STEP_MS 1000
+#define BENCH_PHASE_MS 3600000UL // one hour per link condition
+#define BENCH_SETTLE_MS 600000UL // longest wait for the last uploads
+#define BENCH_MOTION_EVERY 37    // steps between PIR edges
+#define BENCH_VIBRATION_EVERY 53 // steps between vibration edges
+#define BENCH_ROUND_TRIP_MS 350
+
+// Wall clock reported by SNTP at millis() = 0
+#define BENCH_EPOCH_MS 1700000000000ULL
+
+// Firmware (src/main.cpp)
+extern void setup();
+extern FirebaseManager firebaseManager;
+extern uint32_t droppedPacketCount;
+
+// Outcome of one phase
+struct BenchResult {
+  uint32_t uploads;
+  uint32_t records;
+  double seconds;
+  double bytesPerUpload;
+  uint32_t readingP99;
+  uint32_t eventP99;
+  uint32_t edges;
+  uint32_t events;
+  uint32_t retries;
+  uint32_t abandoned;
+};
+
+// Slowly drifting channels, all clear of their alarm levels
+static uint16_t benchAdc(adc1_channel_t channel, uint64_t timeUs) {
+  uint32_t seconds = (uint32_t)(timeUs / 1000000);
+  switch (channel) {
+  case ADC1_CHANNEL_0: // light
+    return 2000 + (seconds * 7) % 400;
+  case ADC1_CHANNEL_3: // gas
+    return 900 + (seconds * 13) % 90;
+  case ADC1_CHANNEL_6: // flame
+    return 4000 - seconds % 50;
+  case ADC1_CHANNEL_7: // soil moisture
+    return 1500 + (seconds / 600) % 100;
+  default: // sound: a 250 Hz tone around mid-scale
+    return 2048 + ((timeUs / 2000) % 2 ? 300 : -300);
+  }
+}
+
+// Boot the firmware once for both phases
+static void startFirmware() {
+  shimSetSerialOutput(false);
+  randomSeed(42);
+  standIn::reset(BENCH_ROUND_TRIP_MS);
+  shimAdcSetSource(benchAdc);
+  shimDhtSetReading(21.5f, 48.0f);
+  shimWiFiSetInRange(PRIMARY_WIFI_SSID, true);
+  shimStartScheduling();
+  setup();
+
+  // SNTP answers once CloudTask has started it
+  shimAdvanceMillis(BENCH_STEP_MS);
+  shimSntpSync(BENCH_EPOCH_MS + millis());
+}
+
+// Capture time (millis()) of the oldest reading and oldest event of an
+// upload, from the record timestamps in its body (0: none)
+static void oldestCaptures(const std::string &body, unsigned long &reading,
+                           unsigned long &event) {
+  reading = 0;
+  event = 0;
+  const char *cursor = body.c_str();
+  while ((cursor = strstr(cursor, "\"/sensors/")) != NULL) {
+    cursor += strlen("\"/sensors/");
+    bool isEvent = strncmp(cursor, "motion/", 7) == 0 ||
+                   strncmp(cursor, "vibration/", 10) == 0;
+    const char *stamp = strstr(cursor, "\"timestamp\":");
+    if (stamp == NULL) {
+      break;
+    }
+    uint64_t epochMs = strtoull(stamp + strlen("\"timestamp\":"), NULL, 10);
+    if (epochMs == 0) {
+      continue; // server time, capture time unknown
+    }
+    unsigned long capturedAt = (unsigned long)(epochMs - BENCH_EPOCH_MS);
+    unsigned long &oldest = isEvent ? event : reading;
+    if (oldest == 0 || capturedAt < oldest) {
+      oldest = capturedAt;
+    }
+  }
+}
+
+// Run the firmware for one phase with failPercent of the requests
+// answered with HTTP 503, then on a clean link until its uploads are done
+static BenchResult runPhase(int failPercent) {
+  size_t firstRequest = standIn::requests().size();
+  uint32_t retries = firebaseManager.getRetryCount();
+  uint32_t abandoned = firebaseManager.getAbandonedCount();
+  uint32_t events = firebaseManager.getEventCount();
+#if TRACE_ENABLED
+  uint32_t records = traceHistogram(TRACE_QUEUE_RESIDENCY).getCount();
+#endif
+
+  auto start = std::chrono::steady_clock::now();
+  standIn::failRandomly(503, failPercent);
+  uint32_t edges = 0;
+  unsigned long end = millis() + BENCH_PHASE_MS;
+  for (uint32_t step = 1; millis() < end; step++) {
+    if (step % BENCH_MOTION_EVERY == 0) {
+      shimSetPin(PIR_SENSOR_PIN, HIGH);
+      edges++;
+    }
+    if (step % BENCH_VIBRATION_EVERY == 0) {
+      shimSetPin(VIBRATION_SENSOR_PIN, HIGH);
+      edges++;
+    }
+    shimAdvanceMillis(BENCH_STEP_MS);
+    shimSetPin(PIR_SENSOR_PIN, LOW);
+    shimSetPin(VIBRATION_SENSOR_PIN, LOW);
+  }
+  standIn::failRandomly(503, 0);
+  end = millis() + BENCH_SETTLE_MS;
+  while (millis() < end &&
+         (firebaseManager.getEventCount() - events < edges ||
+          firebaseManager.getPendingUploads() > 0)) {
+    shimAdvanceMillis(BENCH_STEP_MS);
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  // Acknowledged uploads of this phase
+  LatencyHistogram readingLatency;
+  LatencyHistogram eventLatency;
+  size_t bytes = 0;
+  uint32_t uploads = 0;
+  const std::vector<StandInRequest> &requests = standIn::requests();
+  for (size_t i = firstRequest; i < requests.size(); i++) {
+    const StandInRequest &request = requests[i];
+    TEST_ASSERT_TRUE(request.validJson);
+    if (request.answeredAt == 0 || request.errorCode != 0) {
+      continue;
+    }
+    uploads++;
+    bytes += request.body.size();
+    unsigned long reading, event;
+    oldestCaptures(request.body, reading, event);
+    if (reading != 0) {
+      readingLatency.add(request.answeredAt - reading);
+    }
+    if (event != 0) {
+      eventLatency.add(request.answeredAt - event);
+    }
+  }
+
+  BenchResult result;
+  result.uploads = uploads;
+#if TRACE_ENABLED
+  result.records = traceHistogram(TRACE_QUEUE_RESIDENCY).getCount() - records;
+#else
+  result.records = 0;
+#endif
+  result.seconds = seconds;
+  result.bytesPerUpload = uploads > 0 ? (double)bytes / uploads : 0;
+  result.readingP99 = readingLatency.getPercentile(0.99f);
+  result.eventP99 = eventLatency.getPercentile(0.99f);
+  result.edges = edges;
+  result.events = firebaseManager.getEventCount() - events;
+  result.retries = firebaseManager.getRetryCount() - retries;
+  result.abandoned = firebaseManager.getAbandonedCount() - abandoned;
+  return result;
+}
+
+static void report(const char *name, const BenchResult &result) {
+  ::printf("%s: %.0f s of firmware time per host second, %u sensor "
+           "records, %u uploads, %.0f bytes/upload, p99 reading->ack <= "
+           "%u ms, p99 event->ack <= %u ms, %u/%u events, %u retries, "
+           "%u abandoned\n",
+           name, BENCH_PHASE_MS / 1000.0 / result.seconds, result.records,
+           result.uploads, result.bytesPerUpload, result.readingP99,
+           result.eventP99, result.events, result.edges, result.retries,
+           result.abandoned);
+}
+
+void setUp() { shimSetSerialOutput(false); }
+
+void tearDown() { shimSetSerialOutput(true); }
+
+void test_pipeline_clean_link() {
+  traceReset();
+  BenchResult result = runPhase(0);
+  report("clean link", result);
+  tracePrint();
+  TEST_ASSERT_EQUAL_UINT32(0, result.abandoned);
+  TEST_ASSERT_EQUAL_UINT32(0, result.retries);
+  TEST_ASSERT_EQUAL_UINT32(result.edges, result.events);
+  TEST_ASSERT_EQUAL_UINT32(0, droppedPacketCount);
+  TEST_ASSERT_EQUAL_UINT32(0, shimAdcLostSamples());
+
+  // A window is acknowledged one round trip after it closes
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(
+      2 * (SUMMARY_WINDOW_MS + BENCH_ROUND_TRIP_MS), result.readingP99);
+}
+
+void test_pipeline_lossy_link() {
+  BenchResult result = runPhase(5);
+  report("5% failed requests", result);
+  TEST_ASSERT_EQUAL_UINT32(0, result.abandoned);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, result.retries);
+  TEST_ASSERT_EQUAL_UINT32(result.edges, result.events);
+  TEST_ASSERT_EQUAL_UINT32(0, droppedPacketCount);
+}
+
+int main(int argc, char **argv) {
+  startFirmware();
+  UNITY_BEGIN();
+  RUN_TEST(test_pipeline_clean_link);
+  RUN_TEST(test_pipeline_lossy_link);
+  return UNITY_END();
+}
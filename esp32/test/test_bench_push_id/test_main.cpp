@@ -0,0 +1,155 @@
+// Push ID benchmark: time and heap allocations per key of generatePushId()
+// and generatePushIds() against the String generator they replaced
+// (copied below, built on the native String shim). The shim's String is a
+// std::string, whose small-string buffer saves the first allocations the
+// Arduino String makes; its counts are a lower bound for the device.
+// Run with: pio test -e native-bench -f test_bench_push_id
+
+#include <Arduino.h>
+#include <chrono>
+#include <new>
+#include <unity.h>
+
+#include "PushId.h"
+
+#define BENCH_KEYS 800000
+#define KEYS_PER_MS 8 // keys generated within one millisecond
+
+// Global allocation counter (counts while counting is set)
+static bool counting = false;
+static uint32_t allocations = 0;
+
+void *operator new(size_t size) {
+  if (counting) {
+    allocations++;
+  }
+  void *block = malloc(size > 0 ? size : 1);
+  if (block == NULL) {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+void operator delete(void *block) noexcept { free(block); }
+
+void operator delete(void *block, size_t size) noexcept { free(block); }
+
+// The String generator before the fixed buffers, unchanged
+static const char PUSH_CHARS[] =
+    "-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz";
+static unsigned long lastPushTime = 0;
+static int lastRandChars[12];
+
+static String legacyGeneratePushId() {
+  unsigned long now = millis();
+  bool duplicateTime = (now == lastPushTime);
+  lastPushTime = now;
+
+  char timeStampChars[9];
+  for (int i = 7; i >= 0; i--) {
+    timeStampChars[i] = PUSH_CHARS[now % 64];
+    now = now / 64;
+  }
+  timeStampChars[8] = '\0';
+
+  String id = String(timeStampChars);
+
+  if (!duplicateTime) {
+    for (int i = 0; i < 12; i++) {
+      lastRandChars[i] = random(64);
+    }
+  } else {
+    // Increment the last random chars to ensure uniqueness
+    int i;
+    for (i = 11; i >= 0 && lastRandChars[i] == 63; i--) {
+      lastRandChars[i] = 0;
+    }
+    if (i >= 0) {
+      lastRandChars[i]++;
+    }
+  }
+
+  for (int i = 0; i < 12; i++) {
+    id += PUSH_CHARS[lastRandChars[i]];
+  }
+
+  return id;
+}
+
+// Time and allocations per key
+struct KeyCost {
+  double ns;
+  double allocations;
+};
+
+// Keeps results alive so the optimizer cannot drop the work
+static volatile char sink;
+
+static KeyCost measure(void (*generate)(int batch)) {
+  allocations = 0;
+  counting = true;
+  auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < BENCH_KEYS; k += KEYS_PER_MS) {
+    generate(KEYS_PER_MS);
+    shimAdvanceMillis(1);
+  }
+  double ns = std::chrono::duration<double, std::nano>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  counting = false;
+  KeyCost cost = {ns / BENCH_KEYS, (double)allocations / BENCH_KEYS};
+  return cost;
+}
+
+static void legacyKeys(int batch) {
+  for (int k = 0; k < batch; k++) {
+    String id = legacyGeneratePushId();
+    sink = id.c_str()[PUSH_ID_LENGTH - 1];
+  }
+}
+
+static void singleKeys(int batch) {
+  char id[PUSH_ID_LENGTH + 1];
+  for (int k = 0; k < batch; k++) {
+    generatePushId(id);
+    sink = id[PUSH_ID_LENGTH - 1];
+  }
+}
+
+static void bulkKeys(int batch) {
+  char ids[KEYS_PER_MS][PUSH_ID_LENGTH + 1];
+  generatePushIds(ids, batch);
+  sink = ids[batch - 1][PUSH_ID_LENGTH - 1];
+}
+
+void setUp() { shimSetMillis(1760000000UL); }
+
+void tearDown() {}
+
+void test_push_id_cost() {
+  // The copy still makes 20-character keys
+  String legacy = legacyGeneratePushId();
+  TEST_ASSERT_EQUAL(PUSH_ID_LENGTH, legacy.length());
+
+  KeyCost legacyCost = measure(legacyKeys);
+  KeyCost singleCost = measure(singleKeys);
+  KeyCost bulkCost = measure(bulkKeys);
+
+  ::printf("String generator:  %.1f ns/key, %.2f allocations/key\n",
+           legacyCost.ns, legacyCost.allocations);
+  ::printf("generatePushId:    %.1f ns/key, %.2f allocations/key\n",
+           singleCost.ns, singleCost.allocations);
+  ::printf("generatePushIds:   %.1f ns/key, %.2f allocations/key "
+           "(%d per call)\n",
+           bulkCost.ns, bulkCost.allocations, KEYS_PER_MS);
+
+  TEST_ASSERT_GREATER_OR_EQUAL(1.0, legacyCost.allocations);
+  TEST_ASSERT_TRUE(singleCost.allocations == 0);
+  TEST_ASSERT_TRUE(bulkCost.allocations == 0);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_push_id_cost);
+  return UNITY_END();
+}
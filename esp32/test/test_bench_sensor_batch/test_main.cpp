@@ -0,0 +1,198 @@
+// RAM and per-channel reduction cost of the reading types the firmware
+// queues and buffers: SensorData, the SensorRecords of the sensor ring and
+// the backlog, and the column-per-channel SensorBatch. Sizes are checked
+// for both layouts (unsigned long is 32 bits on the ESP32, 64 here); the
+// SensorData they replaced (5 ints, 2 floats, unsigned long, 2 bools) was
+// 36 bytes on the ESP32.
+// Run with: pio test -e native-bench -f test_bench_sensor_batch
+
+#include <Arduino.h>
+#include <chrono>
+#include <limits.h>
+#include <unity.h>
+
+#include "ReadingBuffer.h"
+#include "SensorBatch.h"
+#include "SpscRing.h"
+
+#define BENCH_PASSES 200000
+
+#if ULONG_MAX == 0xFFFFFFFFUL // ESP32
+#define SENSOR_DATA_BYTES 32
+#define SENSOR_RECORD_BYTES 108
+#else // 64-bit host
+#define SENSOR_DATA_BYTES 40
+#define SENSOR_RECORD_BYTES 120
+#endif
+
+static_assert(sizeof(SensorData) == SENSOR_DATA_BYTES,
+              "SensorData layout changed");
+static_assert(sizeof(SensorRecord) == SENSOR_RECORD_BYTES,
+              "SensorRecord layout changed");
+
+// Firmware (src/main.cpp, src/tasks/SensorTask.cpp)
+extern SpscRing sensorRing;
+extern ReadingBuffer backlog;
+
+// Per-channel reduction over a batch
+struct ChannelTotals {
+  int32_t min[COLUMN_COUNT];
+  int32_t max[COLUMN_COUNT];
+  int32_t sum[COLUMN_COUNT];
+};
+
+// The same readings as records (record channels are in column order)
+static SensorRecord records[SENSOR_BATCH_CAPACITY];
+static SensorBatch batch;
+
+// Keeps results alive so the optimizer cannot drop the work
+static volatile int32_t sink;
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Reduce the records, striding over whole records per value
+static void reduceRecords(ChannelTotals &totals) {
+  for (int c = 0; c < COLUMN_COUNT; c++) {
+    totals.min[c] = INT32_MAX;
+    totals.max[c] = INT32_MIN;
+    totals.sum[c] = 0;
+  }
+  for (int i = 0; i < SENSOR_BATCH_CAPACITY; i++) {
+    const SensorRecord &record = records[i];
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+      totals.min[c] =
+          record.min[c] < totals.min[c] ? record.min[c] : totals.min[c];
+      totals.max[c] =
+          record.max[c] > totals.max[c] ? record.max[c] : totals.max[c];
+      totals.sum[c] += record.sum[c];
+    }
+  }
+}
+
+// Reduce the columns, one contiguous array at a time
+static void reduceColumns(ChannelTotals &totals) {
+  for (int c = 0; c < COLUMN_COUNT; c++) {
+    const int16_t *values = batch.column((BatchColumn)c);
+    int32_t low = INT32_MAX;
+    int32_t high = INT32_MIN;
+    int32_t sum = 0;
+    for (int i = 0; i < SENSOR_BATCH_CAPACITY; i++) {
+      low = values[i] < low ? values[i] : low;
+      high = values[i] > high ? values[i] : high;
+      sum += values[i];
+    }
+    totals.min[c] = low;
+    totals.max[c] = high;
+    totals.sum[c] = sum;
+  }
+}
+
+void setUp() {
+  batch.clear();
+  for (int i = 0; i < SENSOR_BATCH_CAPACITY; i++) {
+    SensorData data;
+    data.lightValue = 2000 + (i * 7) % 400;
+    data.gasValue = 900 + (i * 13) % 90;
+    data.flameValue = 4000 - i;
+    data.soilMoistureValue = 1500 + i % 3;
+    data.soundValue = 1800 + (i * 31) % 300;
+    data.setTemperature(21.5f + i * 0.1f);
+    data.setHumidity(48.0f + (i % 5) * 0.5f);
+    data.temperatureValid = 1;
+    data.humidityValid = 1;
+    data.analogSampled = (1 << ANALOG_CHANNEL_COUNT) - 1;
+    data.timestamp = 60000 + i * 500;
+    batch.append(data);
+    makeRecord(data, records[i]);
+  }
+}
+
+void tearDown() {}
+
+void test_ram() {
+  size_t ringBytes = sensorRing.capacity() * sizeof(SensorRecord);
+  size_t recordBytes = sizeof(records);
+  size_t batchBytes = sizeof(SensorBatch);
+
+  ::printf("SensorData %u bytes, SensorRecord %u bytes (ESP32: 32 and "
+           "108)\n",
+           (unsigned)sizeof(SensorData), (unsigned)sizeof(SensorRecord));
+  ::printf("sensor ring of %u records: %u bytes; backlog of %d records: "
+           "%u bytes\n",
+           sensorRing.capacity(), (unsigned)ringBytes,
+           READING_BUFFER_CAPACITY, (unsigned)sizeof(backlog));
+  ::printf("raw batch of %d readings: %u bytes as records, %u as columns\n",
+           SENSOR_BATCH_CAPACITY, (unsigned)recordBytes,
+           (unsigned)batchBytes);
+
+  TEST_ASSERT_EQUAL_UINT32(16, sensorRing.capacity());
+  TEST_ASSERT_LESS_OR_EQUAL(READING_BUFFER_CAPACITY * sizeof(SensorRecord) +
+                                32,
+                            sizeof(backlog));
+  TEST_ASSERT_GREATER_OR_EQUAL(4 * batchBytes, recordBytes);
+}
+
+void test_channel_reduction() {
+  ChannelTotals fromRecords;
+  ChannelTotals fromColumns;
+  reduceRecords(fromRecords);
+  reduceColumns(fromColumns);
+  for (int c = 0; c < COLUMN_COUNT; c++) {
+    TEST_ASSERT_EQUAL_INT32(fromRecords.min[c], fromColumns.min[c]);
+    TEST_ASSERT_EQUAL_INT32(fromRecords.max[c], fromColumns.max[c]);
+    TEST_ASSERT_EQUAL_INT32(fromRecords.sum[c], fromColumns.sum[c]);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < BENCH_PASSES; pass++) {
+    reduceRecords(fromRecords);
+    sink = fromRecords.sum[pass % COLUMN_COUNT];
+  }
+  double recordsNs = elapsedNs(start) / BENCH_PASSES;
+
+  start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < BENCH_PASSES; pass++) {
+    reduceColumns(fromColumns);
+    sink = fromColumns.sum[pass % COLUMN_COUNT];
+  }
+  double columnsNs = elapsedNs(start) / BENCH_PASSES;
+
+  ::printf("min/max/sum of %d channels x %d readings: %.0f ns as records, "
+           "%.0f ns as columns (%.1fx)\n",
+           COLUMN_COUNT, SENSOR_BATCH_CAPACITY, recordsNs, columnsNs,
+           recordsNs / columnsNs);
+}
+
+void test_append_cost() {
+  SensorData data;
+  data.analogSampled = (1 << ANALOG_CHANNEL_COUNT) - 1;
+  data.temperatureValid = 1;
+  data.humidityValid = 1;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < BENCH_PASSES / 10; pass++) {
+    batch.clear();
+    for (int i = 0; i < SENSOR_BATCH_CAPACITY; i++) {
+      data.lightValue = pass + i;
+      batch.append(data);
+    }
+    sink = batch.column(COLUMN_LIGHT)[pass % SENSOR_BATCH_CAPACITY];
+  }
+  double perReading =
+      elapsedNs(start) / (BENCH_PASSES / 10) / SENSOR_BATCH_CAPACITY;
+
+  ::printf("append: %.1f ns per reading\n", perReading);
+  TEST_ASSERT_TRUE(batch.isFull());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_ram);
+  RUN_TEST(test_channel_reduction);
+  RUN_TEST(test_append_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,211 @@
+// Upload serialization benchmark: heap allocations per upload and per
+// retry (and that none outlives its acknowledgement), and serialization
+// throughput of batch and raw uploads. The stand-in does not record
+// requests here, so every allocation counted comes from FirebaseManager.
+// Run with:
+// pio test -e native-bench -f test_bench_serialize
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <chrono>
+#include <new>
+#include <unity.h>
+
+#include "FirebaseManager.h"
+#include "SensorBatch.h"
+#include "WindowStats.h"
+
+#define BENCH_UPLOADS 20000
+
+// Global allocation and free counters (count while counting is set)
+static bool counting = false;
+static uint32_t allocations = 0;
+static uint32_t frees = 0;
+
+void *operator new(size_t size) {
+  if (counting) {
+    allocations++;
+  }
+  void *block = malloc(size > 0 ? size : 1);
+  if (block == NULL) {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+void operator delete(void *block) noexcept {
+  if (counting && block != NULL) {
+    frees++;
+  }
+  free(block);
+}
+
+void operator delete(void *block, size_t size) noexcept {
+  operator delete(block);
+}
+
+// Manager under test, rebuilt in place for every test
+alignas(FirebaseManager) static uint8_t managerStorage[sizeof(
+    FirebaseManager)];
+static FirebaseManager *manager;
+static WindowSummary summary;
+static EventData events[MAX_EVENTS_PER_UPLOAD];
+static SensorBatch batch;
+static unsigned long lastSync;
+
+// Window summary with every channel populated, the largest batch record
+static void fillSummary() {
+  summary.windowStartEpochMs = 1760000000000ULL;
+  summary.windowStart = 60000;
+  summary.readingCount = 600;
+  for (int c = 0; c < WINDOW_CHANNEL_COUNT; c++) {
+    ChannelSummary &channel = summary.channels[c];
+    channel.count = 600;
+    channel.min = 100.5f + c;
+    channel.max = 3900.25f - c;
+    channel.mean = 2047.125f;
+    channel.stddev = 12.75f;
+    channel.p50 = 2050.0f;
+    channel.p90 = 2300.5f;
+  }
+  summary.soundRms = 140;
+  summary.soundPeak = 800;
+  summary.soundZcr = 95;
+  for (int b = 0; b < SOUND_BAND_COUNT; b++) {
+    summary.soundBands[b] = 250;
+  }
+  for (int i = 0; i < MAX_EVENTS_PER_UPLOAD; i++) {
+    events[i] = EventData(i % 2 ? VIBRATION : MOTION, 60000 + i * 250);
+    events[i].epochMs = 1760000060000ULL + i * 250;
+  }
+}
+
+// Full raw block: 120 readings, every channel sampled
+static void fillBatch() {
+  batch.clear();
+  for (int i = 0; i < SENSOR_BATCH_CAPACITY; i++) {
+    SensorData data;
+    data.lightValue = 2000 + (i * 7) % 400;
+    data.gasValue = 900 + (i * 13) % 90;
+    data.flameValue = 4000 - i;
+    data.soilMoistureValue = 1500;
+    data.soundValue = 1800 + (i * 31) % 300;
+    data.setTemperature(21.5f + i * 0.01f);
+    data.setHumidity(48.0f);
+    data.temperatureValid = 1;
+    data.humidityValid = 1;
+    data.analogSampled = (1 << ANALOG_CHANNEL_COUNT) - 1;
+    data.timestamp = 60000 + i * 500;
+    batch.append(data);
+  }
+  batch.setFirstEpochMs(1760000060000ULL);
+}
+
+void setUp() {
+  shimSetSerialOutput(false);
+  shimSetMillis(1000);
+  standIn::reset(0);
+  standIn::setRecording(false);
+  manager = new (managerStorage)
+      FirebaseManager("bench.firebaseio.test", "token");
+  manager->begin();
+  fillSummary();
+  fillBatch();
+}
+
+void tearDown() {
+  manager->~FirebaseManager();
+  shimSetSerialOutput(true);
+}
+
+// Upload and acknowledge count batches, returning the allocations made
+static uint32_t uploadBatches(int count) {
+  allocations = 0;
+  frees = 0;
+  counting = true;
+  for (int i = 0; i < count; i++) {
+    TEST_ASSERT_TRUE(manager->uploadBatch(&summary, events,
+                                          MAX_EVENTS_PER_UPLOAD, lastSync));
+    manager->loop();
+  }
+  counting = false;
+  return allocations;
+}
+
+void test_batch_upload_allocations() {
+  uploadBatches(UPLOAD_WINDOW_SIZE);
+  uint32_t made = uploadBatches(1000);
+  ::printf("batch upload: %.2f allocations per upload, %u still held "
+           "after the acknowledgements\n",
+           made / 1000.0, made - frees);
+
+  // The body handed to the client is the only allocation left, one per
+  // upload, and it is freed once the upload is acknowledged
+  TEST_ASSERT_EQUAL_UINT32(0, manager->getPendingUploads());
+  TEST_ASSERT_EQUAL_UINT32(1000, made);
+  TEST_ASSERT_EQUAL_UINT32(made, frees);
+}
+
+void test_retry_does_not_allocate() {
+  uploadBatches(1);
+  standIn::failNext(503, 3);
+  TEST_ASSERT_TRUE(manager->uploadBatch(&summary, events,
+                                        MAX_EVENTS_PER_UPLOAD, lastSync));
+  manager->loop();
+
+  allocations = 0;
+  counting = true;
+  for (int i = 0; i < 600 && manager->getPendingUploads() > 0; i++) {
+    shimAdvanceMillis(1000);
+    manager->loop();
+  }
+  counting = false;
+  ::printf("3 retries: %u allocations\n", allocations);
+  TEST_ASSERT_EQUAL_UINT32(3, manager->getRetryCount());
+  TEST_ASSERT_EQUAL(0, manager->getPendingUploads());
+  TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_batch_serialize_throughput() {
+  auto start = std::chrono::steady_clock::now();
+  uploadBatches(BENCH_UPLOADS);
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  double bytes = (double)standIn::bytesSent() / standIn::requestCount();
+  ::printf("batch upload: %.2f us, %.0f bytes, %.1f MB/s\n",
+           seconds * 1e6 / BENCH_UPLOADS, bytes,
+           bytes * BENCH_UPLOADS / seconds / 1e6);
+  TEST_ASSERT_EQUAL_UINT32(BENCH_UPLOADS, manager->getRequestCount());
+}
+
+void test_raw_serialize_throughput() {
+  auto start = std::chrono::steady_clock::now();
+  allocations = 0;
+  for (int i = 0; i < BENCH_UPLOADS; i++) {
+    counting = i >= UPLOAD_WINDOW_SIZE;
+    TEST_ASSERT_TRUE(manager->uploadRaw(batch, lastSync));
+    manager->loop();
+  }
+  counting = false;
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  double bytes = (double)standIn::bytesSent() / standIn::requestCount();
+  ::printf("raw upload (%d readings): %.2f us, %.0f bytes, %.1f MB/s, "
+           "%.2f allocations per upload\n",
+           SENSOR_BATCH_CAPACITY, seconds * 1e6 / BENCH_UPLOADS, bytes,
+           bytes * BENCH_UPLOADS / seconds / 1e6,
+           (double)allocations / (BENCH_UPLOADS - UPLOAD_WINDOW_SIZE));
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(BENCH_UPLOADS - UPLOAD_WINDOW_SIZE,
+                                   allocations);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_batch_upload_allocations);
+  RUN_TEST(test_retry_does_not_allocate);
+  RUN_TEST(test_batch_serialize_throughput);
+  RUN_TEST(test_raw_serialize_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,125 @@
+// TLS connection reuse benchmark: sequential uploads into the Firebase
+// stand-in with a handshake cost (a blocking connect holding heap, see
+// standIn::setHandshakeCost), once on a kept-alive connection and once on
+// a server closing it after every answer. The stand-in's cost is a model,
+// not a measurement: ESP32 TLS handshakes take several hundred ms and tens
+// of KB of heap, whereas a reused connection costs one round trip.
+// Run with: pio test -e native-bench -f test_bench_tls_reuse
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <unity.h>
+#include <vector>
+
+#include "FirebaseManager.h"
+
+#define BENCH_UPLOADS 100
+#define UPLOAD_GAP_MS 1000
+#define STEP_MS 10
+#define ROUND_TRIP_MS 200
+#define HANDSHAKE_MS 600
+#define HANDSHAKE_HEAP 40000
+
+// What a run of uploads cost
+struct ReuseRun {
+  uint32_t handshakes;
+  uint32_t reused;
+  double meanLatencyMs; // sent to acknowledged
+  unsigned long maxLatencyMs;
+  unsigned long longestLoopMs; // FirebaseManager::loop(), handshake included
+  uint32_t heapLowWater;
+};
+
+static unsigned long lastSync;
+
+static ReuseRun runUploads(bool keepAlive) {
+  shimSetMillis(1000);
+  standIn::reset(ROUND_TRIP_MS);
+  standIn::setHandshakeCost(HANDSHAKE_MS, HANDSHAKE_HEAP);
+  standIn::setKeepAlive(keepAlive);
+  shimHeapResetLowWater();
+  FirebaseManager manager("bench.firebaseio.test", "token");
+  manager.begin();
+
+  ReuseRun run = {};
+  for (int i = 0; i < BENCH_UPLOADS; i++) {
+    EventData event(MOTION, millis());
+    TEST_ASSERT_TRUE(manager.uploadBatch(NULL, &event, 1, lastSync));
+    unsigned long next = millis() + UPLOAD_GAP_MS;
+    while (millis() < next || manager.getPendingUploads() > 0) {
+      unsigned long loopStart = millis();
+      manager.loop();
+      if (millis() - loopStart > run.longestLoopMs) {
+        run.longestLoopMs = millis() - loopStart;
+      }
+      shimAdvanceMillis(STEP_MS);
+    }
+  }
+
+  unsigned long totalMs = 0;
+  const std::vector<StandInRequest> &requests = standIn::requests();
+  TEST_ASSERT_EQUAL(BENCH_UPLOADS, requests.size());
+  for (size_t i = 0; i < requests.size(); i++) {
+    TEST_ASSERT_EQUAL(0, requests[i].errorCode);
+    unsigned long latency = requests[i].answeredAt - requests[i].sentAt;
+    totalMs += latency;
+    if (latency > run.maxLatencyMs) {
+      run.maxLatencyMs = latency;
+    }
+  }
+  run.handshakes = manager.getHandshakeCount();
+  run.reused = manager.getReusedCount();
+  run.meanLatencyMs = (double)totalMs / BENCH_UPLOADS;
+  run.heapLowWater = ESP.getMinFreeHeap();
+
+  // Every handshake gave its heap back
+  TEST_ASSERT_EQUAL_UINT32(standIn::handshakeCount(), run.handshakes);
+  TEST_ASSERT_EQUAL_UINT32(180000, ESP.getFreeHeap());
+  return run;
+}
+
+static void report(const char *name, const ReuseRun &run) {
+  ::printf("%s: %u handshakes, %u reused, upload latency mean %.0f ms "
+           "max %lu ms, longest loop %lu ms, heap low-water %u\n",
+           name, run.handshakes, run.reused, run.meanLatencyMs,
+           run.maxLatencyMs, run.longestLoopMs, run.heapLowWater);
+}
+
+void setUp() { shimSetSerialOutput(false); }
+
+void tearDown() { shimSetSerialOutput(true); }
+
+void test_connection_reuse() {
+  ReuseRun reused = runUploads(true);
+  ReuseRun closed = runUploads(false);
+  report("keep-alive", reused);
+  report("no reuse  ", closed);
+  ::printf("reuse saves %.0f ms per upload and %u handshakes per %d "
+           "uploads\n",
+           closed.meanLatencyMs - reused.meanLatencyMs,
+           closed.handshakes - reused.handshakes, BENCH_UPLOADS);
+
+  // One handshake for the whole run, blocking one loop
+  TEST_ASSERT_EQUAL_UINT32(1, reused.handshakes);
+  TEST_ASSERT_EQUAL_UINT32(BENCH_UPLOADS - 1, reused.reused);
+  TEST_ASSERT_EQUAL_UINT32(BENCH_UPLOADS, closed.handshakes);
+  TEST_ASSERT_UINT32_WITHIN(STEP_MS, HANDSHAKE_MS, reused.longestLoopMs);
+
+  // Without reuse every upload pays the handshake
+  TEST_ASSERT_UINT32_WITHIN(STEP_MS, ROUND_TRIP_MS,
+                            (uint32_t)reused.meanLatencyMs);
+  TEST_ASSERT_UINT32_WITHIN(STEP_MS, ROUND_TRIP_MS + HANDSHAKE_MS,
+                            (uint32_t)closed.meanLatencyMs);
+
+  // The heap dips by the handshake's share either way: reuse makes the
+  // dip rare, not shallower
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(180000 - HANDSHAKE_HEAP,
+                                   reused.heapLowWater);
+  TEST_ASSERT_EQUAL_UINT32(reused.heapLowWater, closed.heapLowWater);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_connection_reuse);
+  return UNITY_END();
+}
@@ -0,0 +1,85 @@
+// Upload window benchmark: back-to-back batch uploads into the Firebase
+// stand-in at several injected round trips. FirebaseManager has one
+// connection, which carries one request at a time, so the window does not
+// multiply throughput: it queues the next requests so the connection
+// never idles between them, and a CloudTask iteration (loop() plus
+// submitting) must not wait for the network.
+// Run with: pio test -e native-bench -f test_bench_upload_window
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <chrono>
+#include <unity.h>
+
+#include "FirebaseManager.h"
+
+#define BENCH_STEP_MS 10
+#define BENCH_DURATION_MS 600000UL // ten minutes
+
+// Loop iteration budget of CloudTask
+#define LOOP_BUDGET_US 100000
+
+static unsigned long lastSync;
+
+void setUp() { shimSetSerialOutput(false); }
+
+void tearDown() { shimSetSerialOutput(true); }
+
+// Keep the window full for the bench duration at the given round trip
+static void runWindow(unsigned long roundTripMs) {
+  shimSetMillis(1000);
+  standIn::reset(roundTripMs);
+  standIn::setRecording(false);
+  FirebaseManager manager("bench.firebaseio.test", "token");
+  manager.begin();
+
+  EventData event(MOTION, 0);
+  double worstStepUs = 0;
+  unsigned long end = millis() + BENCH_DURATION_MS;
+  while (millis() < end) {
+    auto start = std::chrono::steady_clock::now();
+    manager.loop();
+    while (manager.canSubmit()) {
+      event.timestamp = millis();
+      TEST_ASSERT_TRUE(manager.uploadBatch(NULL, &event, 1, lastSync));
+    }
+    double stepUs = std::chrono::duration<double, std::micro>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    if (stepUs > worstStepUs) {
+      worstStepUs = stepUs;
+    }
+    shimAdvanceMillis(BENCH_STEP_MS);
+  }
+
+  // The connection's limit is one upload per round trip; submitting one
+  // request at a time would also lose the step until the next loop
+  double minutes = BENCH_DURATION_MS / 60000.0;
+  double perMinute = manager.getRequestCount() / minutes;
+  double linkPerMinute = 60000.0 / roundTripMs;
+  double serialPerMinute = 60000.0 / (roundTripMs + BENCH_STEP_MS);
+  ::printf("rtt %4lu ms: %6.0f uploads/min (%.0f%% of the connection, "
+           "%.2fx one at a time), worst iteration %.1f us\n",
+           roundTripMs, perMinute, 100 * perMinute / linkPerMinute,
+           perMinute / serialPerMinute, worstStepUs);
+
+  TEST_ASSERT_GREATER_OR_EQUAL(0.99 * linkPerMinute, perMinute);
+  TEST_ASSERT_LESS_THAN(LOOP_BUDGET_US, worstStepUs);
+}
+
+void test_window_rtt_50ms() { runWindow(50); }
+
+void test_window_rtt_300ms() { runWindow(300); }
+
+void test_window_rtt_1000ms() { runWindow(1000); }
+
+void test_window_rtt_3000ms() { runWindow(3000); }
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_window_rtt_50ms);
+  RUN_TEST(test_window_rtt_300ms);
+  RUN_TEST(test_window_rtt_1000ms);
+  RUN_TEST(test_window_rtt_3000ms);
+  return UNITY_END();
+}
@@ -0,0 +1,84 @@
+// Per-sample cost of the window statistics: Welford plus two P²
+// estimators per channel, and a whole reading through the window
+// aggregator. Run with: pio test -e native-bench -f test_bench_window_stats
+
+#include <Arduino.h>
+#include <chrono>
+#include <unity.h>
+
+#include "ReadingBuffer.h"
+#include "WindowStats.h"
+
+#define BENCH_SAMPLES 10000000
+
+// Keeps results alive so the optimizer cannot drop the work
+static volatile float sink;
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_channel_sample_cost() {
+  ChannelStats stats;
+  ChannelSummary summary;
+  uint32_t seed = 1;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_SAMPLES; i++) {
+    seed = seed * 1664525 + 1013904223;
+    stats.add(2000 + (seed >> 22));
+  }
+  double perSample = elapsedNs(start) / BENCH_SAMPLES;
+  stats.summarize(summary);
+  sink = summary.p90;
+
+  ::printf("channel (Welford + 2x P2): %.1f ns per sample, %u bytes\n",
+           perSample, (unsigned)sizeof(ChannelStats));
+  TEST_ASSERT_GREATER_OR_EQUAL(2000, summary.min);
+  TEST_ASSERT_LESS_THAN(3024, summary.max);
+}
+
+void test_reading_cost() {
+  // A reading with every channel sampled, one window per minute of
+  // one-second readings
+  WindowAggregator aggregator(SUMMARY_WINDOW_MS);
+  WindowSummary summary;
+  SensorData data;
+  data.analogSampled = (1 << ANALOG_CHANNEL_COUNT) - 1;
+  data.temperatureValid = 1;
+  data.humidityValid = 1;
+  SensorRecord record;
+
+  const int readings = BENCH_SAMPLES / 10;
+  int windows = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < readings; i++) {
+    data.lightValue = 1000 + i % 700;
+    data.gasValue = 500 + i % 33;
+    data.soundRms = 100 + i % 17;
+    data.timestamp = i * 1000UL;
+    makeRecord(data, record);
+    if (aggregator.add(record, summary)) {
+      windows++;
+    }
+  }
+  double perReading = elapsedNs(start) / readings;
+  sink = summary.channels[WINDOW_LIGHT].p50;
+
+  ::printf("reading (7 channels + sound features): %.1f ns, %u bytes of "
+           "aggregator state\n",
+           perReading, (unsigned)sizeof(WindowAggregator));
+  TEST_ASSERT_EQUAL(readings / 60, windows);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_channel_sample_cost);
+  RUN_TEST(test_reading_cost);
+  return UNITY_END();
+}
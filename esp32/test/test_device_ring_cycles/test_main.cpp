@@ -0,0 +1,190 @@
+// On-device cycle counts of the sensor hand-off: FreeRTOS queue
+// (xQueueSend/xQueueReceive, one critical section and one copy per side
+// and item) against SpscRing, per item on one core and for a stream of
+// records from core 1 to core 0 as SensorTask -> CloudTask.
+// Run with: pio test -e nodemcu-32s -f test_device_ring_cycles
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "../../include/DataTypes.h"
+#include "ReadingBuffer.h"
+#include "SpscRing.h"
+
+// Ring/queue length as in main.cpp, items per measurement
+#define RING_LENGTH 16
+#define SAME_CORE_ITEMS 1000
+#define CROSS_CORE_ITEMS 20000
+
+// Batch size of the in-place variant (CloudTask drains whole batches)
+#define BATCH_ITEMS 8
+
+static SensorRecord ringStorage[RING_LENGTH];
+static SpscRing *ring;
+static QueueHandle_t queue;
+
+// Task waiting for the producer of a cross-core run
+static TaskHandle_t mainTask;
+
+void setUp() {
+  ring = new SpscRing(ringStorage, sizeof(SensorRecord), RING_LENGTH);
+  queue = xQueueCreate(RING_LENGTH, sizeof(SensorRecord));
+  TEST_ASSERT_NOT_NULL(queue);
+}
+
+void tearDown() {
+  vQueueDelete(queue);
+  delete ring;
+}
+
+static SensorRecord makeItem(uint32_t seq) {
+  SensorData data;
+  data.timestamp = seq;
+  SensorRecord record;
+  makeRecord(data, record);
+  return record;
+}
+
+void test_same_core_cycles_per_item() {
+  SensorRecord in = makeItem(1);
+  SensorRecord out;
+
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < SAME_CORE_ITEMS; i++) {
+    xQueueSend(queue, &in, 0);
+    xQueueReceive(queue, &out, 0);
+  }
+  uint32_t queueCycles = (ESP.getCycleCount() - start) / SAME_CORE_ITEMS;
+
+  start = ESP.getCycleCount();
+  for (int i = 0; i < SAME_CORE_ITEMS; i++) {
+    ring->push(&in);
+    ring->pop(&out);
+  }
+  uint32_t ringCycles = (ESP.getCycleCount() - start) / SAME_CORE_ITEMS;
+
+  // In place, in batches: built in the slot, read where it lies
+  start = ESP.getCycleCount();
+  uint32_t sum = 0;
+  for (int i = 0; i < SAME_CORE_ITEMS; i += BATCH_ITEMS) {
+    uint32_t count;
+    SensorRecord *slots = (SensorRecord *)ring->reserve(count);
+    for (uint32_t k = 0; k < BATCH_ITEMS; k++) {
+      slots[k].readingCount = 1;
+    }
+    ring->commit(BATCH_ITEMS);
+    const SensorRecord *records = (const SensorRecord *)ring->peek(count);
+    for (uint32_t k = 0; k < count; k++) {
+      sum += records[k].readingCount;
+    }
+    ring->release(count);
+  }
+  uint32_t batchCycles = (ESP.getCycleCount() - start) / SAME_CORE_ITEMS;
+  TEST_ASSERT_EQUAL_UINT32(SAME_CORE_ITEMS, sum);
+
+  Serial.printf("Same core, cycles/item (%u B): xQueue %u, SpscRing "
+                "push/pop %u, reserve/peek x%d %u\n",
+                (unsigned)sizeof(SensorRecord), queueCycles, ringCycles,
+                BATCH_ITEMS, batchCycles);
+  TEST_ASSERT_LESS_THAN_UINT32(queueCycles, ringCycles);
+  TEST_ASSERT_LESS_THAN_UINT32(ringCycles, batchCycles);
+}
+
+// Producers on core 1: CROSS_CORE_ITEMS records, then notify mainTask
+static void queueProducer(void *parameter) {
+  for (uint32_t i = 0; i < CROSS_CORE_ITEMS; i++) {
+    SensorRecord record = makeItem(i);
+    xQueueSend(queue, &record, portMAX_DELAY);
+  }
+  xTaskNotifyGive(mainTask);
+  vTaskDelete(NULL);
+}
+
+static void ringProducer(void *parameter) {
+  for (uint32_t i = 0; i < CROSS_CORE_ITEMS; i++) {
+    uint32_t room;
+    SensorRecord *slot;
+    while ((slot = (SensorRecord *)ring->reserve(room)) == NULL) {
+      taskYIELD();
+    }
+    SensorData data;
+    data.timestamp = i;
+    makeRecord(data, *slot);
+    ring->commit(1);
+  }
+  xTaskNotifyGive(mainTask);
+  vTaskDelete(NULL);
+}
+
+// Outcome of the cross-core runs, filled by the consumer task
+struct CrossCoreRun {
+  TaskHandle_t caller;
+  uint32_t queueCycles;
+  uint32_t ringCycles;
+  uint32_t outOfOrder;
+};
+
+// Consume CROSS_CORE_ITEMS on this core (0) from a producer on core 1,
+// returns the cycles taken and counts records out of order
+static uint32_t runCrossCore(TaskFunction_t producer, bool useRing,
+                             uint32_t &outOfOrder) {
+  mainTask = xTaskGetCurrentTaskHandle();
+  uint32_t start = ESP.getCycleCount();
+  xTaskCreatePinnedToCore(producer, "Producer", 4096, NULL, 1, NULL, 1);
+
+  uint32_t expected = 0;
+  while (expected < CROSS_CORE_ITEMS) {
+    if (useRing) {
+      uint32_t count;
+      const SensorRecord *records = (const SensorRecord *)ring->peek(count);
+      for (uint32_t k = 0; k < count; k++) {
+        outOfOrder += records[k].data.timestamp != expected++;
+      }
+      if (count > 0) {
+        ring->release(count);
+      }
+    } else {
+      SensorRecord record;
+      if (xQueueReceive(queue, &record, portMAX_DELAY) == pdTRUE) {
+        outOfOrder += record.data.timestamp != expected++;
+      }
+    }
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  return cycles;
+}
+
+// Runs the consumer side of both variants on core 0 (assertions stay in
+// the test task)
+static void crossCoreTask(void *parameter) {
+  CrossCoreRun *run = (CrossCoreRun *)parameter;
+  run->queueCycles = runCrossCore(queueProducer, false, run->outOfOrder);
+  run->ringCycles = runCrossCore(ringProducer, true, run->outOfOrder);
+  xTaskNotifyGive(run->caller);
+  vTaskDelete(NULL);
+}
+
+void test_cross_core_stream() {
+  CrossCoreRun run = {xTaskGetCurrentTaskHandle(), 0, 0, 0};
+  xTaskCreatePinnedToCore(crossCoreTask, "Consumer", 4096, &run, 1, NULL,
+                          0);
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+  Serial.printf("Core 1 -> core 0, cycles/item: xQueue %u, SpscRing %u\n",
+                run.queueCycles / CROSS_CORE_ITEMS,
+                run.ringCycles / CROSS_CORE_ITEMS);
+  TEST_ASSERT_EQUAL_UINT32(0, run.outOfOrder);
+  TEST_ASSERT_LESS_THAN_UINT32(run.queueCycles, run.ringCycles);
+}
+
+void setup() {
+  // Time for the serial monitor to attach
+  delay(2000);
+  UNITY_BEGIN();
+  RUN_TEST(test_same_core_cycles_per_item);
+  RUN_TEST(test_cross_core_stream);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,197 @@
+#include <Arduino.h>
+#include <string.h>
+#include <unity.h>
+
+#include "DhtDecoder.h"
+
+// Longest capture: release, response, 40 bits and the final low
+#define MAX_TRACE_PULSES 96
+
+// Pulse train of one frame as the RMT delivers it (idle high ends the
+// capture, so it stops at the final low)
+struct Trace {
+  DhtPulse pulses[MAX_TRACE_PULSES];
+  size_t count;
+
+  void add(uint8_t level, uint16_t durationUs) {
+    pulses[count].level = level;
+    pulses[count++].durationUs = durationUs;
+  }
+};
+
+// Build the trace of a frame with nominal timing plus a small jitter
+static Trace frameTrace(const uint8_t bytes[5], int jitterUs = 0) {
+  Trace trace;
+  trace.count = 0;
+  trace.add(1, 30); // host releases the line
+  trace.add(0, 80); // sensor response
+  trace.add(1, 80);
+  for (int bit = 0; bit < DHT_FRAME_BITS; bit++) {
+    bool one = bytes[bit / 8] & (0x80 >> (bit % 8));
+    int jitter = (bit % 3 - 1) * jitterUs;
+    trace.add(0, 50 + jitter);
+    trace.add(1, (one ? 70 : 26) + jitter);
+  }
+  trace.add(0, 50);
+  return trace;
+}
+
+static void makeFrame(uint8_t bytes[5], uint8_t rh, uint8_t rhDecimal,
+                      uint8_t t, uint8_t tDecimal) {
+  bytes[0] = rh;
+  bytes[1] = rhDecimal;
+  bytes[2] = t;
+  bytes[3] = tDecimal;
+  bytes[4] = rh + rhDecimal + t + tDecimal;
+}
+
+// Trace in the shape of an RMT capture, with per-pulse jitter as seen on
+// a real sensor: 55 %RH, 23.4 °C
+static const DhtPulse CAPTURED[] = {
+    {1, 27}, {0, 83}, {1, 86},
+    // 55 = 00110111
+    {0, 54}, {1, 24}, {0, 53}, {1, 25}, {0, 54}, {1, 71}, {0, 53}, {1, 72},
+    {0, 54}, {1, 24}, {0, 53}, {1, 72}, {0, 54}, {1, 71}, {0, 53}, {1, 71},
+    // 0
+    {0, 55}, {1, 24}, {0, 53}, {1, 24}, {0, 54}, {1, 25}, {0, 53}, {1, 24},
+    {0, 54}, {1, 25}, {0, 53}, {1, 24}, {0, 54}, {1, 24}, {0, 54}, {1, 25},
+    // 23 = 00010111
+    {0, 54}, {1, 24}, {0, 53}, {1, 25}, {0, 54}, {1, 24}, {0, 53}, {1, 71},
+    {0, 54}, {1, 24}, {0, 53}, {1, 72}, {0, 54}, {1, 71}, {0, 53}, {1, 71},
+    // 4 = 00000100
+    {0, 55}, {1, 24}, {0, 53}, {1, 24}, {0, 54}, {1, 25}, {0, 53}, {1, 24},
+    {0, 54}, {1, 25}, {0, 53}, {1, 71}, {0, 54}, {1, 24}, {0, 54}, {1, 25},
+    // 82 = 01010010
+    {0, 54}, {1, 24}, {0, 53}, {1, 71}, {0, 54}, {1, 24}, {0, 53}, {1, 72},
+    {0, 54}, {1, 24}, {0, 53}, {1, 24}, {0, 54}, {1, 71}, {0, 53}, {1, 25},
+    {0, 51},
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_captured_trace() {
+  DhtSample sample;
+  TEST_ASSERT_EQUAL(DHT_OK,
+                    decodeDhtPulses(CAPTURED,
+                                    sizeof(CAPTURED) / sizeof(CAPTURED[0]),
+                                    sample));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 55.0f, sample.humidity);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 23.4f, sample.temperature);
+}
+
+void test_jittered_frame() {
+  uint8_t bytes[5];
+  makeFrame(bytes, 81, 0, 31, 9);
+  Trace trace = frameTrace(bytes, 8);
+  DhtSample sample;
+  TEST_ASSERT_EQUAL(DHT_OK,
+                    decodeDhtPulses(trace.pulses, trace.count, sample));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 81.0f, sample.humidity);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 31.9f, sample.temperature);
+}
+
+void test_negative_temperature() {
+  uint8_t bytes[5];
+  makeFrame(bytes, 40, 0, 5, 0x80 | 3);
+  Trace trace = frameTrace(bytes);
+  DhtSample sample;
+  TEST_ASSERT_EQUAL(DHT_OK,
+                    decodeDhtPulses(trace.pulses, trace.count, sample));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, -5.3f, sample.temperature);
+}
+
+void test_corrupt_checksum() {
+  uint8_t bytes[5];
+  makeFrame(bytes, 55, 0, 23, 4);
+  bytes[4] ^= 0x01;
+  Trace trace = frameTrace(bytes);
+  DhtSample sample;
+  TEST_ASSERT_EQUAL(DHT_ERROR_CHECKSUM,
+                    decodeDhtPulses(trace.pulses, trace.count, sample));
+}
+
+void test_flipped_data_bit() {
+  // A 0 bit read as 1 (high pulse stretched past the threshold)
+  DhtPulse pulses[sizeof(CAPTURED) / sizeof(CAPTURED[0])];
+  size_t count = sizeof(CAPTURED) / sizeof(CAPTURED[0]);
+  memcpy(pulses, CAPTURED, sizeof(CAPTURED));
+  pulses[4].durationUs = 60; // first data bit's high pulse
+  DhtSample sample;
+  TEST_ASSERT_EQUAL(DHT_ERROR_CHECKSUM,
+                    decodeDhtPulses(pulses, count, sample));
+}
+
+void test_truncated_capture() {
+  // Only 30 bits before the capture ended
+  uint8_t bytes[5];
+  makeFrame(bytes, 55, 0, 23, 4);
+  Trace trace = frameTrace(bytes);
+  DhtSample sample;
+  TEST_ASSERT_EQUAL(DHT_ERROR_TIMEOUT,
+                    decodeDhtPulses(trace.pulses, 3 + 2 * 30, sample));
+  TEST_ASSERT_EQUAL(DHT_ERROR_TIMEOUT, decodeDhtPulses(NULL, 0, sample));
+}
+
+void test_pulse_outside_timing() {
+  uint8_t bytes[5];
+  makeFrame(bytes, 55, 0, 23, 4);
+
+  // A high pulse held too long
+  Trace trace = frameTrace(bytes);
+  trace.pulses[10].durationUs = DHT_MAX_PULSE_US + 40;
+  DhtSample sample;
+  TEST_ASSERT_EQUAL(DHT_ERROR_TIMING,
+                    decodeDhtPulses(trace.pulses, trace.count, sample));
+
+  // A glitch low between bits
+  trace = frameTrace(bytes);
+  trace.pulses[21].durationUs = DHT_MIN_PULSE_US - 5;
+  TEST_ASSERT_EQUAL(DHT_ERROR_TIMING,
+                    decodeDhtPulses(trace.pulses, trace.count, sample));
+}
+
+void test_capture_with_leading_noise() {
+  // Line noise before the response is ignored: the data bits are the
+  // last 40 high pulses
+  uint8_t bytes[5];
+  makeFrame(bytes, 60, 0, 19, 0);
+  Trace frame = frameTrace(bytes);
+  Trace trace;
+  trace.count = 0;
+  trace.add(1, 400);
+  trace.add(0, 3);
+  trace.add(1, 2);
+  trace.add(0, 18000);
+  for (size_t i = 0; i < frame.count; i++) {
+    trace.add(frame.pulses[i].level, frame.pulses[i].durationUs);
+  }
+  DhtSample sample;
+  TEST_ASSERT_EQUAL(DHT_OK,
+                    decodeDhtPulses(trace.pulses, trace.count, sample));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 60.0f, sample.humidity);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 19.0f, sample.temperature);
+}
+
+void test_status_names() {
+  TEST_ASSERT_EQUAL_STRING("ok", dhtStatusName(DHT_OK));
+  TEST_ASSERT_EQUAL_STRING("timeout", dhtStatusName(DHT_ERROR_TIMEOUT));
+  TEST_ASSERT_EQUAL_STRING("bad timing", dhtStatusName(DHT_ERROR_TIMING));
+  TEST_ASSERT_EQUAL_STRING("checksum mismatch",
+                           dhtStatusName(DHT_ERROR_CHECKSUM));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_captured_trace);
+  RUN_TEST(test_jittered_frame);
+  RUN_TEST(test_negative_temperature);
+  RUN_TEST(test_corrupt_checksum);
+  RUN_TEST(test_flipped_data_bit);
+  RUN_TEST(test_truncated_capture);
+  RUN_TEST(test_pulse_outside_timing);
+  RUN_TEST(test_capture_with_leading_noise);
+  RUN_TEST(test_status_names);
+  return UNITY_END();
+}
@@ -0,0 +1,183 @@
+// EpochClock, and capture times resolved at upload: TimeSync runs on the
+// fake SNTP of the shim (shimSntpSync), millis() on the virtual clock.
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <esp_sntp.h>
+#include <string>
+#include <unity.h>
+
+#include "EpochClock.h"
+#include "FirebaseManager.h"
+#include "TimeSync.h"
+
+#define EPOCH_MS 1760000000000ULL
+#define SERVER_TIME "\"timestamp\":{\".sv\":\"timestamp\"}"
+
+static TimeSync *timeSync;
+static FirebaseManager *manager;
+static unsigned long lastSync;
+
+// Wall-clock stamp as it appears in an uploaded record
+static std::string stamp(uint64_t epochMs) {
+  return "\"timestamp\":" + std::to_string(epochMs);
+}
+
+// Body of the latest upload
+static const std::string &lastBody() {
+  TEST_ASSERT_GREATER_THAN(0, standIn::requests().size());
+  return standIn::requests().back().body;
+}
+
+static bool contains(const std::string &body, const std::string &text) {
+  return body.find(text) != std::string::npos;
+}
+
+// Upload one motion event captured at localMs (wall clock unknown at
+// capture unless epochMs is given)
+static void uploadEvent(unsigned long localMs, uint64_t epochMs = 0,
+                        bool fromLog = false) {
+  EventData event(MOTION, localMs);
+  event.epochMs = epochMs;
+  TEST_ASSERT_TRUE(manager->uploadBatch(NULL, &event, 1, lastSync, fromLog));
+}
+
+void setUp() {
+  shimSetSerialOutput(false);
+  shimSetMillis(1000);
+  standIn::reset(100);
+  timeSync = new TimeSync();
+  timeSync->begin();
+  manager = new FirebaseManager("epoch.firebaseio.test", "token");
+  manager->begin();
+  manager->setTimeSync(timeSync);
+}
+
+void tearDown() {
+  delete manager;
+  delete timeSync;
+  shimSetSerialOutput(true);
+}
+
+void test_unsynced_clock() {
+  EpochClock clock;
+  TEST_ASSERT_FALSE(clock.isSynced());
+  TEST_ASSERT_EQUAL_UINT64(0, clock.toEpochMs(5000));
+  TEST_ASSERT_EQUAL_UINT32(0, clock.getSyncAge(5000));
+  TEST_ASSERT_EQUAL_UINT32(0, clock.getSyncCount());
+}
+
+void test_sync_converts_before_and_after() {
+  EpochClock clock;
+  clock.sync(EPOCH_MS, 20000);
+  TEST_ASSERT_TRUE(clock.isSynced());
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_MS, clock.toEpochMs(20000));
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_MS + 500, clock.toEpochMs(20500));
+
+  // Readings taken before the sync
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_MS - 15000, clock.toEpochMs(5000));
+  TEST_ASSERT_EQUAL_UINT32(1000, clock.getSyncAge(21000));
+}
+
+void test_millis_wraparound() {
+  // Anchor just before millis() wraps; readings on both sides convert
+  EpochClock clock;
+  clock.sync(EPOCH_MS, 0xFFFFF000UL);
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_MS + 0x1000 + 100, clock.toEpochMs(100));
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_MS - 0x1000, clock.toEpochMs(0xFFFFE000UL));
+}
+
+void test_resync_correction() {
+  // The local clock ran 250 ms slow over an hour
+  EpochClock clock;
+  clock.sync(EPOCH_MS, 10000);
+  TEST_ASSERT_EQUAL_INT32(0, clock.getLastCorrection());
+  clock.sync(EPOCH_MS + 3600250, 3610000);
+  TEST_ASSERT_EQUAL_INT32(250, clock.getLastCorrection());
+  TEST_ASSERT_EQUAL_UINT32(2, clock.getSyncCount());
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_MS + 3600250, clock.toEpochMs(3610000));
+
+  // And 550 ms fast over the next hour
+  clock.sync(EPOCH_MS + 7200000, 7210300);
+  TEST_ASSERT_EQUAL_INT32(-550, clock.getLastCorrection());
+}
+
+void test_time_sync_on_fake_sntp() {
+  TEST_ASSERT_FALSE(timeSync->isSynced());
+  TEST_ASSERT_EQUAL_UINT64(0, timeSync->toEpochMs(millis()));
+
+  shimSetMillis(30000);
+  shimSntpSync(EPOCH_MS);
+  TEST_ASSERT_TRUE(timeSync->isSynced());
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_MS - 29000, timeSync->toEpochMs(1000));
+  TEST_ASSERT_EQUAL_UINT32(1, timeSync->getSyncCount());
+}
+
+void test_capture_before_sync_resolved_at_upload() {
+  // Captured at 5 s of uptime, clock synced at 20 s, uploaded at 21 s
+  shimSetMillis(20000);
+  shimSntpSync(EPOCH_MS);
+  shimSetMillis(21000);
+  uploadEvent(5000);
+  TEST_ASSERT_TRUE(contains(lastBody(), stamp(EPOCH_MS - 15000)));
+  TEST_ASSERT_FALSE(contains(lastBody(), SERVER_TIME));
+}
+
+void test_capture_time_known_at_capture_kept() {
+  // A re-sync after capture does not move a record already stamped
+  shimSetMillis(20000);
+  shimSntpSync(EPOCH_MS);
+  shimSetMillis(25000);
+  shimSntpSync(EPOCH_MS + 5300);
+  uploadEvent(22000, EPOCH_MS + 2000);
+  TEST_ASSERT_TRUE(contains(lastBody(), stamp(EPOCH_MS + 2000)));
+}
+
+void test_unsynced_upload_uses_server_time() {
+  uploadEvent(5000);
+  TEST_ASSERT_TRUE(contains(lastBody(), SERVER_TIME));
+}
+
+void test_summary_and_alarm_resolved() {
+  shimSetMillis(90000);
+  shimSntpSync(EPOCH_MS);
+
+  // A window that started at 0 s of uptime, before the sync
+  WindowSummary summary = {};
+  summary.windowStart = 0;
+  summary.readingCount = 60;
+  TEST_ASSERT_TRUE(manager->uploadBatch(&summary, NULL, 0, lastSync));
+  TEST_ASSERT_TRUE(contains(lastBody(), stamp(EPOCH_MS - 90000)));
+  TEST_ASSERT_FALSE(contains(lastBody(), SERVER_TIME));
+
+  AlarmData alarm;
+  alarm.timestamp = 60000;
+  TEST_ASSERT_TRUE(manager->uploadAlarms(&alarm, 1, lastSync));
+  TEST_ASSERT_TRUE(contains(lastBody(), stamp(EPOCH_MS - 30000)));
+}
+
+void test_log_records_serialized_as_read() {
+  // The drain resolves records of this boot itself; an unresolved one
+  // from the log is from an earlier boot and gets the server time
+  shimSetMillis(20000);
+  shimSntpSync(EPOCH_MS);
+  uploadEvent(5000, 0, true);
+  TEST_ASSERT_TRUE(contains(lastBody(), SERVER_TIME));
+  uploadEvent(5000, EPOCH_MS - 15000, true);
+  TEST_ASSERT_TRUE(contains(lastBody(), stamp(EPOCH_MS - 15000)));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_unsynced_clock);
+  RUN_TEST(test_sync_converts_before_and_after);
+  RUN_TEST(test_millis_wraparound);
+  RUN_TEST(test_resync_correction);
+  RUN_TEST(test_time_sync_on_fake_sntp);
+  RUN_TEST(test_capture_before_sync_resolved_at_upload);
+  RUN_TEST(test_capture_time_known_at_capture_kept);
+  RUN_TEST(test_unsynced_upload_uses_server_time);
+  RUN_TEST(test_summary_and_alarm_resolved);
+  RUN_TEST(test_log_records_serialized_as_read);
+  return UNITY_END();
+}
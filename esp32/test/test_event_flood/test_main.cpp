@@ -0,0 +1,152 @@
+// Event storms through the firmware's own event path, on the shim's
+// scheduler: the test stands in for EventTask and fills the event ring at
+// once, CloudTask collects, flushes and uploads the events into the
+// Firebase stand-in. An upload carries at most MAX_EVENTS_PER_UPLOAD
+// events, so a storm of N costs ceil(N / 16) requests, queued one after
+// the other on the one connection.
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <WiFi.h>
+#include <esp_sntp.h>
+#include <unity.h>
+#include <vector>
+
+#include "FirebaseManager.h"
+#include "SpscRing.h"
+#include "secrets.h"
+
+// Same as CloudTask.cpp: the shortest flush time and the longest sleep
+#define EVENT_FLUSH_MIN_MS 500
+#define IDLE_WAIT_MS 40
+
+#define STORM_EVENTS 100
+#define ROUND_TRIP_MS 350
+#define STEP_MS 10
+#define SETTLE_MS 60000
+
+// Wall clock reported by SNTP at millis() = 0
+#define EPOCH_MS 1700000000000ULL
+
+// Firmware (src/main.cpp)
+extern void setup();
+extern SpscRing eventRing;
+extern TaskHandle_t cloudTaskHandle;
+extern FirebaseManager firebaseManager;
+
+// What became of a storm
+struct StormResult {
+  uint32_t requests;     // acknowledged requests carrying its events
+  uint32_t events;       // its events acknowledged
+  unsigned long worstMs; // detection to acknowledgement, slowest event
+};
+
+// Queue count events detected now, the way EventTask does, and run the
+// firmware until they are all acknowledged or SETTLE_MS has passed
+static StormResult storm(int count) {
+  size_t first = standIn::requests().size();
+  unsigned long detectedAt = millis();
+  for (int i = 0; i < count; i++) {
+    EventData event(MOTION, detectedAt);
+    event.epochMs = EPOCH_MS + detectedAt;
+    TEST_ASSERT_TRUE(eventRing.push(&event));
+  }
+  if (eventRing.takeWaiter()) {
+    xTaskNotifyGive(cloudTaskHandle);
+  }
+
+  StormResult result = {0, 0, 0};
+  unsigned long end = detectedAt + SETTLE_MS;
+  while (result.events < (uint32_t)count && millis() < end) {
+    shimAdvanceMillis(STEP_MS);
+    result = StormResult();
+    const std::vector<StandInRequest> &requests = standIn::requests();
+    for (size_t i = first; i < requests.size(); i++) {
+      if (requests[i].errorCode != 0 || requests[i].answeredAt == 0) {
+        continue;
+      }
+      uint32_t events = 0;
+      const char *cursor = requests[i].body.c_str();
+      while ((cursor = strstr(cursor, "\"/sensors/motion/")) != NULL) {
+        events++;
+        cursor++;
+      }
+      if (events > 0) {
+        result.requests++;
+        result.events += events;
+        result.worstMs = requests[i].answeredAt - detectedAt;
+      }
+    }
+  }
+  return result;
+}
+
+static uint32_t requestsFor(int events) {
+  return (events + MAX_EVENTS_PER_UPLOAD - 1) / MAX_EVENTS_PER_UPLOAD;
+}
+
+void setUp() { shimSetSerialOutput(false); }
+
+void tearDown() {
+  shimAdvanceMillis(SETTLE_MS);
+  shimSetSerialOutput(true);
+}
+
+void test_burst_within_one_upload() {
+  // Fewer events than an upload holds wait for the flush time, then go
+  // in one request
+  StormResult result = storm(5);
+  ::printf("5 events: %u request, worst latency %lu ms\n", result.requests,
+           result.worstMs);
+  TEST_ASSERT_EQUAL_UINT32(5, result.events);
+  TEST_ASSERT_EQUAL_UINT32(1, result.requests);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(
+      EVENT_FLUSH_MIN_MS + ROUND_TRIP_MS + IDLE_WAIT_MS, result.worstMs);
+}
+
+void test_storm_costs_one_request_per_upload_cap() {
+  // Full uploads go at once and queue on the connection: the last one is
+  // answered ceil(N / 16) round trips after the storm
+  StormResult result = storm(STORM_EVENTS);
+  uint32_t requests = requestsFor(STORM_EVENTS);
+  unsigned long budget = EVENT_FLUSH_MIN_MS + (requests - 1) * ROUND_TRIP_MS;
+  ::printf("%d events: %u requests, worst latency %lu ms (budget %lu ms "
+           "+ round trip)\n",
+           STORM_EVENTS, result.requests, result.worstMs, budget);
+  TEST_ASSERT_EQUAL_UINT32(STORM_EVENTS, result.events);
+  TEST_ASSERT_EQUAL_UINT32(requests, result.requests);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(budget + ROUND_TRIP_MS, result.worstMs);
+  TEST_ASSERT_EQUAL_UINT32(0, firebaseManager.getAbandonedCount());
+}
+
+void test_storm_survives_failures() {
+  // The first three requests fail once: every event still arrives, one
+  // retry delay later at worst
+  uint32_t retries = firebaseManager.getRetryCount();
+  standIn::failNext(500, 3);
+  StormResult result = storm(STORM_EVENTS);
+  ::printf("%d events, 3 failures: worst latency %lu ms\n", STORM_EVENTS,
+           result.worstMs);
+  TEST_ASSERT_EQUAL_UINT32(STORM_EVENTS, result.events);
+  TEST_ASSERT_EQUAL_UINT32(3, firebaseManager.getRetryCount() - retries);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(ROUND_TRIP_MS + UPLOAD_RETRY_BASE_MS,
+                                      result.worstMs);
+}
+
+int main(int argc, char **argv) {
+  // Boot the firmware once, wait for the link and the clock
+  shimSetSerialOutput(false);
+  standIn::reset(ROUND_TRIP_MS);
+  shimWiFiSetInRange(PRIMARY_WIFI_SSID, true);
+  shimStartScheduling();
+  setup();
+  shimAdvanceMillis(1000);
+  shimSntpSync(EPOCH_MS + millis());
+  shimAdvanceMillis(10000);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_burst_within_one_upload);
+  RUN_TEST(test_storm_costs_one_request_per_upload_cap);
+  RUN_TEST(test_storm_survives_failures);
+  return UNITY_END();
+}
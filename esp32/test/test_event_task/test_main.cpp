@@ -0,0 +1,160 @@
+// EventTask debouncing, run in the firmware on the shim's scheduler: PIR
+// and vibration edges go in through the interrupts, event records come out
+// of the Firebase stand-in. Edges suppressed by a debounce window are
+// counted and go out on their own once the window has passed.
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <WiFi.h>
+#include <esp_sntp.h>
+#include <unity.h>
+#include <vector>
+
+#include "DigitalSensors.h"
+#include "secrets.h"
+
+// Same as EventTask.cpp
+#define EVENT_DEBOUNCE_MS 3000
+
+#define ROUND_TRIP_MS 50
+#define SETTLE_MS 30000 // events are flushed within the flush bound
+
+// Queued event to acknowledgement on a fast link: the shortest flush time
+// (EVENT_FLUSH_MIN_MS in CloudTask.cpp), a round trip and CloudTask's
+// idle wait
+#define ACK_BOUND_MS (500 + ROUND_TRIP_MS + 100)
+
+// Wall clock reported by SNTP at millis() = 0
+#define EPOCH_MS 1700000000000ULL
+
+// Firmware (src/main.cpp)
+extern void setup();
+
+// An event record as uploaded
+struct EventRecord {
+  unsigned long detectedAt; // millis()
+  unsigned long ackedAt;
+  unsigned edges;
+};
+
+// Records of a type ("motion", "vibration") acknowledged since request
+// index first
+static std::vector<EventRecord> eventRecords(const char *type,
+                                             size_t first) {
+  std::string path = std::string("\"/sensors/") + type + "/";
+  std::vector<EventRecord> records;
+  const std::vector<StandInRequest> &requests = standIn::requests();
+  for (size_t i = first; i < requests.size(); i++) {
+    if (requests[i].errorCode != 0 || requests[i].answeredAt == 0) {
+      continue;
+    }
+    const char *cursor = requests[i].body.c_str();
+    while ((cursor = strstr(cursor, path.c_str())) != NULL) {
+      const char *edges = strstr(cursor, "\"edges\":");
+      const char *stamp = strstr(cursor, "\"timestamp\":");
+      TEST_ASSERT_NOT_NULL(edges);
+      TEST_ASSERT_NOT_NULL(stamp);
+      EventRecord record;
+      record.edges = strtoul(edges + strlen("\"edges\":"), NULL, 10);
+      record.detectedAt = (unsigned long)(
+          strtoull(stamp + strlen("\"timestamp\":"), NULL, 10) - EPOCH_MS);
+      record.ackedAt = requests[i].answeredAt;
+      records.push_back(record);
+      cursor = stamp;
+    }
+  }
+  return records;
+}
+
+static void edge(uint8_t pin) {
+  shimSetPin(pin, HIGH);
+  shimSetPin(pin, LOW);
+}
+
+void setUp() { shimSetSerialOutput(false); }
+
+void tearDown() { shimSetSerialOutput(true); }
+
+void test_single_edge_is_one_event() {
+  size_t first = standIn::requests().size();
+  unsigned long edgeAt = millis();
+  edge(PIR_SENSOR_PIN);
+  shimAdvanceMillis(SETTLE_MS);
+
+  std::vector<EventRecord> records = eventRecords("motion", first);
+  TEST_ASSERT_EQUAL(1, records.size());
+  TEST_ASSERT_EQUAL_UINT32(edgeAt, records[0].detectedAt);
+  TEST_ASSERT_EQUAL_UINT32(1, records[0].edges);
+}
+
+void test_suppressed_edges_flushed_without_next_edge() {
+  // One event, then four edges inside its debounce window and nothing
+  // after: they go out when the window ends, not with a later edge
+  size_t first = standIn::requests().size();
+  unsigned long eventAt = millis();
+  edge(PIR_SENSOR_PIN);
+  for (int i = 0; i < 4; i++) {
+    shimAdvanceMillis(500);
+    edge(PIR_SENSOR_PIN);
+  }
+  unsigned long lastEdgeAt = millis();
+  shimAdvanceMillis(SETTLE_MS);
+
+  std::vector<EventRecord> records = eventRecords("motion", first);
+  TEST_ASSERT_EQUAL(2, records.size());
+  TEST_ASSERT_EQUAL_UINT32(eventAt, records[0].detectedAt);
+  TEST_ASSERT_EQUAL_UINT32(1, records[0].edges);
+  TEST_ASSERT_EQUAL_UINT32(lastEdgeAt, records[1].detectedAt);
+  TEST_ASSERT_EQUAL_UINT32(4, records[1].edges);
+
+  // Queued at the window end, then flushed by CloudTask like any event
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(
+      eventAt + EVENT_DEBOUNCE_MS + ACK_BOUND_MS, records[1].ackedAt);
+}
+
+void test_windows_are_per_type() {
+  // Motion and vibration edges held back in overlapping windows are each
+  // flushed at the end of their own window
+  size_t first = standIn::requests().size();
+  unsigned long motionAt = millis();
+  edge(PIR_SENSOR_PIN);
+  shimAdvanceMillis(1000);
+  unsigned long vibrationAt = millis();
+  edge(VIBRATION_SENSOR_PIN);
+  shimAdvanceMillis(500);
+  edge(VIBRATION_SENSOR_PIN);
+  shimAdvanceMillis(500);
+  edge(PIR_SENSOR_PIN);
+  shimAdvanceMillis(SETTLE_MS);
+
+  std::vector<EventRecord> motion = eventRecords("motion", first);
+  std::vector<EventRecord> vibration = eventRecords("vibration", first);
+  TEST_ASSERT_EQUAL(2, motion.size());
+  TEST_ASSERT_EQUAL(2, vibration.size());
+  TEST_ASSERT_EQUAL_UINT32(motionAt + 2000, motion[1].detectedAt);
+  TEST_ASSERT_EQUAL_UINT32(1, motion[1].edges);
+  TEST_ASSERT_EQUAL_UINT32(vibrationAt + 500, vibration[1].detectedAt);
+  TEST_ASSERT_EQUAL_UINT32(1, vibration[1].edges);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(
+      motionAt + EVENT_DEBOUNCE_MS + ACK_BOUND_MS, motion[1].ackedAt);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(
+      vibrationAt + EVENT_DEBOUNCE_MS + ACK_BOUND_MS, vibration[1].ackedAt);
+}
+
+int main(int argc, char **argv) {
+  // Boot the firmware once, wait for the link and the clock
+  shimSetSerialOutput(false);
+  standIn::reset(ROUND_TRIP_MS);
+  shimWiFiSetInRange(PRIMARY_WIFI_SSID, true);
+  shimStartScheduling();
+  setup();
+  shimAdvanceMillis(1000);
+  shimSntpSync(EPOCH_MS + millis());
+  shimAdvanceMillis(10000);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_single_edge_is_one_event);
+  RUN_TEST(test_suppressed_edges_flushed_without_next_edge);
+  RUN_TEST(test_windows_are_per_type);
+  return UNITY_END();
+}
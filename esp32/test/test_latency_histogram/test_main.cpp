@@ -0,0 +1,96 @@
+// LatencyHistogram buckets, percentiles and summary values
+
+#include <unity.h>
+
+#include "LatencyHistogram.h"
+
+static LatencyHistogram histogram;
+
+void setUp() { histogram.reset(); }
+
+void tearDown() {}
+
+void test_empty_histogram() {
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.getCount());
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.getMax());
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.getMean());
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.getPercentile(0.5f));
+  TEST_ASSERT_EQUAL(0, histogram.getUsedBuckets());
+}
+
+void test_bucket_bounds() {
+  // Bucket 0 holds zeros, bucket i holds [2^(i-1), 2^i)
+  histogram.add(0);
+  histogram.add(1);
+  histogram.add(2);
+  histogram.add(3);
+  histogram.add(4);
+  histogram.add(1023);
+  histogram.add(1024);
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getBucket(0));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getBucket(1));
+  TEST_ASSERT_EQUAL_UINT32(2, histogram.getBucket(2));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getBucket(3));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getBucket(10));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getBucket(11));
+  TEST_ASSERT_EQUAL(12, histogram.getUsedBuckets());
+
+  TEST_ASSERT_EQUAL_UINT32(0, LatencyHistogram::bucketFloor(0));
+  TEST_ASSERT_EQUAL_UINT32(1, LatencyHistogram::bucketFloor(1));
+  TEST_ASSERT_EQUAL_UINT32(1024, LatencyHistogram::bucketFloor(11));
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.getBucket(LATENCY_HISTOGRAM_BUCKETS));
+}
+
+void test_largest_values_go_to_last_bucket() {
+  // Bucket 31 holds [2^30, 2^31) and everything above
+  histogram.add(UINT32_MAX);
+  histogram.add(0x40000000UL);
+  histogram.add(0x20000000UL);
+  TEST_ASSERT_EQUAL_UINT32(2, histogram.getBucket(31));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getBucket(30));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, histogram.getMax());
+
+  // The sum is 64-bit, the mean does not wrap
+  TEST_ASSERT_EQUAL_UINT32((UINT32_MAX + 0x40000000ULL + 0x20000000ULL) / 3,
+                           histogram.getMean());
+}
+
+void test_percentiles_are_bucket_upper_bounds() {
+  // 90 fast samples (100-109), 10 slow ones (5000)
+  for (int i = 0; i < 90; i++) {
+    histogram.add(100 + i % 10);
+  }
+  for (int i = 0; i < 10; i++) {
+    histogram.add(5000);
+  }
+  TEST_ASSERT_EQUAL_UINT32(100, histogram.getCount());
+  TEST_ASSERT_EQUAL_UINT32(127, histogram.getPercentile(0.5f));
+  TEST_ASSERT_EQUAL_UINT32(5000, histogram.getPercentile(0.9f));
+  TEST_ASSERT_EQUAL_UINT32(127, histogram.getPercentile(0.89f));
+
+  // Never above the largest sample
+  TEST_ASSERT_EQUAL_UINT32(5000, histogram.getPercentile(0.99f));
+  TEST_ASSERT_EQUAL_UINT32(5000, histogram.getPercentile(1.0f));
+  TEST_ASSERT_EQUAL_UINT32((90 * 1045 / 10 + 10 * 5000) / 100,
+                           histogram.getMean());
+}
+
+void test_reset_clears_everything() {
+  for (uint32_t v = 1; v < 100000; v *= 3) {
+    histogram.add(v);
+  }
+  histogram.reset();
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.getCount());
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.getMax());
+  TEST_ASSERT_EQUAL(0, histogram.getUsedBuckets());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_histogram);
+  RUN_TEST(test_bucket_bounds);
+  RUN_TEST(test_largest_values_go_to_last_bucket);
+  RUN_TEST(test_percentiles_are_bucket_upper_bounds);
+  RUN_TEST(test_reset_clears_everything);
+  return UNITY_END();
+}
@@ -0,0 +1,200 @@
+// LcdFrame composition and diffing, and the I2C traffic of a minute of
+// status updates: clear-and-redraw against sending only changed cells
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "LcdFrame.h"
+
+// As in DisplayManager: I2C bytes per LCD write through the PCF8574
+#define LCD_I2C_BYTES_PER_WRITE 12
+
+static LcdFrame frame;
+static LcdFrame shown;
+static LcdRun runs[LCD_MAX_RUNS];
+
+// Copy the cells of the runs to the shown frame, like DisplayManager
+static void apply(const LcdFrame &next, LcdFrame &display,
+                  const LcdRun *list, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    for (uint8_t c = list[i].col; c < list[i].col + list[i].length; c++) {
+      display.setChar(list[i].row, c, next.get(list[i].row, c));
+    }
+  }
+}
+
+static bool sameFrame(const LcdFrame &a, const LcdFrame &b) {
+  for (uint8_t r = 0; r < LCD_ROWS; r++) {
+    for (uint8_t c = 0; c < LCD_COLS; c++) {
+      if (a.get(r, c) != b.get(r, c)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Status screen as DisplayManager composes it; returns the LCD writes
+// the former clear-and-redraw needed for it (clear, then per row a
+// cursor move and the row's text)
+static uint16_t composeStatus(LcdFrame &out, const char *ssid,
+                              const char *ip, bool firebaseReady,
+                              unsigned long syncAgoS) {
+  char rows[LCD_ROWS][LCD_COLS + 1];
+  snprintf(rows[0], sizeof(rows[0]), "%c %s", 0, ssid);
+  snprintf(rows[1], sizeof(rows[1]), "%c %s", 1, ip);
+  snprintf(rows[2], sizeof(rows[2]), "%c Firebase:%s", 2,
+           firebaseReady ? "OK" : "NO");
+  if (syncAgoS == 0) {
+    snprintf(rows[3], sizeof(rows[3]), "%c Sync:Just now", 3);
+  } else {
+    snprintf(rows[3], sizeof(rows[3]), "%c Sync:%lus ago", 3, syncAgoS);
+  }
+
+  uint16_t redrawWrites = 1;
+  out.clear();
+  for (uint8_t r = 0; r < LCD_ROWS; r++) {
+    // The icon is char 0-3, so print it separately from the text
+    out.setChar(r, 0, rows[r][0]);
+    out.print(r, 1, rows[r] + 1);
+    redrawWrites += 1 + strlen(rows[r] + 1) + 1;
+  }
+  return redrawWrites;
+}
+
+void setUp() {
+  frame.clear();
+  shown.clear();
+}
+
+void tearDown() {}
+
+void test_print_truncates_at_row_end() {
+  TEST_ASSERT_EQUAL(5, frame.print(0, 2, "abc"));
+  TEST_ASSERT_EQUAL('a', frame.get(0, 2));
+  TEST_ASSERT_EQUAL(' ', frame.get(0, 5));
+
+  TEST_ASSERT_EQUAL(LCD_COLS, frame.print(1, 15, "a long network name"));
+  TEST_ASSERT_EQUAL('n', frame.get(1, LCD_COLS - 1));
+  TEST_ASSERT_EQUAL(' ', frame.get(2, 0));
+
+  // Out of range writes are ignored, reads are blanks
+  frame.setChar(LCD_ROWS, 0, 'x');
+  frame.setChar(0, LCD_COLS, 'x');
+  TEST_ASSERT_EQUAL(3, frame.print(LCD_ROWS, 3, "x"));
+  TEST_ASSERT_EQUAL(' ', frame.get(LCD_ROWS, 0));
+}
+
+void test_identical_frames_send_nothing() {
+  frame.print(0, 0, "same");
+  shown.print(0, 0, "same");
+  TEST_ASSERT_EQUAL(0, frame.diff(shown, runs, LCD_MAX_RUNS));
+  TEST_ASSERT_EQUAL(0, LcdFrame::writeCount(runs, 0));
+}
+
+void test_single_cell_change() {
+  frame.setChar(2, 7, '9');
+  TEST_ASSERT_EQUAL(1, frame.diff(shown, runs, LCD_MAX_RUNS));
+  TEST_ASSERT_EQUAL(2, runs[0].row);
+  TEST_ASSERT_EQUAL(7, runs[0].col);
+  TEST_ASSERT_EQUAL(1, runs[0].length);
+  TEST_ASSERT_EQUAL(2, LcdFrame::writeCount(runs, 1));
+}
+
+void test_short_gaps_are_merged() {
+  // One unchanged cell between changes: rewriting it is as cheap as a
+  // cursor move
+  frame.setChar(0, 3, 'a');
+  frame.setChar(0, 5, 'b');
+  // Two unchanged cells: separate runs
+  frame.setChar(0, 10, 'c');
+  frame.setChar(0, 13, 'd');
+  uint8_t count = frame.diff(shown, runs, LCD_MAX_RUNS);
+  TEST_ASSERT_EQUAL(3, count);
+  TEST_ASSERT_EQUAL(3, runs[0].col);
+  TEST_ASSERT_EQUAL(3, runs[0].length);
+  TEST_ASSERT_EQUAL(10, runs[1].col);
+  TEST_ASSERT_EQUAL(1, runs[1].length);
+  TEST_ASSERT_EQUAL(13, runs[2].col);
+  TEST_ASSERT_EQUAL(4 + 2 + 2, LcdFrame::writeCount(runs, count));
+}
+
+void test_runs_do_not_cross_rows() {
+  frame.setChar(0, LCD_COLS - 1, 'a');
+  frame.setChar(1, 0, 'b');
+  TEST_ASSERT_EQUAL(2, frame.diff(shown, runs, LCD_MAX_RUNS));
+  TEST_ASSERT_EQUAL(0, runs[0].row);
+  TEST_ASSERT_EQUAL(1, runs[1].row);
+}
+
+void test_run_limit_leaves_rest_for_next_diff() {
+  // Every other cell changes on each row: one merged run per row
+  for (uint8_t r = 0; r < LCD_ROWS; r++) {
+    for (uint8_t c = 0; c < LCD_COLS; c += 2) {
+      frame.setChar(r, c, 'x');
+    }
+  }
+  uint8_t count = frame.diff(shown, runs, 2);
+  TEST_ASSERT_EQUAL(2, count);
+  apply(frame, shown, runs, count);
+  TEST_ASSERT_FALSE(sameFrame(frame, shown));
+
+  count = frame.diff(shown, runs, LCD_MAX_RUNS);
+  TEST_ASSERT_EQUAL(2, count);
+  TEST_ASSERT_EQUAL(2, runs[0].row);
+  apply(frame, shown, runs, count);
+  TEST_ASSERT_TRUE(sameFrame(frame, shown));
+}
+
+void test_worst_case_fits_run_array() {
+  // Changes two cells apart give the most runs
+  for (uint8_t r = 0; r < LCD_ROWS; r++) {
+    for (uint8_t c = 0; c < LCD_COLS; c += 3) {
+      frame.setChar(r, c, 'x');
+    }
+  }
+  uint8_t count = frame.diff(shown, runs, LCD_MAX_RUNS);
+  TEST_ASSERT_LESS_OR_EQUAL(LCD_MAX_RUNS, count);
+  apply(frame, shown, runs, count);
+  TEST_ASSERT_TRUE(sameFrame(frame, shown));
+}
+
+void test_status_updates_i2c_bytes() {
+  // A minute of updates every 500 ms, last sync 0-59 s ago
+  uint32_t redrawBytes = 0;
+  uint32_t diffBytes = 0;
+  int updates = 0;
+  for (int step = 0; step < 120; step++) {
+    uint16_t redrawWrites =
+        composeStatus(frame, "HomeNetwork", "192.168.1.42", true, step / 2);
+    uint8_t count = frame.diff(shown, runs, LCD_MAX_RUNS);
+    apply(frame, shown, runs, count);
+    TEST_ASSERT_TRUE(sameFrame(frame, shown));
+
+    // The first frame is a full draw either way
+    if (step > 0) {
+      redrawBytes += redrawWrites * LCD_I2C_BYTES_PER_WRITE;
+      diffBytes +=
+          LcdFrame::writeCount(runs, count) * LCD_I2C_BYTES_PER_WRITE;
+      updates++;
+    }
+  }
+
+  ::printf("I2C bytes per update: %.0f clear-and-redraw, %.1f diffed\n",
+           (double)redrawBytes / updates, (double)diffBytes / updates);
+  TEST_ASSERT_LESS_OR_EQUAL(redrawBytes / 20, diffBytes);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_print_truncates_at_row_end);
+  RUN_TEST(test_identical_frames_send_nothing);
+  RUN_TEST(test_single_cell_change);
+  RUN_TEST(test_short_gaps_are_merged);
+  RUN_TEST(test_runs_do_not_cross_rows);
+  RUN_TEST(test_run_limit_leaves_rest_for_next_diff);
+  RUN_TEST(test_worst_case_fits_run_array);
+  RUN_TEST(test_status_updates_i2c_bytes);
+  return UNITY_END();
+}
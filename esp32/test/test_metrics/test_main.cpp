@@ -0,0 +1,163 @@
+// Metrics collection (device id, queue peaks, registration limits) and
+// the /metrics/<device> record uploaded from a snapshot
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <string>
+#include <unity.h>
+
+#include "FirebaseManager.h"
+#include "Metrics.h"
+#include "SpscRing.h"
+
+static Metrics *metrics;
+
+static bool contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+
+void setUp() {
+  shimSetSerialOutput(false);
+  shimSetMillis(5000);
+  metrics = new Metrics();
+  metrics->begin();
+}
+
+void tearDown() {
+  delete metrics;
+  shimSetSerialOutput(true);
+}
+
+void test_device_id_from_mac() {
+  TEST_ASSERT_EQUAL_STRING("esp32-aabbccddeeff", metrics->getDeviceId());
+  TEST_ASSERT_EQUAL(METRICS_DEVICE_ID_LENGTH,
+                    strlen(metrics->getDeviceId()));
+}
+
+void test_heap_and_tasks() {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  metrics->addTask("SensorTask", task, 4096);
+  metrics->addTask("Missing", NULL, 4096);
+
+  MetricsSnapshot snapshot;
+  metrics->collect(snapshot);
+  TEST_ASSERT_EQUAL_UINT32(5000, snapshot.uptimeMs);
+  TEST_ASSERT_EQUAL_UINT32(180000, snapshot.freeHeap);
+  TEST_ASSERT_EQUAL_UINT32(150000, snapshot.minFreeHeap);
+  TEST_ASSERT_EQUAL_UINT32(110000, snapshot.largestFreeBlock);
+  TEST_ASSERT_EQUAL(1, snapshot.taskCount);
+  TEST_ASSERT_EQUAL_STRING("SensorTask", snapshot.tasks[0].name);
+  TEST_ASSERT_EQUAL_UINT32(4096, snapshot.tasks[0].stackSize);
+
+  // No runtime stats on the host
+  TEST_ASSERT_EQUAL(-1, snapshot.tasks[0].cpuPermille);
+}
+
+void test_queue_peak_between_collections() {
+  QueueHandle_t queue = xQueueCreate(8, sizeof(int));
+  metrics->addQueue("eventQueue", queue, 8);
+
+  int item = 0;
+  for (int i = 0; i < 5; i++) {
+    xQueueSend(queue, &item, 0);
+  }
+  metrics->sample();
+  for (int i = 0; i < 4; i++) {
+    xQueueReceive(queue, &item, 0);
+  }
+  metrics->sample();
+
+  MetricsSnapshot snapshot;
+  metrics->collect(snapshot);
+  TEST_ASSERT_EQUAL(1, snapshot.queueCount);
+  TEST_ASSERT_EQUAL_STRING("eventQueue", snapshot.queues[0].name);
+  TEST_ASSERT_EQUAL(8, snapshot.queues[0].capacity);
+  TEST_ASSERT_EQUAL(1, snapshot.queues[0].depth);
+  TEST_ASSERT_EQUAL(5, snapshot.queues[0].peak);
+
+  // The next interval starts from the current depth
+  metrics->collect(snapshot);
+  TEST_ASSERT_EQUAL(1, snapshot.queues[0].peak);
+}
+
+void test_ring_depth() {
+  static int storage[16];
+  SpscRing ring(storage, sizeof(int), 16);
+  metrics->addRing("sensorRing", &ring);
+
+  int item = 7;
+  for (int i = 0; i < 3; i++) {
+    ring.push(&item);
+  }
+  metrics->sample();
+  ring.pop(&item);
+
+  MetricsSnapshot snapshot;
+  metrics->collect(snapshot);
+  TEST_ASSERT_EQUAL(16, snapshot.queues[0].capacity);
+  TEST_ASSERT_EQUAL(2, snapshot.queues[0].depth);
+  TEST_ASSERT_EQUAL(3, snapshot.queues[0].peak);
+}
+
+void test_registration_limits() {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  for (int i = 0; i < METRICS_MAX_TASKS + 2; i++) {
+    metrics->addTask("task", task, 1024);
+  }
+  QueueHandle_t queue = xQueueCreate(1, 1);
+  for (int i = 0; i < METRICS_MAX_QUEUES + 2; i++) {
+    metrics->addQueue("queue", queue, 1);
+  }
+  metrics->addQueue("null", NULL, 1);
+  metrics->addRing("null", NULL);
+
+  MetricsSnapshot snapshot;
+  metrics->collect(snapshot);
+  TEST_ASSERT_EQUAL(METRICS_MAX_TASKS, snapshot.taskCount);
+  TEST_ASSERT_EQUAL(METRICS_MAX_QUEUES, snapshot.queueCount);
+}
+
+void test_metrics_upload_record() {
+  standIn::reset(100);
+  FirebaseManager manager("metrics.firebaseio.test", "token");
+  manager.begin();
+
+  // Some upload history for the histograms
+  unsigned long lastSync = 0;
+  EventData event(MOTION, 4000);
+  TEST_ASSERT_TRUE(manager.uploadBatch(NULL, &event, 1, lastSync));
+  shimAdvanceMillis(100);
+  manager.loop();
+
+  metrics->addTask("CloudTask", xTaskGetCurrentTaskHandle(), 8192);
+  QueueHandle_t queue = xQueueCreate(4, sizeof(int));
+  metrics->addQueue("eventQueue", queue, 4);
+  MetricsSnapshot snapshot;
+  metrics->collect(snapshot);
+  snapshot.droppedPackets = 3;
+  TEST_ASSERT_TRUE(manager.uploadMetrics(snapshot, metrics->getDeviceId()));
+
+  std::string body = standIn::requests().back().body;
+  TEST_ASSERT_TRUE(standIn::isValidJson(body.c_str()));
+  TEST_ASSERT_TRUE(contains(body, "{\"/metrics/esp32-aabbccddeeff\":{"));
+  TEST_ASSERT_TRUE(contains(body, "\"heap\":{\"free\":180000,"
+                                  "\"minFree\":150000,"
+                                  "\"largestBlock\":110000}"));
+  TEST_ASSERT_TRUE(contains(body, "\"CloudTask\":{\"stack\":8192,"));
+  TEST_ASSERT_TRUE(contains(body, "\"eventQueue\":{\"capacity\":4,"
+                                  "\"depth\":0,\"peak\":0}"));
+  TEST_ASSERT_TRUE(contains(body, "\"uploads\":{\"requests\":1,"));
+  TEST_ASSERT_TRUE(contains(body, "\"rtt\":{\"n\":1,\"mean\":100,"));
+  TEST_ASSERT_TRUE(contains(body, "\"dropped\":3"));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_device_id_from_mac);
+  RUN_TEST(test_heap_and_tasks);
+  RUN_TEST(test_queue_peak_between_collections);
+  RUN_TEST(test_ring_depth);
+  RUN_TEST(test_registration_limits);
+  RUN_TEST(test_metrics_upload_record);
+  return UNITY_END();
+}
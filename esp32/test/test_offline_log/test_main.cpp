@@ -0,0 +1,353 @@
+// OfflineLog on a host directory standing in for LittleFS. A "reboot" is
+// a new OfflineLog over the same files; power loss is simulated by
+// cutting writes short (shimFsLimitWrites).
+
+#include <Arduino.h>
+#include <FS.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <unity.h>
+
+#include "FirebaseManager.h"
+#include "OfflineLog.h"
+
+#define LOG_DIR "/log"
+
+// Records of this size fill a segment with 63 records
+#define RECORD_SIZE 255
+
+static char root[] = "/tmp/offline-log-XXXXXX";
+static fs::FS *flash;
+static OfflineLog *offlineLog;
+
+// Reopen the log over the files on flash, as after a reboot
+static void reboot() {
+  delete offlineLog;
+  offlineLog = new OfflineLog(LOG_DIR);
+  TEST_ASSERT_TRUE(offlineLog->begin(*flash));
+}
+
+static bool appendRecord(uint32_t index, uint8_t length = sizeof(uint32_t)) {
+  uint8_t payload[OFFLINE_LOG_MAX_PAYLOAD];
+  memset(payload, index & 0xFF, sizeof(payload));
+  memcpy(payload, &index, sizeof(index));
+  return offlineLog->append(payload, length);
+}
+
+// Read the next record's index (-1 if none left)
+static long readRecord() {
+  uint8_t payload[OFFLINE_LOG_MAX_PAYLOAD];
+  int length = offlineLog->read(payload, sizeof(payload));
+  if (length < 0) {
+    return -1;
+  }
+  uint32_t index;
+  memcpy(&index, payload, sizeof(index));
+  return index;
+}
+
+static int segmentCount() {
+  int count = 0;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(std::string(root) + LOG_DIR)) {
+    if (entry.path().extension() == ".bin") {
+      count++;
+    }
+  }
+  return count;
+}
+
+void setUp() {
+  shimSetSerialOutput(false);
+  strcpy(root, "/tmp/offline-log-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+  flash = new fs::FS(root);
+  offlineLog = NULL;
+  reboot();
+}
+
+void tearDown() {
+  shimFsLimitWrites(-1);
+  delete offlineLog;
+  delete flash;
+  std::filesystem::remove_all(root);
+  shimSetSerialOutput(true);
+}
+
+void test_records_read_back_in_order() {
+  TEST_ASSERT_TRUE(offlineLog->isEmpty());
+  for (uint32_t i = 0; i < 10; i++) {
+    TEST_ASSERT_TRUE(appendRecord(i));
+  }
+  TEST_ASSERT_FALSE(offlineLog->isEmpty());
+  for (long i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL(i, readRecord());
+  }
+  TEST_ASSERT_EQUAL(-1, readRecord());
+  offlineLog->commit();
+  TEST_ASSERT_TRUE(offlineLog->isEmpty());
+}
+
+void test_reading_does_not_seal_the_write_segment() {
+  // Interleaved appends and reads stay in one segment
+  for (uint32_t i = 0; i < 20; i++) {
+    TEST_ASSERT_TRUE(appendRecord(i));
+    TEST_ASSERT_EQUAL(i, readRecord());
+    TEST_ASSERT_EQUAL(-1, readRecord());
+  }
+  TEST_ASSERT_EQUAL(1, segmentCount());
+}
+
+void test_reader_follows_the_writer_across_segments() {
+  // The reader's handle on the write segment goes stale when the writer
+  // moves on; no record may be skipped
+  TEST_ASSERT_TRUE(appendRecord(0, RECORD_SIZE));
+  TEST_ASSERT_EQUAL(0, readRecord());
+  for (uint32_t i = 1; i < 150; i++) {
+    TEST_ASSERT_TRUE(appendRecord(i, RECORD_SIZE));
+  }
+  TEST_ASSERT_EQUAL(3, segmentCount());
+  for (long i = 1; i < 150; i++) {
+    TEST_ASSERT_EQUAL(i, readRecord());
+  }
+  TEST_ASSERT_EQUAL(-1, readRecord());
+}
+
+void test_rewind_returns_to_committed_position() {
+  for (uint32_t i = 0; i < 6; i++) {
+    appendRecord(i);
+  }
+  readRecord();
+  readRecord();
+  offlineLog->commit();
+  TEST_ASSERT_EQUAL(2, readRecord());
+  TEST_ASSERT_EQUAL(3, readRecord());
+  offlineLog->rewind();
+  TEST_ASSERT_EQUAL(2, readRecord());
+}
+
+void test_uncommitted_reads_survive_reboot() {
+  for (uint32_t i = 0; i < 6; i++) {
+    appendRecord(i);
+  }
+  readRecord();
+  offlineLog->commit();
+  readRecord();
+  readRecord();
+
+  // Read but never acknowledged: read again after the reboot
+  reboot();
+  TEST_ASSERT_EQUAL(1, readRecord());
+}
+
+void test_commit_of_an_earlier_position() {
+  for (uint32_t i = 0; i < 6; i++) {
+    appendRecord(i);
+  }
+  readRecord();
+  readRecord();
+  OfflineLogPosition acknowledged = offlineLog->getReadPosition();
+  readRecord();
+  readRecord();
+  offlineLog->commit(acknowledged);
+
+  reboot();
+  TEST_ASSERT_EQUAL(2, readRecord());
+}
+
+void test_torn_cursor_write_keeps_previous_cursor() {
+  for (uint32_t i = 0; i < 6; i++) {
+    appendRecord(i);
+  }
+  readRecord();
+  readRecord();
+  offlineLog->commit();
+
+  // Power lost while the next cursor is written
+  readRecord();
+  shimFsLimitWrites(5);
+  offlineLog->commit();
+  shimFsLimitWrites(-1);
+
+  reboot();
+  TEST_ASSERT_EQUAL(2, readRecord());
+}
+
+void test_torn_record_is_skipped() {
+  appendRecord(0);
+  shimFsLimitWrites(3);
+  TEST_ASSERT_FALSE(appendRecord(1));
+  shimFsLimitWrites(-1);
+  TEST_ASSERT_TRUE(appendRecord(2));
+
+  TEST_ASSERT_EQUAL(0, readRecord());
+  TEST_ASSERT_EQUAL(2, readRecord());
+  TEST_ASSERT_EQUAL(-1, readRecord());
+
+  // Same after a reboot
+  reboot();
+  TEST_ASSERT_EQUAL(0, readRecord());
+  TEST_ASSERT_EQUAL(2, readRecord());
+  TEST_ASSERT_EQUAL(-1, readRecord());
+}
+
+void test_full_ring_drops_oldest_segment() {
+  uint32_t count = 63 * (OFFLINE_LOG_MAX_SEGMENTS + 2);
+  for (uint32_t i = 0; i < count; i++) {
+    TEST_ASSERT_TRUE(appendRecord(i, RECORD_SIZE));
+  }
+  TEST_ASSERT_EQUAL(OFFLINE_LOG_MAX_SEGMENTS, segmentCount());
+  TEST_ASSERT_GREATER_THAN_UINT32(0, offlineLog->getDroppedSegments());
+
+  // Reading resumes at the oldest record left, in order up to the newest
+  long first = readRecord();
+  TEST_ASSERT_GREATER_THAN(0, first);
+  long last = first;
+  long next;
+  while ((next = readRecord()) >= 0) {
+    TEST_ASSERT_EQUAL(last + 1, next);
+    last = next;
+  }
+  TEST_ASSERT_EQUAL(count - 1, last);
+}
+
+void test_foreign_records_are_skipped() {
+  // Records longer than the reader's buffer (older firmware) are skipped
+  appendRecord(0, 64);
+  appendRecord(1, 8);
+  uint8_t payload[16];
+  TEST_ASSERT_EQUAL(8, offlineLog->read(payload, sizeof(payload)));
+  TEST_ASSERT_EQUAL(-1, offlineLog->read(payload, sizeof(payload)));
+}
+
+// Drain both logs through FirebaseManager as CloudTask does, with the
+// Firebase stand-in answering after 500 ms
+static void drainEvents(FirebaseManager &manager, OfflineLog &sensorLog,
+                        OfflineLog &eventLog, unsigned long &lastSync) {
+  EventData events[MAX_EVENTS_PER_UPLOAD];
+  int count = 0;
+  while (count < MAX_EVENTS_PER_UPLOAD &&
+         eventLog.read(&events[count], sizeof(EventData)) ==
+             sizeof(EventData)) {
+    count++;
+  }
+  TEST_ASSERT_GREATER_THAN(0, count);
+  TEST_ASSERT_TRUE(manager.uploadBatch(NULL, events, count, lastSync, true));
+}
+
+void test_records_know_their_boot() {
+  // Records of the previous boot come first, then those of this one
+  appendRecord(1);
+  appendRecord(2);
+  reboot();
+  appendRecord(3);
+
+  TEST_ASSERT_EQUAL(1, readRecord());
+  TEST_ASSERT_FALSE(offlineLog->isReadFromThisBoot());
+  TEST_ASSERT_EQUAL(2, readRecord());
+  TEST_ASSERT_FALSE(offlineLog->isReadFromThisBoot());
+  TEST_ASSERT_EQUAL(3, readRecord());
+  TEST_ASSERT_TRUE(offlineLog->isReadFromThisBoot());
+
+  // After another reboot none of them is
+  offlineLog->rewind();
+  reboot();
+  TEST_ASSERT_EQUAL(1, readRecord());
+  TEST_ASSERT_EQUAL(2, readRecord());
+  TEST_ASSERT_EQUAL(3, readRecord());
+  TEST_ASSERT_FALSE(offlineLog->isReadFromThisBoot());
+}
+
+void test_drained_records_committed_on_ack_only() {
+  OfflineLog sensorLog("/sensors");
+  OfflineLog eventLog("/events");
+  TEST_ASSERT_TRUE(sensorLog.begin(*flash));
+  TEST_ASSERT_TRUE(eventLog.begin(*flash));
+  for (int i = 0; i < 3; i++) {
+    EventData event(MOTION, 1000 + i);
+    TEST_ASSERT_TRUE(eventLog.append(&event, sizeof(event)));
+  }
+
+  shimSetMillis(5000);
+  standIn::reset(500);
+  FirebaseManager manager("test.firebaseio.test", "token");
+  manager.begin();
+  manager.setOfflineLogs(&sensorLog, &eventLog);
+  unsigned long lastSync = 0;
+  drainEvents(manager, sensorLog, eventLog, lastSync);
+  TEST_ASSERT_TRUE(manager.isDrainPending());
+
+  // Queued but not acknowledged: after a reboot now the events are read
+  // again
+  EventData event;
+  OfflineLog rebooted("/events");
+  TEST_ASSERT_TRUE(rebooted.begin(*flash));
+  TEST_ASSERT_EQUAL(sizeof(EventData), rebooted.read(&event, sizeof(event)));
+  TEST_ASSERT_EQUAL_UINT32(1000, event.timestamp);
+
+  shimAdvanceMillis(500);
+  manager.loop();
+  TEST_ASSERT_FALSE(manager.isDrainPending());
+  TEST_ASSERT_TRUE(eventLog.isEmpty());
+  OfflineLog acknowledged("/events");
+  TEST_ASSERT_TRUE(acknowledged.begin(*flash));
+  TEST_ASSERT_EQUAL(-1, acknowledged.read(&event, sizeof(event)));
+}
+
+void test_given_up_drain_is_read_again() {
+  OfflineLog sensorLog("/sensors");
+  OfflineLog eventLog("/events");
+  TEST_ASSERT_TRUE(sensorLog.begin(*flash));
+  TEST_ASSERT_TRUE(eventLog.begin(*flash));
+  EventData event(VIBRATION, 1000);
+  TEST_ASSERT_TRUE(eventLog.append(&event, sizeof(event)));
+
+  // Every attempt of the drain fails with a server error until its budget
+  // is used up. Other uploads get through in between, so the circuit
+  // stays closed (an outage never uses the budget up).
+  shimSetMillis(5000);
+  standIn::reset(0);
+  FirebaseManager manager("test.firebaseio.test", "token");
+  manager.begin();
+  manager.setOfflineLogs(&sensorLog, &eventLog);
+  unsigned long lastSync = 0;
+  standIn::failNext(503, 1);
+  drainEvents(manager, sensorLog, eventLog, lastSync);
+  MetricsSnapshot snapshot = {};
+  for (int i = 0; i < 20000 && manager.isDrainPending(); i++) {
+    uint32_t failures = manager.getFailureCount();
+    standIn::failNext(503, 1);
+    shimAdvanceMillis(100);
+    manager.loop();
+    if (manager.getFailureCount() != failures) {
+      standIn::failNext(0, 0);
+      TEST_ASSERT_TRUE(manager.uploadMetrics(snapshot, "device"));
+      manager.loop();
+    }
+  }
+  TEST_ASSERT_FALSE(manager.isDrainPending());
+  TEST_ASSERT_EQUAL_UINT32(1, manager.getAbandonedCount());
+
+  // The event is still there to be drained later
+  EventData again;
+  TEST_ASSERT_EQUAL(sizeof(EventData), eventLog.read(&again, sizeof(again)));
+  TEST_ASSERT_EQUAL(VIBRATION, again.type);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_read_back_in_order);
+  RUN_TEST(test_reading_does_not_seal_the_write_segment);
+  RUN_TEST(test_reader_follows_the_writer_across_segments);
+  RUN_TEST(test_rewind_returns_to_committed_position);
+  RUN_TEST(test_uncommitted_reads_survive_reboot);
+  RUN_TEST(test_commit_of_an_earlier_position);
+  RUN_TEST(test_torn_cursor_write_keeps_previous_cursor);
+  RUN_TEST(test_torn_record_is_skipped);
+  RUN_TEST(test_full_ring_drops_oldest_segment);
+  RUN_TEST(test_foreign_records_are_skipped);
+  RUN_TEST(test_records_know_their_boot);
+  RUN_TEST(test_drained_records_committed_on_ack_only);
+  RUN_TEST(test_given_up_drain_is_read_again);
+  return UNITY_END();
+}
@@ -0,0 +1,92 @@
+#include <Arduino.h>
+#include <string.h>
+#include <unity.h>
+
+#include "PushId.h"
+
+static const char PUSH_CHARS[] =
+    "-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz";
+
+// Decode the 8 timestamp characters of a push ID
+static unsigned long decodeTime(const char *id) {
+  unsigned long time = 0;
+  for (int i = 0; i < 8; i++) {
+    time = time * 64 + (strchr(PUSH_CHARS, id[i]) - PUSH_CHARS);
+  }
+  return time;
+}
+
+void setUp() { shimSetMillis(1760000000UL); }
+
+void tearDown() {}
+
+void test_id_format() {
+  char id[PUSH_ID_LENGTH + 1];
+  generatePushId(id);
+  TEST_ASSERT_EQUAL(PUSH_ID_LENGTH, strlen(id));
+  for (int i = 0; i < PUSH_ID_LENGTH; i++) {
+    TEST_ASSERT_NOT_NULL(strchr(PUSH_CHARS, id[i]));
+  }
+}
+
+void test_timestamp_prefix() {
+  char id[PUSH_ID_LENGTH + 1];
+  generatePushId(id);
+  TEST_ASSERT_EQUAL_UINT32(millis(), decodeTime(id));
+}
+
+void test_same_millisecond_ids_increase() {
+  // Enough keys to carry through the last random characters
+  char previous[PUSH_ID_LENGTH + 1];
+  char id[PUSH_ID_LENGTH + 1];
+  generatePushId(previous);
+  for (int i = 0; i < 5000; i++) {
+    generatePushId(id);
+    TEST_ASSERT_TRUE(strcmp(previous, id) < 0);
+    TEST_ASSERT_EQUAL_STRING_LEN(previous, id, 8);
+    strcpy(previous, id);
+  }
+}
+
+void test_later_ids_sort_after() {
+  char first[PUSH_ID_LENGTH + 1];
+  char second[PUSH_ID_LENGTH + 1];
+  generatePushId(first);
+  shimAdvanceMillis(1);
+  generatePushId(second);
+  TEST_ASSERT_TRUE(strcmp(first, second) < 0);
+  TEST_ASSERT_EQUAL_UINT32(decodeTime(first) + 1, decodeTime(second));
+}
+
+void test_batch_ids_increase() {
+  char ids[64][PUSH_ID_LENGTH + 1];
+  generatePushIds(ids, 64);
+  for (int k = 1; k < 64; k++) {
+    TEST_ASSERT_EQUAL(PUSH_ID_LENGTH, strlen(ids[k]));
+    TEST_ASSERT_EQUAL_STRING_LEN(ids[0], ids[k], 8);
+    TEST_ASSERT_TRUE(strcmp(ids[k - 1], ids[k]) < 0);
+  }
+
+  // The next key in the same millisecond continues after the batch
+  char next[PUSH_ID_LENGTH + 1];
+  generatePushId(next);
+  TEST_ASSERT_TRUE(strcmp(ids[63], next) < 0);
+}
+
+void test_empty_batch_writes_nothing() {
+  char ids[1][PUSH_ID_LENGTH + 1];
+  memset(ids, 'x', sizeof(ids));
+  generatePushIds(ids, 0);
+  TEST_ASSERT_EQUAL('x', ids[0][0]);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_id_format);
+  RUN_TEST(test_timestamp_prefix);
+  RUN_TEST(test_same_millisecond_ids_increase);
+  RUN_TEST(test_later_ids_sort_after);
+  RUN_TEST(test_batch_ids_increase);
+  RUN_TEST(test_empty_batch_writes_nothing);
+  return UNITY_END();
+}
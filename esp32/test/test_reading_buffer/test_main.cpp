@@ -0,0 +1,269 @@
+// ReadingBuffer merging (counts, sums, ranges, sound features) and an
+// hour-long stall of the consumer: memory stays bounded and every second
+// of the stall is still covered, at reduced resolution
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "ReadingBuffer.h"
+#include "WindowStats.h"
+
+// Readings per second during the stall runs
+#define STALL_PERIOD_MS 1000
+
+// Stall starts here (ms of uptime), one second after a window boundary
+#define STALL_START_MS 601000UL
+
+static ReadingBuffer *buffer;
+
+void setUp() { buffer = new ReadingBuffer(SUMMARY_WINDOW_MS); }
+
+void tearDown() { delete buffer; }
+
+// A reading at timestamp with every analog channel sampled and the DHT
+// values valid; channel values derive from the timestamp
+static SensorRecord reading(unsigned long timestamp) {
+  SensorData data;
+  data.timestamp = timestamp;
+  data.gasValue = (timestamp / 1000) % 4096;
+  data.lightValue = 2000;
+  data.soundValue = 100;
+  data.soundRms = 30;
+  data.soundPeak = 80;
+  data.analogSampled = (1 << ANALOG_CHANNEL_COUNT) - 1;
+  data.setTemperature(21.5f);
+  data.temperatureValid = 1;
+  data.setHumidity(40.0f);
+  data.humidityValid = 1;
+  SensorRecord record;
+  makeRecord(data, record);
+  return record;
+}
+
+// Push one reading per STALL_PERIOD_MS for durationMs without popping,
+// checking the bound after every push
+static void stall(unsigned long durationMs) {
+  for (unsigned long t = 0; t < durationMs; t += STALL_PERIOD_MS) {
+    buffer->push(reading(STALL_START_MS + t));
+    TEST_ASSERT_LESS_OR_EQUAL(READING_BUFFER_CAPACITY, buffer->count());
+  }
+}
+
+// Pop every record, checking that they cover the stall without a gap:
+// each record starts one period after the previous one ended. Returns
+// the number of records that span a window boundary.
+static int drainContiguous(unsigned long durationMs) {
+  unsigned long expectedStart = STALL_START_MS;
+  uint32_t readings = 0;
+  int crossings = 0;
+  while (!buffer->isEmpty()) {
+    const SensorRecord &record = buffer->front();
+    TEST_ASSERT_EQUAL_UINT32(expectedStart, record.data.timestamp);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(record.data.timestamp,
+                                        record.lastTimestamp);
+    TEST_ASSERT_EQUAL_UINT32(
+        record.data.timestamp + (record.readingCount - 1) * STALL_PERIOD_MS,
+        record.lastTimestamp);
+    if (record.data.timestamp / SUMMARY_WINDOW_MS !=
+        record.lastTimestamp / SUMMARY_WINDOW_MS) {
+      crossings++;
+    }
+    readings += record.readingCount;
+    expectedStart = record.lastTimestamp + STALL_PERIOD_MS;
+    buffer->pop();
+  }
+  TEST_ASSERT_EQUAL_UINT32(durationMs / STALL_PERIOD_MS, readings);
+  TEST_ASSERT_EQUAL_UINT32(STALL_START_MS + durationMs, expectedStart);
+  return crossings;
+}
+
+void test_make_record() {
+  SensorRecord record = reading(5000);
+  TEST_ASSERT_EQUAL(1, record.readingCount);
+  TEST_ASSERT_EQUAL_UINT32(5000, record.lastTimestamp);
+  TEST_ASSERT_EQUAL(1, record.count[ANALOG_GAS]);
+  TEST_ASSERT_EQUAL(5, record.sum[ANALOG_GAS]);
+  TEST_ASSERT_EQUAL(215, record.min[RECORD_TEMPERATURE]);
+  TEST_ASSERT_EQUAL(400, record.max[RECORD_HUMIDITY]);
+
+  // A channel not sampled holds its value but no sample
+  SensorData data;
+  data.timestamp = 100;
+  data.lightValue = 7;
+  makeRecord(data, record);
+  TEST_ASSERT_EQUAL(0, record.count[ANALOG_LIGHT]);
+  TEST_ASSERT_EQUAL(0, record.sum[ANALOG_LIGHT]);
+  TEST_ASSERT_EQUAL(0, record.count[RECORD_TEMPERATURE]);
+}
+
+void test_merge_keeps_exact_sums_and_ranges() {
+  SensorRecord record = reading(1000);
+  SensorRecord next = reading(2000);
+  next.data.lightValue = 0;
+  makeRecord(next.data, next);
+  SensorRecord third = reading(9000);
+  mergeRecords(record, next);
+  mergeRecords(record, third);
+
+  TEST_ASSERT_EQUAL(3, record.readingCount);
+  TEST_ASSERT_EQUAL_UINT32(1000, record.data.timestamp);
+  TEST_ASSERT_EQUAL_UINT32(9000, record.lastTimestamp);
+  TEST_ASSERT_EQUAL(3, record.count[ANALOG_GAS]);
+  TEST_ASSERT_EQUAL(1 + 2 + 9, record.sum[ANALOG_GAS]);
+  TEST_ASSERT_EQUAL(1, record.min[ANALOG_GAS]);
+  TEST_ASSERT_EQUAL(9, record.max[ANALOG_GAS]);
+  TEST_ASSERT_EQUAL(4, record.data.gasValue);
+
+  // The mean is rounded from the exact sum: 4000 / 3
+  TEST_ASSERT_EQUAL(0, record.min[ANALOG_LIGHT]);
+  TEST_ASSERT_EQUAL(2000, record.max[ANALOG_LIGHT]);
+  TEST_ASSERT_EQUAL(1333, record.data.lightValue);
+}
+
+void test_merge_sound_features() {
+  SensorRecord record = reading(1000);
+  SensorRecord loud = reading(2000);
+  loud.data.soundRms = 70;
+  loud.data.soundPeak = 300;
+  mergeRecords(record, loud);
+
+  // RMS from the summed energy: sqrt((30^2 + 70^2) / 2)
+  TEST_ASSERT_EQUAL(54, record.data.soundRms);
+  TEST_ASSERT_EQUAL(300, record.data.soundPeak);
+}
+
+void test_merge_skips_channels_without_samples() {
+  SensorRecord record = reading(1000);
+  SensorData data;
+  data.timestamp = 2000;
+  data.gasValue = 4000;
+  SensorRecord unsampled;
+  makeRecord(data, unsampled);
+  mergeRecords(record, unsampled);
+
+  TEST_ASSERT_EQUAL(2, record.readingCount);
+  TEST_ASSERT_EQUAL(1, record.count[ANALOG_GAS]);
+  TEST_ASSERT_EQUAL(1, record.data.gasValue);
+  TEST_ASSERT_EQUAL(1, record.count[RECORD_TEMPERATURE]);
+  TEST_ASSERT_EQUAL(215, record.data.temperatureTenths);
+}
+
+void test_fifo_below_capacity() {
+  for (int i = 0; i < READING_BUFFER_CAPACITY; i++) {
+    buffer->push(reading(1000 + i));
+  }
+  TEST_ASSERT_EQUAL(READING_BUFFER_CAPACITY, buffer->count());
+  TEST_ASSERT_EQUAL_UINT32(0, buffer->getMergeCount());
+  for (int i = 0; i < READING_BUFFER_CAPACITY; i++) {
+    TEST_ASSERT_EQUAL_UINT32(1000 + i, buffer->front().data.timestamp);
+    buffer->pop();
+  }
+  TEST_ASSERT_TRUE(buffer->isEmpty());
+
+  // Popping an empty buffer does nothing
+  buffer->pop();
+  TEST_ASSERT_EQUAL(0, buffer->count());
+}
+
+void test_full_buffer_merges_oldest_cheapest_pair() {
+  for (int i = 0; i < READING_BUFFER_CAPACITY + 1; i++) {
+    buffer->push(reading(1000 + i));
+  }
+  TEST_ASSERT_EQUAL(READING_BUFFER_CAPACITY, buffer->count());
+  TEST_ASSERT_EQUAL_UINT32(1, buffer->getMergeCount());
+  TEST_ASSERT_EQUAL_UINT32(READING_BUFFER_CAPACITY + 1,
+                           buffer->getReadingCount());
+
+  // All pairs cost the same, so the oldest went first
+  TEST_ASSERT_EQUAL(2, buffer->front().readingCount);
+  TEST_ASSERT_EQUAL_UINT32(1001, buffer->front().lastTimestamp);
+
+  // The next merge takes the next two single readings, not the merged
+  // record
+  buffer->push(reading(2000));
+  buffer->pop();
+  TEST_ASSERT_EQUAL(2, buffer->front().readingCount);
+  TEST_ASSERT_EQUAL_UINT32(1002, buffer->front().data.timestamp);
+}
+
+void test_merges_stay_within_windows() {
+  // Two windows' worth: records on both sides of the boundary, the pair
+  // across it is never the one merged
+  for (int i = 0; i < 2 * READING_BUFFER_CAPACITY; i++) {
+    buffer->push(reading(SUMMARY_WINDOW_MS - 32000 + i * 500));
+  }
+  int crossings = 0;
+  while (!buffer->isEmpty()) {
+    const SensorRecord &record = buffer->front();
+    if (record.data.timestamp / SUMMARY_WINDOW_MS !=
+        record.lastTimestamp / SUMMARY_WINDOW_MS) {
+      crossings++;
+    }
+    buffer->pop();
+  }
+  TEST_ASSERT_EQUAL(0, crossings);
+}
+
+void test_hour_stall_bounded_and_covered() {
+  // A stalled consumer for an hour: 3600 readings into 64 records, one
+  // per window at worst, none lost and none spanning two windows
+  stall(3600000);
+  TEST_ASSERT_EQUAL(READING_BUFFER_CAPACITY, buffer->count());
+  TEST_ASSERT_EQUAL_UINT32(3600, buffer->getReadingCount());
+  TEST_ASSERT_EQUAL_UINT32(3600 - READING_BUFFER_CAPACITY,
+                           buffer->getMergeCount());
+  TEST_ASSERT_EQUAL(0, drainContiguous(3600000));
+
+  // All of it in the fixed record array, nothing allocated
+  TEST_ASSERT_LESS_OR_EQUAL(
+      READING_BUFFER_CAPACITY * sizeof(SensorRecord) + 32,
+      sizeof(ReadingBuffer));
+}
+
+void test_hour_stall_keeps_exact_window_sums() {
+  // The window sums of the gas channel come out as without the stall
+  // (the stall touches 61 windows, the first and last partly)
+  const unsigned long firstWindow = STALL_START_MS / SUMMARY_WINDOW_MS;
+  stall(3600000);
+  int32_t sums[61] = {0};
+  while (!buffer->isEmpty()) {
+    const SensorRecord &record = buffer->front();
+    sums[record.data.timestamp / SUMMARY_WINDOW_MS - firstWindow] +=
+        record.sum[ANALOG_GAS];
+    buffer->pop();
+  }
+  int32_t expected[61] = {0};
+  for (unsigned long t = 0; t < 3600000; t += STALL_PERIOD_MS) {
+    unsigned long timestamp = STALL_START_MS + t;
+    expected[timestamp / SUMMARY_WINDOW_MS - firstWindow] +=
+        (timestamp / 1000) % 4096;
+  }
+  for (int w = 0; w < 61; w++) {
+    TEST_ASSERT_EQUAL_INT32(expected[w], sums[w]);
+  }
+}
+
+void test_longer_stall_still_covered() {
+  // Past an hour windows merge too, the oldest first, still without a gap
+  stall(3 * 3600000UL);
+  TEST_ASSERT_EQUAL(READING_BUFFER_CAPACITY, buffer->count());
+  TEST_ASSERT_EQUAL_UINT32(3 * 3600, buffer->getReadingCount());
+  TEST_ASSERT_GREATER_THAN(SUMMARY_WINDOW_MS / STALL_PERIOD_MS,
+                           buffer->front().readingCount);
+  TEST_ASSERT_GREATER_THAN(0, drainContiguous(3 * 3600000UL));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_make_record);
+  RUN_TEST(test_merge_keeps_exact_sums_and_ranges);
+  RUN_TEST(test_merge_sound_features);
+  RUN_TEST(test_merge_skips_channels_without_samples);
+  RUN_TEST(test_fifo_below_capacity);
+  RUN_TEST(test_full_buffer_merges_oldest_cheapest_pair);
+  RUN_TEST(test_merges_stay_within_windows);
+  RUN_TEST(test_hour_stall_bounded_and_covered);
+  RUN_TEST(test_hour_stall_keeps_exact_window_sums);
+  RUN_TEST(test_longer_stall_still_covered);
+  return UNITY_END();
+}
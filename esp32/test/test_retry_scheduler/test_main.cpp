@@ -0,0 +1,291 @@
+// RetryScheduler backoff, attempt budgets and circuit breaker, and how
+// FirebaseManager settles uploads it gives up: refused payloads are
+// dropped, anything else goes back to the offline log
+
+#include <Arduino.h>
+#include <FS.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <unity.h>
+
+#include "FirebaseManager.h"
+#include "OfflineLog.h"
+#include "RetryScheduler.h"
+
+static const RetryPolicy policy = {1000, 8000, 4};
+static const BreakerPolicy breaker = {3, 10000, 40000};
+
+static char root[] = "/tmp/retry-scheduler-XXXXXX";
+static fs::FS *flash;
+
+void setUp() {
+  shimSetSerialOutput(false);
+  strcpy(root, "/tmp/retry-scheduler-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+  flash = new fs::FS(root);
+}
+
+void tearDown() {
+  delete flash;
+  std::filesystem::remove_all(root);
+  shimSetSerialOutput(true);
+}
+
+// Fail requests until the circuit opens at nowMs
+static void tripAt(RetryScheduler &scheduler, uint32_t nowMs) {
+  for (int i = 0; i < breaker.failureThreshold; i++) {
+    TEST_ASSERT_TRUE(scheduler.allowRequest(nowMs));
+    scheduler.recordFailure(nowMs);
+  }
+  TEST_ASSERT_EQUAL(BREAKER_OPEN, scheduler.getState(nowMs));
+}
+
+void test_backoff_doubles_up_to_cap_with_jitter() {
+  RetryScheduler scheduler(breaker);
+  scheduler.seed(42);
+  const uint32_t expected[] = {1000, 2000, 4000, 8000, 8000, 8000};
+  for (int round = 0; round < 50; round++) {
+    for (uint8_t attempts = 1; attempts <= 6; attempts++) {
+      // Equal jitter: between half and all of the delay
+      uint32_t full = expected[attempts - 1];
+      uint32_t delay = scheduler.retryDelay(policy, attempts);
+      TEST_ASSERT_GREATER_OR_EQUAL_UINT32(full / 2, delay);
+      TEST_ASSERT_LESS_OR_EQUAL_UINT32(full, delay);
+    }
+  }
+}
+
+void test_same_seed_replays_same_delays() {
+  RetryScheduler first(breaker);
+  RetryScheduler second(breaker);
+  RetryScheduler other(breaker);
+  first.seed(7);
+  second.seed(7);
+  other.seed(8);
+  bool differs = false;
+  for (uint8_t attempts = 1; attempts <= 20; attempts++) {
+    uint32_t delay = first.retryDelay(policy, attempts);
+    TEST_ASSERT_EQUAL_UINT32(delay, second.retryDelay(policy, attempts));
+    differs = differs || delay != other.retryDelay(policy, attempts);
+  }
+  TEST_ASSERT_TRUE(differs);
+}
+
+void test_attempt_budget() {
+  RetryScheduler scheduler(breaker);
+  TEST_ASSERT_TRUE(scheduler.canRetry(policy, 1));
+  TEST_ASSERT_TRUE(scheduler.canRetry(policy, 3));
+  TEST_ASSERT_FALSE(scheduler.canRetry(policy, 4));
+}
+
+void test_breaker_trips_after_threshold() {
+  RetryScheduler scheduler(breaker);
+  for (int i = 0; i < breaker.failureThreshold - 1; i++) {
+    scheduler.recordFailure(1000);
+  }
+  TEST_ASSERT_EQUAL(BREAKER_CLOSED, scheduler.getState(1000));
+
+  // A success in between starts the count again
+  scheduler.recordSuccess();
+  scheduler.recordFailure(1000);
+  TEST_ASSERT_EQUAL(BREAKER_CLOSED, scheduler.getState(1000));
+  TEST_ASSERT_EQUAL(1, scheduler.getConsecutiveFailures());
+
+  scheduler.recordSuccess();
+  tripAt(scheduler, 2000);
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.getTripCount());
+  TEST_ASSERT_FALSE(scheduler.isAllowed(2000));
+  TEST_ASSERT_FALSE(scheduler.allowRequest(2000 + breaker.openMs - 1));
+}
+
+void test_half_open_lets_one_probe_through() {
+  RetryScheduler scheduler(breaker);
+  tripAt(scheduler, 0);
+  uint32_t now = breaker.openMs;
+  TEST_ASSERT_EQUAL(BREAKER_HALF_OPEN, scheduler.getState(now));
+
+  // isAllowed only looks, allowRequest takes the probe
+  TEST_ASSERT_TRUE(scheduler.isAllowed(now));
+  TEST_ASSERT_TRUE(scheduler.isAllowed(now));
+  TEST_ASSERT_TRUE(scheduler.allowRequest(now));
+  TEST_ASSERT_FALSE(scheduler.isAllowed(now));
+  TEST_ASSERT_FALSE(scheduler.allowRequest(now + 5000));
+
+  scheduler.recordSuccess();
+  TEST_ASSERT_EQUAL(BREAKER_CLOSED, scheduler.getState(now));
+  TEST_ASSERT_EQUAL(0, scheduler.getConsecutiveFailures());
+  TEST_ASSERT_TRUE(scheduler.allowRequest(now));
+}
+
+void test_failed_probe_doubles_open_time_up_to_max() {
+  RetryScheduler scheduler(breaker);
+  tripAt(scheduler, 0);
+  uint32_t now = 0;
+  const uint32_t expected[] = {10000, 20000, 40000, 40000};
+  for (int i = 0; i < 4; i++) {
+    // Half-open exactly when the current open time is up
+    TEST_ASSERT_EQUAL(BREAKER_OPEN,
+                      scheduler.getState(now + expected[i] - 1));
+    now += expected[i];
+    TEST_ASSERT_TRUE(scheduler.allowRequest(now));
+    scheduler.recordFailure(now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(5, scheduler.getTripCount());
+
+  // Recovery starts over from the base open time
+  now += breaker.maxOpenMs;
+  TEST_ASSERT_TRUE(scheduler.allowRequest(now));
+  scheduler.recordSuccess();
+  tripAt(scheduler, now);
+  TEST_ASSERT_EQUAL(BREAKER_HALF_OPEN,
+                    scheduler.getState(now + breaker.openMs));
+}
+
+void test_rejected_probe_closes_circuit() {
+  // A 4xx answer to the probe shows the server is reachable: the probe is
+  // over and the circuit closes, instead of waiting on it forever
+  RetryScheduler scheduler(breaker);
+  tripAt(scheduler, 0);
+  uint32_t now = breaker.openMs;
+  TEST_ASSERT_TRUE(scheduler.allowRequest(now));
+  scheduler.recordRejected();
+  TEST_ASSERT_EQUAL(BREAKER_CLOSED, scheduler.getState(now));
+  TEST_ASSERT_TRUE(scheduler.isAllowed(now));
+  TEST_ASSERT_TRUE(scheduler.allowRequest(now));
+  TEST_ASSERT_EQUAL(0, scheduler.getConsecutiveFailures());
+}
+
+// FirebaseManager with both offline logs on the host flash, the stand-in
+// answering right away
+struct Uploader {
+  OfflineLog sensorLog;
+  OfflineLog eventLog;
+  FirebaseManager manager;
+  unsigned long lastSync;
+
+  Uploader()
+      : sensorLog("/sensors"), eventLog("/events"),
+        manager("test.firebaseio.test", "token"), lastSync(0) {
+    TEST_ASSERT_TRUE(sensorLog.begin(*flash));
+    TEST_ASSERT_TRUE(eventLog.begin(*flash));
+    shimSetMillis(5000);
+    standIn::reset(0);
+    manager.begin();
+    manager.setOfflineLogs(&sensorLog, &eventLog);
+  }
+
+  // Upload a live window summary with two events
+  void uploadLive() {
+    WindowSummary summary = {};
+    summary.windowStart = 1000;
+    summary.readingCount = 60;
+    EventData events[2] = {EventData(MOTION, 1500),
+                           EventData(VIBRATION, 2500)};
+    TEST_ASSERT_TRUE(manager.uploadBatch(&summary, events, 2, lastSync));
+  }
+
+  // Fail every attempt of the upload with errorCode. A successful metrics
+  // upload after each failure keeps the circuit closed, so the attempt
+  // budget can run out.
+  void failUntilGivenUp(int errorCode) {
+    MetricsSnapshot snapshot = {};
+    for (int i = 0; i < 20000 && manager.getAbandonedCount() == 0; i++) {
+      uint32_t failures = manager.getFailureCount();
+      standIn::failNext(errorCode, 1);
+      shimAdvanceMillis(100);
+      manager.loop();
+      if (manager.getFailureCount() != failures) {
+        standIn::failNext(0, 0);
+        TEST_ASSERT_TRUE(manager.uploadMetrics(snapshot, "device"));
+        manager.loop();
+      }
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, manager.getAbandonedCount());
+    TEST_ASSERT_EQUAL(0, manager.getPendingUploads());
+  }
+};
+
+void test_given_up_live_batch_goes_to_offline_log() {
+  Uploader uploader;
+  standIn::failNext(503, 1);
+  uploader.uploadLive();
+  uploader.failUntilGivenUp(503);
+
+  // The summary and both events are back on flash for the next drain
+  WindowSummary summary;
+  TEST_ASSERT_EQUAL(sizeof(WindowSummary),
+                    uploader.sensorLog.read(&summary, sizeof(summary)));
+  TEST_ASSERT_EQUAL(60, summary.readingCount);
+  TEST_ASSERT_EQUAL_UINT32(1000, summary.windowStart);
+  TEST_ASSERT_TRUE(uploader.sensorLog.isReadFromThisBoot());
+
+  EventData event;
+  TEST_ASSERT_EQUAL(sizeof(EventData),
+                    uploader.eventLog.read(&event, sizeof(event)));
+  TEST_ASSERT_EQUAL(MOTION, event.type);
+  TEST_ASSERT_EQUAL(sizeof(EventData),
+                    uploader.eventLog.read(&event, sizeof(event)));
+  TEST_ASSERT_EQUAL(VIBRATION, event.type);
+  TEST_ASSERT_EQUAL_UINT32(2500, event.timestamp);
+  TEST_ASSERT_EQUAL(-1, uploader.eventLog.read(&event, sizeof(event)));
+}
+
+void test_rejected_live_batch_is_dropped() {
+  Uploader uploader;
+  standIn::failNext(400, 1);
+  uploader.uploadLive();
+  uploader.failUntilGivenUp(400);
+  TEST_ASSERT_TRUE(uploader.sensorLog.isEmpty());
+  TEST_ASSERT_TRUE(uploader.eventLog.isEmpty());
+}
+
+void test_rate_limit_is_not_a_rejection() {
+  // 429 asks for a retry later: it counts towards the breaker and the
+  // batch is kept, like a server error
+  Uploader uploader;
+  standIn::failNext(429, 1);
+  uploader.uploadLive();
+  uploader.failUntilGivenUp(429);
+  TEST_ASSERT_FALSE(uploader.sensorLog.isEmpty());
+  TEST_ASSERT_FALSE(uploader.eventLog.isEmpty());
+}
+
+void test_rejected_probe_reopens_upload_path() {
+  Uploader uploader;
+  standIn::failNext(503, BREAKER_FAILURE_THRESHOLD);
+  uploader.uploadLive();
+  for (int i = 0; i < 2000 && !uploader.manager.isCircuitOpen(); i++) {
+    shimAdvanceMillis(100);
+    uploader.manager.loop();
+  }
+  TEST_ASSERT_TRUE(uploader.manager.isCircuitOpen());
+  TEST_ASSERT_EQUAL_UINT32(1, uploader.manager.getBreakerTripCount());
+
+  // The retry after the open time is the probe, and the server refuses it
+  standIn::failNext(400, 1);
+  uint32_t failures = uploader.manager.getFailureCount();
+  for (int i = 0; i < 2000 && uploader.manager.getFailureCount() == failures;
+       i++) {
+    shimAdvanceMillis(100);
+    uploader.manager.loop();
+  }
+  TEST_ASSERT_EQUAL_UINT32(failures + 1, uploader.manager.getFailureCount());
+  TEST_ASSERT_FALSE(uploader.manager.isCircuitOpen());
+  TEST_ASSERT_TRUE(uploader.manager.canSubmit());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_backoff_doubles_up_to_cap_with_jitter);
+  RUN_TEST(test_same_seed_replays_same_delays);
+  RUN_TEST(test_attempt_budget);
+  RUN_TEST(test_breaker_trips_after_threshold);
+  RUN_TEST(test_half_open_lets_one_probe_through);
+  RUN_TEST(test_failed_probe_doubles_open_time_up_to_max);
+  RUN_TEST(test_rejected_probe_closes_circuit);
+  RUN_TEST(test_given_up_live_batch_goes_to_offline_log);
+  RUN_TEST(test_rejected_live_batch_is_dropped);
+  RUN_TEST(test_rate_limit_is_not_a_rejection);
+  RUN_TEST(test_rejected_probe_reopens_upload_path);
+  return UNITY_END();
+}
@@ -0,0 +1,306 @@
+// SamplingScheduler rules, and a replay of the SensorTask policies against
+// a fire trace: ten quiet minutes, then a 60 s gas/flame ramp.
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "SamplingScheduler.h"
+
+// Channels of the trace (SensorTask numbering for gas and flame)
+#define CH_LIGHT 0
+#define CH_GAS 1
+#define CH_FLAME 2
+#define CH_SOIL 3
+#define CH_SOUND 4
+#define CH_DHT 5
+#define TRACE_CHANNELS 6
+
+#define QUIET_MS 600000UL
+#define RAMP_MS 60000UL
+
+// Same policies as SensorTask
+static const SamplingPolicy policies[TRACE_CHANNELS] = {
+    {1000, 16000, 200.0f, 32, SAMPLING_NO_THRESHOLD, false}, // light
+    {250, 2000, 20.0f, 16, 2000, false},                      // gas (high)
+    {250, 2000, 20.0f, 16, 1500, true},                       // flame (low)
+    {2000, 32000, 100.0f, 32, SAMPLING_NO_THRESHOLD, false}, // soil
+    {500, 4000, 300.0f, 64, SAMPLING_NO_THRESHOLD, false},   // sound
+    {2000, 2000, 0.0f, 0, SAMPLING_NO_THRESHOLD, false},     // DHT11 cache
+};
+
+static const SamplingPolicy simple = {250, 2000, 20.0f, 4,
+                                      SAMPLING_NO_THRESHOLD, false};
+
+static SamplingScheduler scheduler;
+
+// Trace value of a channel at t (ms since start), with a little noise
+static int traceValue(uint8_t channel, uint32_t t) {
+  int noise = (int)((t / 250 * 2654435761UL) >> 28) % 8;
+  float fire = t < QUIET_MS ? 0.0f : (t - QUIET_MS) / (float)RAMP_MS;
+  if (fire > 1.0f) {
+    fire = 1.0f;
+  }
+  switch (channel) {
+  case CH_GAS:
+    return 400 + noise + (int)(2600 * fire);
+  case CH_FLAME:
+    return 4000 - noise - (int)(3500 * fire);
+  case CH_LIGHT:
+    return 2000 + noise;
+  case CH_SOIL:
+    return 1500 + noise;
+  default:
+    return 1800 + noise * 4;
+  }
+}
+
+// Replay statistics over [fromMs, toMs)
+struct Replay {
+  uint32_t readings;            // wakeups with at least one channel due
+  uint32_t samples[TRACE_CHANNELS];
+  uint32_t firstFastGasMs;      // first gas period at the minimum
+};
+
+// Run the scheduler over the trace like the SensorTask loop does
+static Replay replay(uint32_t startMs, uint32_t fromMs, uint32_t toMs) {
+  Replay result = {};
+  result.firstFastGasMs = UINT32_MAX;
+  uint32_t now = startMs;
+  while (now - startMs < toMs) {
+    uint32_t t = now - startMs;
+    uint8_t due = scheduler.due(now);
+    if (t >= fromMs && due != 0) {
+      result.readings++;
+    }
+    for (uint8_t c = 0; c < TRACE_CHANNELS; c++) {
+      if (due & (1 << c)) {
+        scheduler.update(c, traceValue(c, t), now);
+        if (t >= fromMs) {
+          result.samples[c]++;
+        }
+      }
+    }
+    if (t >= QUIET_MS && result.firstFastGasMs == UINT32_MAX &&
+        scheduler.getPeriod(CH_GAS) == policies[CH_GAS].minPeriodMs) {
+      result.firstFastGasMs = t;
+    }
+    now += scheduler.msUntilNext(now);
+  }
+  return result;
+}
+
+static void configureTrace(uint32_t startMs) {
+  scheduler = SamplingScheduler();
+  for (uint8_t c = 0; c < TRACE_CHANNELS; c++) {
+    scheduler.configure(c, policies[c]);
+  }
+  scheduler.start(startMs);
+}
+
+void setUp() { scheduler = SamplingScheduler(); }
+
+void tearDown() {}
+
+void test_starts_due_at_minimum_period() {
+  scheduler.configure(0, simple);
+  scheduler.configure(3, simple);
+  scheduler.start(1000);
+
+  TEST_ASSERT_EQUAL_HEX8(0x09, scheduler.due(1000));
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.msUntilNext(1000));
+  TEST_ASSERT_EQUAL_UINT32(250, scheduler.getPeriod(0));
+
+  scheduler.update(0, 100, 1000);
+  TEST_ASSERT_EQUAL_HEX8(0x08, scheduler.due(1000));
+  scheduler.update(3, 100, 1000);
+  TEST_ASSERT_EQUAL_HEX8(0, scheduler.due(1000));
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.getSampleCount(0));
+}
+
+void test_unconfigured_channels_are_ignored() {
+  SamplingPolicy zero = simple;
+  zero.minPeriodMs = 0;
+  scheduler.configure(1, zero);
+  scheduler.configure(SAMPLING_MAX_CHANNELS, simple);
+  scheduler.start(0);
+
+  TEST_ASSERT_EQUAL_HEX8(0, scheduler.due(0));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, scheduler.msUntilNext(0));
+  scheduler.update(1, 5, 0);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.getSampleCount(1));
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.getPeriod(SAMPLING_MAX_CHANNELS));
+}
+
+void test_quiet_channel_relaxes_to_maximum() {
+  scheduler.configure(0, simple);
+  scheduler.start(0);
+
+  // 250 -> 500 -> 1000 -> 2000, then capped
+  uint32_t now = 0;
+  const uint32_t expected[] = {500, 1000, 2000, 2000, 2000};
+  for (int i = 0; i < 5; i++) {
+    scheduler.update(0, 100, now);
+    TEST_ASSERT_EQUAL_UINT32(expected[i], scheduler.getPeriod(0));
+    now += scheduler.msUntilNext(now);
+  }
+}
+
+void test_fast_change_snaps_to_minimum() {
+  scheduler.configure(0, simple);
+  scheduler.start(0);
+  uint32_t now = 0;
+  for (int i = 0; i < 4; i++) {
+    scheduler.update(0, 100, now);
+    now += scheduler.msUntilNext(now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(2000, scheduler.getPeriod(0));
+
+  // 50 counts over 2 s is 25/s, above the fast rate
+  scheduler.update(0, 150, now);
+  TEST_ASSERT_EQUAL_UINT32(250, scheduler.getPeriod(0));
+  TEST_ASSERT_EQUAL_UINT32(250, scheduler.msUntilNext(now));
+}
+
+void test_moderate_change_holds_period() {
+  scheduler.configure(0, simple);
+  scheduler.start(0);
+  scheduler.update(0, 100, 0);
+  TEST_ASSERT_EQUAL_UINT32(500, scheduler.getPeriod(0));
+
+  // 5 counts over 500 ms is 10/s: between a quarter of the fast rate and
+  // the fast rate, so the period stays
+  scheduler.update(0, 105, 500);
+  TEST_ASSERT_EQUAL_UINT32(500, scheduler.getPeriod(0));
+}
+
+void test_deadband_is_noise() {
+  scheduler.configure(0, simple);
+  scheduler.start(0);
+  scheduler.update(0, 100, 0);
+
+  // 4 counts in 100 ms would be 40/s, but within the deadband it does not
+  // tighten (only holds)
+  scheduler.update(0, 104, 100);
+  TEST_ASSERT_EQUAL_UINT32(500, scheduler.getPeriod(0));
+
+  // Noise around the last real value relaxes as its rate falls
+  scheduler.update(0, 97, 2000);
+  TEST_ASSERT_EQUAL_UINT32(1000, scheduler.getPeriod(0));
+}
+
+void test_slow_ramp_counts_as_fast() {
+  scheduler.configure(CH_GAS, policies[CH_GAS]);
+  scheduler.start(0);
+
+  // 10 counts per 250 ms (40/s) stays within the 16-count deadband on
+  // every sample, but is past the fast rate of 20/s
+  scheduler.update(CH_GAS, 400, 0);
+  uint32_t now = 0;
+  while (now < 5000) {
+    now += scheduler.msUntilNext(now);
+    scheduler.update(CH_GAS, 400 + 10 * (now / 250), now);
+    TEST_ASSERT_EQUAL_UINT32(250, scheduler.getPeriod(CH_GAS));
+  }
+}
+
+void test_threshold_holds_minimum_period() {
+  SamplingPolicy high = simple;
+  high.threshold = 2000;
+  SamplingPolicy low = simple;
+  low.threshold = 1500;
+  low.alarmBelow = true;
+  scheduler.configure(0, high);
+  scheduler.configure(1, low);
+  scheduler.start(0);
+
+  // Steady values past the threshold keep the fastest period
+  for (uint32_t now = 0; now < 5000; now += 250) {
+    scheduler.update(0, 2000, now);
+    scheduler.update(1, 1500, now);
+    TEST_ASSERT_EQUAL_UINT32(250, scheduler.getPeriod(0));
+    TEST_ASSERT_EQUAL_UINT32(250, scheduler.getPeriod(1));
+  }
+
+  // Back on the safe side they relax again
+  scheduler.update(0, 1999, 5000);
+  scheduler.update(1, 1501, 5000);
+  TEST_ASSERT_EQUAL_UINT32(500, scheduler.getPeriod(0));
+  TEST_ASSERT_EQUAL_UINT32(500, scheduler.getPeriod(1));
+}
+
+void test_due_times_align_and_do_not_drift() {
+  SamplingPolicy slow = simple;
+  slow.minPeriodMs = 1000;
+  slow.maxPeriodMs = 1000;
+  scheduler.configure(0, slow);
+  scheduler.configure(1, simple);
+  scheduler.start(100);
+
+  // A late wakeup keeps the grid of the start time
+  scheduler.update(0, 0, 100);
+  scheduler.update(1, 0, 100);
+  TEST_ASSERT_TRUE(scheduler.due(1100) & 1);
+  scheduler.update(0, 0, 1170);
+  TEST_ASSERT_FALSE(scheduler.due(2099) & 1);
+  TEST_ASSERT_TRUE(scheduler.due(2100) & 1);
+
+  // Channels with related periods fall due together
+  uint32_t now = 1170;
+  scheduler.update(1, 0, now);
+  while (!(scheduler.due(now) & 1)) {
+    uint8_t due = scheduler.due(now);
+    if (due & 2) {
+      scheduler.update(1, 0, now);
+    }
+    now += scheduler.msUntilNext(now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(2100, now);
+  TEST_ASSERT_EQUAL_HEX8(0x03, scheduler.due(now));
+}
+
+void test_survives_millis_wrap() {
+  configureTrace(0xffff0000UL);
+  Replay wrapped = replay(0xffff0000UL, 0, 200000);
+  configureTrace(0);
+  Replay plain = replay(0, 0, 200000);
+  TEST_ASSERT_EQUAL_UINT32(plain.readings, wrapped.readings);
+  TEST_ASSERT_EQUAL_UINT32(plain.samples[CH_GAS], wrapped.samples[CH_GAS]);
+}
+
+void test_fire_trace_replay() {
+  configureTrace(5000);
+
+  // Steady state: the last five quiet minutes, against 1 Hz before
+  Replay quiet = replay(5000, QUIET_MS - 300000, QUIET_MS);
+  float quietRate = quiet.readings / 300.0f;
+
+  configureTrace(5000);
+  Replay fire = replay(5000, QUIET_MS, QUIET_MS + RAMP_MS);
+  float gasRate = fire.samples[CH_GAS] / (RAMP_MS / 1000.0f);
+  ::printf("quiet: %.2f readings/s; fire: gas %.2f samples/s, fast after "
+           "%u ms\n",
+           quietRate, gasRate,
+           (unsigned)(fire.firstFastGasMs - QUIET_MS));
+
+  TEST_ASSERT_LESS_OR_EQUAL(0.55f, quietRate);
+  TEST_ASSERT_LESS_OR_EQUAL(2000, fire.firstFastGasMs - QUIET_MS);
+  TEST_ASSERT_GREATER_OR_EQUAL(3.8f, gasRate);
+  TEST_ASSERT_GREATER_OR_EQUAL(3.8f * RAMP_MS / 1000,
+                               fire.samples[CH_FLAME]);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_starts_due_at_minimum_period);
+  RUN_TEST(test_unconfigured_channels_are_ignored);
+  RUN_TEST(test_quiet_channel_relaxes_to_maximum);
+  RUN_TEST(test_fast_change_snaps_to_minimum);
+  RUN_TEST(test_moderate_change_holds_period);
+  RUN_TEST(test_deadband_is_noise);
+  RUN_TEST(test_slow_ramp_counts_as_fast);
+  RUN_TEST(test_threshold_holds_minimum_period);
+  RUN_TEST(test_due_times_align_and_do_not_drift);
+  RUN_TEST(test_survives_millis_wrap);
+  RUN_TEST(test_fire_trace_replay);
+  return UNITY_END();
+}
@@ -0,0 +1,117 @@
+// SensorBatch columns and the packed SensorData fields they come from
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "SensorBatch.h"
+
+#define ALL_ANALOG ((1 << ANALOG_CHANNEL_COUNT) - 1)
+
+static SensorBatch batch;
+
+// Reading i of a test series, every channel sampled
+static SensorData reading(int i) {
+  SensorData data;
+  data.lightValue = 100 + i;
+  data.gasValue = 200 + i;
+  data.flameValue = 4095 - i;
+  data.soilMoistureValue = 1500;
+  data.soundValue = 1800 + i;
+  data.analogSampled = ALL_ANALOG;
+  data.setTemperature(-5.0f + i * 0.1f);
+  data.setHumidity(40.0f + i * 0.5f);
+  data.temperatureValid = 1;
+  data.humidityValid = 1;
+  data.timestamp = 60000 + i * 1000;
+  return data;
+}
+
+void setUp() { batch.clear(); }
+
+void tearDown() {}
+
+void test_fixed_point_fields() {
+  SensorData data;
+  data.setTemperature(-12.34f);
+  data.setHumidity(98.76f);
+  TEST_ASSERT_EQUAL(-123, data.temperatureTenths);
+  TEST_ASSERT_EQUAL(988, data.humidityTenths);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, -12.3f, data.getTemperature());
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 98.8f, data.getHumidity());
+
+  // Limits of the DHT11/DHT22 ranges fit the bitfields
+  data.setTemperature(-40.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, -40.0f, data.getTemperature());
+  data.setTemperature(80.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 80.0f, data.getTemperature());
+  data.setHumidity(100.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 100.0f, data.getHumidity());
+}
+
+void test_append_fills_columns() {
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_TRUE(batch.append(reading(i)));
+  }
+  TEST_ASSERT_EQUAL(3, batch.count());
+
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_EQUAL_UINT32(60000 + i * 1000, batch.timestamps()[i]);
+    TEST_ASSERT_EQUAL_INT16(100 + i, batch.column(COLUMN_LIGHT)[i]);
+    TEST_ASSERT_EQUAL_INT16(200 + i, batch.column(COLUMN_GAS)[i]);
+    TEST_ASSERT_EQUAL_INT16(4095 - i, batch.column(COLUMN_FLAME)[i]);
+    TEST_ASSERT_EQUAL_INT16(1500, batch.column(COLUMN_SOIL_MOISTURE)[i]);
+    TEST_ASSERT_EQUAL_INT16(1800 + i, batch.column(COLUMN_SOUND)[i]);
+    TEST_ASSERT_EQUAL_INT16(-50 + i, batch.column(COLUMN_TEMPERATURE)[i]);
+    TEST_ASSERT_EQUAL_INT16(400 + i * 5, batch.column(COLUMN_HUMIDITY)[i]);
+  }
+}
+
+void test_unsampled_channels_are_missing() {
+  SensorData data = reading(0);
+  data.analogSampled = ALL_ANALOG & ~(1 << ANALOG_SOUND);
+  data.temperatureValid = 0;
+  batch.append(data);
+
+  TEST_ASSERT_EQUAL_INT16(SENSOR_BATCH_MISSING,
+                          batch.column(COLUMN_SOUND)[0]);
+  TEST_ASSERT_EQUAL_INT16(SENSOR_BATCH_MISSING,
+                          batch.column(COLUMN_TEMPERATURE)[0]);
+  TEST_ASSERT_EQUAL_INT16(100, batch.column(COLUMN_LIGHT)[0]);
+  TEST_ASSERT_EQUAL_INT16(400, batch.column(COLUMN_HUMIDITY)[0]);
+}
+
+void test_epoch_set_once_per_batch() {
+  // Unknown until set (before time sync, the server time stands in)
+  batch.append(reading(0));
+  batch.append(reading(1));
+  TEST_ASSERT_EQUAL_UINT64(0, batch.firstEpochMs());
+  batch.setFirstEpochMs(1760000060000ULL);
+  TEST_ASSERT_EQUAL_UINT64(1760000060000ULL, batch.firstEpochMs());
+}
+
+void test_full_batch_rejects_and_clear_resets() {
+  for (int i = 0; i < SENSOR_BATCH_CAPACITY; i++) {
+    TEST_ASSERT_FALSE(batch.isFull());
+    TEST_ASSERT_TRUE(batch.append(reading(i)));
+  }
+  TEST_ASSERT_TRUE(batch.isFull());
+  TEST_ASSERT_FALSE(batch.append(reading(0)));
+  TEST_ASSERT_EQUAL(SENSOR_BATCH_CAPACITY, batch.count());
+  batch.setFirstEpochMs(1760000060000ULL);
+
+  batch.clear();
+  TEST_ASSERT_EQUAL(0, batch.count());
+  TEST_ASSERT_EQUAL_UINT64(0, batch.firstEpochMs());
+  TEST_ASSERT_TRUE(batch.append(reading(7)));
+  TEST_ASSERT_EQUAL_INT16(107, batch.column(COLUMN_LIGHT)[0]);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fixed_point_fields);
+  RUN_TEST(test_append_fills_columns);
+  RUN_TEST(test_unsampled_channels_are_missing);
+  RUN_TEST(test_epoch_set_once_per_batch);
+  RUN_TEST(test_full_batch_rejects_and_clear_resets);
+  return UNITY_END();
+}
@@ -0,0 +1,295 @@
+// SeriesCodec round trips and the raw block format. The golden block below
+// is also decoded by web/src/lib/series-codec.test.ts, so a change on
+// either side of the format breaks one of the two tests.
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unity.h>
+
+#include "FirebaseManager.h"
+#include "SensorBatch.h"
+#include "SeriesCodec.h"
+
+#define EPOCH_MS 1760000060000ULL
+
+// Record of the golden batch (see fillGoldenBatch)
+#define GOLDEN_RECORD                                                         \
+  "{\"n\":10,\"t\":\"ANAPAAAAABozGgA=\",\"light\":\"oB8GAAAAAAAAAAA=\","      \
+  "\"gas\":\"iA4BAAYFAAYFAAY=\",\"flame\":\"/j8AAAAAAAAAAAA=\","              \
+  "\"soil-moisture\":\"uBcAAAAAAFBPAAA=\",\"sound\":\"kBxkAAAA\","            \
+  "\"temperature\":\"HQIABAMAAAA=\",\"humidity\":\"wAcCAAQDAAAA\","           \
+  "\"present\":{\"sound\":\"VQE=\",\"temperature\":\"5wM=\","                 \
+  "\"humidity\":\"5wM=\"},\"timestamp\":1760000060000}"
+
+static FirebaseManager *manager;
+static SensorBatch batch;
+static unsigned long lastSync;
+
+// Encode values, decode them again and compare
+static void roundTrip(const int32_t *values, int count) {
+  uint8_t buffer[64 * SERIES_MAX_VARINT_BYTES];
+  SeriesEncoder encoder(buffer, sizeof(buffer));
+  for (int i = 0; i < count; i++) {
+    encoder.add(values[i]);
+  }
+  TEST_ASSERT_FALSE(encoder.overflowed());
+
+  SeriesDecoder decoder(encoder.data(), encoder.length());
+  int32_t value;
+  for (int i = 0; i < count; i++) {
+    TEST_ASSERT_TRUE(decoder.next(value));
+    TEST_ASSERT_EQUAL_INT32(values[i], value);
+  }
+  TEST_ASSERT_FALSE(decoder.next(value));
+}
+
+// Standard base64 decoding of a JSON string value
+static std::string fromBase64(const std::string &text) {
+  static const std::string alphabet =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string bytes;
+  uint32_t bits = 0;
+  int bitCount = 0;
+  for (char c : text) {
+    size_t index = alphabet.find(c);
+    if (index == std::string::npos) {
+      continue;
+    }
+    bits = (bits << 6) | index;
+    bitCount += 6;
+    if (bitCount >= 8) {
+      bitCount -= 8;
+      bytes += (char)((bits >> bitCount) & 0xff);
+    }
+  }
+  return bytes;
+}
+
+// Decoded series of a field in a record ("name":"base64")
+static std::vector<int32_t> series(const std::string &record,
+                                   const char *name) {
+  std::string key = std::string("\"") + name + "\":\"";
+  size_t start = record.find(key);
+  TEST_ASSERT_TRUE(start != std::string::npos);
+  start += key.length();
+  std::string bytes =
+      fromBase64(record.substr(start, record.find('"', start) - start));
+
+  std::vector<int32_t> values;
+  SeriesDecoder decoder((const uint8_t *)bytes.data(), bytes.length());
+  int32_t value;
+  while (decoder.next(value)) {
+    values.push_back(value);
+  }
+  return values;
+}
+
+// Record object of the latest raw upload (without the push-id path)
+static std::string lastRecord() {
+  TEST_ASSERT_GREATER_THAN(0, standIn::requests().size());
+  const std::string &body = standIn::requests().back().body;
+  size_t start = body.find("{\"n\":");
+  TEST_ASSERT_TRUE(start != std::string::npos);
+  return body.substr(start, body.length() - start - 1);
+}
+
+// Ten readings 1 s apart with one late reading, sound sampled every
+// other reading and a DHT read failure on readings 3 and 4
+static void fillGoldenBatch(uint64_t firstEpochMs) {
+  static const unsigned long offsets[10] = {0,    1000, 2000, 3000, 4000,
+                                            5000, 6013, 7000, 8000, 9000};
+  batch.clear();
+  for (int i = 0; i < 10; i++) {
+    SensorData data;
+    data.lightValue = 2000 + i * 3;
+    data.gasValue = 900 - (i % 3);
+    data.flameValue = 4095;
+    data.soilMoistureValue = 1500 + (i > 5 ? 40 : 0);
+    data.soundValue = 1800 + i * 25;
+    data.analogSampled = (1 << ANALOG_CHANNEL_COUNT) - 1;
+    if (i % 2 == 1) {
+      data.analogSampled &= ~(1 << ANALOG_SOUND);
+    }
+    data.temperatureTenths = -15 + i;
+    data.humidityTenths = 480 + i;
+    data.temperatureValid = i != 3 && i != 4;
+    data.humidityValid = i != 3 && i != 4;
+    data.timestamp = 60000 + offsets[i];
+    batch.append(data);
+  }
+  batch.setFirstEpochMs(firstEpochMs);
+}
+
+void setUp() {
+  shimSetSerialOutput(false);
+  shimSetMillis(1000);
+  standIn::reset(0);
+  manager = new FirebaseManager("codec.firebaseio.test", "token");
+  manager->begin();
+}
+
+void tearDown() {
+  delete manager;
+  shimSetSerialOutput(true);
+}
+
+void test_round_trip_edge_values() {
+  const int32_t values[] = {0,         INT32_MAX, INT32_MIN, INT32_MAX,
+                            -1,        1,         INT32_MIN, 0,
+                            123456789, -98765,    INT16_MIN, INT16_MAX};
+  roundTrip(values, sizeof(values) / sizeof(values[0]));
+
+  const int32_t single[] = {INT32_MIN};
+  roundTrip(single, 1);
+  roundTrip(NULL, 0);
+}
+
+void test_round_trip_wrapping_counter() {
+  // millis() offsets across the 49-day wrap stay exact
+  int32_t values[64];
+  uint32_t time = 0xffffff00UL;
+  for (int i = 0; i < 64; i++) {
+    values[i] = (int32_t)time;
+    time += 17;
+  }
+  roundTrip(values, 64);
+}
+
+void test_regular_series_is_one_byte_per_sample() {
+  uint8_t buffer[256];
+  SeriesEncoder encoder(buffer, sizeof(buffer));
+  for (int i = 0; i < 100; i++) {
+    encoder.add(60000 + i * 1000);
+  }
+  // First value (3 bytes), first delta (2 bytes), then zero delta-of-deltas
+  TEST_ASSERT_EQUAL(3 + 2 + 98, encoder.length());
+}
+
+void test_malformed_varint_stops_decoding() {
+  // Continuation bit set on the last byte
+  const uint8_t truncated[] = {0x02, 0x80};
+  SeriesDecoder first(truncated, sizeof(truncated));
+  int32_t value;
+  TEST_ASSERT_TRUE(first.next(value));
+  TEST_ASSERT_EQUAL_INT32(1, value);
+  TEST_ASSERT_FALSE(first.next(value));
+
+  // Longer than any 32-bit varint
+  const uint8_t overlong[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+  SeriesDecoder second(overlong, sizeof(overlong));
+  TEST_ASSERT_FALSE(second.next(value));
+}
+
+void test_encoder_reports_overflow() {
+  uint8_t buffer[4];
+  SeriesEncoder encoder(buffer, sizeof(buffer));
+  encoder.add(1);
+  TEST_ASSERT_FALSE(encoder.overflowed());
+  encoder.add(INT32_MAX);
+  TEST_ASSERT_TRUE(encoder.overflowed());
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(buffer), encoder.length());
+}
+
+void test_golden_raw_block() {
+  fillGoldenBatch(EPOCH_MS);
+  TEST_ASSERT_TRUE(manager->uploadRaw(batch, lastSync));
+  std::string record = lastRecord();
+  TEST_ASSERT_EQUAL_STRING(GOLDEN_RECORD, record.c_str());
+}
+
+void test_golden_series_decode() {
+  fillGoldenBatch(EPOCH_MS);
+  TEST_ASSERT_TRUE(manager->uploadRaw(batch, lastSync));
+  std::string record = lastRecord();
+
+  std::vector<int32_t> t = series(record, "t");
+  TEST_ASSERT_EQUAL(10, t.size());
+  TEST_ASSERT_EQUAL_INT32(0, t[0]);
+  TEST_ASSERT_EQUAL_INT32(6013, t[6]);
+
+  // Gaps are left out of the series instead of being marked
+  std::vector<int32_t> sound = series(record, "sound");
+  TEST_ASSERT_EQUAL(5, sound.size());
+  TEST_ASSERT_EQUAL_INT32(1850, sound[1]);
+  std::vector<int32_t> temperature = series(record, "temperature");
+  TEST_ASSERT_EQUAL(8, temperature.size());
+  TEST_ASSERT_EQUAL_INT32(-15, temperature[0]);
+  TEST_ASSERT_EQUAL_INT32(-10, temperature[3]);
+
+  // Presence bitmaps only for the channels with gaps
+  TEST_ASSERT_TRUE(record.find("\"present\":{\"sound\":\"VQE=\","
+                               "\"temperature\":\"5wM=\","
+                               "\"humidity\":\"5wM=\"}") !=
+                   std::string::npos);
+  TEST_ASSERT_TRUE(record.find("\"anchor\"") == std::string::npos);
+}
+
+void test_unsynced_block_anchors_on_last_reading() {
+  fillGoldenBatch(0);
+  TEST_ASSERT_TRUE(manager->uploadRaw(batch, lastSync));
+  std::string record = lastRecord();
+
+  // Offsets count back from the last reading, stamped by the server
+  TEST_ASSERT_TRUE(record.find("\"anchor\":\"last\"") != std::string::npos);
+  TEST_ASSERT_TRUE(record.find("{\".sv\":\"timestamp\"}") !=
+                   std::string::npos);
+  std::vector<int32_t> t = series(record, "t");
+  TEST_ASSERT_EQUAL_INT32(-9000, t[0]);
+  TEST_ASSERT_EQUAL_INT32(0, t[9]);
+}
+
+void test_raw_block_five_times_smaller_than_json() {
+  // A full block against one JSON record per reading
+  batch.clear();
+  size_t jsonBytes = 0;
+  for (int i = 0; i < SENSOR_BATCH_CAPACITY; i++) {
+    SensorData data;
+    data.lightValue = 2000 + (i * 7) % 40;
+    data.gasValue = 900 + (i * 13) % 9;
+    data.flameValue = 4000 - i;
+    data.soilMoistureValue = 1500;
+    data.soundValue = 1800 + (i * 31) % 30;
+    data.setTemperature(21.5f + (i / 30) * 0.1f);
+    data.setHumidity(48.0f);
+    data.temperatureValid = 1;
+    data.humidityValid = 1;
+    data.analogSampled = (1 << ANALOG_CHANNEL_COUNT) - 1;
+    data.timestamp = 60000 + i * 1000;
+    batch.append(data);
+
+    char record[256];
+    jsonBytes += snprintf(
+        record, sizeof(record),
+        "\"%020d\":{\"timestamp\":%llu,\"light\":%u,\"gas\":%u,"
+        "\"flame\":%u,\"soil-moisture\":%u,\"sound\":%u,"
+        "\"temperature\":%.1f,\"humidity\":%.1f},",
+        i, EPOCH_MS + i * 1000ULL, data.lightValue,
+        data.gasValue, data.flameValue, data.soilMoistureValue,
+        data.soundValue, data.getTemperature(), data.getHumidity());
+  }
+  batch.setFirstEpochMs(EPOCH_MS);
+
+  TEST_ASSERT_TRUE(manager->uploadRaw(batch, lastSync));
+  size_t rawBytes = standIn::requests().back().body.length();
+  ::printf("%d readings: raw %u bytes, JSON %u bytes (%.1fx)\n",
+           SENSOR_BATCH_CAPACITY, (unsigned)rawBytes, (unsigned)jsonBytes,
+           (double)jsonBytes / rawBytes);
+  TEST_ASSERT_GREATER_OR_EQUAL(5 * rawBytes, jsonBytes);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_edge_values);
+  RUN_TEST(test_round_trip_wrapping_counter);
+  RUN_TEST(test_regular_series_is_one_byte_per_sample);
+  RUN_TEST(test_malformed_varint_stops_decoding);
+  RUN_TEST(test_encoder_reports_overflow);
+  RUN_TEST(test_golden_raw_block);
+  RUN_TEST(test_golden_series_decode);
+  RUN_TEST(test_unsynced_block_anchors_on_last_reading);
+  RUN_TEST(test_raw_block_five_times_smaller_than_json);
+  return UNITY_END();
+}
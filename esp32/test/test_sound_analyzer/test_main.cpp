@@ -0,0 +1,238 @@
+// Sound features from WAV files: synthetic tones, a saw-like harmonic
+// series and wind-like noise are written as 16-bit mono WAVs, read back
+// and fed to the analyzer as 12-bit ADC counts around the microphone
+// bias, the way AnalogSensors feeds the sound channel.
+
+#include <Arduino.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+#include <vector>
+
+#include "SoundAnalyzer.h"
+
+// Sound channel rate and analysis budget (see AnalogSensors.h)
+#define SAMPLE_RATE_HZ 4000
+#define ANALYSIS_BUDGET_US 2000
+
+#define WAV_PATH "/tmp/test_sound_analyzer.wav"
+
+static const float TWO_PI = 6.28318530718f;
+
+static SoundAnalyzer *analyzer;
+
+static void putLe(FILE *file, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    fputc((value >> (8 * i)) & 0xFF, file);
+  }
+}
+
+// Write 16-bit mono PCM samples as a WAV file
+static void writeWav(const char *path, const std::vector<int16_t> &samples) {
+  FILE *file = fopen(path, "wb");
+  TEST_ASSERT_NOT_NULL(file);
+  uint32_t dataBytes = samples.size() * 2;
+  fwrite("RIFF", 1, 4, file);
+  putLe(file, 36 + dataBytes, 4);
+  fwrite("WAVEfmt ", 1, 8, file);
+  putLe(file, 16, 4);
+  putLe(file, 1, 2); // PCM
+  putLe(file, 1, 2); // mono
+  putLe(file, SAMPLE_RATE_HZ, 4);
+  putLe(file, SAMPLE_RATE_HZ * 2, 4);
+  putLe(file, 2, 2);
+  putLe(file, 16, 2);
+  fwrite("data", 1, 4, file);
+  putLe(file, dataBytes, 4);
+  for (int16_t sample : samples) {
+    putLe(file, (uint16_t)sample, 2);
+  }
+  fclose(file);
+}
+
+// Read a 16-bit mono PCM WAV file and feed it to the analyzer as ADC
+// counts; returns the number of windows analyzed and leaves the features
+// averaged over all of them in average
+static int feedWav(const char *path, SoundFeatures &average) {
+  FILE *file = fopen(path, "rb");
+  TEST_ASSERT_NOT_NULL(file);
+  uint8_t header[12];
+  TEST_ASSERT_EQUAL(12, fread(header, 1, 12, file));
+  TEST_ASSERT_EQUAL_MEMORY("RIFF", header, 4);
+  TEST_ASSERT_EQUAL_MEMORY("WAVE", header + 8, 4);
+
+  // Skip chunks up to the samples, checking the format on the way
+  uint8_t chunk[8];
+  uint32_t size = 0;
+  while (fread(chunk, 1, 8, file) == 8) {
+    size = chunk[4] | chunk[5] << 8 | chunk[6] << 16 | chunk[7] << 24;
+    if (memcmp(chunk, "data", 4) == 0) {
+      break;
+    }
+    std::vector<uint8_t> body(size);
+    TEST_ASSERT_EQUAL(size, fread(body.data(), 1, size, file));
+    if (memcmp(chunk, "fmt ", 4) == 0) {
+      TEST_ASSERT_EQUAL(1, body[0] | body[1] << 8);   // PCM
+      TEST_ASSERT_EQUAL(1, body[2] | body[3] << 8);   // mono
+      TEST_ASSERT_EQUAL(16, body[14] | body[15] << 8); // 16 bit
+    }
+  }
+
+  memset(&average, 0, sizeof(average));
+  int windows = 0;
+  uint8_t pcm[2];
+  for (uint32_t i = 0; i < size / 2 && fread(pcm, 1, 2, file) == 2; i++) {
+    int16_t sample = (int16_t)(pcm[0] | pcm[1] << 8);
+    if (analyzer->addSample(2048 + (sample >> 4))) {
+      const SoundFeatures &features = analyzer->getFeatures();
+      average.rms += features.rms;
+      average.peak += features.peak;
+      average.zcr += features.zcr;
+      for (int b = 0; b < SOUND_ANALYZER_BANDS; b++) {
+        average.bandEnergy[b] += features.bandEnergy[b];
+      }
+      windows++;
+    }
+  }
+  fclose(file);
+
+  if (windows > 0) {
+    average.rms /= windows;
+    average.peak /= windows;
+    average.zcr /= windows;
+    for (int b = 0; b < SOUND_ANALYZER_BANDS; b++) {
+      average.bandEnergy[b] /= windows;
+    }
+  }
+  return windows;
+}
+
+// One second of a sine at the given frequency and amplitude (PCM units)
+static std::vector<int16_t> tone(float hz, float amplitude) {
+  std::vector<int16_t> samples(SAMPLE_RATE_HZ);
+  for (int i = 0; i < SAMPLE_RATE_HZ; i++) {
+    samples[i] = amplitude * sinf(TWO_PI * hz * i / SAMPLE_RATE_HZ);
+  }
+  return samples;
+}
+
+// Analyze a tone from a fresh stream (no samples left from earlier ones)
+static void analyzeTone(float hz, SoundFeatures &features) {
+  delete analyzer;
+  analyzer = new SoundAnalyzer(SAMPLE_RATE_HZ);
+  writeWav(WAV_PATH, tone(hz, 16000));
+  TEST_ASSERT_EQUAL(SAMPLE_RATE_HZ / SOUND_WINDOW_SIZE,
+                    feedWav(WAV_PATH, features));
+}
+
+void setUp() { analyzer = new SoundAnalyzer(SAMPLE_RATE_HZ); }
+
+void tearDown() {
+  delete analyzer;
+  remove(WAV_PATH);
+}
+
+void test_tone_lands_in_its_band() {
+  // One tone inside each band: <250, 250-500, 500-1000, 1000-Nyquist
+  const float tones[SOUND_ANALYZER_BANDS] = {125, 375, 750, 1500};
+  for (int b = 0; b < SOUND_ANALYZER_BANDS; b++) {
+    SoundFeatures features;
+    analyzeTone(tones[b], features);
+    TEST_ASSERT_GREATER_THAN(0.95f * 100, features.bandEnergy[b] * 100);
+  }
+}
+
+void test_tone_time_domain_features() {
+  // 16000 PCM -> 1000 ADC counts
+  SoundFeatures features;
+  analyzeTone(375, features);
+  TEST_ASSERT_FLOAT_WITHIN(15, 1000 / sqrtf(2), features.rms);
+  TEST_ASSERT_FLOAT_WITHIN(15, 1000, features.peak);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 2.0f * 375 / SAMPLE_RATE_HZ, features.zcr);
+}
+
+void test_saw_and_wind_differ() {
+  // Two-stroke engine: 120 Hz firing with strong harmonics up to 1.8 kHz
+  std::vector<int16_t> saw(SAMPLE_RATE_HZ * 2);
+  for (size_t i = 0; i < saw.size(); i++) {
+    float value = 0;
+    for (int h = 1; h <= 15; h++) {
+      value += sinf(TWO_PI * 120 * h * i / SAMPLE_RATE_HZ) / sqrtf(h);
+    }
+    saw[i] = 3000 * value;
+  }
+  SoundFeatures sawFeatures;
+  writeWav(WAV_PATH, saw);
+  feedWav(WAV_PATH, sawFeatures);
+
+  // Wind: white noise through a one-pole low-pass at ~60 Hz
+  std::vector<int16_t> wind(SAMPLE_RATE_HZ * 2);
+  uint32_t seed = 1;
+  float level = 0;
+  for (size_t i = 0; i < wind.size(); i++) {
+    seed = seed * 1664525 + 1013904223;
+    float white = (int32_t)seed / 2147483648.0f;
+    level += 0.09f * (white - level);
+    wind[i] = 60000 * level;
+  }
+  SoundFeatures windFeatures;
+  writeWav(WAV_PATH, wind);
+  feedWav(WAV_PATH, windFeatures);
+
+  ::printf("saw bands %.2f %.2f %.2f %.2f zcr %.3f\n",
+           sawFeatures.bandEnergy[0], sawFeatures.bandEnergy[1],
+           sawFeatures.bandEnergy[2], sawFeatures.bandEnergy[3],
+           sawFeatures.zcr);
+  ::printf("wind bands %.2f %.2f %.2f %.2f zcr %.3f\n",
+           windFeatures.bandEnergy[0], windFeatures.bandEnergy[1],
+           windFeatures.bandEnergy[2], windFeatures.bandEnergy[3],
+           windFeatures.zcr);
+
+  // Wind stays low; the engine spreads into the upper bands
+  TEST_ASSERT_GREATER_THAN(70, windFeatures.bandEnergy[0] * 100);
+  TEST_ASSERT_LESS_THAN(50, sawFeatures.bandEnergy[0] * 100);
+  TEST_ASSERT_GREATER_THAN(30, (sawFeatures.bandEnergy[2] +
+                                sawFeatures.bandEnergy[3]) * 100);
+}
+
+void test_silence_has_no_energy() {
+  std::vector<int16_t> silence(SOUND_WINDOW_SIZE * 2, 0);
+  writeWav(WAV_PATH, silence);
+  SoundFeatures features;
+  TEST_ASSERT_EQUAL(2, feedWav(WAV_PATH, features));
+  TEST_ASSERT_EQUAL_FLOAT(0, features.rms);
+  TEST_ASSERT_EQUAL_FLOAT(0, features.peak);
+  for (int b = 0; b < SOUND_ANALYZER_BANDS; b++) {
+    TEST_ASSERT_EQUAL_FLOAT(0, features.bandEnergy[b]);
+  }
+}
+
+void test_window_within_cpu_budget() {
+  // Host time per analyzed window; the device budget is the upper bound
+  std::vector<int16_t> samples = tone(750, 8000);
+  const int windows = 1000;
+  auto start = std::chrono::steady_clock::now();
+  for (int w = 0; w < windows; w++) {
+    for (int i = 0; i < SOUND_WINDOW_SIZE; i++) {
+      analyzer->addSample(2048 + (samples[i] >> 4));
+    }
+  }
+  double perWindowUs = std::chrono::duration<double, std::micro>(
+                           std::chrono::steady_clock::now() - start)
+                           .count() /
+                       windows;
+  ::printf("%.1f us per %d-sample window (budget %d us on the ESP32)\n",
+           perWindowUs, SOUND_WINDOW_SIZE, ANALYSIS_BUDGET_US);
+  TEST_ASSERT_LESS_THAN(ANALYSIS_BUDGET_US, perWindowUs);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_tone_lands_in_its_band);
+  RUN_TEST(test_tone_time_domain_features);
+  RUN_TEST(test_saw_and_wind_differ);
+  RUN_TEST(test_silence_has_no_energy);
+  RUN_TEST(test_window_within_cpu_budget);
+  return UNITY_END();
+}
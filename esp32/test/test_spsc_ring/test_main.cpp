@@ -0,0 +1,264 @@
+// SpscRing: FIFO order, batch reserve/commit and peek/release across the
+// end of the storage, the wait/notify handshake, and a two-thread stress
+// run. The stress run checks every item for order and tearing; built with
+// -fsanitize=thread (pio test -e native-tsan) it runs a billion items.
+
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unity.h>
+
+#include "SpscRing.h"
+
+// Items passed in the stress run (override with -DSPSC_STRESS_ITEMS=...)
+#ifndef SPSC_STRESS_ITEMS
+#define SPSC_STRESS_ITEMS 20000000ULL
+#endif
+
+// Capacity of the stress ring (small, so both sides keep hitting full
+// and empty)
+#define STRESS_CAPACITY 64
+
+// Longest wait for a notification before it counts as lost (ms)
+#define STRESS_WAIT_MS 2000
+
+// Test item: a sequence number and a check value written apart from it,
+// so a torn or stale read shows
+struct Item {
+  uint64_t seq;
+  uint32_t pad[4];
+  uint64_t check;
+};
+
+static uint64_t checkOf(uint64_t seq) {
+  return ~(seq * 0x9E3779B97F4A7C15ULL);
+}
+
+static Item items[8];
+static SpscRing *ring;
+
+void setUp() { ring = new SpscRing(items, sizeof(Item), 8); }
+
+void tearDown() { delete ring; }
+
+static Item makeItem(uint64_t seq) {
+  Item item = {};
+  item.seq = seq;
+  item.check = checkOf(seq);
+  return item;
+}
+
+void test_push_pop_in_order() {
+  TEST_ASSERT_EQUAL_UINT32(8, ring->capacity());
+  Item item;
+  TEST_ASSERT_FALSE(ring->pop(&item));
+
+  for (uint64_t i = 0; i < 8; i++) {
+    Item in = makeItem(i);
+    TEST_ASSERT_TRUE(ring->push(&in));
+  }
+  Item extra = makeItem(8);
+  TEST_ASSERT_FALSE(ring->push(&extra));
+  TEST_ASSERT_EQUAL_UINT32(8, ring->size());
+
+  for (uint64_t i = 0; i < 8; i++) {
+    TEST_ASSERT_TRUE(ring->pop(&item));
+    TEST_ASSERT_EQUAL_UINT64(i, item.seq);
+  }
+  TEST_ASSERT_FALSE(ring->pop(&item));
+  TEST_ASSERT_EQUAL_UINT32(0, ring->size());
+}
+
+void test_reserve_stops_at_end_of_storage() {
+  // Move the indices to slot 5 of 8
+  Item item = makeItem(0);
+  for (int i = 0; i < 5; i++) {
+    ring->push(&item);
+    ring->pop(&item);
+  }
+
+  // Free slots run 5..7, then 0..4 in a second reserve
+  uint32_t count;
+  Item *batch = (Item *)ring->reserve(count);
+  TEST_ASSERT_EQUAL_PTR(&items[5], batch);
+  TEST_ASSERT_EQUAL_UINT32(3, count);
+  for (uint32_t i = 0; i < count; i++) {
+    batch[i] = makeItem(100 + i);
+  }
+  ring->commit(count);
+  batch = (Item *)ring->reserve(count);
+  TEST_ASSERT_EQUAL_PTR(&items[0], batch);
+  TEST_ASSERT_EQUAL_UINT32(5, count);
+  batch[0] = makeItem(103);
+  batch[1] = makeItem(104);
+  ring->commit(2);
+  TEST_ASSERT_EQUAL_UINT32(5, ring->size());
+
+  // Reads split the same way
+  const Item *read = (const Item *)ring->peek(count);
+  TEST_ASSERT_EQUAL_UINT32(3, count);
+  TEST_ASSERT_EQUAL_UINT64(100, read[0].seq);
+  ring->release(count);
+  read = (const Item *)ring->peek(count);
+  TEST_ASSERT_EQUAL_UINT32(2, count);
+  TEST_ASSERT_EQUAL_UINT64(104, read[1].seq);
+
+  // Part of a batch can be released
+  ring->release(1);
+  read = (const Item *)ring->peek(count);
+  TEST_ASSERT_EQUAL_UINT32(1, count);
+  TEST_ASSERT_EQUAL_UINT64(104, read[0].seq);
+}
+
+void test_full_ring_reserves_nothing() {
+  uint32_t count;
+  ring->reserve(count);
+  ring->commit(count);
+  TEST_ASSERT_NULL(ring->reserve(count));
+  TEST_ASSERT_EQUAL_UINT32(0, count);
+  ring->peek(count);
+  ring->release(1);
+  TEST_ASSERT_NOT_NULL(ring->reserve(count));
+  TEST_ASSERT_EQUAL_UINT32(1, count);
+}
+
+void test_wait_handshake() {
+  // A producer pays for a notification only after prepareWait()
+  Item item = makeItem(1);
+  ring->push(&item);
+  TEST_ASSERT_FALSE(ring->takeWaiter());
+
+  // Items already there: no wait
+  TEST_ASSERT_FALSE(ring->prepareWait());
+  TEST_ASSERT_FALSE(ring->takeWaiter());
+  ring->pop(&item);
+
+  // Empty: the consumer waits, the next push wakes it once
+  TEST_ASSERT_TRUE(ring->prepareWait());
+  ring->push(&item);
+  TEST_ASSERT_TRUE(ring->takeWaiter());
+  TEST_ASSERT_FALSE(ring->takeWaiter());
+  ring->cancelWait();
+
+  // A wait given up before any push needs no notification
+  ring->pop(&item);
+  TEST_ASSERT_TRUE(ring->prepareWait());
+  ring->cancelWait();
+  ring->push(&item);
+  TEST_ASSERT_FALSE(ring->takeWaiter());
+}
+
+// Outcome of the stress run, filled by the consumer
+struct StressResult {
+  uint64_t received;
+  uint64_t outOfOrder;
+  uint64_t torn;
+  uint32_t waits;
+  uint32_t lostWakeups;
+};
+
+void test_two_thread_stress() {
+  static Item storage[STRESS_CAPACITY];
+  SpscRing stress(storage, sizeof(Item), STRESS_CAPACITY);
+  std::atomic<TaskHandle_t> consumerTask(NULL);
+  StressResult result = {};
+  uint32_t notifications = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Consumer: drains in batches like CloudTask, sleeps on its
+  // notification when the ring is empty
+  std::thread consumer([&] {
+    consumerTask.store(xTaskGetCurrentTaskHandle());
+    uint64_t expected = 0;
+    while (expected < SPSC_STRESS_ITEMS) {
+      uint32_t count;
+      const Item *batch = (const Item *)stress.peek(count);
+      if (batch == NULL) {
+        if (stress.prepareWait()) {
+          result.waits++;
+          if (ulTaskNotifyTake(pdTRUE, STRESS_WAIT_MS) == 0 &&
+              stress.size() == 0) {
+            result.lostWakeups++;
+          }
+          stress.cancelWait();
+        }
+        continue;
+      }
+      for (uint32_t i = 0; i < count; i++) {
+        if (batch[i].seq != expected) {
+          result.outOfOrder++;
+        }
+        if (batch[i].check != checkOf(batch[i].seq)) {
+          result.torn++;
+        }
+        expected = batch[i].seq + 1;
+      }
+      result.received += count;
+      stress.release(count);
+    }
+  });
+
+  // Producer: writes batches of 1 to 7 items in place like SensorTask,
+  // notifies only a waiting consumer
+  std::thread producer([&] {
+    while (consumerTask.load() == NULL) {
+      std::this_thread::yield();
+    }
+    uint64_t seq = 0;
+    uint32_t batchSize = 1;
+    while (seq < SPSC_STRESS_ITEMS) {
+      uint32_t count;
+      Item *batch = (Item *)stress.reserve(count);
+      if (batch == NULL) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (count > batchSize) {
+        count = batchSize;
+      }
+      if (count > SPSC_STRESS_ITEMS - seq) {
+        count = (uint32_t)(SPSC_STRESS_ITEMS - seq);
+      }
+      for (uint32_t i = 0; i < count; i++) {
+        batch[i].seq = seq;
+        batch[i].check = checkOf(seq);
+        seq++;
+      }
+      stress.commit(count);
+      if (stress.takeWaiter()) {
+        notifications++;
+        xTaskNotifyGive(consumerTask.load());
+      }
+      batchSize = batchSize % 7 + 1;
+    }
+  });
+
+  producer.join();
+  consumer.join();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  printf("SPSC stress: %llu items in %.2f s (%.1f M items/s), %u waits, "
+         "%u notifications\n",
+         (unsigned long long)result.received, seconds,
+         result.received / seconds / 1e6, result.waits, notifications);
+  TEST_ASSERT_EQUAL_UINT64(SPSC_STRESS_ITEMS, result.received);
+  TEST_ASSERT_EQUAL_UINT64(0, result.outOfOrder);
+  TEST_ASSERT_EQUAL_UINT64(0, result.torn);
+  TEST_ASSERT_EQUAL_UINT32(0, result.lostWakeups);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(result.waits, notifications);
+  TEST_ASSERT_EQUAL_UINT32(0, stress.size());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_push_pop_in_order);
+  RUN_TEST(test_reserve_stops_at_end_of_storage);
+  RUN_TEST(test_full_ring_reserves_nothing);
+  RUN_TEST(test_wait_handshake);
+  RUN_TEST(test_two_thread_stress);
+  return UNITY_END();
+}
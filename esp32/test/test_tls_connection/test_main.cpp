@@ -0,0 +1,115 @@
+// TLS connection tracking in FirebaseManager: full handshakes, requests
+// reusing an open connection and disconnects, against the stand-in's
+// link (the connection opens with the first request after the link
+// comes up)
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <string>
+#include <unity.h>
+
+#include "FirebaseManager.h"
+
+#define TEST_CA "-----BEGIN CERTIFICATE-----\n...\n"
+
+static FirebaseManager *manager;
+static unsigned long lastSync;
+
+// Upload one event and wait for its acknowledgement
+static void uploadAndAck() {
+  EventData event(MOTION, millis());
+  TEST_ASSERT_TRUE(manager->uploadBatch(NULL, &event, 1, lastSync));
+  for (int i = 0; i < 100 && manager->getPendingUploads() > 0; i++) {
+    shimAdvanceMillis(10);
+    manager->loop();
+  }
+  TEST_ASSERT_EQUAL(0, manager->getPendingUploads());
+}
+
+void setUp() {
+  shimSetSerialOutput(false);
+  shimSetMillis(1000);
+  standIn::reset(200);
+  manager = new FirebaseManager("tls.firebaseio.test", "token", TEST_CA);
+  manager->begin();
+}
+
+void tearDown() {
+  delete manager;
+  shimSetSerialOutput(true);
+}
+
+void test_first_request_opens_connection() {
+  TEST_ASSERT_EQUAL_UINT32(0, manager->getHandshakeCount());
+  uploadAndAck();
+  TEST_ASSERT_EQUAL_UINT32(1, manager->getHandshakeCount());
+  TEST_ASSERT_EQUAL_UINT32(0, manager->getReusedCount());
+  TEST_ASSERT_EQUAL_UINT32(0, manager->getDisconnectCount());
+}
+
+void test_requests_reuse_open_connection() {
+  for (int i = 0; i < 10; i++) {
+    uploadAndAck();
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, manager->getHandshakeCount());
+  TEST_ASSERT_EQUAL_UINT32(9, manager->getReusedCount());
+}
+
+void test_link_loss_reconnects_with_full_handshake() {
+  uploadAndAck();
+  uploadAndAck();
+
+  standIn::setLinkUp(false);
+  manager->loop();
+  TEST_ASSERT_EQUAL_UINT32(1, manager->getDisconnectCount());
+
+  standIn::setLinkUp(true);
+  uploadAndAck();
+  uploadAndAck();
+  TEST_ASSERT_EQUAL_UINT32(2, manager->getHandshakeCount());
+  TEST_ASSERT_EQUAL_UINT32(2, manager->getReusedCount());
+  TEST_ASSERT_EQUAL_UINT32(1, manager->getDisconnectCount());
+}
+
+void test_idle_connection_is_not_counted_again() {
+  uploadAndAck();
+  for (int i = 0; i < 100; i++) {
+    shimAdvanceMillis(1000);
+    manager->loop();
+  }
+  uploadAndAck();
+  TEST_ASSERT_EQUAL_UINT32(1, manager->getHandshakeCount());
+  TEST_ASSERT_EQUAL_UINT32(1, manager->getReusedCount());
+}
+
+void test_metrics_report_tls_counters() {
+  uploadAndAck();
+  uploadAndAck();
+  MetricsSnapshot snapshot = {};
+  TEST_ASSERT_TRUE(manager->uploadMetrics(snapshot, "esp32-test"));
+  const std::string &body = standIn::requests().back().body;
+  TEST_ASSERT_TRUE(body.find("\"tls\":{\"handshakes\":1,\"reused\":1,"
+                             "\"disconnects\":0,\"pinned\":true,"
+                             "\"handshake\":{\"n\":1,") !=
+                   std::string::npos);
+}
+
+void test_unpinned_manager_reports_it() {
+  FirebaseManager unpinned("tls.firebaseio.test", "token");
+  unpinned.begin();
+  MetricsSnapshot snapshot = {};
+  TEST_ASSERT_TRUE(unpinned.uploadMetrics(snapshot, "esp32-test"));
+  const std::string &body = standIn::requests().back().body;
+  TEST_ASSERT_TRUE(body.find("\"pinned\":false") != std::string::npos);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_request_opens_connection);
+  RUN_TEST(test_requests_reuse_open_connection);
+  RUN_TEST(test_link_loss_reconnects_with_full_handshake);
+  RUN_TEST(test_idle_connection_is_not_counted_again);
+  RUN_TEST(test_metrics_report_tls_counters);
+  RUN_TEST(test_unpinned_manager_reports_it);
+  return UNITY_END();
+}
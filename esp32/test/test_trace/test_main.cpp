@@ -0,0 +1,107 @@
+// Trace points on the host: scoped timing with the host cycle counter
+// (ns), microsecond values and the per-point histograms
+
+#include <chrono>
+#include <string.h>
+#include <unity.h>
+
+// Trace points on for this file, whatever the build flags say
+#undef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#include "Trace.h"
+
+// Busy-wait so that the scope has a known minimum length
+static void spinUs(int us) {
+  auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+  while (std::chrono::steady_clock::now() < end) {
+  }
+}
+
+void setUp() { traceReset(); }
+
+void tearDown() {}
+
+void test_scope_records_its_lifetime() {
+  {
+    TRACE_SCOPE(TRACE_BUILD_BATCH);
+    spinUs(2000);
+  }
+  LatencyHistogram h = traceHistogram(TRACE_BUILD_BATCH);
+  TEST_ASSERT_EQUAL_UINT32(1, h.getCount());
+  TEST_ASSERT_GREATER_OR_EQUAL(2000 * traceCyclesPerUs(), h.getMax());
+  TEST_ASSERT_LESS_THAN(200000 * traceCyclesPerUs(), h.getMax());
+  TEST_ASSERT_EQUAL_UINT32(0, traceHistogram(TRACE_LCD_UPDATE).getCount());
+}
+
+void test_nested_scopes() {
+  {
+    TRACE_SCOPE(TRACE_FIREBASE_LOOP);
+    for (int i = 0; i < 3; i++) {
+      TRACE_SCOPE(TRACE_DB_UPDATE);
+      spinUs(100);
+    }
+  }
+  LatencyHistogram outer = traceHistogram(TRACE_FIREBASE_LOOP);
+  LatencyHistogram inner = traceHistogram(TRACE_DB_UPDATE);
+  TEST_ASSERT_EQUAL_UINT32(1, outer.getCount());
+  TEST_ASSERT_EQUAL_UINT32(3, inner.getCount());
+  TEST_ASSERT_GREATER_OR_EQUAL(3 * inner.getMean(), outer.getMax());
+}
+
+void test_microsecond_values() {
+  TRACE_VALUE_US(TRACE_QUEUE_RESIDENCY, 1500);
+  TRACE_VALUE_US(TRACE_QUEUE_RESIDENCY, 0);
+  LatencyHistogram h = traceHistogram(TRACE_QUEUE_RESIDENCY);
+  TEST_ASSERT_EQUAL_UINT32(2, h.getCount());
+  TEST_ASSERT_EQUAL_UINT32(1500 * traceCyclesPerUs(), h.getMax());
+
+  // Values beyond the cycle range saturate
+  traceRecordUs(TRACE_QUEUE_RESIDENCY, UINT32_MAX / 2);
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX,
+                           traceHistogram(TRACE_QUEUE_RESIDENCY).getMax());
+}
+
+void test_histogram_is_a_copy() {
+  traceRecord(TRACE_SOUND_READ, 100);
+  LatencyHistogram copy = traceHistogram(TRACE_SOUND_READ);
+  traceRecord(TRACE_SOUND_READ, 100);
+  TEST_ASSERT_EQUAL_UINT32(1, copy.getCount());
+  TEST_ASSERT_EQUAL_UINT32(2, traceHistogram(TRACE_SOUND_READ).getCount());
+}
+
+void test_unknown_point_is_ignored() {
+  traceRecord(TRACE_POINT_COUNT, 100);
+  TEST_ASSERT_EQUAL_UINT32(0, traceHistogram(TRACE_POINT_COUNT).getCount());
+  TEST_ASSERT_EQUAL_STRING("unknown", tracePointName(TRACE_POINT_COUNT));
+}
+
+void test_point_names() {
+  TEST_ASSERT_EQUAL_STRING("sound-read", tracePointName(TRACE_SOUND_READ));
+  TEST_ASSERT_EQUAL_STRING("build-batch", tracePointName(TRACE_BUILD_BATCH));
+  TEST_ASSERT_EQUAL_STRING("lcd-update", tracePointName(TRACE_LCD_UPDATE));
+  for (int p = 0; p < TRACE_POINT_COUNT; p++) {
+    TEST_ASSERT_GREATER_THAN(0, strlen(tracePointName((TracePoint)p)));
+  }
+}
+
+void test_reset_clears_all_points() {
+  for (int p = 0; p < TRACE_POINT_COUNT; p++) {
+    traceRecord((TracePoint)p, 10);
+  }
+  traceReset();
+  for (int p = 0; p < TRACE_POINT_COUNT; p++) {
+    TEST_ASSERT_EQUAL_UINT32(0, traceHistogram((TracePoint)p).getCount());
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_scope_records_its_lifetime);
+  RUN_TEST(test_nested_scopes);
+  RUN_TEST(test_microsecond_values);
+  RUN_TEST(test_histogram_is_a_copy);
+  RUN_TEST(test_unknown_point_is_ignored);
+  RUN_TEST(test_point_names);
+  RUN_TEST(test_reset_clears_all_points);
+  return UNITY_END();
+}
@@ -0,0 +1,248 @@
+// WiFi flapping, run in the firmware on the shim's scheduler: no network,
+// then the primary and the enterprise network coming and going. WiFiManager
+// must cycle primary -> secondary -> backoff on its timeouts without ever
+// holding CloudTask up, and the readings taken meanwhile must keep
+// draining from the sensor ring into the offline log and reach Firebase
+// once a link is back.
+
+#include <Arduino.h>
+#include <FirebaseClient.h>
+#include <WiFi.h>
+#include <esp_sntp.h>
+#include <set>
+#include <unity.h>
+#include <vector>
+
+#include "OfflineLog.h"
+#include "SpscRing.h"
+#include "WiFiManager.h"
+#include "WindowStats.h"
+#include "secrets.h"
+
+// Same as CloudTask.cpp: CloudTask's longest sleep
+#define IDLE_WAIT_MS 40
+
+#define STEP_MS 100
+#define ROUND_TRIP_MS 200
+
+// CloudTask empties the sensor ring on every iteration, so it never holds
+// more than a few records
+#define SENSOR_RING_BOUND 4
+
+// Wall clock reported by SNTP at millis() = 0
+#define EPOCH_MS 1700000000000ULL
+
+// Firmware (src/main.cpp, src/tasks/CloudTask.cpp)
+extern void setup();
+extern WiFiManager wifiManager;
+extern TaskHandle_t cloudTaskHandle;
+extern SpscRing sensorRing;
+extern OfflineLog sensorLog;
+extern uint32_t droppedPacketCount;
+
+// A WiFiManager state and how long it lasted
+struct StateSpan {
+  WiFiState state;
+  unsigned long enteredAt;
+  unsigned long duration;
+};
+
+// What the firmware did over a stretch of time
+struct FlapRun {
+  std::vector<StateSpan> states;
+  uint32_t mostQueued;      // sensor ring fill, highest seen
+  bool logUsed;             // offline log held data at some point
+  bool connectedPrimary;    // a link came up on either network
+  bool connectedSecondary;
+};
+
+// Networks in range; the Firebase link follows them
+static void setNetworks(bool primary, bool secondary) {
+  shimWiFiSetInRange(PRIMARY_WIFI_SSID, primary);
+  shimWiFiSetInRange(SECONDARY_WIFI_SSID, secondary);
+  standIn::setLinkUp(primary || secondary);
+}
+
+// Run for durationMs, sampling the firmware every step
+static void run(FlapRun &flap, unsigned long durationMs) {
+  unsigned long end = millis() + durationMs;
+  while (millis() < end) {
+    shimAdvanceMillis(STEP_MS);
+    WiFiState state = wifiManager.getState();
+    if (flap.states.empty() || flap.states.back().state != state) {
+      if (!flap.states.empty()) {
+        StateSpan &last = flap.states.back();
+        last.duration = millis() - last.enteredAt;
+      }
+      StateSpan span = {state, millis(), 0};
+      flap.states.push_back(span);
+    }
+    if (sensorRing.size() > flap.mostQueued) {
+      flap.mostQueued = sensorRing.size();
+    }
+    if (!sensorLog.isEmpty()) {
+      flap.logUsed = true;
+    }
+    if (wifiManager.isConnected()) {
+      if (wifiManager.isUsingPrimary()) {
+        flap.connectedPrimary = true;
+      } else {
+        flap.connectedSecondary = true;
+      }
+    }
+  }
+}
+
+// Start times (millis()) of the windows acknowledged since request index
+// first, from their light records
+static std::set<unsigned long> uploadedWindows(size_t first) {
+  std::set<unsigned long> windows;
+  const std::vector<StandInRequest> &requests = standIn::requests();
+  for (size_t i = first; i < requests.size(); i++) {
+    if (requests[i].errorCode != 0 || requests[i].answeredAt == 0) {
+      continue;
+    }
+    const char *cursor = requests[i].body.c_str();
+    while ((cursor = strstr(cursor, "\"/sensors/light/")) != NULL) {
+      const char *stamp = strstr(cursor, "\"timestamp\":");
+      TEST_ASSERT_NOT_NULL(stamp);
+      uint64_t epochMs =
+          strtoull(stamp + strlen("\"timestamp\":"), NULL, 10);
+      windows.insert((unsigned long)(epochMs - EPOCH_MS));
+      cursor = stamp;
+    }
+  }
+  return windows;
+}
+
+// CloudTask never slept longer than its idle wait: no WiFi call blocked it
+static void assertCloudTaskNeverBlocked() {
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(IDLE_WAIT_MS,
+                                   shimLongestBlockMs(cloudTaskHandle));
+}
+
+void setUp() { shimSetSerialOutput(false); }
+
+void tearDown() { shimSetSerialOutput(true); }
+
+void test_no_network_cycles_primary_secondary_backoff() {
+  setNetworks(false, false);
+  uint32_t attempts = shimWiFiAttempts();
+  FlapRun flap = {};
+  run(flap, 300000);
+
+  // Whole spans only: from the first primary attempt entered while
+  // sampling to the last state
+  size_t first = 1;
+  unsigned long backoffBound = WIFI_BACKOFF_MIN_MS;
+  while (flap.states[first].state != WIFI_CONNECTING_PRIMARY) {
+    if (flap.states[first].state == WIFI_BACKOFF) {
+      backoffBound *= 2;
+    }
+    first++;
+  }
+  int rounds = 0;
+  for (size_t i = first; i + 1 < flap.states.size(); i++) {
+    const StateSpan &span = flap.states[i];
+    WiFiState next = flap.states[i + 1].state;
+    switch (span.state) {
+    case WIFI_CONNECTING_PRIMARY:
+      TEST_ASSERT_EQUAL(WIFI_CONNECTING_SECONDARY, next);
+      TEST_ASSERT_UINT32_WITHIN(STEP_MS, WIFI_PRIMARY_TIMEOUT_MS,
+                                span.duration);
+      break;
+    case WIFI_CONNECTING_SECONDARY:
+      TEST_ASSERT_EQUAL(WIFI_BACKOFF, next);
+      TEST_ASSERT_UINT32_WITHIN(STEP_MS, WIFI_SECONDARY_TIMEOUT_MS,
+                                span.duration);
+      break;
+    case WIFI_BACKOFF:
+      // Equal jitter: half to all of a delay doubling per round
+      TEST_ASSERT_EQUAL(WIFI_CONNECTING_PRIMARY, next);
+      TEST_ASSERT_GREATER_OR_EQUAL_UINT32(backoffBound / 2 - STEP_MS,
+                                          span.duration);
+      TEST_ASSERT_LESS_OR_EQUAL_UINT32(backoffBound + STEP_MS,
+                                       span.duration);
+      backoffBound = backoffBound * 2 < WIFI_BACKOFF_MAX_MS
+                         ? backoffBound * 2
+                         : WIFI_BACKOFF_MAX_MS;
+      rounds++;
+      break;
+    default:
+      TEST_FAIL_MESSAGE("unexpected WiFi state");
+    }
+  }
+  ::printf("%d rounds of primary/secondary/backoff in 300 s, %u joins\n",
+           rounds, shimWiFiAttempts() - attempts);
+  TEST_ASSERT_GREATER_OR_EQUAL(5, rounds);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(2 * rounds,
+                                      shimWiFiAttempts() - attempts);
+
+  // Readings kept flowing from the ring to flash the whole time
+  assertCloudTaskNeverBlocked();
+  TEST_ASSERT_TRUE(flap.logUsed);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(SENSOR_RING_BOUND, flap.mostQueued);
+  TEST_ASSERT_EQUAL_UINT32(0, droppedPacketCount);
+}
+
+void test_flapping_links_lose_no_window() {
+  // Primary up and down, the enterprise network covering some outages,
+  // then the primary back for good to drain the offline log
+  size_t firstRequest = standIn::requests().size();
+  unsigned long start = millis();
+  FlapRun flap = {};
+  for (int i = 0; i < 6; i++) {
+    setNetworks(true, false);
+    run(flap, 45000);
+    setNetworks(false, i % 2 == 1);
+    run(flap, 75000);
+  }
+  unsigned long flapEnd = millis();
+  setNetworks(true, false);
+  run(flap, 600000);
+
+  TEST_ASSERT_TRUE(flap.connectedPrimary);
+  TEST_ASSERT_TRUE(flap.connectedSecondary);
+  TEST_ASSERT_TRUE(flap.logUsed);
+  TEST_ASSERT_TRUE(sensorLog.isEmpty());
+  assertCloudTaskNeverBlocked();
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(SENSOR_RING_BOUND, flap.mostQueued);
+  TEST_ASSERT_EQUAL_UINT32(0, droppedPacketCount);
+
+  // Every window of the flapping period reached Firebase, live or from
+  // the offline log: their starts are one window apart throughout
+  std::set<unsigned long> windows = uploadedWindows(firstRequest);
+  unsigned long previous = 0;
+  int count = 0;
+  for (unsigned long window : windows) {
+    if (window < start || window >= flapEnd) {
+      continue;
+    }
+    if (previous != 0) {
+      TEST_ASSERT_EQUAL_UINT32_MESSAGE(SUMMARY_WINDOW_MS, window - previous,
+                                       "window lost");
+    }
+    previous = window;
+    count++;
+  }
+  ::printf("%d windows over %lu s of flapping, all uploaded\n", count,
+           (flapEnd - start) / 1000);
+  TEST_ASSERT_GREATER_OR_EQUAL((flapEnd - start) / SUMMARY_WINDOW_MS - 1,
+                               count);
+}
+
+int main(int argc, char **argv) {
+  // Boot the firmware once, without a network; the clock is synced
+  shimSetSerialOutput(false);
+  standIn::reset(ROUND_TRIP_MS);
+  setNetworks(false, false);
+  shimStartScheduling();
+  setup();
+  shimAdvanceMillis(1000);
+  shimSntpSync(EPOCH_MS + millis());
+
+  UNITY_BEGIN();
+  RUN_TEST(test_no_network_cycles_primary_secondary_backoff);
+  RUN_TEST(test_flapping_links_lose_no_window);
+  return UNITY_END();
+}
@@ -0,0 +1,327 @@
+#include <Arduino.h>
+#include <algorithm>
+#include <math.h>
+#include <unity.h>
+#include <vector>
+
+#include "ReadingBuffer.h"
+#include "StreamingStats.h"
+#include "WindowStats.h"
+
+#define WINDOW_MS 60000
+
+static uint32_t seed;
+
+// Deterministic uniform sample in [0, 1)
+static float uniform() {
+  seed = seed * 1664525 + 1013904223;
+  return (seed >> 8) / 16777216.0f;
+}
+
+// Deterministic standard normal sample (Box-Muller)
+static float normal() {
+  float u = uniform() + 1e-7f;
+  return sqrtf(-2.0f * logf(u)) * cosf(6.28318530718f * uniform());
+}
+
+// Fraction of samples below value (where value ranks in the data)
+static float rankOf(const std::vector<float> &sorted, float value) {
+  return (float)(std::lower_bound(sorted.begin(), sorted.end(), value) -
+                 sorted.begin()) /
+         sorted.size();
+}
+
+// Check a P² estimate ranks within tolerance of p in samples
+static void checkQuantile(std::vector<float> samples, float p,
+                          float tolerance) {
+  P2Quantile quantile(p);
+  for (float x : samples) {
+    quantile.add(x);
+  }
+  std::sort(samples.begin(), samples.end());
+  TEST_ASSERT_FLOAT_WITHIN(tolerance, p, rankOf(samples, quantile.value()));
+}
+
+// A reading at time (uptime ms)
+static SensorRecord reading(unsigned long time, uint16_t light) {
+  SensorData data;
+  data.lightValue = light;
+  data.gasValue = 500;
+  data.soundRms = 100;
+  data.analogSampled = (1 << ANALOG_LIGHT) | (1 << ANALOG_GAS) |
+                       (1 << ANALOG_SOUND);
+  data.setTemperature(21.5f);
+  data.temperatureValid = 1;
+  data.timestamp = time;
+  SensorRecord record;
+  makeRecord(data, record);
+  return record;
+}
+
+void setUp() { seed = 42; }
+
+void tearDown() {}
+
+void test_running_stats_match_two_pass() {
+  std::vector<float> samples;
+  RunningStats stats;
+  for (int i = 0; i < 10000; i++) {
+    float x = 2000.0f + 50.0f * normal();
+    samples.push_back(x);
+    stats.add(x);
+  }
+
+  double mean = 0;
+  for (float x : samples) {
+    mean += x;
+  }
+  mean /= samples.size();
+  double m2 = 0;
+  for (float x : samples) {
+    m2 += (x - mean) * (x - mean);
+  }
+  double variance = m2 / (samples.size() - 1);
+
+  TEST_ASSERT_EQUAL(10000, stats.count());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, mean, stats.mean());
+  TEST_ASSERT_FLOAT_WITHIN(variance * 1e-3, variance, stats.variance());
+  TEST_ASSERT_EQUAL_FLOAT(*std::min_element(samples.begin(), samples.end()),
+                          stats.min());
+  TEST_ASSERT_EQUAL_FLOAT(*std::max_element(samples.begin(), samples.end()),
+                          stats.max());
+}
+
+void test_running_stats_edge_cases() {
+  RunningStats stats;
+  TEST_ASSERT_EQUAL(0, stats.count());
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.variance());
+
+  stats.add(7);
+  TEST_ASSERT_EQUAL_FLOAT(7, stats.mean());
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.variance());
+
+  // Descending samples update the minimum
+  stats.add(5);
+  stats.add(3);
+  TEST_ASSERT_EQUAL_FLOAT(3, stats.min());
+  TEST_ASSERT_EQUAL_FLOAT(7, stats.max());
+  TEST_ASSERT_EQUAL_FLOAT(4, stats.variance());
+
+  stats.reset();
+  TEST_ASSERT_EQUAL(0, stats.count());
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.mean());
+}
+
+void test_running_stats_merged() {
+  // 10 at 4, then 10 merged at mean 8: the spread within the merged group
+  // is lost, the spread between the groups is kept
+  RunningStats stats;
+  for (int i = 0; i < 10; i++) {
+    stats.add(4);
+  }
+  stats.addMerged(8, 6, 10, 10);
+  TEST_ASSERT_EQUAL(20, stats.count());
+  TEST_ASSERT_EQUAL_FLOAT(6, stats.mean());
+  TEST_ASSERT_EQUAL_FLOAT(4, stats.min());
+  TEST_ASSERT_EQUAL_FLOAT(10, stats.max());
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 80.0f / 19, stats.variance());
+
+  // Merged first, and an empty group
+  RunningStats merged;
+  merged.addMerged(3, 1, 5, 4);
+  merged.addMerged(100, 0, 200, 0);
+  TEST_ASSERT_EQUAL(4, merged.count());
+  TEST_ASSERT_EQUAL_FLOAT(3, merged.mean());
+  TEST_ASSERT_EQUAL_FLOAT(1, merged.min());
+  TEST_ASSERT_EQUAL_FLOAT(5, merged.max());
+}
+
+void test_p2_exact_below_five_samples() {
+  P2Quantile median(0.5f);
+  TEST_ASSERT_EQUAL_FLOAT(0, median.value());
+  median.add(9);
+  TEST_ASSERT_EQUAL_FLOAT(9, median.value());
+  median.add(1);
+  median.add(5);
+  TEST_ASSERT_EQUAL_FLOAT(5, median.value());
+  median.add(7);
+  TEST_ASSERT_EQUAL_FLOAT(5, median.value()); // nearest rank of 4
+
+  P2Quantile p90(0.9f);
+  for (float x : {3.0f, 1.0f, 4.0f, 2.0f}) {
+    p90.add(x);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(4, p90.value());
+
+  median.reset();
+  TEST_ASSERT_EQUAL_FLOAT(0, median.value());
+}
+
+void test_p2_accuracy_long_streams() {
+  // Rank error of the estimates on 10000 samples of different shapes
+  const float ps[] = {0.5f, 0.9f};
+  for (float p : ps) {
+    std::vector<float> uniformSamples, normalSamples, skewedSamples;
+    for (int i = 0; i < 10000; i++) {
+      uniformSamples.push_back(4095 * uniform());
+      normalSamples.push_back(1500 + 80 * normal());
+      skewedSamples.push_back(-200 * logf(uniform() + 1e-7f));
+    }
+    checkQuantile(uniformSamples, p, 0.01f);
+    checkQuantile(normalSamples, p, 0.01f);
+    checkQuantile(skewedSamples, p, 0.01f);
+  }
+}
+
+void test_p2_accuracy_one_minute_window() {
+  // A window of 60 one-second readings
+  for (int trial = 0; trial < 20; trial++) {
+    std::vector<float> samples;
+    for (int i = 0; i < 60; i++) {
+      samples.push_back(1500 + 80 * normal());
+    }
+    checkQuantile(samples, 0.5f, 0.1f);
+    checkQuantile(samples, 0.9f, 0.1f);
+  }
+}
+
+void test_p2_sorted_input() {
+  // Monotonic input (a sensor ramping up) still tracks the quantile
+  std::vector<float> ramp;
+  for (int i = 0; i < 1000; i++) {
+    ramp.push_back(i);
+  }
+  checkQuantile(ramp, 0.5f, 0.02f);
+  checkQuantile(ramp, 0.9f, 0.02f);
+}
+
+void test_channel_stats_summary() {
+  ChannelStats stats;
+  for (int i = 1; i <= 100; i++) {
+    stats.add(i);
+  }
+  stats.addMerged(50, 40, 60, 10);
+
+  ChannelSummary summary;
+  stats.summarize(summary);
+  TEST_ASSERT_EQUAL(110, summary.count);
+  TEST_ASSERT_EQUAL_FLOAT(1, summary.min);
+  TEST_ASSERT_EQUAL_FLOAT(100, summary.max);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, (5050.0f + 500) / 110, summary.mean);
+  TEST_ASSERT_FLOAT_WITHIN(3, 50, summary.p50);
+  TEST_ASSERT_FLOAT_WITHIN(3, 89, summary.p90);
+  TEST_ASSERT_GREATER_THAN(20, summary.stddev);
+
+  stats.reset();
+  stats.summarize(summary);
+  TEST_ASSERT_EQUAL(0, summary.count);
+}
+
+void test_windows_aligned_on_uptime() {
+  WindowAggregator aggregator(WINDOW_MS);
+  WindowSummary summary;
+
+  // Readings every second from 30 s of uptime: the first window is
+  // [0, 60 s) and holds 30 of them
+  for (unsigned long t = 30000; t < 60000; t += 1000) {
+    TEST_ASSERT_FALSE(aggregator.add(reading(t, t / 1000), summary));
+  }
+  TEST_ASSERT_EQUAL(30, aggregator.getReadingCount());
+  TEST_ASSERT_TRUE(aggregator.add(reading(60000, 60), summary));
+
+  TEST_ASSERT_EQUAL(0, summary.windowStartEpochMs);
+  TEST_ASSERT_EQUAL_UINT32(0, summary.windowStart);
+  TEST_ASSERT_EQUAL(30, summary.readingCount);
+  const ChannelSummary &light = summary.channels[WINDOW_LIGHT];
+  TEST_ASSERT_EQUAL(30, light.count);
+  TEST_ASSERT_EQUAL_FLOAT(30, light.min);
+  TEST_ASSERT_EQUAL_FLOAT(59, light.max);
+  TEST_ASSERT_EQUAL_FLOAT(44.5f, light.mean);
+  TEST_ASSERT_EQUAL_FLOAT(21.5f, summary.channels[WINDOW_TEMPERATURE].mean);
+  TEST_ASSERT_EQUAL(100, summary.soundRms);
+
+  // Channels that were not sampled have no statistics
+  TEST_ASSERT_EQUAL(0, summary.channels[WINDOW_FLAME].count);
+  TEST_ASSERT_EQUAL(0, summary.channels[WINDOW_HUMIDITY].count);
+
+  // The reading that closed the window opened the next one
+  TEST_ASSERT_EQUAL(1, aggregator.getReadingCount());
+}
+
+void test_windows_aligned_on_wall_clock() {
+  WindowAggregator aggregator(WINDOW_MS);
+  WindowSummary summary;
+  const uint64_t epoch = 1759999980000ULL; // a multiple of the window
+  const unsigned long uptime = 12345;
+
+  aggregator.setClock(epoch + 59000, uptime);
+  aggregator.add(reading(uptime, 1), summary);
+  TEST_ASSERT_TRUE(aggregator.add(reading(uptime + 1000, 2), summary));
+  TEST_ASSERT_EQUAL_UINT64(epoch, summary.windowStartEpochMs);
+  TEST_ASSERT_EQUAL_UINT32(uptime - 59000, summary.windowStart);
+  TEST_ASSERT_EQUAL(1, summary.readingCount);
+}
+
+void test_clock_sync_closes_window() {
+  // The first synced reading closes the uptime-aligned window
+  WindowAggregator aggregator(WINDOW_MS);
+  WindowSummary summary;
+  aggregator.add(reading(1000, 1), summary);
+  aggregator.add(reading(2000, 2), summary);
+  aggregator.setClock(1760000003000ULL, 3000);
+  TEST_ASSERT_TRUE(aggregator.add(reading(3000, 3), summary));
+  TEST_ASSERT_EQUAL(0, summary.windowStartEpochMs);
+  TEST_ASSERT_EQUAL(2, summary.readingCount);
+}
+
+void test_close_if_due_after_grace() {
+  WindowAggregator aggregator(WINDOW_MS);
+  WindowSummary summary;
+  TEST_ASSERT_FALSE(aggregator.closeIfDue(100000, summary)); // nothing open
+
+  aggregator.add(reading(10000, 5), summary);
+  TEST_ASSERT_FALSE(aggregator.closeIfDue(WINDOW_MS, summary));
+  TEST_ASSERT_FALSE(
+      aggregator.closeIfDue(WINDOW_MS + WINDOW_CLOSE_GRACE_MS - 1, summary));
+  TEST_ASSERT_TRUE(
+      aggregator.closeIfDue(WINDOW_MS + WINDOW_CLOSE_GRACE_MS, summary));
+  TEST_ASSERT_EQUAL(1, summary.readingCount);
+  TEST_ASSERT_EQUAL(0, aggregator.getReadingCount());
+  TEST_ASSERT_FALSE(
+      aggregator.closeIfDue(WINDOW_MS + WINDOW_CLOSE_GRACE_MS, summary));
+}
+
+void test_merged_record_counts_all_readings() {
+  WindowAggregator aggregator(WINDOW_MS);
+  WindowSummary summary;
+  SensorRecord merged = reading(1000, 10);
+  SensorRecord next = reading(2000, 30);
+  mergeRecords(merged, next);
+  aggregator.add(merged, summary);
+  aggregator.closeIfDue(WINDOW_MS + WINDOW_CLOSE_GRACE_MS, summary);
+
+  TEST_ASSERT_EQUAL(2, summary.readingCount);
+  const ChannelSummary &light = summary.channels[WINDOW_LIGHT];
+  TEST_ASSERT_EQUAL(2, light.count);
+  TEST_ASSERT_EQUAL_FLOAT(20, light.mean);
+  TEST_ASSERT_EQUAL_FLOAT(10, light.min);
+  TEST_ASSERT_EQUAL_FLOAT(30, light.max);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_running_stats_match_two_pass);
+  RUN_TEST(test_running_stats_edge_cases);
+  RUN_TEST(test_running_stats_merged);
+  RUN_TEST(test_p2_exact_below_five_samples);
+  RUN_TEST(test_p2_accuracy_long_streams);
+  RUN_TEST(test_p2_accuracy_one_minute_window);
+  RUN_TEST(test_p2_sorted_input);
+  RUN_TEST(test_channel_stats_summary);
+  RUN_TEST(test_windows_aligned_on_uptime);
+  RUN_TEST(test_windows_aligned_on_wall_clock);
+  RUN_TEST(test_clock_sync_closes_window);
+  RUN_TEST(test_close_if_due_after_grace);
+  RUN_TEST(test_merged_record_counts_all_readings);
+  return UNITY_END();
+}
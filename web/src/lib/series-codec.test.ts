@@ -0,0 +1,78 @@
+// Decoder tests against blocks produced by the ESP32 encoder (the golden
+// record of esp32/test/test_series_codec). Run with: npm test
+import assert from "node:assert/strict";
+import { test } from "node:test";
+
+import { decodeRawBlock, decodeSeries, type RawBlock } from "./series-codec";
+
+const GOLDEN_EPOCH_MS = 1760000060000;
+
+// Golden block: ten readings, sound sampled every other reading and no
+// DHT values for readings 3 and 4
+const golden: RawBlock = {
+  n: 10,
+  t: "ANAPAAAAABozGgA=",
+  light: "oB8GAAAAAAAAAAA=",
+  gas: "iA4BAAYFAAYFAAY=",
+  flame: "/j8AAAAAAAAAAAA=",
+  "soil-moisture": "uBcAAAAAAFBPAAA=",
+  sound: "kBxkAAAA",
+  temperature: "HQIABAMAAAA=",
+  humidity: "wAcCAAQDAAAA",
+  present: { sound: "VQE=", temperature: "5wM=", humidity: "5wM=" },
+  timestamp: GOLDEN_EPOCH_MS,
+};
+
+// Capture times of the golden readings (ms after the first)
+const offsets = [0, 1000, 2000, 3000, 4000, 5000, 6013, 7000, 8000, 9000];
+
+test("decodes the golden block", () => {
+  const readings = decodeRawBlock(golden);
+  assert.equal(readings.length, 10);
+
+  readings.forEach((reading, i) => {
+    const dhtFailed = i === 3 || i === 4;
+    assert.deepEqual(reading, {
+      timestamp: GOLDEN_EPOCH_MS + offsets[i],
+      light: 2000 + i * 3,
+      gas: 900 - (i % 3),
+      flame: 4095,
+      soilMoisture: 1500 + (i > 5 ? 40 : 0),
+      sound: i % 2 === 0 ? 1800 + i * 25 : null,
+      temperature: dhtFailed ? null : (-15 + i) / 10,
+      humidity: dhtFailed ? null : (480 + i) / 10,
+    });
+  });
+});
+
+test("anchors unsynced blocks on the last reading", () => {
+  const serverTime = 1760000123456;
+  const readings = decodeRawBlock({
+    ...golden,
+    t: "z4wB0A8AAAAAGjMaAA==",
+    anchor: "last",
+    timestamp: serverTime,
+  });
+
+  assert.equal(readings[9].timestamp, serverTime);
+  readings.forEach((reading, i) => {
+    assert.equal(reading.timestamp, serverTime - 9000 + offsets[i]);
+  });
+});
+
+test("wraps like the device", () => {
+  // INT32_MAX, INT32_MIN, -1, 0: the deltas overflow int32 and wrap
+  const bytes = [
+    [0xfe, 0xff, 0xff, 0xff, 0x0f],
+    [0x02],
+    [0xfc, 0xff, 0xff, 0xff, 0x0f],
+    [0xfb, 0xff, 0xff, 0xff, 0x0f],
+  ].flat();
+  const encoded = btoa(String.fromCharCode(...bytes));
+  assert.deepEqual(decodeSeries(encoded), [2147483647, -2147483648, -1, 0]);
+});
+
+test("rejects truncated varints", () => {
+  assert.throws(() => decodeSeries(btoa("\x02\x80")), /truncated varint/);
+  assert.throws(() => decodeSeries(btoa("\x80\x80\x80\x80\x80\x01")));
+});
@@ -0,0 +1,138 @@
+// Decoder for the raw time-series blocks uploaded by the ESP32 in raw mode
+// (see esp32/lib/SeriesCodec). Each series is base64 of zigzag LEB128
+// varints: first value, first delta, then delta-of-delta. Arithmetic wraps
+// modulo 2^32 like on the device.
+
+// Value channels of a raw block
+export type RawChannel =
+  | "light"
+  | "gas"
+  | "flame"
+  | "soil-moisture"
+  | "sound"
+  | "temperature" // tenths of °C
+  | "humidity"; // tenths of %RH
+
+// Raw block record stored under /sensors/raw/<push-id>. A channel series
+// holds only the samples that were taken; a channel with gaps has a
+// presence bitmap (base64, bit i of byte i / 8 set if reading i has one).
+export type RawBlock = {
+  timestamp: number; // epoch ms of the first reading (the last if anchored)
+  n: number; // number of readings
+  t: string; // capture time offsets from timestamp (ms)
+
+  // "last": the device clock was not synced, timestamp is the server time
+  // of the write and stands in for the last reading (t counts back to it)
+  anchor?: "last";
+  present?: Partial<Record<RawChannel, string>>;
+} & Record<RawChannel, string>;
+
+// One decoded reading (null: sensor was not sampled or had no valid value)
+export interface RawReading {
+  timestamp: number;
+  light: number | null;
+  gas: number | null;
+  flame: number | null;
+  soilMoisture: number | null;
+  sound: number | null;
+  temperature: number | null;
+  humidity: number | null;
+}
+
+// Convert base64 to bytes (works in the browser and in Node)
+function base64ToBytes(encoded: string): Uint8Array {
+  const binary = atob(encoded);
+  const bytes = new Uint8Array(binary.length);
+  for (let i = 0; i < binary.length; i++) {
+    bytes[i] = binary.charCodeAt(i);
+  }
+  return bytes;
+}
+
+// Decode one delta-of-delta series
+export function decodeSeries(encoded: string): number[] {
+  const bytes = base64ToBytes(encoded);
+  const values: number[] = [];
+  let position = 0;
+  let previous = 0;
+  let previousDelta = 0;
+
+  while (position < bytes.length) {
+    // Zigzag varint (at most 5 bytes for 32 bits)
+    let zigzag = 0;
+    let shift = 0;
+    let byte: number;
+    do {
+      if (position >= bytes.length || shift >= 35) {
+        throw new Error("Malformed series: truncated varint");
+      }
+      byte = bytes[position++];
+      zigzag += (byte & 0x7f) * 2 ** shift;
+      shift += 7;
+    } while (byte & 0x80);
+    zigzag = zigzag >>> 0;
+    const decoded = (zigzag >>> 1) ^ -(zigzag & 1);
+
+    let value: number;
+    if (values.length === 0) {
+      value = decoded;
+    } else {
+      const delta =
+        values.length === 1 ? decoded : (previousDelta + decoded) | 0;
+      value = (previous + delta) | 0;
+      previousDelta = delta;
+    }
+    previous = value;
+    values.push(value);
+  }
+
+  return values;
+}
+
+// Decode one channel of a block into n values (null where not sampled)
+function decodeChannel(
+  block: RawBlock,
+  channel: RawChannel,
+): (number | null)[] {
+  const samples = decodeSeries(block[channel]);
+  const bitmap = block.present?.[channel];
+  const present = bitmap === undefined ? null : base64ToBytes(bitmap);
+
+  const values: (number | null)[] = [];
+  let next = 0;
+  for (let i = 0; i < block.n; i++) {
+    const has = present === null || (present[i >> 3] & (1 << (i & 7))) !== 0;
+    values.push(has && next < samples.length ? samples[next++] : null);
+  }
+  return values;
+}
+
+// Decode a whole raw block into readings
+export function decodeRawBlock(block: RawBlock): RawReading[] {
+  const offsets = decodeSeries(block.t);
+  const light = decodeChannel(block, "light");
+  const gas = decodeChannel(block, "gas");
+  const flame = decodeChannel(block, "flame");
+  const soil = decodeChannel(block, "soil-moisture");
+  const sound = decodeChannel(block, "sound");
+  const temperature = decodeChannel(block, "temperature");
+  const humidity = decodeChannel(block, "humidity");
+
+  const tenths = (value: number | null) =>
+    value === null ? null : value / 10;
+
+  const readings: RawReading[] = [];
+  for (let i = 0; i < block.n && i < offsets.length; i++) {
+    readings.push({
+      timestamp: block.timestamp + offsets[i],
+      light: light[i],
+      gas: gas[i],
+      flame: flame[i],
+      soilMoisture: soil[i],
+      sound: sound[i],
+      temperature: tenths(temperature[i]),
+      humidity: tenths(humidity[i]),
+    });
+  }
+  return readings;
+}